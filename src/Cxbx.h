@@ -48,6 +48,8 @@ typedef uint32_t xbaddr;
 #define _DEBUG_TRACK_VS_CONST
 /*! define this to print current configuration at kernel startup */
 #define _DEBUG_PRINT_CURRENT_CONF
+/*! define this to also write the output of the software audio mixer to a wav file */
+//#define _DEBUG_DSOUND_MIXER_WAV "D:\\cxbx\\mixer.wav"
 
 /*! define this to dump textures that have been set */
 //#define _DEBUG_DUMP_TEXTURE_SETTEXTURE "D:\\xbox\\_textures\\"
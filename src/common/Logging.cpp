@@ -26,6 +26,13 @@
 // ******************************************************************
 
 #include <windows.h> // for PULONG
+#include <io.h> // for _dup and _write
+#include <fcntl.h> // for _O_BINARY
+#include <cstdarg> // for va_list
+#include <algorithm> // for std::stable_sort
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "Logging.h"
 #include "common\Settings.hpp"
@@ -96,6 +103,7 @@ const char* g_EnumModules2String[to_underlying(CXBXR_MODULE::MAX)] = {
 	"XE      ",
 };
 std::atomic_int g_CurrentLogLevel = to_underlying(LOG_LEVEL::INFO);
+std::atomic_uint g_ModuleLogMask[to_underlying(CXBXR_MODULE::MAX)] = { 0 };
 
 // Set up the logging variables for the GUI process
 inline void log_get_settings()
@@ -114,17 +122,452 @@ inline void log_sync_config()
 
 void log_set_config(int LogLevel, unsigned int* LoggedModules)
 {
+	unsigned int LevelMask = 0;
+	for (int level = LogLevel; level < to_underlying(LOG_LEVEL::MAX); level++) {
+		LevelMask |= 1 << level;
+	}
+
 	g_CurrentLogLevel = LogLevel;
 	for (unsigned int index = to_underlying(CXBXR_MODULE::CXBXR); index < to_underlying(CXBXR_MODULE::MAX); index++) {
 		if (LoggedModules[index / 32] & (1 << (index % 32))) {
 			g_EnabledModules[index] = true;
+			g_ModuleLogMask[index] = LevelMask;
 		}
 		else {
 			g_EnabledModules[index] = false;
+			g_ModuleLogMask[index] = 0;
 		}
 	}
 }
 
+// A ring of records written by a single thread and read by the writer thread
+typedef struct _LogRing {
+	std::atomic_uint32_t Head;    // index of the next record the owning thread will commit
+	std::atomic_uint32_t Tail;    // index of the next record the writer thread will read
+	std::atomic_uint32_t Dropped; // records discarded since the writer last reported it
+	std::atomic_bool Retired;     // set when the owning thread exits
+	uint32_t ThreadId;
+	LogRecord Scratch;            // filled (and then discarded) instead of a record when the ring is full
+	LogRecord Records[LOG_ASYNC_RING_RECORDS];
+}LogRing;
+
+// Releases the ring of a thread to the writer thread when the thread exits
+struct LogRingOwner {
+	LogRing* Ring = nullptr;
+	~LogRingOwner() {
+		if (Ring != nullptr) {
+			Ring->Retired = true;
+		}
+	}
+};
+
+std::atomic_bool g_LogAsync;
+
+static thread_local LogRingOwner t_LogRing;
+// All the rings that could still contain records, only accessed under LogRingsMtx
+static std::vector<LogRing*> LogRings;
+static std::mutex LogRingsMtx;
+static std::atomic_int LogOverflowPolicy = to_underlying(LOG_OVERFLOW_POLICY::DROP);
+// Incremented by the writer thread each time it finds all rings empty, used by log_async_flush
+static std::atomic_uint32_t LogWriterIdlePasses;
+// Set by the writer thread before it looks for records, so that a commit after that wakes it up
+static std::atomic_bool LogWriterWaiting;
+static HANDLE LogWriterEvent;
+// Where the writer thread writes to, this was stdout before log_async_start took it over
+static int LogOutputFd = -1;
+
+// The text a thread has written to std::cout, up to the end of the last line
+static thread_local std::string t_LogAsyncLine;
+
+// Replaces the buffer of std::cout while logging asynchronously, so that the lines written to it become TEXT records
+class LogAsyncStreambuf : public std::streambuf {
+protected:
+	int_type overflow(int_type c) override {
+		if (c != traits_type::eof()) {
+			char ch = traits_type::to_char_type(c);
+			xsputn(&ch, 1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize n) override {
+		t_LogAsyncLine.append(s, (size_t)n);
+		size_t end = t_LogAsyncLine.rfind('\n');
+		if (end != std::string::npos) {
+			log_async_text(t_LogAsyncLine.data(), end + 1);
+			t_LogAsyncLine.erase(0, end + 1);
+		}
+		return n;
+	}
+
+	int sync() override {
+		if (!t_LogAsyncLine.empty()) {
+			log_async_text(t_LogAsyncLine.data(), t_LogAsyncLine.length());
+			t_LogAsyncLine.clear();
+		}
+		return 0;
+	}
+};
+
+static LogAsyncStreambuf LogAsyncCoutBuf;
+
+void log_async_render_pointer(std::ostream& os, const LogRecord& record, const LogRecordArg& arg)
+{
+	os << hex4((uint32_t)arg.Value);
+}
+
+void log_async_render_truncated(std::ostream& os, const LogRecord& record, const LogRecordArg& arg)
+{
+	os << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(16) << arg.Value << std::dec << "...";
+}
+
+// The copy of a string argument is described by the upper half of its value, as an offset and a length into Text
+static void log_async_render_copy(std::ostream& os, const LogRecord& record, const LogRecordArg& arg, const char* type)
+{
+	uint32_t offset = (uint32_t)(arg.Value >> 48);
+	uint32_t length = (uint32_t)(arg.Value >> 32) & 0xFFFF;
+
+	os << type << hex4((uint32_t)arg.Value) << " = \"";
+	for (uint32_t i = 0; i < length && record.Text[offset + i] != '\0'; i++) {
+		output_char(os, record.Text[offset + i]);
+	}
+	os << "\"";
+	// The nul terminator is copied along, its absence means the string was cut off
+	if (length == 0 || record.Text[offset + length - 1] != '\0') {
+		os << "...";
+	}
+}
+
+static void log_async_render_string(std::ostream& os, const LogRecord& record, const LogRecordArg& arg)
+{
+	log_async_render_copy(os, record, arg, "(char *)");
+}
+
+static void log_async_render_wstring(std::ostream& os, const LogRecord& record, const LogRecordArg& arg)
+{
+	log_async_render_copy(os, record, arg, "(wchar *)");
+}
+
+template<class C>
+static void log_async_copy(LogRecord* record, LogRecordArg& arg, const C* str)
+{
+	uint32_t offset = record->TextLength;
+	uint32_t length = 0;
+
+	// Copy up to and including the nul terminator, rendering unicode as ANSI like the synchronous path does
+	while (offset + length < LOG_ASYNC_RECORD_TEXT) {
+		C c = str[length];
+		record->Text[offset + length++] = (c <= 0xFF) ? (char)c : '?';
+		if (c == 0) {
+			break;
+		}
+	}
+
+	record->TextLength = (uint16_t)(offset + length);
+	arg.Value |= ((uint64_t)offset << 48) | ((uint64_t)length << 32);
+}
+
+void log_async_copy_string(LogRecord* record, LogRecordArg& arg, const char* str)
+{
+	log_async_copy(record, arg, (const unsigned char*)str);
+	arg.Render = log_async_render_string;
+}
+
+void log_async_copy_wstring(LogRecord* record, LogRecordArg& arg, const wchar_t* str)
+{
+	log_async_copy(record, arg, str);
+	arg.Render = log_async_render_wstring;
+}
+
+static void log_async_render(std::ostringstream& out, const LogRecord& record)
+{
+	if (record.Kind == LOG_RECORD_KIND::TEXT) {
+		out.write(record.Text, record.TextLength);
+		return;
+	}
+
+	char buffer[16];
+
+	// Start each record with the formatting of a fresh stream, like the synchronous path does
+	out.flags(std::ios_base::dec | std::ios_base::skipws);
+	out.fill(' ');
+
+	snprintf(buffer, sizeof(buffer), "[0x%.4X] ", record.ThreadId);
+	out << buffer;
+	out << g_EnumModules2String[to_underlying(record.Module)];
+	out << remove_emupatch_prefix(record.Function);
+
+	if (record.Kind == LOG_RECORD_KIND::RESULT) {
+		out << " returns ";
+	}
+	else {
+		out << "(";
+	}
+
+	for (unsigned i = 0; i < record.ArgCount; i++) {
+		const LogRecordArg& arg = record.Args[i];
+		if (record.Kind == LOG_RECORD_KIND::CALL) {
+			if (arg.Out) {
+				out << LOG_ARG_OUT_START << arg.Name << " : ";
+			}
+			else {
+				out << LOG_ARG_START << arg.Name << " : ";
+			}
+		}
+
+		arg.Render(out, record, arg);
+	}
+
+	if (record.Kind == LOG_RECORD_KIND::RESULT) {
+		out << "\n";
+	}
+	else {
+		out << ((record.ArgCount > 0) ? "\n);\n" : ");\n");
+	}
+}
+
+// Collects the records of all rings into batch, returns false when there was nothing to collect
+static bool log_async_collect(std::vector<LogRecord>& batch, std::ostringstream& out)
+{
+	bool collected = false;
+	char buffer[128];
+
+	std::lock_guard<std::mutex> lock(LogRingsMtx);
+
+	for (auto it = LogRings.begin(); it != LogRings.end();) {
+		LogRing* ring = *it;
+		// Check this before reading Head, so that a retired ring is only freed once all its records are drained
+		bool retired = ring->Retired;
+		uint32_t head = ring->Head.load(std::memory_order_acquire);
+		uint32_t tail = ring->Tail.load(std::memory_order_relaxed);
+
+		for (; tail != head; tail++) {
+			batch.push_back(ring->Records[tail & (LOG_ASYNC_RING_RECORDS - 1)]);
+			collected = true;
+		}
+		ring->Tail.store(tail, std::memory_order_release);
+
+		uint32_t dropped = ring->Dropped.exchange(0);
+		if (dropped > 0) {
+			snprintf(buffer, sizeof(buffer), "[0x%.4X] %sdropped %u records, the log writer couldn't keep up\n",
+				ring->ThreadId, g_EnumModules2String[to_underlying(CXBXR_MODULE::LOG)], dropped);
+			out << buffer;
+			collected = true;
+		}
+
+		if (retired) {
+			delete ring;
+			it = LogRings.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	return collected;
+}
+
+// Thread that drains the rings of all threads and writes out their records
+static void log_async_writer_thread()
+{
+	std::vector<LogRecord> batch;
+	std::ostringstream out;
+
+	CxbxSetThreadName("Cxbx Log Writer");
+
+	while (true) {
+		LogWriterWaiting = true;
+
+		if (!log_async_collect(batch, out)) {
+			LogWriterIdlePasses++;
+			WaitForSingleObject(LogWriterEvent, INFINITE);
+			continue;
+		}
+
+		LogWriterWaiting = false;
+
+		// Each ring is in order already, but records of different threads must be interleaved
+		std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+			return a.Timestamp < b.Timestamp;
+		});
+
+		for (const LogRecord& record : batch) {
+			log_async_render(out, record);
+		}
+
+		std::string text = out.str();
+		_write(LogOutputFd, text.data(), (unsigned int)text.length());
+		batch.clear();
+		out.str("");
+	}
+}
+
+// Reads what is still written to stdout directly (with printf and the like), and passes it on as TEXT records.
+// This output is stamped when it's read rather than when it was written, so it can lag behind records a little
+static void log_async_stdout_thread(HANDLE pipe)
+{
+	char buffer[LOG_ASYNC_RECORD_TEXT * 4];
+	DWORD read;
+
+	CxbxSetThreadName("Cxbx Log Stdout");
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+	while (ReadFile(pipe, buffer, sizeof(buffer), &read, nullptr) && read > 0) {
+		log_async_text(buffer, read);
+	}
+}
+
+// Switches all logging of this process over to the rings, this can't be undone
+void log_async_start()
+{
+	if (g_LogAsync) {
+		return;
+	}
+
+	fflush(stdout);
+	LogOutputFd = _dup(_fileno(stdout));
+	LogWriterEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	// Everything else that writes to stdout is redirected to a pipe, which is read back into the rings
+	HANDLE read, write;
+	if (CreatePipe(&read, &write, nullptr, 0)) {
+		int fd = _open_osfhandle((intptr_t)write, _O_BINARY);
+		_dup2(fd, _fileno(stdout));
+		_close(fd);
+		setvbuf(stdout, nullptr, _IONBF, 0);
+		std::thread(log_async_stdout_thread, read).detach();
+	}
+
+	std::cout.rdbuf(&LogAsyncCoutBuf);
+	std::thread(log_async_writer_thread).detach();
+	g_LogAsync = true;
+}
+
+LogRecord* log_async_begin(const CXBXR_MODULE cxbxr_module, const char* func, const LOG_RECORD_KIND kind)
+{
+	LogRing* ring = t_LogRing.Ring;
+
+	if (ring == nullptr) {
+		ring = new LogRing;
+		ring->Head = 0;
+		ring->Tail = 0;
+		ring->Dropped = 0;
+		ring->Retired = false;
+		ring->ThreadId = GetCurrentThreadId();
+		t_LogRing.Ring = ring;
+
+		std::lock_guard<std::mutex> lock(LogRingsMtx);
+		LogRings.push_back(ring);
+	}
+
+	uint32_t head = ring->Head.load(std::memory_order_relaxed);
+	LogRecord* record = &ring->Records[head & (LOG_ASYNC_RING_RECORDS - 1)];
+
+	while (head - ring->Tail.load(std::memory_order_acquire) == LOG_ASYNC_RING_RECORDS) {
+		if (LogOverflowPolicy == to_underlying(LOG_OVERFLOW_POLICY::DROP)) {
+			record = &ring->Scratch;
+			break;
+		}
+		SetEvent(LogWriterEvent);
+		std::this_thread::yield();
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	record->Timestamp = counter.QuadPart;
+	record->ThreadId = ring->ThreadId;
+	record->Module = cxbxr_module;
+	record->Kind = kind;
+	record->ArgCount = 0;
+	record->TextLength = 0;
+	record->Function = func;
+
+	return record;
+}
+
+void log_async_commit(LogRecord* record)
+{
+	LogRing* ring = t_LogRing.Ring;
+
+	if (record == &ring->Scratch) {
+		ring->Dropped++;
+	}
+	else {
+		ring->Head.store(ring->Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// The exchange also keeps the check from moving before the store of Head
+	if (LogWriterWaiting.exchange(false)) {
+		SetEvent(LogWriterEvent);
+	}
+}
+
+// Writes text out in order with the records, splitting it over as many TEXT records as it needs
+void log_async_text(const char* text, size_t length)
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	while (length > 0) {
+		LogRecord* record = log_async_begin(CXBXR_MODULE::LOG, nullptr, LOG_RECORD_KIND::TEXT);
+		size_t part = (length < LOG_ASYNC_RECORD_TEXT) ? length : LOG_ASYNC_RECORD_TEXT;
+		memcpy(record->Text, text, part);
+		record->TextLength = (uint16_t)part;
+		// All parts share a timestamp, so that the records of other threads can't end up in between
+		record->Timestamp = counter.QuadPart;
+		log_async_commit(record);
+		text += part;
+		length -= part;
+	}
+}
+
+void log_async_printf(const char* fmt, ...)
+{
+	char buffer[1024];
+	va_list argp;
+
+	va_start(argp, fmt);
+	int length = vsnprintf(buffer, sizeof(buffer), fmt, argp);
+	va_end(argp);
+
+	if (length < 0) {
+		return;
+	}
+
+	if ((size_t)length < sizeof(buffer)) {
+		log_async_text(buffer, length);
+		return;
+	}
+
+	std::string text(length + 1, '\0');
+	va_start(argp, fmt);
+	vsnprintf(&text[0], text.size(), fmt, argp);
+	va_end(argp);
+	log_async_text(text.data(), length);
+}
+
+// Waits until the records committed so far by all threads have been written out (or a second has passed)
+void log_async_flush()
+{
+	if (!g_LogAsync) {
+		return;
+	}
+
+	std::cout.flush();
+
+	// The writer could have been in the middle of an idle pass when this was called, so wait for two of them
+	uint32_t start = LogWriterIdlePasses;
+	for (int i = 0; i < 1000 && LogWriterIdlePasses - start < 2; i++) {
+		SetEvent(LogWriterEvent);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void log_async_set_overflow_policy(const LOG_OVERFLOW_POLICY policy)
+{
+	LogOverflowPolicy = to_underlying(policy);
+}
+
 // Generate active log filter output.
 void log_generate_active_filter_output(const CXBXR_MODULE cxbxr_module)
 {
@@ -132,6 +575,12 @@ void log_generate_active_filter_output(const CXBXR_MODULE cxbxr_module)
 	std::string generic_output_str = _logThreadPrefix + g_EnumModules2String[to_underlying(cxbxr_module)];
 
 	std::cout << generic_output_str << "Current log level: " << g_CurrentLogLevel << std::endl;
+	if (g_CurrentLogLevel < to_underlying(CXBXR_LOG_MIN_LEVEL)) {
+		std::cout << generic_output_str << "Messages below log level " << to_underlying(CXBXR_LOG_MIN_LEVEL) << " are not part of this build" << std::endl;
+	}
+	if (g_LogAsync) {
+		std::cout << generic_output_str << "Logging asynchronously" << std::endl;
+	}
 
 	generic_output_str.append("Active log filter: ");
 	for (unsigned int index = to_underlying(CXBXR_MODULE::CXBXR); index < to_underlying(CXBXR_MODULE::MAX); index++) {
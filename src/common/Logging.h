@@ -32,6 +32,8 @@
 #include <iostream> // For std::cout
 #include <iomanip> // For std::setw
 #include <atomic> // For atomic_bool and atomic_uint
+#include <cstring> // For memcpy
+#include <type_traits> // For std::is_pointer and std::is_trivially_copyable
 #include "common\util\CxbxUtil.h" // For g_bPrintfOn and to_underlying
 
 typedef enum class _LOG_LEVEL {
@@ -109,6 +111,31 @@ typedef enum class _CXBXR_MODULE: unsigned int {
 extern std::atomic_bool g_EnabledModules[to_underlying(CXBXR_MODULE::MAX)];
 extern const char* g_EnumModules2String[to_underlying(CXBXR_MODULE::MAX)];
 extern std::atomic_int g_CurrentLogLevel;
+// For each module, bit n is set when messages of LOG_LEVEL n are to be printed. This caches the combination
+// of g_EnabledModules and g_CurrentLogLevel, so that checking a log statement takes a single load
+extern std::atomic_uint g_ModuleLogMask[to_underlying(CXBXR_MODULE::MAX)];
+
+// Log statements below this level are compiled out. Debug builds keep all of them, release builds
+// leave out the DEBUG level (which includes all function call logging), so selecting that level
+// in the logging configuration of the GUI only has an effect in debug builds
+#ifndef CXBXR_LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define CXBXR_LOG_MIN_LEVEL LOG_LEVEL::DEBUG
+#else
+#define CXBXR_LOG_MIN_LEVEL LOG_LEVEL::INFO
+#endif
+#endif
+
+// Returns the lowest level compiled in for the given module; add a case here to override
+// CXBXR_LOG_MIN_LEVEL for a specific module
+constexpr LOG_LEVEL log_compiled_min_level(const CXBXR_MODULE cxbxr_module)
+{
+	return CXBXR_LOG_MIN_LEVEL;
+}
+
+// Evaluates to a constant for constant arguments, so that the statements it guards are removed by the compiler
+#define LOG_COMPILED_IN(cxbxr_module, level) \
+	(to_underlying(level) >= to_underlying(log_compiled_min_level(cxbxr_module)))
 
 extern inline void log_get_settings();
 
@@ -210,6 +237,140 @@ LOG_SANITIZE(sanitized_char_pointer, char *);
 LOG_SANITIZE(sanitized_wchar_pointer, wchar_t *);
 
 
+//
+// Asynchronous binary logging (enabled by the LogAsync core setting)
+//
+
+// Call sites don't render anything, they only copy the raw bytes of their arguments into a record
+// of a ring buffer owned by the calling thread. A background thread drains the rings of all threads,
+// renders the records in timestamp order and writes them out. While this is enabled, all other text
+// output of the kernel goes through the same rings (as TEXT records), so that it stays in order
+#define LOG_ASYNC_MAX_ARGS 12
+#define LOG_ASYNC_RECORD_TEXT 128 // bytes of text per record
+#define LOG_ASYNC_RING_RECORDS 1024 // per thread, must be a power of two
+
+typedef enum class _LOG_RECORD_KIND : uint8_t {
+	CALL = 0,
+	RESULT,
+	TEXT,
+}LOG_RECORD_KIND;
+
+// What a thread does when its ring is full because the writer can't keep up
+typedef enum class _LOG_OVERFLOW_POLICY {
+	DROP = 0, // discard the record, the writer reports how many were lost
+	BLOCK,    // wait until the writer has made room
+}LOG_OVERFLOW_POLICY;
+
+typedef struct _LogRecord LogRecord;
+typedef struct _LogRecordArg LogRecordArg;
+
+// Called by the writer thread to render an argument, chosen at the call site from the type of the argument
+typedef void (*LogRecordArgRender)(std::ostream& os, const LogRecord& record, const LogRecordArg& arg);
+
+typedef struct _LogRecordArg {
+	const char* Name;          // the stringized argument, as passed to LOG_FUNC_ARG
+	uint64_t Value;            // the raw bytes of the argument (for strings, also where its copy is in Text)
+	LogRecordArgRender Render;
+	bool Out;                  // passed with LOG_FUNC_ARG_OUT
+}LogRecordArg;
+
+typedef struct _LogRecord {
+	uint64_t Timestamp;   // QueryPerformanceCounter when the record was started
+	uint32_t ThreadId;
+	CXBXR_MODULE Module;
+	LOG_RECORD_KIND Kind;
+	uint8_t ArgCount;
+	uint16_t TextLength;  // the number of bytes of Text that are used
+	const char* Function; // __func__ of the call site, which lives as long as the program
+	LogRecordArg Args[LOG_ASYNC_MAX_ARGS];
+	char Text[LOG_ASYNC_RECORD_TEXT]; // the output of a TEXT record, or copies of the string arguments
+}LogRecord;
+
+// Set by log_async_start, after which all logging goes through the rings
+extern std::atomic_bool g_LogAsync;
+
+void log_async_start();
+LogRecord* log_async_begin(const CXBXR_MODULE cxbxr_module, const char* func, const LOG_RECORD_KIND kind);
+void log_async_commit(LogRecord* record);
+void log_async_text(const char* text, size_t length);
+void log_async_printf(const char* fmt, ...);
+void log_async_flush();
+void log_async_set_overflow_policy(const LOG_OVERFLOW_POLICY policy);
+
+void log_async_render_pointer(std::ostream& os, const LogRecord& record, const LogRecordArg& arg);
+void log_async_render_truncated(std::ostream& os, const LogRecord& record, const LogRecordArg& arg);
+void log_async_copy_string(LogRecord* record, LogRecordArg& arg, const char* str);
+void log_async_copy_wstring(LogRecord* record, LogRecordArg& arg, const wchar_t* str);
+
+// Renders a captured value with the same << operator the synchronous path uses
+template<class T>
+void log_async_render_value(std::ostream& os, const LogRecord& record, const LogRecordArg& arg)
+{
+	os << _log_sanitize(*reinterpret_cast<const T*>(&arg.Value));
+}
+
+// Values that fit in a record are rendered as such, pointers are never followed (the writer runs
+// too late for that) and anything else only shows its first bytes
+template<class T>
+inline void log_async_capture(LogRecordArg& arg, const T& value, std::true_type /*fits*/)
+{
+	memcpy(&arg.Value, &value, sizeof(T));
+	arg.Render = std::is_pointer<T>::value ? &log_async_render_pointer : &log_async_render_value<T>;
+}
+
+template<class T>
+inline void log_async_capture(LogRecordArg& arg, const T& value, std::false_type /*fits*/)
+{
+	memcpy(&arg.Value, &value, sizeof(arg.Value));
+	arg.Render = log_async_render_truncated;
+}
+
+template<class T>
+inline LogRecordArg* log_async_arg(LogRecord* record, const char* name, const T& value)
+{
+	if (record->ArgCount == LOG_ASYNC_MAX_ARGS) {
+		return nullptr;
+	}
+
+	LogRecordArg& arg = record->Args[record->ArgCount++];
+	arg.Name = name;
+	arg.Value = 0;
+	arg.Out = false;
+	log_async_capture(arg, value, std::integral_constant<bool,
+		sizeof(T) <= sizeof(arg.Value) && std::is_trivially_copyable<T>::value && !std::is_array<T>::value>());
+	return &arg;
+}
+
+// Strings are copied into the record, as far as they fit
+inline LogRecordArg* log_async_arg(LogRecord* record, const char* name, const char* value)
+{
+	LogRecordArg* arg = log_async_arg<const void*>(record, name, value);
+	if (arg != nullptr && value != nullptr) {
+		log_async_copy_string(record, *arg, value);
+	}
+	return arg;
+}
+
+inline LogRecordArg* log_async_arg(LogRecord* record, const char* name, char* value)
+{
+	return log_async_arg(record, name, (const char*)value);
+}
+
+inline LogRecordArg* log_async_arg(LogRecord* record, const char* name, const wchar_t* value)
+{
+	LogRecordArg* arg = log_async_arg<const void*>(record, name, value);
+	if (arg != nullptr && value != nullptr) {
+		log_async_copy_wstring(record, *arg, value);
+	}
+	return arg;
+}
+
+inline LogRecordArg* log_async_arg(LogRecord* record, const char* name, wchar_t* value)
+{
+	return log_async_arg(record, name, (const wchar_t*)value);
+}
+
+
 //
 // Function (and argument) logging defines
 //
@@ -248,7 +409,8 @@ extern thread_local std::string _logThreadPrefix;
 
 // Checks if this log should be printed or not
 #define LOG_CHECK_ENABLED_EX(cxbxr_module, level) \
-	if (g_EnabledModules[to_underlying(cxbxr_module)] && to_underlying(level) >= g_CurrentLogLevel)
+	if (LOG_COMPILED_IN(cxbxr_module, level) && \
+		(g_ModuleLogMask[to_underlying(cxbxr_module)].load(std::memory_order_relaxed) & (1 << to_underlying(level))))
 
 // Checks if this log should be printed or not
 #define LOG_CHECK_ENABLED(level) \
@@ -261,14 +423,22 @@ extern thread_local std::string _logThreadPrefix;
 		_logThreadPrefix = tmp.str(); \
     }
 
-#define LOG_FUNC_INIT(func) \
-	static thread_local std::string _logFuncPrefix; \
+// Declares the function prefix, which LOG_FUNC_PREFIX_INIT only fills in once something is actually logged.
+// Passing a thread_local declaration runs its initialization check, so this belongs inside LOG_CHECK_ENABLED
+#define LOG_FUNC_DECL \
+	static thread_local std::string _logFuncPrefix;
+
+#define LOG_FUNC_PREFIX_INIT(func) \
 	if (_logFuncPrefix.length() == 0) {	\
 		std::stringstream tmp; \
 		tmp << g_EnumModules2String[to_underlying(LOG_PREFIX)] << (func != nullptr ? remove_emupatch_prefix(func) : ""); \
 		_logFuncPrefix = tmp.str(); \
 	}
 
+#define LOG_FUNC_INIT(func) \
+	LOG_FUNC_DECL \
+	LOG_FUNC_PREFIX_INIT(func)
+
 #define LOG_INIT \
 	LOG_THREAD_INIT \
 	LOG_FUNC_INIT(__func__)
@@ -276,52 +446,103 @@ extern thread_local std::string _logThreadPrefix;
 #define LOG_FINIT \
 	_logFuncPrefix.clear(); // Reset prefix, to show caller changes
 
+// Holds the message of a synchronously logged call, which isn't constructed when logging asynchronously
+struct LogFuncMessage {
+	union { std::stringstream Stream; };
+	bool Used;
+	LogFuncMessage(bool used) : Used(used) { if (Used) new (&Stream) std::stringstream(); }
+	~LogFuncMessage() { if (Used) Stream.~basic_stringstream(); }
+};
+
+// In asynchronous mode, calls are captured into a record which the writer thread renders later on
 #define LOG_FUNC_BEGIN_NO_INIT \
 	do { if(g_bPrintfOn) { \
+		LogRecord* _record = g_LogAsync ? log_async_begin(LOG_PREFIX, __func__, LOG_RECORD_KIND::CALL) : nullptr; \
+		LogFuncMessage _msg(_record == nullptr); \
+		std::stringstream& msg = _msg.Stream; \
 		bool _had_arg = false; \
-		std::stringstream msg; \
-		msg << _logThreadPrefix << _logFuncPrefix << "(";
+		if (_record == nullptr) msg << _logThreadPrefix << _logFuncPrefix << "(";
 
+// The prefixes are declared and initialized after the check, so that disabled (or compiled out) logging doesn't touch them
 #define LOG_FUNC_BEGIN \
-		LOG_INIT \
 		LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { \
+			LOG_FUNC_DECL \
+			LOG_THREAD_INIT \
+			LOG_FUNC_PREFIX_INIT(__func__) \
 			LOG_FUNC_BEGIN_NO_INIT
 
 // LOG_FUNC_ARG writes output via all available ostream << operator overloads, sanitizing and adding detail where possible
 #define LOG_FUNC_ARG(arg) \
-		_had_arg = true; \
-		msg << LOG_ARG_START << #arg << " : " << _log_sanitize(arg);
+		if (_record != nullptr) { log_async_arg(_record, #arg, arg); } \
+		else { \
+			_had_arg = true; \
+			msg << LOG_ARG_START << #arg << " : " << _log_sanitize(arg); \
+		}
 
 // LOG_FUNC_ARG_TYPE writes output using the overloaded << operator of the given type
 #define LOG_FUNC_ARG_TYPE(type, arg) \
-		_had_arg = true; \
-		msg << LOG_ARG_START << #arg << " : " << (type)arg;
+		if (_record != nullptr) { log_async_arg(_record, #arg, (type)arg); } \
+		else { \
+			_had_arg = true; \
+			msg << LOG_ARG_START << #arg << " : " << (type)arg; \
+		}
 
 // LOG_FUNC_ARG_OUT prevents expansion of types, by only rendering as a pointer
 #define LOG_FUNC_ARG_OUT(arg) \
-		_had_arg = true; \
-		msg << LOG_ARG_OUT_START << #arg << " : " << hex4((uint32_t)arg);
+		if (_record != nullptr) { \
+			LogRecordArg* _arg = log_async_arg(_record, #arg, hex4((uint32_t)arg)); \
+			if (_arg != nullptr) _arg->Out = true; \
+		} \
+		else { \
+			_had_arg = true; \
+			msg << LOG_ARG_OUT_START << #arg << " : " << hex4((uint32_t)arg); \
+		}
 
 // LOG_FUNC_END closes off function and optional argument logging
 #define LOG_FUNC_END \
-			if (_had_arg) msg << "\n"; \
-			msg << ");\n"; \
-			std::cout << msg.str(); \
+			if (_record != nullptr) { log_async_commit(_record); } \
+			else { \
+				if (_had_arg) msg << "\n"; \
+				msg << ");\n"; \
+				std::cout << msg.str(); \
+			} \
 		} } while (0); \
 	}
 
 // LOG_FUNC_RESULT logs the function return result
 #define LOG_FUNC_RESULT(r) \
-	std::cout << _logThreadPrefix << _logFuncPrefix << " returns " << _log_sanitize(r) << "\n";
+	if (g_LogAsync) { \
+		LogRecord* _record = log_async_begin(LOG_PREFIX, __func__, LOG_RECORD_KIND::RESULT); \
+		log_async_arg(_record, "", r); \
+		log_async_commit(_record); \
+	} \
+	else { \
+		LOG_FUNC_DECL \
+		LOG_THREAD_INIT \
+		LOG_FUNC_PREFIX_INIT(__func__) \
+		std::cout << _logThreadPrefix << _logFuncPrefix << " returns " << _log_sanitize(r) << "\n"; \
+	}
 
 // LOG_FUNC_RESULT_TYPE logs the function return result using the overloaded << operator of the given type
 #define LOG_FUNC_RESULT_TYPE(type, r) \
-	std::cout << _logThreadPrefix << _logFuncPrefix << " returns " << (type)r << "\n";
+	if (g_LogAsync) { \
+		LogRecord* _record = log_async_begin(LOG_PREFIX, __func__, LOG_RECORD_KIND::RESULT); \
+		log_async_arg(_record, "", (type)r); \
+		log_async_commit(_record); \
+	} \
+	else { \
+		LOG_FUNC_DECL \
+		LOG_THREAD_INIT \
+		LOG_FUNC_PREFIX_INIT(__func__) \
+		std::cout << _logThreadPrefix << _logFuncPrefix << " returns " << (type)r << "\n"; \
+	}
 
 // LOG_FORWARD indicates that an api is implemented by a forward to another API
 #define LOG_FORWARD(api) \
-	LOG_INIT \
 	LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { \
+		LOG_FUNC_DECL \
+		LOG_THREAD_INIT \
+		LOG_FUNC_PREFIX_INIT(__func__) \
 		do { if(g_bPrintfOn) { \
 			std::cout << _logThreadPrefix << _logFuncPrefix << " forwarding to "#api"...\n"; \
 		} } while (0); \
@@ -331,7 +552,7 @@ extern thread_local std::string _logThreadPrefix;
 #define LOG_IGNORED() \
 	do { \
 		static bool b_echoOnce = true; \
-			if(g_bPrintfOn && b_echoOnce) { \
+			if(LOG_COMPILED_IN(LOG_PREFIX, LOG_LEVEL::INFO) && g_bPrintfOn && b_echoOnce) { \
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
@@ -345,7 +566,7 @@ extern thread_local std::string _logThreadPrefix;
 #define LOG_UNIMPLEMENTED() \
 	do { \
 		static bool b_echoOnce = true; \
-			if(g_bPrintfOn && b_echoOnce) { \
+			if(LOG_COMPILED_IN(LOG_PREFIX, LOG_LEVEL::INFO) && g_bPrintfOn && b_echoOnce) { \
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
@@ -359,7 +580,7 @@ extern thread_local std::string _logThreadPrefix;
 #define LOG_INCOMPLETE() \
 	do { \
 		static bool b_echoOnce = true; \
-			if(g_bPrintfOn && b_echoOnce) { \
+			if(LOG_COMPILED_IN(LOG_PREFIX, LOG_LEVEL::INFO) && g_bPrintfOn && b_echoOnce) { \
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
@@ -373,7 +594,7 @@ extern thread_local std::string _logThreadPrefix;
 #define LOG_NOT_SUPPORTED() \
 	do { \
 		static bool b_echoOnce = true; \
-			if(g_bPrintfOn && b_echoOnce) { \
+			if(LOG_COMPILED_IN(LOG_PREFIX, LOG_LEVEL::INFO) && g_bPrintfOn && b_echoOnce) { \
 				LOG_CHECK_ENABLED(LOG_LEVEL::INFO) { \
 					LOG_THREAD_INIT \
 					LOG_FUNC_INIT(__func__) \
@@ -391,7 +612,10 @@ extern thread_local std::string _logThreadPrefix;
 #define DBG_PRINTF_EX(cxbxr_module, fmt, ...) { \
 		LOG_CHECK_ENABLED_EX(cxbxr_module, LOG_LEVEL::DEBUG) { \
 			CXBX_CHECK_INTEGRITY(); \
-			if(g_bPrintfOn) printf("[0x%.4X] %s"##fmt, GetCurrentThreadId(), g_EnumModules2String[to_underlying(cxbxr_module)], ##__VA_ARGS__); \
+			if(g_bPrintfOn) { \
+				if (g_LogAsync) log_async_printf("[0x%.4X] %s"##fmt, GetCurrentThreadId(), g_EnumModules2String[to_underlying(cxbxr_module)], ##__VA_ARGS__); \
+				else printf("[0x%.4X] %s"##fmt, GetCurrentThreadId(), g_EnumModules2String[to_underlying(cxbxr_module)], ##__VA_ARGS__); \
+			} \
 		} \
      }
 
@@ -419,10 +643,10 @@ extern thread_local std::string _logThreadPrefix;
 #define LOG_FUNC_ONE_ARG_OUT(arg) LOG_FUNC_BEGIN LOG_FUNC_ARG_OUT(arg) LOG_FUNC_END 
 
 // RETURN logs the given result and then returns it (so this should appear last in functions)
-#define RETURN(r) do { if (g_bPrintfOn) LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { LOG_FUNC_RESULT(r) } return r; } while (0)
+#define RETURN(r) do { LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { if (g_bPrintfOn) { LOG_FUNC_RESULT(r) } } return r; } while (0)
 
 // RETURN_TYPE logs the given typed result and then returns it (so this should appear last in functions)
-#define RETURN_TYPE(type, r) do { if (g_bPrintfOn) LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { LOG_FUNC_RESULT_TYPE(type, r) } return r; } while (0)
+#define RETURN_TYPE(type, r) do { LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { if (g_bPrintfOn) { LOG_FUNC_RESULT_TYPE(type, r) } } return r; } while (0)
 
 #define LOG_ONCE(msg, ...) { static bool bFirstTime = true; if(bFirstTime) { bFirstTime = false; DBG_PRINTF("TRAC: " ## msg, __VA_ARGS__); } }
 
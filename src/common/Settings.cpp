@@ -45,7 +45,7 @@ static_assert(false, "Please implement support for cross-platform's user profile
 std::string g_exec_filepath;
 
 // NOTE: Update settings_version when add/edit/delete setting's structure.
-const unsigned int settings_version = 4;
+const unsigned int settings_version = 5;
 
 Settings* g_Settings = nullptr;
 
@@ -74,6 +74,7 @@ static struct {
 	const char* AllowAdminPrivilege = "AllowAdminPrivilege";
 	const char* LoggedModules = "LoggedModules";
 	const char* LogLevel = "LogLevel";
+	const char* LogAsync = "LogAsync";
 } sect_core_keys;
 
 static const char* section_video = "video";
@@ -93,11 +94,13 @@ static struct {
 	const char* codec_pcm = "PCM";
 	const char* codec_xadpcm = "XADPCM";
 	const char* codec_unknown = "UnknownCodec";
+	const char* software_mixer = "SoftwareMixer";
 } sect_audio_keys;
 
 static const char* section_network = "network";
 static struct {
 	const char* adapter_name = "adapter_name";
+	const char* loopback = "loopback";
 } sect_network_keys;
 
 static const char* section_controller_dinput = "controller-dinput";
@@ -347,6 +350,7 @@ bool Settings::LoadConfig()
 	m_core.allowAdminPrivilege = m_si.GetBoolValue(section_core, sect_core_keys.AllowAdminPrivilege, /*Default=*/false);
 
 	m_core.LogLevel = m_si.GetLongValue(section_core, sect_core_keys.LogLevel, 1);
+	m_core.LogAsync = m_si.GetBoolValue(section_core, sect_core_keys.LogAsync, /*Default=*/false);
 	si_list.clear();
 	index = 0;
 	list_max = std::size(m_core.LoggedModules);
@@ -425,6 +429,7 @@ bool Settings::LoadConfig()
 	m_audio.codec_pcm = m_si.GetBoolValue(section_audio, sect_audio_keys.codec_pcm, /*Default=*/true, nullptr);
 	m_audio.codec_xadpcm = m_si.GetBoolValue(section_audio, sect_audio_keys.codec_xadpcm, /*Default=*/true, nullptr);
 	m_audio.codec_unknown = m_si.GetBoolValue(section_audio, sect_audio_keys.codec_unknown, /*Default=*/true, nullptr);
+	m_audio.software_mixer = m_si.GetBoolValue(section_audio, sect_audio_keys.software_mixer, /*Default=*/false, nullptr);
 
 	// ==== Audio End ===========
 
@@ -438,6 +443,8 @@ bool Settings::LoadConfig()
 		std::strncpy(m_network.adapter_name, si_data, std::size(m_network.adapter_name));
 	}
 
+	m_network.loopback = m_si.GetBoolValue(section_network, sect_network_keys.loopback, /*Default=*/false, nullptr);
+
 	// ==== Network End =========
 
 	// ==== Controller Begin ====
@@ -537,6 +544,7 @@ bool Settings::Save(std::string file_path)
 	m_si.SetValue(section_core, sect_core_keys.KrnlDebugLogFile, m_core.szKrnlDebug, nullptr, true);
 	m_si.SetBoolValue(section_core, sect_core_keys.AllowAdminPrivilege, m_core.allowAdminPrivilege, nullptr, true);
 	m_si.SetLongValue(section_core, sect_core_keys.LogLevel, m_core.LogLevel, nullptr, false, true);
+	m_si.SetBoolValue(section_core, sect_core_keys.LogAsync, m_core.LogAsync, nullptr, true);
 
 	std::stringstream stream;
 	stream << "0x" << std::hex << m_core.LoggedModules[0];
@@ -574,12 +582,14 @@ bool Settings::Save(std::string file_path)
 	m_si.SetBoolValue(section_audio, sect_audio_keys.codec_pcm, m_audio.codec_pcm, nullptr, true);
 	m_si.SetBoolValue(section_audio, sect_audio_keys.codec_xadpcm, m_audio.codec_xadpcm, nullptr, true);
 	m_si.SetBoolValue(section_audio, sect_audio_keys.codec_unknown, m_audio.codec_unknown, nullptr, true);
+	m_si.SetBoolValue(section_audio, sect_audio_keys.software_mixer, m_audio.software_mixer, nullptr, true);
 
 	// ==== Audio End ===========
 
 	// ==== Network Begin =======
 
 	m_si.SetValue(section_network, sect_network_keys.adapter_name, m_network.adapter_name, nullptr, true);
+	m_si.SetBoolValue(section_network, sect_network_keys.loopback, m_network.loopback, nullptr, true);
 	
 	// ==== Network End =========
 
@@ -146,7 +146,7 @@ public:
 		bool allowAdminPrivilege;
         unsigned int LoggedModules[NUM_INTEGERS_LOG];
 		int LogLevel = 1;
-		bool Reserved2 = 0;
+		bool LogAsync = false;
 		bool Reserved3 = 0;
 		bool Reserved4 = 0;
 		int  Reserved99[10] = { 0 };
@@ -170,13 +170,14 @@ public:
 		bool codec_pcm ;
 		bool codec_xadpcm;
 		bool codec_unknown;
-		bool Reserved4 = 0;
+		bool software_mixer = false;
 		int  Reserved99[14] = { 0 };
 	} m_audio;
 
 	// Network settings
 	struct s_network {
 		char adapter_name[MAX_PATH] = "";
+		bool loopback = false;
 	} m_network;
 
 	// Controller settings
@@ -27,10 +27,14 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#include <mmsystem.h>
 #endif
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <functional>
 #include "Timer.h"
 #include "common\util\CxbxUtil.h"
 #include "core\kernel\init\CxbxKrnl.h"
@@ -44,13 +48,37 @@
 #define CLOCK_REALTIME 0
 //#define CLOCK_VIRTUALTIME  1
 
+// How long before a deadline the dispatchers stop sleeping and start spinning. The host only wakes us up with a granularity
+// of about 1 ms (after timeBeginPeriod), so sleeping any closer than this would make the timers fire late
+#define TIMER_SPIN_SLACK_NS SCALE_MS_IN_NS
+
+
+// A pending expiration: the absolute deadline (ns) and the timer it belongs to
+typedef std::pair<uint64_t, TimerObject*> TimerEntry;
+
+// A thread serving all the shared timers with the same cpu affinity, or a single dedicated timer. The pending expirations
+// are kept in a min-heap ordered by deadline, so the thread only ever has to look at the earliest one
+typedef struct _TimerDispatcher
+{
+	unsigned long* CpuAffinity;          // the cpu affinity of the timers served by this dispatcher
+	bool Dedicated;                      // serves a single timer, and goes away together with it
+	std::mutex Mtx;                      // lock to acquire when accessing Queue
+	std::condition_variable Cv;          // signalled when a new expiration is queued
+	std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> Queue;
+}
+TimerDispatcher;
+
 
 // Vector storing all the timers created
 static std::vector<TimerObject*> TimerList;
+// Vector storing the shared dispatchers created so far, one per distinct cpu affinity
+static std::vector<TimerDispatcher*> DispatcherList;
 // The frequency of the high resolution clock of the host
 uint64_t HostClockFrequency;
 // Lock to acquire when accessing TimerList
 std::mutex TimerMtx;
+// The timer whose callback the current thread is running, if any
+static thread_local TimerObject* CurrentTimer = nullptr;
 
 
 // Returns the current time of the timer
@@ -94,32 +122,110 @@ void Timer_Destroy(TimerObject* Timer)
 	TimerList.erase(TimerList.begin() + index);
 }
 
-// Thread that runs the timer
-void ClockThread(TimerObject* Timer)
+// Thread that runs the timers of a dispatcher
+void DispatcherThread(TimerDispatcher* Dispatcher, std::string Name)
 {
-	uint64_t NewExpireTime;
+	TimerEntry Entry;
+	uint64_t Now;
 
-	if (!Timer->Name.empty()) {
-		CxbxSetThreadName(Timer->Name.c_str());
+	CxbxSetThreadName(Name.c_str());
+	if (Dispatcher->CpuAffinity != nullptr) {
+		InitXboxThread(*Dispatcher->CpuAffinity);
 	}
-	if (Timer->CpuAffinity != nullptr) {
-		InitXboxThread(*Timer->CpuAffinity);
-	}
-	NewExpireTime = GetNextExpireTime(Timer);
+
+	std::unique_lock<std::mutex> lock(Dispatcher->Mtx);
 
 	while (true) {
-		if (GetTime_NS(Timer) > NewExpireTime) {
-			if (Timer->Exit.load()) {
-				Timer_Destroy(Timer);
-				return;
+		if (Dispatcher->Queue.empty()) {
+			Dispatcher->Cv.wait(lock);
+			continue;
+		}
+
+		Entry = Dispatcher->Queue.top();
+		Now = GetTime_NS(Entry.second);
+
+		if (Now < Entry.first) {
+			// Sleep until shortly before the deadline, then spin for the rest. In both cases we go back to the top since
+			// an earlier expiration could have been queued in the meantime
+			if (Entry.first - Now > TIMER_SPIN_SLACK_NS) {
+				Dispatcher->Cv.wait_for(lock, std::chrono::nanoseconds(Entry.first - Now - TIMER_SPIN_SLACK_NS));
+			}
+			else {
+				lock.unlock();
+				std::this_thread::yield();
+				lock.lock();
 			}
-			Timer->Callback(Timer->Opaque);
-			NewExpireTime = GetNextExpireTime(Timer);
+			continue;
 		}
-		Sleep(1); // prevent burning the cpu
+
+		Dispatcher->Queue.pop();
+		lock.unlock();
+
+		// Exit is checked under the callback lock, so that once Timer_Exit got hold of it no new callback can start
+		std::unique_lock<std::mutex> CallbackLock(Entry.second->CallbackMtx);
+		if (Entry.second->Exit.load()) {
+			CallbackLock.unlock();
+			Timer_Destroy(Entry.second);
+			if (Dispatcher->Dedicated) {
+				// Nothing else can be queued on a dedicated dispatcher, so it's done
+				delete Dispatcher;
+				return;
+			}
+			lock.lock();
+			continue;
+		}
+
+		CurrentTimer = Entry.second;
+		Entry.second->Callback(Entry.second->Opaque);
+		CurrentTimer = nullptr;
+		CallbackLock.unlock();
+
+		// The next deadline is counted from the one just served, so that the timer doesn't drift by the time spent in the
+		// callback. If we fell behind by more than a whole period, don't try to catch up and count from now instead
+		Now = GetTime_NS(Entry.second);
+		Entry.first += Entry.second->ExpireTime_MS.load();
+		if (Entry.first <= Now) {
+			Entry.first = GetNextExpireTime(Entry.second);
+		}
+
+		lock.lock();
+		Dispatcher->Queue.push(Entry);
 	}
 }
 
+// Retrieves the dispatcher to serve Timer: a new one for a dedicated timer, otherwise the one serving the shared timers with
+// the same affinity, creating it if it doesn't exist yet
+static TimerDispatcher* GetDispatcher(TimerObject* Timer)
+{
+	std::lock_guard<std::mutex>lock(TimerMtx);
+
+	if (!Timer->Dedicated) {
+		for (auto Dispatcher : DispatcherList) {
+			if (Dispatcher->CpuAffinity == Timer->CpuAffinity) {
+				return Dispatcher;
+			}
+		}
+	}
+
+	TimerDispatcher* Dispatcher = new TimerDispatcher;
+	Dispatcher->CpuAffinity = Timer->CpuAffinity;
+	Dispatcher->Dedicated = Timer->Dedicated;
+
+	// A dedicated dispatcher is only ever running its own timer, a shared one is named after the order of creation instead,
+	// since which timer happens to start it first says nothing about the others it serves
+	std::string Name;
+	if (Dispatcher->Dedicated) {
+		Name = Timer->Name;
+	}
+	else {
+		DispatcherList.emplace_back(Dispatcher);
+		Name = "Cxbx Timer Dispatcher " + std::to_string(DispatcherList.size());
+	}
+	std::thread(DispatcherThread, Dispatcher, Name).detach();
+
+	return Dispatcher;
+}
+
 // Changes the expire time of a timer
 void Timer_ChangeExpireTime(TimerObject* Timer, uint64_t Expire_ms)
 {
@@ -127,13 +233,19 @@ void Timer_ChangeExpireTime(TimerObject* Timer, uint64_t Expire_ms)
 }
 
 // Destroys the timer
+// Returns only after a callback that is already running has finished, so the caller can then free whatever the callback uses.
+// When called from the callback of the timer itself, it returns right away instead
 void Timer_Exit(TimerObject* Timer)
 {
 	Timer->Exit.store(true);
+	if (CurrentTimer != Timer) {
+		std::lock_guard<std::mutex>lock(Timer->CallbackMtx);
+	}
 }
 
 // Allocates the memory for the timer object
-TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigned long* Affinity)
+// Dedicated timers get a dispatcher thread of their own, instead of sharing one with the other timers of the same affinity
+TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigned long* Affinity, bool Dedicated)
 {
 	std::lock_guard<std::mutex>lock(TimerMtx);
 	TimerObject* pTimer = new TimerObject;
@@ -144,6 +256,7 @@ TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigne
 	pTimer->Opaque = Arg;
 	Name.empty() ? pTimer->Name = "Unnamed thread" : pTimer->Name = Name;
 	pTimer->CpuAffinity = Affinity;
+	pTimer->Dedicated = Dedicated;
 	TimerList.emplace_back(pTimer);
 
 	return pTimer;
@@ -153,8 +266,14 @@ TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigne
 // Expire_MS must be expressed in NS
 void Timer_Start(TimerObject* Timer, uint64_t Expire_MS)
 {
+	TimerDispatcher* Dispatcher = GetDispatcher(Timer);
+
 	Timer->ExpireTime_MS.store(Expire_MS);
-	std::thread(ClockThread, Timer).detach();
+	{
+		std::lock_guard<std::mutex>lock(Dispatcher->Mtx);
+		Dispatcher->Queue.emplace(GetNextExpireTime(Timer), Timer);
+	}
+	Dispatcher->Cv.notify_one();
 }
 
 // Retrives the frequency of the high resolution clock of the host
@@ -164,9 +283,19 @@ void Timer_Init()
 	LARGE_INTEGER freq;
 	QueryPerformanceFrequency(&freq);
 	HostClockFrequency = freq.QuadPart;
+	// Make the host scheduler wake up the timer dispatchers with 1 ms granularity, instead of the default ~15.6 ms
+	timeBeginPeriod(1);
 #elif __linux__
 	ClockFrequency = 0;
 #else
 #error "Unsupported OS"
 #endif
 }
+
+// Restores the host scheduler granularity changed by Timer_Init
+void Timer_Shutdown()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
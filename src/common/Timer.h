@@ -29,6 +29,8 @@
 #define TIMER_H
 
 #include <atomic>
+#include <mutex>
+#include <string>
 
 #define SCALE_S_IN_NS  1000000000
 #define SCALE_MS_IN_NS 1000000
@@ -48,19 +50,22 @@ typedef struct _TimerObject
 	std::atomic_bool Exit;               // indicates that the timer should be destroyed
 	TimerCB Callback;                    // function to call when the timer expires
 	void* Opaque;                        // opaque argument to pass to the callback
-	std::string Name;                    // the name of the timer thread (if any)
-	unsigned long* CpuAffinity;          // the cpu affinity of the timer thread (if any)
+	std::string Name;                    // the name of the timer (and of its dispatcher thread, for a dedicated timer)
+	unsigned long* CpuAffinity;          // the cpu affinity of the dispatcher thread (shared timers with the same one share it)
+	bool Dedicated;                      // served by a dispatcher thread of its own, for timers that can't afford to wait on others
+	std::mutex CallbackMtx;              // held while the callback runs, so that Timer_Exit can wait for it
 }
 TimerObject;
 
 extern uint64_t HostClockFrequency;
 
 /* Timer exported functions */
-TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigned long* Affinity);
+TimerObject* Timer_Create(TimerCB Callback, void* Arg, std::string Name, unsigned long* Affinity, bool Dedicated = false);
 void Timer_Start(TimerObject* Timer, uint64_t Expire_MS);
 void Timer_Exit(TimerObject* Timer);
 void Timer_ChangeExpireTime(TimerObject* Timer, uint64_t Expire_ms);
 inline uint64_t GetTime_NS(TimerObject* Timer);
 void Timer_Init();
+void Timer_Shutdown();
 
 #endif
@@ -0,0 +1,285 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+// Within a block, every channel is an independent ADPCM stream: a 4 byte header (the first sample and the
+// step index) followed by 8 code words of 8 samples each, interleaved with the code words of the other
+// channels. Samples depend on the previous one, but streams don't depend on each other, so the vectorized
+// decoders below run one stream per lane. Each lane repeats TXboxAdpcmDecoder_DecodeSample exactly, so
+// the output is identical to TXboxAdpcmDecoder_Decode_Memory.
+
+#include <emmintrin.h> // For SSE2 intrinsics
+#include <smmintrin.h> // For SSE4.1 intrinsics
+#include <immintrin.h> // For AVX2 intrinsics
+#include "common\util\CPUID.h" // For SimdCaps
+#include "XADPCM.h"
+
+#define XBOX_ADPCM_CODEWORDS 8 // Per channel, each holding 8 samples
+#define XBOX_ADPCM_SAMPLES   (XBOX_ADPCM_CODEWORDS * 8) // Per channel, following the header sample
+
+// StepTable widened to 32 bits, so it can be gathered from
+static const struct StepTable32_t {
+    int32_t Entry[89];
+
+    StepTable32_t() {
+        for (int i = 0; i < 89; i++) {
+            Entry[i] = StepTable[i];
+        }
+    }
+} StepTable32;
+
+static inline uint32_t Read32(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (in[3] << 24);
+}
+
+// Byte offset of a stream's header in the input, stream being the block times FChannels plus the channel
+static inline size_t StreamInputOffset(size_t stream, int FChannels)
+{
+    return (stream / FChannels) * XBOX_ADPCM_SRCSIZE * FChannels + (stream % FChannels) * 4;
+}
+
+// Byte offset of a stream's first (header) sample in the output
+static inline size_t StreamOutputOffset(size_t stream, int FChannels)
+{
+    return (stream / FChannels) * XBOX_ADPCM_DSTSIZE * FChannels + (stream % FChannels) * 2;
+}
+
+static void DecodeStreams_C(const uint8_t *in, uint8_t *out, size_t first, size_t streams, int FChannels)
+{
+    const size_t InStride = 4 * FChannels;
+    const size_t OutStride = 2 * FChannels;
+
+    for (size_t stream = first; stream < streams; stream++) {
+        const uint8_t *pIn = in + StreamInputOffset(stream, FChannels);
+        uint8_t *pOut = out + StreamOutputOffset(stream, FChannels);
+        TAdpcmState State;
+
+        pOut[0] = pIn[0];
+        pOut[1] = pIn[1];
+        State.Predictor = pIn[0] | (pIn[1] << 8);
+        State.Index = pIn[2] | (pIn[3] << 8);
+        if (State.Index > 88) {
+            State.Index = 88;
+        } else if (State.Index < 0) {
+            State.Index = 0;
+        }
+        State.StepSize = StepTable[State.Index];
+
+        for (int i = 0; i < XBOX_ADPCM_CODEWORDS; i++) {
+            pIn += InStride;
+            uint32_t CodeBuf = Read32(pIn);
+            for (int j = 0; j < 8; j++) {
+                pOut += OutStride;
+                *(int16_t *)pOut = (int16_t)TXboxAdpcmDecoder_DecodeSample(CodeBuf & 15, &State);
+                CodeBuf >>= 4;
+            }
+        }
+    }
+}
+
+// Stores the samples of each lane, gathered as Samples[sample][lane], to its stream in the output
+template<int Lanes>
+static inline void ScatterSamples(const int32_t (&Samples)[XBOX_ADPCM_SAMPLES][Lanes], uint8_t *out, size_t first, int FChannels)
+{
+    const size_t OutStride = 2 * FChannels;
+
+    for (int l = 0; l < Lanes; l++) {
+        uint8_t *pOut = out + StreamOutputOffset(first + l, FChannels);
+        for (int i = 0; i < XBOX_ADPCM_SAMPLES; i++) {
+            pOut += OutStride;
+            *(int16_t *)pOut = (int16_t)Samples[i][l];
+        }
+    }
+}
+
+static size_t Decode_Blocks_C(const uint8_t *in, size_t inlen, uint8_t *out, int FChannels)
+{
+    size_t streams = (inlen / (XBOX_ADPCM_SRCSIZE * FChannels)) * FChannels;
+
+    DecodeStreams_C(in, out, 0, streams, FChannels);
+
+    return (streams / FChannels) * XBOX_ADPCM_DSTSIZE * FChannels;
+}
+
+static size_t Decode_Blocks_SSE41(const uint8_t *in, size_t inlen, uint8_t *out, int FChannels)
+{
+    const size_t InStride = 4 * FChannels;
+    size_t streams = (inlen / (XBOX_ADPCM_SRCSIZE * FChannels)) * FChannels;
+    size_t stream = 0;
+
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128i One = _mm_set1_epi32(1);
+    const __m128i Two = _mm_set1_epi32(2);
+    const __m128i Three = _mm_set1_epi32(3);
+    const __m128i Four = _mm_set1_epi32(4);
+    const __m128i Eight = _mm_set1_epi32(8);
+    const __m128i Fifteen = _mm_set1_epi32(15);
+    const __m128i IndexMax = _mm_set1_epi32(88);
+    const __m128i SampleMin = _mm_set1_epi32(-32768);
+    const __m128i SampleMax = _mm_set1_epi32(32767);
+    alignas(16) int32_t Samples[XBOX_ADPCM_SAMPLES][4];
+
+    for (; stream + 4 <= streams; stream += 4) {
+        const uint8_t *pIn[4];
+        for (int l = 0; l < 4; l++) {
+            pIn[l] = in + StreamInputOffset(stream + l, FChannels);
+            uint8_t *pOut = out + StreamOutputOffset(stream + l, FChannels);
+            pOut[0] = pIn[l][0];
+            pOut[1] = pIn[l][1];
+        }
+
+        // Predictor is the low word, the step index the third byte (TAdpcmState::Index is only 8 bits)
+        __m128i Header = _mm_setr_epi32(Read32(pIn[0]), Read32(pIn[1]), Read32(pIn[2]), Read32(pIn[3]));
+        __m128i Predictor = _mm_srai_epi32(_mm_slli_epi32(Header, 16), 16);
+        __m128i Index = _mm_srai_epi32(_mm_slli_epi32(Header, 8), 24);
+        Index = _mm_min_epi32(_mm_max_epi32(Index, Zero), IndexMax);
+
+        for (int i = 0; i < XBOX_ADPCM_CODEWORDS; i++) {
+            size_t Offset = InStride * (i + 1);
+            __m128i CodeBuf = _mm_setr_epi32(Read32(pIn[0] + Offset), Read32(pIn[1] + Offset), Read32(pIn[2] + Offset), Read32(pIn[3] + Offset));
+            for (int j = 0; j < 8; j++) {
+                __m128i StepSize = _mm_setr_epi32(StepTable32.Entry[_mm_cvtsi128_si32(Index)], StepTable32.Entry[_mm_extract_epi32(Index, 1)],
+                                                  StepTable32.Entry[_mm_extract_epi32(Index, 2)], StepTable32.Entry[_mm_extract_epi32(Index, 3)]);
+                __m128i Code = _mm_and_si128(CodeBuf, Fifteen);
+                __m128i Bit4 = _mm_cmpeq_epi32(_mm_and_si128(Code, Four), Four);
+                __m128i Bit2 = _mm_cmpeq_epi32(_mm_and_si128(Code, Two), Two);
+                __m128i Bit1 = _mm_cmpeq_epi32(_mm_and_si128(Code, One), One);
+                __m128i Sign = _mm_cmpeq_epi32(_mm_and_si128(Code, Eight), Eight);
+
+                __m128i Delta = _mm_srai_epi32(StepSize, 3);
+                Delta = _mm_add_epi32(Delta, _mm_and_si128(Bit4, StepSize));
+                Delta = _mm_add_epi32(Delta, _mm_and_si128(Bit2, _mm_srai_epi32(StepSize, 1)));
+                Delta = _mm_add_epi32(Delta, _mm_and_si128(Bit1, _mm_srai_epi32(StepSize, 2)));
+                Delta = _mm_sub_epi32(_mm_xor_si128(Delta, Sign), Sign);
+                Predictor = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(Predictor, Delta), SampleMin), SampleMax);
+                _mm_store_si128((__m128i *)Samples[i * 8 + j], Predictor);
+
+                // IndexTable : -1 without bit 2 set, 2, 4, 6 or 8 with it
+                __m128i IndexDelta = _mm_blendv_epi8(_mm_set1_epi32(-1), _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(Code, Three), 1), Two), Bit4);
+                Index = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(Index, IndexDelta), Zero), IndexMax);
+
+                CodeBuf = _mm_srli_epi32(CodeBuf, 4);
+            }
+        }
+
+        ScatterSamples<4>(Samples, out, stream, FChannels);
+    }
+
+    DecodeStreams_C(in, out, stream, streams, FChannels);
+
+    return (streams / FChannels) * XBOX_ADPCM_DSTSIZE * FChannels;
+}
+
+static size_t Decode_Blocks_AVX2(const uint8_t *in, size_t inlen, uint8_t *out, int FChannels)
+{
+    const int InStride = 4 * FChannels;
+    size_t streams = (inlen / (XBOX_ADPCM_SRCSIZE * FChannels)) * FChannels;
+    size_t stream = 0;
+
+    const __m256i Zero = _mm256_setzero_si256();
+    const __m256i One = _mm256_set1_epi32(1);
+    const __m256i Two = _mm256_set1_epi32(2);
+    const __m256i Three = _mm256_set1_epi32(3);
+    const __m256i Four = _mm256_set1_epi32(4);
+    const __m256i Eight = _mm256_set1_epi32(8);
+    const __m256i Fifteen = _mm256_set1_epi32(15);
+    const __m256i IndexMax = _mm256_set1_epi32(88);
+    const __m256i SampleMin = _mm256_set1_epi32(-32768);
+    const __m256i SampleMax = _mm256_set1_epi32(32767);
+    alignas(32) int32_t Samples[XBOX_ADPCM_SAMPLES][8];
+
+    // Gathers are indexed relative to the first of the 8 streams, which are all within 8 blocks of it
+    alignas(32) int32_t Offsets[8];
+    for (int l = 0; l < 8; l++) {
+        Offsets[l] = (int32_t)(StreamInputOffset(l, FChannels));
+    }
+    const __m256i HeaderOffsets = _mm256_load_si256((const __m256i *)Offsets);
+
+    for (; stream + 8 <= streams; stream += 8) {
+        const uint8_t *pIn = in + StreamInputOffset(stream, FChannels);
+        for (int l = 0; l < 8; l++) {
+            uint8_t *pOut = out + StreamOutputOffset(stream + l, FChannels);
+            pOut[0] = pIn[Offsets[l]];
+            pOut[1] = pIn[Offsets[l] + 1];
+        }
+
+        // Predictor is the low word, the step index the third byte (TAdpcmState::Index is only 8 bits)
+        __m256i Header = _mm256_i32gather_epi32((const int *)pIn, HeaderOffsets, 1);
+        __m256i Predictor = _mm256_srai_epi32(_mm256_slli_epi32(Header, 16), 16);
+        __m256i Index = _mm256_srai_epi32(_mm256_slli_epi32(Header, 8), 24);
+        Index = _mm256_min_epi32(_mm256_max_epi32(Index, Zero), IndexMax);
+
+        for (int i = 0; i < XBOX_ADPCM_CODEWORDS; i++) {
+            __m256i CodeOffsets = _mm256_add_epi32(HeaderOffsets, _mm256_set1_epi32(InStride * (i + 1)));
+            __m256i CodeBuf = _mm256_i32gather_epi32((const int *)pIn, CodeOffsets, 1);
+            for (int j = 0; j < 8; j++) {
+                __m256i StepSize = _mm256_i32gather_epi32((const int *)StepTable32.Entry, Index, 4);
+                __m256i Code = _mm256_and_si256(CodeBuf, Fifteen);
+                __m256i Bit4 = _mm256_cmpeq_epi32(_mm256_and_si256(Code, Four), Four);
+                __m256i Bit2 = _mm256_cmpeq_epi32(_mm256_and_si256(Code, Two), Two);
+                __m256i Bit1 = _mm256_cmpeq_epi32(_mm256_and_si256(Code, One), One);
+                __m256i Sign = _mm256_cmpeq_epi32(_mm256_and_si256(Code, Eight), Eight);
+
+                __m256i Delta = _mm256_srai_epi32(StepSize, 3);
+                Delta = _mm256_add_epi32(Delta, _mm256_and_si256(Bit4, StepSize));
+                Delta = _mm256_add_epi32(Delta, _mm256_and_si256(Bit2, _mm256_srai_epi32(StepSize, 1)));
+                Delta = _mm256_add_epi32(Delta, _mm256_and_si256(Bit1, _mm256_srai_epi32(StepSize, 2)));
+                Delta = _mm256_sub_epi32(_mm256_xor_si256(Delta, Sign), Sign);
+                Predictor = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(Predictor, Delta), SampleMin), SampleMax);
+                _mm256_store_si256((__m256i *)Samples[i * 8 + j], Predictor);
+
+                // IndexTable : -1 without bit 2 set, 2, 4, 6 or 8 with it
+                __m256i IndexDelta = _mm256_blendv_epi8(_mm256_set1_epi32(-1), _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(Code, Three), 1), Two), Bit4);
+                Index = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(Index, IndexDelta), Zero), IndexMax);
+
+                CodeBuf = _mm256_srli_epi32(CodeBuf, 4);
+            }
+        }
+
+        ScatterSamples<8>(Samples, out, stream, FChannels);
+    }
+
+    DecodeStreams_C(in, out, stream, streams, FChannels);
+
+    return (streams / FChannels) * XBOX_ADPCM_DSTSIZE * FChannels;
+}
+
+//
+// Dispatch : detect SIMD support to select the real implementation on first call
+//
+
+size_t(*TXboxAdpcmDecoder_Decode_Blocks)(const uint8_t *, size_t, uint8_t *, int) =
+[](const uint8_t *in, size_t inlen, uint8_t *out, int FChannels)
+{
+    SimdCaps supports;
+    if (supports.AVX2())
+        TXboxAdpcmDecoder_Decode_Blocks = Decode_Blocks_AVX2;
+    else if (supports.SSE41())
+        TXboxAdpcmDecoder_Decode_Blocks = Decode_Blocks_SSE41;
+    else
+        TXboxAdpcmDecoder_Decode_Blocks = Decode_Blocks_C;
+
+    return TXboxAdpcmDecoder_Decode_Blocks(in, inlen, out, FChannels);
+};
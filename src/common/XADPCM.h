@@ -93,7 +93,7 @@ const static int8_t IndexTable[16] = {
     -1, -1, -1, -1, 2, 4, 6, 8
 };
 
-int TXboxAdpcmDecoder_DecodeSample(int Code, TAdpcmState *State) {
+inline int TXboxAdpcmDecoder_DecodeSample(int Code, TAdpcmState *State) {
     int     Delta,
         Result;
 
@@ -111,7 +111,7 @@ int TXboxAdpcmDecoder_DecodeSample(int Code, TAdpcmState *State) {
     return(Result);
 }
 
-int TXboxAdpcmDecoder_Decode_Memory(uint8_t *in, int inlen, uint8_t *out, const int FChannels) {
+inline int TXboxAdpcmDecoder_Decode_Memory(uint8_t *in, int inlen, uint8_t *out, const int FChannels) {
     TAdpcmState FAdpcmState[2];
     int16_t     Buffers[2][8];
     uint32_t    CodeBuf;
@@ -150,10 +150,15 @@ int TXboxAdpcmDecoder_Decode_Memory(uint8_t *in, int inlen, uint8_t *out, const
     }
     return(outlen * XBOX_ADPCM_DSTSIZE * FChannels);
 }
-int TXboxAdpcmDecoder_guess_output_size(int SourceSize) {
+inline int TXboxAdpcmDecoder_guess_output_size(int SourceSize) {
     return((SourceSize / XBOX_ADPCM_SRCSIZE) * XBOX_ADPCM_DSTSIZE);
 }
 
+// Decodes all whole blocks (XBOX_ADPCM_SRCSIZE bytes per channel) of in straight into out, returning the
+// number of bytes written. Gives the same output as TXboxAdpcmDecoder_Decode_Memory, but decodes several
+// blocks/channels at once using SSE4.1 or AVX2 when available (selected on first call, see XADPCM.cpp).
+extern size_t(*TXboxAdpcmDecoder_Decode_Blocks)(const uint8_t *in, size_t inlen, uint8_t *out, int FChannels);
+
 #undef TXboxAdpcmDecoder_delimit
 
 #endif // XBOXADPCM_H
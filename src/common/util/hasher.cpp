@@ -0,0 +1,257 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+// The hash implemented here follows the design of xxHash's XXH3 : the input is consumed in
+// 64 byte stripes by eight independent 64 bit accumulators (which maps directly onto SSE2/AVX2
+// registers), the accumulators get scrambled after every block of stripes, and are finally
+// merged and avalanched into one 64 bit result. The plain C, SSE2 and AVX2 versions below
+// produce identical results, so it's safe to mix them (e.g. in stored hashes).
+
+#include <string.h> // For memcpy
+#include <emmintrin.h> // For SSE2 intrinsics
+#include <immintrin.h> // For AVX2 intrinsics
+#include "hasher.h"
+#include "CPUID.h" // For SimdCaps
+
+#define HASH_LANES 8
+#define HASH_STRIPES_PER_BLOCK 16
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+static const uint32_t PRIME32_1 = 0x9E3779B1U;
+static const uint32_t PRIME32_2 = 0x85EBCA77U;
+static const uint32_t PRIME32_3 = 0xC2B2AE3DU;
+
+// Keys mixed in while accumulating, scrambling and merging (8 each)
+alignas(32) static const uint64_t HashKeys[3 * HASH_LANES] = {
+	0xD729D44F0FDBC48DULL, 0x66C2FA97CB311D71ULL, 0x6E3367519F68D747ULL, 0xA74D1B9D39BF2C17ULL,
+	0x551B9865C7D6562DULL, 0x401D82ADE1549AF9ULL, 0x13DF2A71143F2711ULL, 0xB798EAF332EC66D7ULL,
+	0x8D18F764FF86038FULL, 0x8885641CC239C083ULL, 0xB7A65D8DA737BB0DULL, 0xD5F46C5CE1DBE90DULL,
+	0xA9E0D728C19835D1ULL, 0x7A15A9338922DF7FULL, 0xDBBADC9CC58AFB75ULL, 0x97386521FC0C67BFULL,
+	0xB1F3BDB394AB6C5BULL, 0x99A79B8C6EFE1A4DULL, 0x037E81E6250CEE07ULL, 0x0FABC61E4F5A7E6FULL,
+	0x620C9B629C13CA01ULL, 0xEE8CDA82B36A01A9ULL, 0x7B3AB53B3D323CB5ULL, 0x60AF0BBBC621305DULL,
+};
+
+#define ACCUMULATE_KEYS (&HashKeys[0 * HASH_LANES])
+#define SCRAMBLE_KEYS   (&HashKeys[1 * HASH_LANES])
+#define MERGE_KEYS      (&HashKeys[2 * HASH_LANES])
+
+static inline uint64_t Read64(const uint8_t* p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint64_t RotateLeft64(uint64_t x, unsigned int bits)
+{
+	return (x << bits) | (x >> (64 - bits));
+}
+
+static inline uint64_t Avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+// ******************************************************************
+// * Plain C implementation
+// ******************************************************************
+static void AccumulateStripes_C(uint64_t* acc, const uint8_t* data, size_t stripes)
+{
+	for (; stripes > 0; stripes--, data += HASH_STRIPE_SIZE) {
+		for (int i = 0; i < HASH_LANES; i++) {
+			uint64_t value = Read64(data + i * sizeof(uint64_t));
+			uint64_t keyed = value ^ ACCUMULATE_KEYS[i];
+			acc[i ^ 1] += value;
+			acc[i] += (uint64_t)(uint32_t)keyed * (keyed >> 32);
+		}
+	}
+}
+
+static void ScrambleAccumulators_C(uint64_t* acc)
+{
+	for (int i = 0; i < HASH_LANES; i++) {
+		uint64_t value = acc[i];
+		value ^= value >> 47;
+		value ^= SCRAMBLE_KEYS[i];
+		acc[i] = value * PRIME32_1;
+	}
+}
+
+// ******************************************************************
+// * SSE2 implementation
+// ******************************************************************
+static void AccumulateStripes_SSE2(uint64_t* acc, const uint8_t* data, size_t stripes)
+{
+	__m128i* const xacc = (__m128i*)acc;
+	const __m128i* const xkey = (const __m128i*)ACCUMULATE_KEYS;
+
+	for (; stripes > 0; stripes--, data += HASH_STRIPE_SIZE) {
+		const __m128i* const xdata = (const __m128i*)data;
+		for (int i = 0; i < HASH_LANES / 2; i++) {
+			__m128i value = _mm_loadu_si128(xdata + i);
+			__m128i keyed = _mm_xor_si128(value, _mm_load_si128(xkey + i));
+			// Multiply the low and high halves of each keyed 64 bit lane
+			__m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+			// Add the input to the neighbouring lane (acc[i ^ 1])
+			__m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+			xacc[i] = _mm_add_epi64(xacc[i], _mm_add_epi64(product, swapped));
+		}
+	}
+}
+
+static void ScrambleAccumulators_SSE2(uint64_t* acc)
+{
+	__m128i* const xacc = (__m128i*)acc;
+	const __m128i* const xkey = (const __m128i*)SCRAMBLE_KEYS;
+	const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+
+	for (int i = 0; i < HASH_LANES / 2; i++) {
+		__m128i value = xacc[i];
+		value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+		value = _mm_xor_si128(value, _mm_load_si128(xkey + i));
+		// There's no 64 bit multiply in SSE2, so combine two 32x32->64 bit products
+		__m128i low = _mm_mul_epu32(value, prime);
+		__m128i high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+		xacc[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+	}
+}
+
+// ******************************************************************
+// * AVX2 implementation
+// ******************************************************************
+static void AccumulateStripes_AVX2(uint64_t* acc, const uint8_t* data, size_t stripes)
+{
+	__m256i* const xacc = (__m256i*)acc;
+	const __m256i* const xkey = (const __m256i*)ACCUMULATE_KEYS;
+
+	for (; stripes > 0; stripes--, data += HASH_STRIPE_SIZE) {
+		const __m256i* const xdata = (const __m256i*)data;
+		for (int i = 0; i < HASH_LANES / 4; i++) {
+			__m256i value = _mm256_loadu_si256(xdata + i);
+			__m256i keyed = _mm256_xor_si256(value, _mm256_load_si256(xkey + i));
+			__m256i product = _mm256_mul_epu32(keyed, _mm256_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+			__m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+			xacc[i] = _mm256_add_epi64(xacc[i], _mm256_add_epi64(product, swapped));
+		}
+	}
+}
+
+static void ScrambleAccumulators_AVX2(uint64_t* acc)
+{
+	__m256i* const xacc = (__m256i*)acc;
+	const __m256i* const xkey = (const __m256i*)SCRAMBLE_KEYS;
+	const __m256i prime = _mm256_set1_epi32((int)PRIME32_1);
+
+	for (int i = 0; i < HASH_LANES / 4; i++) {
+		__m256i value = xacc[i];
+		value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 47));
+		value = _mm256_xor_si256(value, _mm256_load_si256(xkey + i));
+		__m256i low = _mm256_mul_epu32(value, prime);
+		__m256i high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+		xacc[i] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+	}
+}
+
+// Until InitHasher is called, fall back to the plain C implementation
+static void(*AccumulateStripes)(uint64_t* acc, const uint8_t* data, size_t stripes) = AccumulateStripes_C;
+static void(*ScrambleAccumulators)(uint64_t* acc) = ScrambleAccumulators_C;
+
+static inline void InitAccumulators(uint64_t* acc)
+{
+	acc[0] = PRIME32_3;
+	acc[1] = PRIME64_1;
+	acc[2] = PRIME64_2;
+	acc[3] = PRIME64_3;
+	acc[4] = PRIME64_4;
+	acc[5] = PRIME32_2;
+	acc[6] = PRIME64_5;
+	acc[7] = PRIME32_1;
+}
+
+static uint64_t MergeAccumulators(const uint64_t* acc, size_t len)
+{
+	uint64_t result = (uint64_t)len * PRIME64_1;
+	for (int i = 0; i < HASH_LANES; i += 2) {
+		uint64_t mixed = (acc[i] ^ MERGE_KEYS[i]) * PRIME64_2 + (acc[i + 1] ^ MERGE_KEYS[i + 1]);
+		result = RotateLeft64(result ^ Avalanche(mixed), 27) * PRIME64_1 + PRIME64_4;
+	}
+
+	return Avalanche(result);
+}
+
+void InitHasher()
+{
+	SimdCaps supports;
+	if (supports.AVX2()) {
+		AccumulateStripes = AccumulateStripes_AVX2;
+		ScrambleAccumulators = ScrambleAccumulators_AVX2;
+	}
+	else if (supports.SSE2()) {
+		AccumulateStripes = AccumulateStripes_SSE2;
+		ScrambleAccumulators = ScrambleAccumulators_SSE2;
+	}
+	else {
+		AccumulateStripes = AccumulateStripes_C;
+		ScrambleAccumulators = ScrambleAccumulators_C;
+	}
+}
+
+uint64_t ComputeHash(const void* data, size_t len)
+{
+	alignas(32) uint64_t acc[HASH_LANES];
+	const uint8_t* input = (const uint8_t*)data;
+	size_t stripes = len / HASH_STRIPE_SIZE;
+
+	InitAccumulators(acc);
+
+	while (stripes >= HASH_STRIPES_PER_BLOCK) {
+		AccumulateStripes(acc, input, HASH_STRIPES_PER_BLOCK);
+		ScrambleAccumulators(acc);
+		input += HASH_STRIPES_PER_BLOCK * HASH_STRIPE_SIZE;
+		stripes -= HASH_STRIPES_PER_BLOCK;
+	}
+
+	AccumulateStripes(acc, input, stripes);
+	input += stripes * HASH_STRIPE_SIZE;
+
+	// Zero-pad the last partial stripe; the length gets merged in, so padding can't cause collisions
+	size_t remainder = len % HASH_STRIPE_SIZE;
+	if (remainder > 0) {
+		alignas(32) uint8_t last[HASH_STRIPE_SIZE] = { 0 };
+		memcpy(last, input, remainder);
+		AccumulateStripes(acc, last, 1);
+	}
+
+	return MergeAccumulators(acc, len);
+}
@@ -0,0 +1,41 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#ifndef HASHER_H
+#define HASHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Size of the blocks the hasher consumes at once
+#define HASH_STRIPE_SIZE 64
+
+// Selects the fastest hash implementation supported by the host cpu (SSE2, AVX2 or plain C).
+// All implementations produce identical hashes, so this only affects speed.
+void InitHasher();
+
+// Computes a 64 bit hash over the whole buffer. Use this for change detection of guest data
+// (textures, surfaces, vertex and index buffers) and for hashing cache keys.
+uint64_t ComputeHash(const void* data, size_t len);
+
+#endif
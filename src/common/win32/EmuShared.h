@@ -175,6 +175,7 @@ class EmuShared : public Mutex
 		// ******************************************************************
 		void GetLogLv(int *value) { Lock(); *value = m_core.LogLevel; Unlock(); }
 		void SetLogLv(int *value) { Lock(); m_core.LogLevel = *value; Unlock(); }
+		void GetIsLogAsync(bool *value) { Lock(); *value = m_core.LogAsync; Unlock(); }
 
 		// ******************************************************************
 		// * Log modules value Accessors
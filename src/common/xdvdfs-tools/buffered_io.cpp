@@ -2,6 +2,8 @@
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 #define _XBOXKRNL_DEFEXTRN_
 
+#include <string.h>
+
 // prevent name collisions
 namespace xboxkrnl
 {
@@ -9,76 +11,174 @@ namespace xboxkrnl
 
 #include "buffered_io.h"
 
+static DWORD HashSector(DWORD SectorNumber)
+{
+	// Consecutive sectors land in consecutive buckets
+	return SectorNumber & (DISK_BUFFER_HASH - 1);
+}
+//------------------------------------------------------------------------------
+static void LruRemove(
+		PCDIO_READ This,
+		DWORD Index)
+{
+	if (This->LruPrev[Index] != DISK_NO_ENTRY)
+		This->LruNext[This->LruPrev[Index]] = This->LruNext[Index];
+	else
+		This->LruHead = This->LruNext[Index];
+
+	if (This->LruNext[Index] != DISK_NO_ENTRY)
+		This->LruPrev[This->LruNext[Index]] = This->LruPrev[Index];
+	else
+		This->LruTail = This->LruPrev[Index];
+}
+//------------------------------------------------------------------------------
+static void LruPushFront(
+		PCDIO_READ This,
+		DWORD Index)
+{
+	This->LruPrev[Index] = DISK_NO_ENTRY;
+	This->LruNext[Index] = This->LruHead;
+	if (This->LruHead != DISK_NO_ENTRY)
+		This->LruPrev[This->LruHead] = Index;
+	else
+		This->LruTail = Index;
+
+	This->LruHead = Index;
+}
+//------------------------------------------------------------------------------
+static DWORD FindSector(
+		PCDIO_READ This,
+		DWORD SectorNumber)
+{
+	DWORD	Index;
+
+	for(Index = This->HashTable[HashSector(SectorNumber)];Index != DISK_NO_ENTRY;Index = This->HashNext[Index])
+	{
+		if (This->SectorList[Index] == SectorNumber)
+			return Index;
+	}
+
+	return DISK_NO_ENTRY;
+}
+//------------------------------------------------------------------------------
+static void HashRemove(
+		PCDIO_READ This,
+		DWORD Index)
+{
+	DWORD	*Link;
+
+	Link = &This->HashTable[HashSector(This->SectorList[Index])];
+	while (*Link != Index)
+		Link = &This->HashNext[*Link];
+
+	*Link = This->HashNext[Index];
+	This->SectorList[Index] = DISK_NO_ENTRY;
+}
+//------------------------------------------------------------------------------
+// Evict the least recently used unlocked entry and store SectorNumber in it
+static DWORD StoreSector(
+		PCDIO_READ This,
+		DWORD SectorNumber,
+		PBYTE Data)
+{
+	DWORD	Index, Bucket;
+
+	for(Index = This->LruTail;Index != DISK_NO_ENTRY;Index = This->LruPrev[Index])
+	{
+		if (This->LockList[Index] == 0)
+			break;
+	}
+
+	// We land here if all entries were locked, and that's BAD !
+	if (Index == DISK_NO_ENTRY)
+		return DISK_NO_ENTRY;
+
+	if (This->SectorList[Index] != DISK_NO_ENTRY)
+		HashRemove(This, Index);
+
+	memcpy(&This->DiskBuffer[Index * SECTOR_SIZE], Data, SECTOR_SIZE);
+
+	Bucket = HashSector(SectorNumber);
+	This->SectorList[Index] = SectorNumber;
+	This->HashNext[Index] = This->HashTable[Bucket];
+	This->HashTable[Bucket] = Index;
+
+	LruRemove(This, Index);
+	LruPushFront(This, Index);
+	return Index;
+}
+//------------------------------------------------------------------------------
+void InitBufferedSectors(
+		PCDIO_READ This)
+{
+	DWORD	i;
+
+	for(i = 0;i < DISK_BUFFER_HASH;i++)
+		This->HashTable[i] = DISK_NO_ENTRY;
+
+	This->LruHead = DISK_NO_ENTRY;
+	This->LruTail = DISK_NO_ENTRY;
+	for(i = 0;i < DISK_BUFFER;i++)
+	{
+		This->SectorList[i] = DISK_NO_ENTRY;
+		This->LockList[i] = 0;
+		This->HashNext[i] = DISK_NO_ENTRY;
+		LruPushFront(This, i);
+	}
+}
+//------------------------------------------------------------------------------
 PBYTE GetSectorBuffered(
 		PCDIO_READ This,
 		DWORD SectorNumber)
 {
-	int		i, index;
-	PBYTE	Ptr;
+	DWORD	Index, Count, i;
 
 	// Have we got this baby in buffer ?
-	for(i = 0;i < DISK_BUFFER;i++)
+	Index = FindSector(This, SectorNumber);
+	if (Index != DISK_NO_ENTRY)
 	{
-		if (This->SectorList[i] == SectorNumber)
-		{
-			This->LockList[i]++;
-			return(&This->DiskBuffer[i * SECTOR_SIZE]);
-		}
+		This->LockList[Index]++;
+		LruRemove(This, Index);
+		LruPushFront(This, Index);
+		return(&This->DiskBuffer[Index * SECTOR_SIZE]);
 	}
 
-	// Nope, load the sector and store it in buffer
-	for(i = 0;i < DISK_BUFFER;i++)
+	// Nope, load it together with the sectors following it (which are likely
+	// to be needed next), falling back to a single sector near the end of the disk
+	Count = DISK_READ_AHEAD;
+	if (!This->Sectors(This->Data, This->ReadAheadBuffer, SectorNumber, Count))
 	{
-		if (This->LockList[This->WriteIndex] == 0)
-		{
-			// Take an entry into the ring buffer but do not
-			// write the sector number yet (this is needed
-			// for re-entrancy purposes
-			Ptr = &This->DiskBuffer[This->WriteIndex * SECTOR_SIZE];
-
-			This->LockList[This->WriteIndex]++;
-			This->SectorList[This->WriteIndex] = 0;
-
-			index = This->WriteIndex;
-			This->WriteIndex++;
-			This->WriteIndex %= DISK_BUFFER;
-
-			if (This->Sectors(This->Data, Ptr, SectorNumber, 1))
-			{
-				// OK, write the sector number and exit
-				This->SectorList[index] = SectorNumber;
-				return(Ptr);
-			}
-
-			// If something went bad free the slot
-			This->SectorList[index] = 0;
-			This->LockList[index]--;
+		Count = 1;
+		if (!This->Sectors(This->Data, This->ReadAheadBuffer, SectorNumber, Count))
 			return NULL;
-		}
+	}
 
-		This->WriteIndex++;
-		This->WriteIndex %= DISK_BUFFER;
+	// Store the following sectors first, so that the requested one ends up
+	// as the most recently used
+	for(i = Count - 1;i > 0;i--)
+	{
+		if (FindSector(This, SectorNumber + i) == DISK_NO_ENTRY)
+			StoreSector(This, SectorNumber + i, &This->ReadAheadBuffer[i * SECTOR_SIZE]);
 	}
 
-	// We land here if all entries were locked, and that's BAD !
-	return NULL;
+	Index = StoreSector(This, SectorNumber, This->ReadAheadBuffer);
+	if (Index == DISK_NO_ENTRY)
+		return NULL;
+
+	This->LockList[Index]++;
+	return(&This->DiskBuffer[Index * SECTOR_SIZE]);
 }
 //------------------------------------------------------------------------------
 void ReleaseBufferedSector(
 		PCDIO_READ This,
 		DWORD SectorNumber)
 {
-	int     i;
+	DWORD	Index;
 
-	// Find the sector in the lock list and decrease its usage count
-	for(i = 0;i < DISK_BUFFER;i++)
-	{
-		if ((This->SectorList[i] == SectorNumber)&&(This->LockList[i]))
-		{
-			This->LockList[i]--;
-			return;
-		}
-	}
+	// Find the sector and decrease its usage count
+	Index = FindSector(This, SectorNumber);
+	if ((Index != DISK_NO_ENTRY)&&(This->LockList[Index]))
+		This->LockList[Index]--;
 }
 
 } // namespace
@@ -14,13 +14,28 @@ extern "C" {
 #define SECTOR_SIZE 2048
 
 // Determines how many sectors are buffered in each instance of CDIO_READ
-#define DISK_BUFFER		64
+#define DISK_BUFFER		256
+
+// Number of buckets in the sector number hash index (must be a power of two)
+#define DISK_BUFFER_HASH	512
+
+// Determines how many consecutive sectors are read at once when a sector isn't buffered yet
+#define DISK_READ_AHEAD	16
+
+// Marks unused entries and the end of hash chains and the LRU list
+#define DISK_NO_ENTRY	0xFFFFFFFF
 
 typedef struct {
-	DWORD	SectorList[DISK_BUFFER];		// Ring buffer for buffered disk i/o
+	DWORD	SectorList[DISK_BUFFER];		// Sector held by each buffer entry (or DISK_NO_ENTRY)
 	DWORD	LockList[DISK_BUFFER];			// Lock for each buffered sector
+	DWORD	HashNext[DISK_BUFFER];			// Next entry in the same hash bucket
+	DWORD	LruPrev[DISK_BUFFER];			// Previous (more recently used) entry
+	DWORD	LruNext[DISK_BUFFER];			// Next (less recently used) entry
+	DWORD	HashTable[DISK_BUFFER_HASH];	// First entry of each hash bucket
+	DWORD	LruHead;						// Most recently used entry
+	DWORD	LruTail;						// Least recently used entry
 	BYTE	DiskBuffer[SECTOR_SIZE * DISK_BUFFER];	// Storage room for buffered sectors
-	DWORD	WriteIndex;						// Write pointer
+	BYTE	ReadAheadBuffer[SECTOR_SIZE * DISK_READ_AHEAD];	// Staging room for multi-sector reads
 
 	// Pointer to arbitrary data passed at init
 	// (usually a file or device handle)
@@ -34,6 +49,10 @@ typedef struct {
 
 } CDIO_READ, *PCDIO_READ;
 
+// Empty the buffer (must be called before first use)
+extern void InitBufferedSectors(
+				PCDIO_READ This);
+
 // Get a sector from buffer and lock it
 extern PBYTE GetSectorBuffered(
 				PCDIO_READ This,
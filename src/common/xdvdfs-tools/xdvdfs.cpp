@@ -26,16 +26,19 @@
 
 #define VOLUME_DESCRIPTOR_SECTOR_OFFSET 32
 
-#if BYTE_ORDER == BIG_ENDIAN
+// Note : MSVC doesn't define BYTE_ORDER, in which case BYTE_ORDER == BIG_ENDIAN would hold (as 0 == 0)
+#if defined(BYTE_ORDER) && defined(BIG_ENDIAN) && (BYTE_ORDER == BIG_ENDIAN)
 //#define ENDIAN_SAFE16(a) ((((a)&0xFF00)>>8)|(((a)&0xFF)<<8))
 #define ENDIAN_SAFE32(a) ((((a)&0xFF000000)>>24)|(((a)&0x00FF0000)>>8)|(((a)&0x0000FF00)<<8)|(((a)&0xFF)<<24))
-#elif BYTE_ORDER == LITTLE_ENDIAN
+#else
 //#define ENDIAN_SAFE16(a) (a)
 #define ENDIAN_SAFE32(a) (a)
-#else
-#error "xdvdfs.c: Looks like endianness is not defined."
 #endif
 
+// Where the game partition starts on the known disc layouts (XGD1, XGD2 and XGD3),
+// checked before scanning for the volume descriptor sector by sector
+static const DWORD KnownFileSystemBaseSectors[] = { 0, 0x30600, 0x1FB20, 0x4100 };
+
 // Directory Entry
 typedef struct {
 	WORD		LeftSubTree;
@@ -47,17 +50,251 @@ typedef struct {
 	BYTE		Filename[FILENAME_SIZE];
 } XDVDFS_DIRECTORY_ENTRY, *PXDVDFS_DIRECTORY_ENTRY;
 
+// Case insensitive FNV-1a hash of a filename
+static DWORD	HashFilename(
+			PCHAR	Filename,
+			DWORD	Length)
+{
+	DWORD	Hash = 2166136261u;
+	DWORD	i;
+
+	for (i = 0; i < Length; i++)
+	{
+		Hash ^= (BYTE)UPPERCASE(Filename[i]);
+		Hash *= 16777619u;
+	}
+
+	return Hash;
+}
+
+// Case insensitive filename order, used to sort the directory indices
+static int	CompareIndexEntries(
+			const void	*A,
+			const void	*B)
+{
+	PXDVDFS_INDEX_ENTRY	EntryA = (PXDVDFS_INDEX_ENTRY)A;
+	PXDVDFS_INDEX_ENTRY	EntryB = (PXDVDFS_INDEX_ENTRY)B;
+	DWORD				i;
+
+	for (i = 0; (i < EntryA->FilenameLength) && (i < EntryB->FilenameLength); i++)
+	{
+		if (UPPERCASE(EntryA->Filename[i]) != UPPERCASE(EntryB->Filename[i]))
+			return (int)UPPERCASE(EntryA->Filename[i]) - (int)UPPERCASE(EntryB->Filename[i]);
+	}
+
+	return (int)EntryA->FilenameLength - (int)EntryB->FilenameLength;
+}
+
+// Walk the on-disc entries of a directory, counting them or filling the index
+// Note: Entries never cross sectors, the rest of a sector is padded with 0xFF
+static DWORD	ParseDirectory(
+			PBYTE					Directory,
+			DWORD					DirectorySize,
+			PXDVDFS_INDEX_ENTRY		Entries,
+			PCHAR					Names,
+			PDWORD					NamesSize)
+{
+	PXDVDFS_DIRECTORY_ENTRY	Entry;
+	DWORD					Position, Offset, Count;
+
+	Count = 0;
+	*NamesSize = 0;
+	Position = 0;
+	while (Position < DirectorySize)
+	{
+		Entry = (PXDVDFS_DIRECTORY_ENTRY)&Directory[Position];
+		Offset = Position % SECTOR_SIZE;
+		// If the header doesn't fit, or Entry->FileStartSector = 0xFFFFFFFF, we
+		// reached the last entry of the sector
+		if ((Offset + offsetof(XDVDFS_DIRECTORY_ENTRY, Filename) > SECTOR_SIZE) ||
+			(Position + offsetof(XDVDFS_DIRECTORY_ENTRY, Filename) > DirectorySize) ||
+			(Entry->FileStartSector == 0xFFFFFFFF) ||
+			(Offset + offsetof(XDVDFS_DIRECTORY_ENTRY, Filename) + Entry->FilenameLength > SECTOR_SIZE))
+		{
+			Position = (Position & ~(SECTOR_SIZE - 1)) + SECTOR_SIZE;
+			continue;
+		}
+
+		if (Entry->FilenameLength)
+		{
+			if (Entries)
+			{
+				Entries[Count].FileStartSector = ENDIAN_SAFE32(Entry->FileStartSector);
+				Entries[Count].FileSize = ENDIAN_SAFE32(Entry->FileSize);
+				Entries[Count].FileAttributes = Entry->FileAttributes;
+				Entries[Count].FilenameLength = Entry->FilenameLength;
+				Entries[Count].Filename = &Names[*NamesSize];
+				memcpy(Entries[Count].Filename, Entry->Filename, Entry->FilenameLength);
+				Entries[Count].Filename[Entry->FilenameLength] = 0;
+				Entries[Count].NameHash = HashFilename(Entries[Count].Filename, Entry->FilenameLength);
+			}
+
+			Count++;
+			*NamesSize += Entry->FilenameLength + 1;
+		}
+
+		// Advance to next entry
+		Position += Entry->FilenameLength + offsetof(XDVDFS_DIRECTORY_ENTRY, Filename);
+		if (Position & 3)
+		{
+			Position &= ~3;
+			Position += 4;
+		}
+	}
+
+	return Count;
+}
+
+// Get the index of a directory, reading the whole directory in on first use
+static PXDVDFS_DIRECTORY_INDEX	GetDirectoryIndex(
+			PXDVDFS_SESSION	Session,
+			DWORD			StartSector,
+			DWORD			DirectorySize)
+{
+	PXDVDFS_DIRECTORY_INDEX	Index;
+	PBYTE					Directory;
+	PCHAR					Names;
+	DWORD					Bucket, Count, NamesSize, TableSize, Sectors, i, Slot;
+
+	Bucket = StartSector % XDVDFS_INDEX_BUCKETS;
+	for (Index = Session->DirectoryIndex[Bucket]; Index; Index = Index->Next)
+	{
+		if (Index->DirectoryStartSector == StartSector)
+			return Index;
+	}
+
+	// Read in the whole directory (bypassing the sector buffer, it's only needed once)
+	Sectors = (DirectorySize + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	Directory = (PBYTE)malloc(Sectors ? Sectors * SECTOR_SIZE : 1);
+	if (!Directory)
+		return NULL;
+
+	for (i = 0; i < Sectors; i += MIN(Sectors - i, TRANSFER_SIZE))
+	{
+		if (!Session->Read.Sectors(
+				Session->Read.Data,
+				&Directory[i * SECTOR_SIZE],
+				StartSector + i,
+				MIN(Sectors - i, TRANSFER_SIZE)))
+		{
+			free(Directory);
+			return NULL;
+		}
+	}
+
+	// Size the hash table to at most half full
+	Count = ParseDirectory(Directory, DirectorySize, NULL, NULL, &NamesSize);
+	for (TableSize = 2; TableSize < Count * 2; TableSize *= 2)
+		;
+
+	// Allocate the index, its entries, hash table and names in one go
+	Index = (PXDVDFS_DIRECTORY_INDEX)malloc(sizeof(XDVDFS_DIRECTORY_INDEX) +
+		(Count * sizeof(XDVDFS_INDEX_ENTRY)) + (TableSize * sizeof(DWORD)) + NamesSize);
+	if (!Index)
+	{
+		free(Directory);
+		return NULL;
+	}
+
+	Index->DirectoryStartSector = StartSector;
+	Index->EntryCount = Count;
+	Index->Entries = (PXDVDFS_INDEX_ENTRY)(Index + 1);
+	Index->HashTable = (PDWORD)(Index->Entries + Count);
+	Index->HashMask = TableSize - 1;
+	Names = (PCHAR)(Index->HashTable + TableSize);
+
+	ParseDirectory(Directory, DirectorySize, Index->Entries, Names, &NamesSize);
+	free(Directory);
+
+	// Sort the entries for enumeration, then hash them by name
+	qsort(Index->Entries, Count, sizeof(XDVDFS_INDEX_ENTRY), CompareIndexEntries);
+	memset(Index->HashTable, 0, TableSize * sizeof(DWORD));
+	for (i = 0; i < Count; i++)
+	{
+		Slot = Index->Entries[i].NameHash & Index->HashMask;
+		while (Index->HashTable[Slot])
+			Slot = (Slot + 1) & Index->HashMask;
+
+		Index->HashTable[Slot] = i + 1;
+	}
+
+	Index->Next = Session->DirectoryIndex[Bucket];
+	Session->DirectoryIndex[Bucket] = Index;
+	return Index;
+}
+
+// Find a filename (which doesn't have to be zero terminated) in a directory index
+static PXDVDFS_INDEX_ENTRY	FindIndexEntry(
+			PXDVDFS_DIRECTORY_INDEX	Index,
+			PCHAR					Filename,
+			DWORD					Length)
+{
+	PXDVDFS_INDEX_ENTRY	Entry;
+	DWORD				Hash, Slot, i;
+
+	Hash = HashFilename(Filename, Length);
+	for (Slot = Hash & Index->HashMask; Index->HashTable[Slot]; Slot = (Slot + 1) & Index->HashMask)
+	{
+		Entry = &Index->Entries[Index->HashTable[Slot] - 1];
+		if ((Entry->NameHash != Hash) || (Entry->FilenameLength != Length))
+			continue;
+
+		for (i = 0; i < Length; i++)
+		{
+			if (UPPERCASE(Filename[i]) != UPPERCASE(Entry->Filename[i]))
+				break;
+		}
+
+		if (i == Length)
+			return Entry;
+	}
+
+	return NULL;
+}
+
+// Fill in the current file of a search record from an index entry
+static void	SetCurrentFile(
+			PXDVDFS_SESSION		Session,
+			PXDVDFS_INDEX_ENTRY	Entry,
+			PSEARCH_RECORD		SearchRecord)
+{
+	memcpy(SearchRecord->CurrentFilename, Entry->Filename, Entry->FilenameLength + 1);
+	SearchRecord->CurrentFileAttributes = Entry->FileAttributes;
+	SearchRecord->CurrentFileSize = Entry->FileSize;
+	// Cxbx addition : Correct all sector-numbers with file system base sector :
+	SearchRecord->CurrentFileStartSector = Entry->FileStartSector + Session->FileSystemBaseSector;
+	SearchRecord->CurrentFileEndSector = SearchRecord->CurrentFileStartSector
+								 + (SearchRecord->CurrentFileSize / SECTOR_SIZE);
+	if (SearchRecord->CurrentFileSize % SECTOR_SIZE)
+		SearchRecord->CurrentFileEndSector++;
+}
+
 // XDVDFS init a session object
 BOOL	XDVDFS_Mount(
 			PXDVDFS_SESSION	Session,
 			BOOL			(*ReadFunc)(PVOID, PVOID, DWORD, DWORD),
 			PVOID			Data)
 {
+	DWORD	i;
+
 	Session->Read.Data = Data;
 	Session->Read.Sectors = ReadFunc;
 
 	XDVDFS_UnMount(Session);
 
+	// try the known layouts first
+	for (i = 0; i < sizeof(KnownFileSystemBaseSectors) / sizeof(KnownFileSystemBaseSectors[0]); i++) {
+		Session->FileSystemBaseSector = KnownFileSystemBaseSectors[i];
+		if (Session->Read.Sectors(
+			Session->Read.Data,
+			(PVOID)&Session->Root,
+			Session->FileSystemBaseSector + VOLUME_DESCRIPTOR_SECTOR_OFFSET,
+			1) &&
+			(memcmp(Session->Root.Signature1, XDVDFS_Signature, SIGNATURE_SIZE) == 0) &&
+			(memcmp(Session->Root.Signature2, XDVDFS_Signature, SIGNATURE_SIZE) == 0))
+			return TRUE;
+	}
+
 	// scan sectors until the signature is found
 	Session->FileSystemBaseSector = 0;
 	while (1) {
@@ -97,10 +334,22 @@ BOOL	XDVDFS_Mount(
 BOOL	XDVDFS_UnMount(
 			PXDVDFS_SESSION	Session)
 {
-	// Reset ring buffer
-	memset(Session->Read.SectorList, 0, sizeof(DWORD) * DISK_BUFFER);
-	memset(Session->Read.LockList, 0, sizeof(DWORD) * DISK_BUFFER);
-	Session->Read.WriteIndex = 0;
+	PXDVDFS_DIRECTORY_INDEX	Index;
+	DWORD					i;
+
+	// Reset sector buffer
+	InitBufferedSectors(&Session->Read);
+	// Drop the directory indices
+	for (i = 0; i < XDVDFS_INDEX_BUCKETS; i++)
+	{
+		while (Session->DirectoryIndex[i])
+		{
+			Index = Session->DirectoryIndex[i];
+			Session->DirectoryIndex[i] = Index->Next;
+			free(Index);
+		}
+	}
+
 	// Invalidate all open files & search structures
 	Session->Magic++;
 	return TRUE;
@@ -124,88 +373,42 @@ DWORD	XDVDFS_GetRootDir(
 }
 
 // Enumerate files
+// Note: Files are returned in name order, from the directory index
 DWORD	XDVDFS_EnumFiles(
 			PXDVDFS_SESSION	Session,
 			PSEARCH_RECORD	SearchRecord)
 {
-	PXDVDFS_DIRECTORY_ENTRY	Entry;
-	DWORD					SectorNumber, Position, i;
-	PBYTE					Ptr;
+	PXDVDFS_DIRECTORY_INDEX	Index;
 
-enum_retry:
 	// Check structure validity
 	if (SearchRecord->Magic != Session->Magic)
 		return XDVDFS_EXPIRED_SESSION;
 
-	// Check if we reached the end of the directory
-	if (SearchRecord->Position >= SearchRecord->DirectorySize)
-		return XDVDFS_NO_MORE_FILES;
-
-	// Get current position in sector, remainder
-	SectorNumber = SearchRecord->Position / SECTOR_SIZE;
-	Position = SearchRecord->Position % SECTOR_SIZE;
-	// Get the current sector in buffer and lock it
-	Ptr = GetSectorBuffered(&Session->Read,
-							SectorNumber + SearchRecord->SearchStartSector);
-	if (!Ptr)
+	// Get the index of the directory
+	Index = GetDirectoryIndex(Session, SearchRecord->SearchStartSector, SearchRecord->DirectorySize);
+	if (!Index)
 		return XDVDFS_DISK_ERROR;
 
-	// If we're at the begining...
-	if (!SearchRecord->Position)
-	{
-		// ...bufferize the whole dir.
-		for(i = 1;i < MIN(DISK_BUFFER - 1, SearchRecord->DirectorySize / SECTOR_SIZE);i++)
-		{
-			GetSectorBuffered(&Session->Read, i + SearchRecord->SearchStartSector);
-			ReleaseBufferedSector(&Session->Read, i + SearchRecord->SearchStartSector);
-		}
-	}
-
-	Entry = (PXDVDFS_DIRECTORY_ENTRY)&Ptr[Position];
-	// If Entry->FileStartSector = 0xFFFFFFFF or Position > 2040, we reached the last
-	// entry of the sector
-	if ((Position > (SECTOR_SIZE - offsetof(XDVDFS_DIRECTORY_ENTRY, FileStartSector)))||(Entry->FileStartSector == 0xFFFFFFFF))
-	{
-		// Let's get the next one
-		ReleaseBufferedSector(&Session->Read,
-								SectorNumber + SearchRecord->SearchStartSector);
-		SearchRecord->Position = (SearchRecord->Position & ~(SECTOR_SIZE - 1)) + SECTOR_SIZE;
-		goto enum_retry;
-	}
-
-	// Copy the filename (filenames up to 255 chars)
-	memcpy(SearchRecord->CurrentFilename, Entry->Filename, Entry->FilenameLength);
-	SearchRecord->CurrentFilename[Entry->FilenameLength] = 0;
-	// Copy file parameters in the search_rec
-	SearchRecord->CurrentFileAttributes = Entry->FileAttributes;
-	SearchRecord->CurrentFileSize = ENDIAN_SAFE32(Entry->FileSize);
-	// Cxbx addition : Correct all sector-numbers with file system base sector :
-	SearchRecord->CurrentFileStartSector = ENDIAN_SAFE32(Entry->FileStartSector) + Session->FileSystemBaseSector;
-	SearchRecord->CurrentFileEndSector = SearchRecord->CurrentFileStartSector
-								 + (SearchRecord->CurrentFileSize / SECTOR_SIZE);
-	if (SearchRecord->CurrentFileSize % SECTOR_SIZE)
-		SearchRecord->CurrentFileEndSector++;
-
-	// Advance to next entry
-	SearchRecord->Position += Entry->FilenameLength + offsetof(XDVDFS_DIRECTORY_ENTRY, Filename);
-	if (SearchRecord->Position & 3)
-	{
-		SearchRecord->Position &= ~3;
-		SearchRecord->Position += 4;
-	}
+	// Check if we reached the end of the directory
+	if (SearchRecord->Position >= Index->EntryCount)
+		return XDVDFS_NO_MORE_FILES;
 
-	// Free the buffer
-	ReleaseBufferedSector(&Session->Read,
-							SectorNumber + SearchRecord->SearchStartSector);
+	// Copy the entry and advance to the next one
+	SetCurrentFile(Session, &Index->Entries[SearchRecord->Position], SearchRecord);
+	SearchRecord->Position++;
 	return XDVDFS_NO_ERROR;
 }
 
+// Find a file given its path
+// Note: Every path component is a hash lookup in the (cached) index of its directory
 DWORD	XDVDFS_GetFileInfo(
 			PXDVDFS_SESSION	Session,
 			LPSTR 			Filename,
 			PSEARCH_RECORD	SearchRecord)
 {
-	DWORD   Length, i, ReturnCode;
+	PXDVDFS_DIRECTORY_INDEX	Index;
+	PXDVDFS_INDEX_ENTRY		Entry;
+	DWORD					Length;
 
 	// To begin, we will enter the root directory
 	XDVDFS_GetRootDir(Session, SearchRecord);
@@ -213,62 +416,40 @@ DWORD	XDVDFS_GetFileInfo(
 	SearchRecord->CurrentFileSize = SearchRecord->DirectorySize;
 	SearchRecord->CurrentFileAttributes = XDVDFS_ATTRIBUTE_DIRECTORY;
 	SearchRecord->CurrentFilename[0] = 0;
-	// Skip leading backslash if present
-	if (*Filename == DIRECTORY_SEPARATOR)
-		Filename++;
-	
+
 	while(*Filename)
 	{
 		// Skip backslashes
 		while(*Filename == DIRECTORY_SEPARATOR)
 			Filename++;
 
+		// Trailing backslashes name the directory itself
+		if (!*Filename)
+			break;
+
 		// If previously matched name is not a dir, fail
 		if (!(SearchRecord->CurrentFileAttributes & XDVDFS_ATTRIBUTE_DIRECTORY))
 			return XDVDFS_FILE_NOT_FOUND;
 
-		// Enter that directory
+		// Calculate length of the path component
 		Length = 0;
+		while((Filename[Length]) && (Filename[Length] != DIRECTORY_SEPARATOR))
+			Length++;
+
+		// Enter that directory
 		SearchRecord->SearchStartSector = SearchRecord->CurrentFileStartSector;
 		SearchRecord->DirectorySize = SearchRecord->CurrentFileSize;
-		SearchRecord->Position = 0;
-		// Browse the contents of the dir
-		while( (ReturnCode = XDVDFS_EnumFiles(Session, SearchRecord)) ==
-			XDVDFS_NO_ERROR)
-		{
-			// Dxbx addition : Stop at first file if no further path is given
-			if (*Filename == 0)
-				break;
+		Index = GetDirectoryIndex(Session, SearchRecord->SearchStartSector, SearchRecord->DirectorySize);
+		if (!Index)
+			return XDVDFS_DISK_ERROR;
 
-			// Calculate length of the filename
-			Length = 0;
-			while( (SearchRecord->CurrentFilename[Length])&&
-				(SearchRecord->CurrentFilename[Length] != DIRECTORY_SEPARATOR) )
-					Length++;
-
-			// Match the filename against the one given
-			for(i = 0;i < Length;i++)
-			{
-				if ((Filename[i] == DIRECTORY_SEPARATOR)||
-					(!Filename[i])||
-					(UPPERCASE(Filename[i]) !=
-					UPPERCASE(SearchRecord->CurrentFilename[i])))
-						break;
-			}
-
-			// If it matched, exit
-			if ((i == Length)&&((Filename[i] == 0)
-				||(Filename[i] == DIRECTORY_SEPARATOR)))
-				break;
-		}
-
-		// If we reached the end of the dir without matching, fail
-		if (ReturnCode == XDVDFS_NO_MORE_FILES)
+		// Look the component up, failing if it's not there
+		Entry = FindIndexEntry(Index, Filename, Length);
+		if (!Entry)
 			return XDVDFS_FILE_NOT_FOUND;
 
-		// If any other error occured, fail
-		if (ReturnCode != XDVDFS_NO_ERROR)
-			return ReturnCode;
+		SetCurrentFile(Session, Entry, SearchRecord);
+		SearchRecord->Position = (DWORD)(Entry - Index->Entries) + 1;
 
 		// Match next part of the given filename
 		Filename += Length;
@@ -325,7 +506,6 @@ DWORD	XDVDFS_OpenFile(
 
 	// Copy file info into the FILE_RECORD structure
 	FileRecord->Magic = SearchRecord.Magic;
-	FileRecord->PartialSector = 0;
 	FileRecord->FileStartSector = SearchRecord.CurrentFileStartSector;
 	FileRecord->FileSize = SearchRecord.CurrentFileSize;
 	FileRecord->CurrentPosition = 0;
@@ -348,7 +528,6 @@ DWORD	XDVDFS_OpenFileEx(
 
 	// Copy file info into the FILE_RECORD structure
 	FileRecord->Magic = SearchRecord->Magic;
-	FileRecord->PartialSector = 0;
 	FileRecord->FileStartSector = SearchRecord->CurrentFileStartSector;
 	FileRecord->FileSize = SearchRecord->CurrentFileSize;
 	FileRecord->CurrentPosition = 0;
@@ -364,6 +543,7 @@ DWORD	XDVDFS_FileRead(
 {
 	DWORD   CurrentSector, Position, PartialRead, Readed, i;
 	PBYTE	Buffer = (PBYTE)OutBuffer;
+	PBYTE	Ptr;
 
 	Readed = 0;
 	// Check structure validity
@@ -378,27 +558,21 @@ DWORD	XDVDFS_FileRead(
 	if (!Size)
 		return Readed;
 
-	// Process partial sector read before
+	// Process partial sector read before (through the sector buffer, as small
+	// reads tend to hit the same or neighbouring sectors)
 	Position = FileRecord->CurrentPosition % SECTOR_SIZE;
 	if (Position)
 	{
 		CurrentSector = (FileRecord->CurrentPosition / SECTOR_SIZE) +
 			FileRecord->FileStartSector;
 		PartialRead = MIN(Size, SECTOR_SIZE - Position);
-		if (FileRecord->PartialSector != CurrentSector)
-		{
-			if (!Session->Read.Sectors(
-								Session->Read.Data,
-								FileRecord->PartialData,
-								CurrentSector,
-								1))
-				return 0;
+		Ptr = GetSectorBuffered(&Session->Read, CurrentSector);
+		if (!Ptr)
+			return 0;
 
-			FileRecord->PartialSector = CurrentSector;
-		}
-
-		for(i = 0;i < PartialRead;i++)
-			*Buffer++ = FileRecord->PartialData[Position++];
+		memcpy(Buffer, &Ptr[Position], PartialRead);
+		ReleaseBufferedSector(&Session->Read, CurrentSector);
+		Buffer += PartialRead;
 
 		Size -= PartialRead;
 		Readed += PartialRead;
@@ -440,20 +614,12 @@ DWORD	XDVDFS_FileRead(
 	PartialRead = Size;
 	CurrentSector = (FileRecord->CurrentPosition / SECTOR_SIZE)
 						+ FileRecord->FileStartSector;
-	if (FileRecord->PartialSector != CurrentSector)
-	{
-		if (!Session->Read.Sectors(
-							Session->Read.Data,
-							FileRecord->PartialData,
-							CurrentSector,
-							1))
-			return Readed;
-
-		FileRecord->PartialSector = CurrentSector;
-	}
+	Ptr = GetSectorBuffered(&Session->Read, CurrentSector);
+	if (!Ptr)
+		return Readed;
 
-	for(i = 0;i < PartialRead;i++)
-		*Buffer++ = FileRecord->PartialData[i];
+	memcpy(Buffer, Ptr, PartialRead);
+	ReleaseBufferedSector(&Session->Read, CurrentSector);
 
 	Readed += PartialRead;
 	FileRecord->CurrentPosition += PartialRead;
@@ -13,14 +13,17 @@ extern "C" {
 
 #include "buffered_io.h"
 
-CONST CHAR *XDVDFS_Signature = "MICROSOFT*XBOX*MEDIA";
+static CONST CHAR XDVDFS_Signature[] = "MICROSOFT*XBOX*MEDIA";
 
 //-- Defines ------------------------------------------------------------------
 
-#define SIGNATURE_SIZE sizeof(XDVDFS_Signature)
+#define SIGNATURE_SIZE (sizeof(XDVDFS_Signature) - 1)
 
 #define FILENAME_SIZE 256
 
+// Number of buckets of the per-session directory index hash (keyed by directory start sector)
+#define XDVDFS_INDEX_BUCKETS 1024
+
 // Attributes
 #define XDVDFS_ATTRIBUTE_READONLY	0x01
 #define XDVDFS_ATTRIBUTE_HIDDEN		0x02
@@ -54,7 +57,30 @@ typedef struct {
 	BYTE		Signature2[SIGNATURE_SIZE];
 } XDVDFS_VOLUME_DESCRIPTOR, *PXDVDFS_VOLUME_DESCRIPTOR;
 
+// In-memory form of a directory entry
+typedef struct {
+	DWORD		NameHash;
+	DWORD		FileStartSector;
+	DWORD		FileSize;
+	BYTE		FileAttributes;
+	BYTE		FilenameLength;
+	PCHAR		Filename;
+} XDVDFS_INDEX_ENTRY, *PXDVDFS_INDEX_ENTRY;
+
+// Directory index, built the first time a directory is searched or enumerated.
+// Entries are sorted by upper-cased name, the hash table maps names to entries.
+typedef struct _XDVDFS_DIRECTORY_INDEX {
+	struct _XDVDFS_DIRECTORY_INDEX	*Next;
+	DWORD							DirectoryStartSector;
+	DWORD							EntryCount;
+	PXDVDFS_INDEX_ENTRY				Entries;
+	// Entry number + 1 per slot, 0 for free slots (open addressing)
+	PDWORD							HashTable;
+	DWORD							HashMask;
+} XDVDFS_DIRECTORY_INDEX, *PXDVDFS_DIRECTORY_INDEX;
+
 // XDVDFS session
+// Note : Must be zero initialized before the first XDVDFS_Mount
 typedef struct {
 	// Start sector of current session
 	DWORD						FileSystemBaseSector;
@@ -65,6 +91,9 @@ typedef struct {
 	// Our little interface for reading sectors
 	CDIO_READ					Read;
 
+	// Indices of the directories touched so far, freed on unmount
+	PXDVDFS_DIRECTORY_INDEX		DirectoryIndex[XDVDFS_INDEX_BUCKETS];
+
 	// The dword below is incremented when the filesystem is unmounted
 	// automatically invalidating all open files and search records
 	DWORD						Magic;
@@ -73,8 +102,6 @@ typedef struct {
 // File Record
 typedef struct {
 	DWORD	Magic;
-	BYTE	PartialData[SECTOR_SIZE];
-	DWORD	PartialSector;
 	DWORD	FileStartSector;
 	DWORD	FileSize;
 	DWORD	CurrentPosition;
@@ -85,7 +112,7 @@ typedef struct {
 	DWORD	Magic;
 	DWORD	SearchStartSector;
 	DWORD	DirectorySize;
-	DWORD	Position;
+	DWORD	Position; // Number of (name sorted) entries enumerated so far
 	BYTE	CurrentFilename[FILENAME_SIZE];
 	DWORD	CurrentFileAttributes;
 	DWORD	CurrentFileSize;
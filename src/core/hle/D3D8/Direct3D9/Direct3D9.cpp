@@ -27,7 +27,7 @@
 #define _XBOXKRNL_DEFEXTRN_
 #define LOG_PREFIX CXBXR_MODULE::D3D8
 
-#include "common\util\xxhash32.h"
+#include "common\util\hasher.h" // For ComputeHash
 #include <condition_variable>
 
 // prevent name collisions
@@ -40,6 +40,7 @@ namespace xboxkrnl
 #include "CxbxVersion.h"
 #include "core\kernel\init\CxbxKrnl.h"
 #include "core\kernel\support\Emu.h"
+#include "core\kernel\exports\EmuKrnl.h" // For AvpGetRefreshRate
 #include "core\kernel\support\EmuFS.h"
 #include "EmuShared.h"
 #include "gui\DbgConsole.h"
@@ -209,9 +210,12 @@ g_EmuCDPD = {0};
 #define DEBUG_D3DRESULT(hRet, message) \
 	do { \
 		LOG_CHECK_ENABLED(LOG_LEVEL::DEBUG) { \
-			if (FAILED(hRet)) \
-				if(g_bPrintfOn) \
-					printf("%s%s : %s D3D error (0x%.08X: %s)\n", _logThreadPrefix.c_str(), _logFuncPrefix.c_str(), message, hRet, D3DErrorString(hRet)); \
+			if (FAILED(hRet) && g_bPrintfOn) { \
+				LOG_FUNC_DECL \
+				LOG_THREAD_INIT \
+				LOG_FUNC_PREFIX_INIT(__func__) \
+				printf("%s%s : %s D3D error (0x%.08X: %s)\n", _logThreadPrefix.c_str(), _logFuncPrefix.c_str(), message, hRet, D3DErrorString(hRet)); \
+			} \
 		} \
 	} while (0)
 
@@ -717,7 +721,7 @@ typedef struct {
 	DWORD dwXboxResourceType = 0;
 	void* pXboxData = nullptr;
 	size_t szXboxDataSize = 0;
-	uint32_t hash = 0;
+	uint64_t hash = 0;
 	bool forceRehash = false;
 	std::chrono::time_point<std::chrono::high_resolution_clock> nextHashTime;
 	std::chrono::milliseconds hashLifeTime = 1ms;
@@ -867,8 +871,8 @@ bool HostResourceRequiresUpdate(resource_key_t key, DWORD dwSize)
 
 	auto now = std::chrono::high_resolution_clock::now();
 	if (now > it->second.nextHashTime || it->second.forceRehash) {
-		uint32_t oldHash = it->second.hash;
-		it->second.hash = XXHash32::hash(it->second.pXboxData, it->second.szXboxDataSize, 0);
+		uint64_t oldHash = it->second.hash;
+		it->second.hash = ComputeHash(it->second.pXboxData, it->second.szXboxDataSize);
 
 		if (it->second.hash != oldHash) {
 			// The data changed, so reset the hash lifetime
@@ -906,7 +910,7 @@ void SetHostResource(XTL::X_D3DResource* pXboxResource, XTL::IDirect3DResource*
 	resourceInfo.dwXboxResourceType = GetXboxCommonResourceType(pXboxResource);
 	resourceInfo.pXboxData = GetDataFromXboxResource(pXboxResource);
 	resourceInfo.szXboxDataSize = dwSize > 0 ? dwSize : GetXboxResourceSize(pXboxResource);
-	resourceInfo.hash = XXHash32::hash(resourceInfo.pXboxData, resourceInfo.szXboxDataSize, 0);
+	resourceInfo.hash = ComputeHash(resourceInfo.pXboxData, resourceInfo.szXboxDataSize);
 	resourceInfo.hashLifeTime = 1ms;
 	resourceInfo.lastUpdate = std::chrono::high_resolution_clock::now();
 	resourceInfo.nextHashTime = resourceInfo.lastUpdate + resourceInfo.hashLifeTime;
@@ -1712,15 +1716,19 @@ static LRESULT WINAPI EmuMsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPar
     return S_OK; // = Is not part of D3D8 handling.
 }
 
-std::chrono::time_point<std::chrono::steady_clock, std::chrono::duration<double, std::nano>> GetNextVBlankTime()
+std::chrono::duration<double, std::nano> GetVBlankPeriod()
 {
+	// The refresh rate comes from the mode last set with AvSetDisplayMode, which is only called when
+	// Direct3D_CreateDevice is unpatched. Otherwise this stays at 60hz
 	// TODO: Read display frequency from Xbox Display Adapter
 	// This is accessed by calling CMiniport::GetRefreshRate(); 
 	// This reads from the structure located at CMinpPort::m_CurrentAvInfo
-	// This will require at least Direct3D_CreateDevice being unpatched
-	// otherwise, m_CurrentAvInfo will never be initialised!
-	// 20ms should be used in the case of 50hz
-	return std::chrono::steady_clock::now() + 16.6666666667ms;
+	return std::chrono::duration<double, std::nano>(1s) / AvpGetRefreshRate();
+}
+
+std::chrono::time_point<std::chrono::steady_clock, std::chrono::duration<double, std::nano>> GetNextVBlankTime()
+{
+	return std::chrono::steady_clock::now() + GetVBlankPeriod();
 }
 
 
@@ -2314,7 +2322,7 @@ static void EmuVerifyResourceIsRegistered(XTL::X_D3DResource *pResource, DWORD D
 }
 
 typedef struct {
-	DWORD Hash = 0;
+	uint64_t Hash = 0;
 	DWORD IndexCount = 0;
 	XTL::IDirect3DIndexBuffer* pHostIndexBuffer = nullptr;
 } ConvertedIndexBuffer;
@@ -2332,8 +2340,6 @@ void CxbxUpdateActiveIndexBuffer
 	UINT          IndexCount
 )
 {
-	LOG_INIT; // Allows use of DEBUG_D3DRESULT
-
 	// Create a reference to the active buffer
 	ConvertedIndexBuffer& indexBuffer = g_ConvertedIndexBuffers[pIndexData];
 
@@ -2370,7 +2376,7 @@ void CxbxUpdateActiveIndexBuffer
 	}
 
 	// If the data needs updating, do so
-	uint32_t uiHash = XXHash32::hash(pIndexData, IndexCount * 2, 0);
+	uint64_t uiHash = ComputeHash(pIndexData, IndexCount * 2);
 	if (uiHash != indexBuffer.Hash)	{
 		// Update the Index Count and the hash
 		indexBuffer.IndexCount = IndexCount;
@@ -6886,8 +6892,6 @@ XTL::INDEX16 *CxbxAssureQuadListIndexBuffer(UINT NrOfQuadVertices)
 // TODO : Move to own file
 void CxbxAssureQuadListD3DIndexBuffer(UINT NrOfQuadVertices)
 {
-	LOG_INIT // Allows use of DEBUG_D3DRESULT
-
 	HRESULT hRet;
 
 	if (QuadToTriangleD3DIndexBuffer_Size < NrOfQuadVertices)
@@ -6941,8 +6945,6 @@ void CxbxAssureQuadListD3DIndexBuffer(UINT NrOfQuadVertices)
 // Calls SetIndices with a separate index-buffer, that's populated with the supplied indices.
 void CxbxDrawIndexedClosingLine(XTL::INDEX16 LowIndex, XTL::INDEX16 HighIndex)
 {
-	LOG_INIT // Allows use of DEBUG_D3DRESULT
-
 	HRESULT hRet;
 
 	const UINT uiIndexBufferSize = sizeof(XTL::INDEX16) * 2; // 4 bytes needed for 2 indices
@@ -6988,8 +6990,6 @@ void CxbxDrawIndexedClosingLine(XTL::INDEX16 LowIndex, XTL::INDEX16 HighIndex)
 // TODO : Move to own file
 void CxbxDrawIndexedClosingLineUP(XTL::INDEX16 LowIndex, XTL::INDEX16 HighIndex, void *pHostVertexStreamZeroData, UINT uiHostVertexStreamZeroStride)
 {
-	LOG_INIT // Allows use of DEBUG_D3DRESULT
-
 	XTL::INDEX16 CxbxClosingLineIndices[2] = { LowIndex, HighIndex };
 
 	HRESULT hRet = g_pD3DDevice->DrawIndexedPrimitiveUP(
@@ -7011,8 +7011,6 @@ void CxbxDrawIndexedClosingLineUP(XTL::INDEX16 LowIndex, XTL::INDEX16 HighIndex,
 // Called by D3DDevice_DrawIndexedVertices and EmuExecutePushBufferRaw (twice)
 void XTL::CxbxDrawIndexed(CxbxDrawContext &DrawContext)
 {
-	LOG_INIT // Allows use of DEBUG_D3DRESULT
-
 	assert(DrawContext.dwStartVertex == 0);
 	assert(DrawContext.pIndexData != nullptr);
 	assert(IsValidCurrentShader());
@@ -7094,8 +7092,6 @@ void XTL::CxbxDrawIndexed(CxbxDrawContext &DrawContext)
 // Called by D3DDevice_DrawVerticesUP, EmuExecutePushBufferRaw and EmuFlushIVB
 void XTL::CxbxDrawPrimitiveUP(CxbxDrawContext &DrawContext)
 {
-	LOG_INIT // Allows use of DEBUG_D3DRESULT
-
 	assert(DrawContext.dwStartVertex == 0);
 	assert(DrawContext.pXboxVertexStreamZeroData != NULL);
 	assert(DrawContext.uiXboxVertexStreamZeroStride > 0);
@@ -7158,8 +7154,6 @@ void XTL::CxbxDrawPrimitiveUP(CxbxDrawContext &DrawContext)
 
 void EmuUpdateActiveTextureStages()
 {
-	LOG_INIT;
-
 	for (int i = 0; i < TEXTURE_STAGES; i++)
 	{
 		XTL::X_D3DBaseTexture *pBaseTexture = XTL::EmuD3DActiveTexture[i];
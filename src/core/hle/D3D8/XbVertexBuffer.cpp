@@ -29,7 +29,6 @@
 #define LOG_PREFIX CXBXR_MODULE::VTXB
 
 #include "core\kernel\memory-manager\VMManager.h"
-#include "common\util\xxhash32.h" // For XXHash32::hash()
 #include "core\kernel\support\Emu.h"
 #include "core\kernel\support\EmuXTL.h"
 #include "core\hle\D3D8\ResourceTracker.h"
@@ -138,8 +137,6 @@ void ActivatePatchedStream
 	bool bRelease
 )
 {
-	//LOG_INIT // Allows use of DEBUG_D3DRESULT
-
 	// Use the cached stream values on the host
 	if (pPatchedStream->bCacheIsStreamZeroDrawUP) {
 		// Set the UserPointer variables in the drawing context
@@ -36,6 +36,8 @@ namespace xboxkrnl {
 
 #include <dsound.h>
 #include <thread>
+#include <chrono>
+#include <atomic>
 #include "core\kernel\init\CxbxKrnl.h"
 #include "core\kernel\support\Emu.h"
 #include "core\kernel\support\EmuFS.h"
@@ -45,6 +47,7 @@ namespace xboxkrnl {
 
 #include "Logging.h"
 #include "DirectSoundLogging.hpp"
+#include "DirectSoundMixer.hpp"
 #include "..\XbDSoundLogging.hpp"
 
 #include <mmreg.h>
@@ -198,6 +201,15 @@ DWORD                               g_dwXbMemAllocated = 0;
 DWORD                               g_dwFree2DBuffers = 0;
 DWORD                               g_dwFree3DBuffers = 0;
 std::thread dsound_thread;
+// Streams which have their packets processed asynchronously (after FlushEx) are handed over to
+// dsound_thread_worker, which sleeps until signaled or until the next packet should be done
+#define DSOUND_STREAM_WORKER_MAX_TIMEOUT 50 // in milliseconds
+static HANDLE                       g_DSoundStreamWorkEvent = NULL;
+static vector_ds_stream             g_DSoundStreamAsyncWork;
+// Worker statistics, to see how much (or little) the worker wakes up on idle audio scenes
+static std::atomic<uint64_t>        g_DSoundStreamWorkerWakeups { 0 };
+static std::atomic<uint64_t>        g_DSoundStreamWorkerPackets { 0 };
+static std::atomic<uint64_t>        g_DSoundStreamWorkerIdleUs { 0 };
 static void dsound_thread_worker(LPVOID);
 
 #define RETURN_RESULT_CHECK(hRet) { \
@@ -217,6 +229,11 @@ void CxbxInitAudio()
     g_EmuShared->GetAudioSettings(&g_XBAudio);
 }
 
+void CxbxShutdownAudio()
+{
+    DSoundMixerStop();
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -242,6 +259,9 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreate)
 
     if (!initialized) {
         InitializeCriticalSection(&g_DSoundCriticalSection);
+        InitializeCriticalSection(&g_DSoundListenerCriticalSection);
+        InitializeCriticalSection(&g_DSoundStreamWorkCriticalSection);
+        g_DSoundStreamWorkEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
         dsound_thread = std::thread(dsound_thread_worker, nullptr);
     }
 
@@ -295,6 +315,11 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreate)
             CxbxKrnlCleanup("g_pDSound8->SetCooperativeLevel Failed!");
         }
 
+        // Voices get mixed internally and played through a single host buffer from here on
+        if (g_XBAudio.software_mixer) {
+            DSoundMixerStart(g_pDSound8);
+        }
+
         // clear sound buffer cache
         vector_ds_buffer::iterator ppDSBuffer = g_pDSoundBufferCache.begin();
         for (; ppDSBuffer != g_pDSoundBufferCache.end();) {
@@ -330,7 +355,11 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreate)
         // But how to set DSBCAPS_CTRLFX on primary buffer or should it be set for all current and future cache buffers?
         // We need LPDIRECTSOUNDFXI3DL2REVERB8 / IID_IDirectSoundFXI3DL2Reverb8 or use LPDIRECTSOUNDBUFFER8 / IID_IDirectSoundBuffer8
 
-        hRet = g_pDSoundPrimaryBuffer->QueryInterface(IID_IDirectSound3DListener8, (LPVOID*)&g_pDSoundPrimary3DListener8);
+        if (g_pDSoundMixer != nullptr) {
+            hRet = DSoundMixerCreate3DListener(g_pDSoundPrimary3DListener8);
+        } else {
+            hRet = g_pDSoundPrimaryBuffer->QueryInterface(IID_IDirectSound3DListener8, (LPVOID*)&g_pDSoundPrimary3DListener8);
+        }
 
         if (hRet != DS_OK) {
             CxbxKrnlCleanup("Creating primary 3D Listener for DirectSound Failed!");
@@ -458,6 +487,63 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_DownloadEffectsImage)
     return S_OK;
 }
 
+// Hand a stream over to dsound_thread_worker, once it has packets to be processed asynchronously
+// NOTE: Must be called within the stream's critical section.
+static void DSoundStreamQueueAsyncWork(XTL::X_CDirectSoundStream* pThis)
+{
+    if ((pThis->EmuFlags & DSE_FLAG_FLUSH_ASYNC) == 0 || pThis->Xb_rtFlushEx != 0 || pThis->Host_BufferPacketArray.size() == 0) {
+        return;
+    }
+
+    enterStreamWorkCriticalSection;
+
+    if (std::find(g_DSoundStreamAsyncWork.begin(), g_DSoundStreamAsyncWork.end(), pThis) == g_DSoundStreamAsyncWork.end()) {
+        g_DSoundStreamAsyncWork.push_back(pThis);
+    }
+
+    leaveStreamWorkCriticalSection;
+
+    SetEvent(g_DSoundStreamWorkEvent);
+}
+
+// Drop a reference to a stream, the last one frees the stream along with its critical section
+// NOTE: Must be called outside of the stream's critical section.
+static void DSoundStreamDereference(XTL::X_CDirectSoundStream* pThis)
+{
+    if (InterlockedDecrement(&pThis->Host_RefCount) == 0) {
+        DeleteCriticalSection(&pThis->Host_CriticalSection);
+        delete pThis;
+    }
+}
+
+// Milliseconds until the write cursor passes the end of the stream's current packet, which is when
+// DSoundStreamProcess has something to do again.
+// NOTE: Must be called within the stream's critical section.
+static DWORD DSoundStreamGetAsyncTimeout(XTL::X_CDirectSoundStream* pThis)
+{
+    // Paused streams make no progress until told otherwise, just check back on them now and then.
+    if ((pThis->EmuFlags & (DSE_FLAG_PAUSE | DSE_FLAG_SYNCHPLAYBACK_CONTROL)) > 0) {
+        return DSOUND_STREAM_WORKER_MAX_TIMEOUT;
+    }
+
+    DWORD writePos = 0;
+    XTL::host_voice_packet &packet = pThis->Host_BufferPacketArray.front();
+    if (packet.isWritten == false || pThis->EmuDirectSoundBuffer8->GetCurrentPosition(nullptr, &writePos) != DS_OK) {
+        return 1;
+    }
+
+    // The packet may wrap around the end of the host buffer.
+    int64_t remaining = (int64_t)packet.rangeStart + packet.xmp_data.dwMaxSize - writePos;
+    if (remaining > (int64_t)pThis->EmuBufferDesc.dwBufferBytes) {
+        remaining -= pThis->EmuBufferDesc.dwBufferBytes;
+    } else if (remaining < 0) {
+        remaining += pThis->EmuBufferDesc.dwBufferBytes;
+    }
+
+    DWORD dwTimeout = (DWORD)(remaining * 1000 / pThis->EmuBufferDesc.lpwfxFormat->nAvgBytesPerSec) + 1;
+    return std::min<DWORD>(dwTimeout, DSOUND_STREAM_WORKER_MAX_TIMEOUT);
+}
+
 // ******************************************************************
 // * patch: DirectSoundDoWork
 // ******************************************************************
@@ -476,15 +562,18 @@ VOID WINAPI XTL::EMUPATCH(DirectSoundDoWork)()
 
     vector_ds_buffer::iterator ppDSBuffer = g_pDSoundBufferCache.begin();
     for (; ppDSBuffer != g_pDSoundBufferCache.end(); ppDSBuffer++) {
-        if ((*ppDSBuffer)->Host_lock.pLockPtr1 == nullptr || (*ppDSBuffer)->EmuBufferToggle != X_DSB_TOGGLE_DEFAULT) {
+        XTL::X_CDirectSoundBuffer* pThis = *ppDSBuffer;
+        enterObjectCriticalSection(pThis);
+        if (pThis->Host_lock.pLockPtr1 == nullptr || pThis->EmuBufferToggle != X_DSB_TOGGLE_DEFAULT) {
+            leaveObjectCriticalSection(pThis);
             continue;
         }
-        XTL::X_CDirectSoundBuffer* pThis = *ppDSBuffer;
         // However there's a chance of locked buffers has been set which needs to be unlock.
         DSoundGenericUnlock(pThis->EmuFlags,
                             pThis->EmuDirectSoundBuffer8,
                             pThis->EmuBufferDesc,
                             pThis->Host_lock,
+                            pThis->Host_shadow,
                             pThis->X_BufferCache,
                             pThis->X_lock.dwLockOffset,
                             pThis->X_lock.dwLockBytes1,
@@ -501,15 +590,19 @@ VOID WINAPI XTL::EMUPATCH(DirectSoundDoWork)()
             pThis->Xb_rtStopEx = 0LL;
             pThis->EmuDirectSoundBuffer8->Stop();
         }
+
+        leaveObjectCriticalSection(pThis);
     }
 
     // Actually, DirectSoundStream need to process buffer packets here.
     vector_ds_stream::iterator ppDSStream = g_pDSoundStreamCache.begin();
     for (; ppDSStream != g_pDSoundStreamCache.end(); ppDSStream++) {
-        if ((*ppDSStream)->Host_BufferPacketArray.size() == 0) {
+        X_CDirectSoundStream* pThis = (*ppDSStream);
+        enterObjectCriticalSection(pThis);
+        if (pThis->Host_BufferPacketArray.size() == 0) {
+            leaveObjectCriticalSection(pThis);
             continue;
         }
-        X_CDirectSoundStream* pThis = (*ppDSStream);
         // TODO: Do we need this in async thread loop?
         if (pThis->Xb_rtPauseEx != 0 && pThis->Xb_rtPauseEx <= getTime.QuadPart) {
             pThis->Xb_rtPauseEx = 0LL;
@@ -523,8 +616,11 @@ VOID WINAPI XTL::EMUPATCH(DirectSoundDoWork)()
             if (pThis->Xb_rtFlushEx != 0 && pThis->Xb_rtFlushEx <= getTime.QuadPart) {
                 pThis->Xb_rtFlushEx = 0LL;
                 DSoundStreamProcess(pThis);
+                DSoundStreamQueueAsyncWork(pThis);
             }
         }
+
+        leaveObjectCriticalSection(pThis);
     }
 
     leaveCriticalSection;
@@ -536,21 +632,69 @@ static void dsound_thread_worker(LPVOID nullPtr)
 {
 	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
 
+    DWORD dwTimeout = INFINITE;
+    vector_ds_stream asyncWork;
+    auto lastReport = std::chrono::steady_clock::now();
     while (true) {
-		Sleep(0);
-        enterCriticalSection;
+        auto waitStart = std::chrono::steady_clock::now();
+        WaitForSingleObject(g_DSoundStreamWorkEvent, dwTimeout);
+        auto waitEnd = std::chrono::steady_clock::now();
+        g_DSoundStreamWorkerWakeups++;
+        g_DSoundStreamWorkerIdleUs += std::chrono::duration_cast<std::chrono::microseconds>(waitEnd - waitStart).count();
+
+        // The streams are referenced while still linked, so the title releasing one meanwhile can't free it
+        enterStreamWorkCriticalSection;
+        asyncWork = g_DSoundStreamAsyncWork;
+        for (auto pThis : asyncWork) {
+            InterlockedIncrement(&pThis->Host_RefCount);
+        }
+        leaveStreamWorkCriticalSection;
 
-        vector_ds_stream::iterator ppDSStream = g_pDSoundStreamCache.begin();
-        for (; ppDSStream != g_pDSoundStreamCache.end(); ppDSStream++) {
-            if ((*ppDSStream)->Host_BufferPacketArray.size() == 0) {
+        // Only visit the streams which were handed over, until they run out of packets (or got flushed)
+        dwTimeout = INFINITE;
+        for (auto pThis : asyncWork) {
+            enterObjectCriticalSection(pThis);
+
+            // Released by the title after the list was taken, it's already unlinked
+            if (pThis->EmuDirectSoundBuffer8 == nullptr) {
+                leaveObjectCriticalSection(pThis);
+                DSoundStreamDereference(pThis);
                 continue;
             }
-            if (((*ppDSStream)->EmuFlags & DSE_FLAG_FLUSH_ASYNC) > 0 && (*ppDSStream)->Xb_rtFlushEx == 0) {
-                DSoundStreamProcess((*ppDSStream));
+
+            if ((pThis->EmuFlags & DSE_FLAG_FLUSH_ASYNC) > 0 && pThis->Xb_rtFlushEx == 0) {
+                size_t packetCount = pThis->Host_BufferPacketArray.size();
+                DSoundStreamProcess(pThis);
+                g_DSoundStreamWorkerPackets += packetCount - pThis->Host_BufferPacketArray.size();
+            }
+
+            if ((pThis->EmuFlags & DSE_FLAG_FLUSH_ASYNC) == 0 || pThis->Xb_rtFlushEx != 0 || pThis->Host_BufferPacketArray.size() == 0) {
+                // Must be removed before leaving the stream's lock, or a packet queued in between would be lost.
+                enterStreamWorkCriticalSection;
+                vector_ds_stream::iterator ppDSStream = std::find(g_DSoundStreamAsyncWork.begin(), g_DSoundStreamAsyncWork.end(), pThis);
+                if (ppDSStream != g_DSoundStreamAsyncWork.end()) {
+                    g_DSoundStreamAsyncWork.erase(ppDSStream);
+                }
+                leaveStreamWorkCriticalSection;
+            } else {
+                dwTimeout = std::min(dwTimeout, DSoundStreamGetAsyncTimeout(pThis));
             }
+
+            leaveObjectCriticalSection(pThis);
+            DSoundStreamDereference(pThis);
         }
 
-        leaveCriticalSection;
+        if (waitEnd - lastReport >= std::chrono::seconds(10)) {
+            lastReport = waitEnd;
+            EmuLog(LOG_LEVEL::DEBUG, "Stream worker: %llu wakeups, %llu packets processed, %llu ms idle",
+                   (uint64_t)g_DSoundStreamWorkerWakeups, (uint64_t)g_DSoundStreamWorkerPackets, (uint64_t)g_DSoundStreamWorkerIdleUs / 1000);
+            for (DSoundLockSite* site = g_DSoundLockSites.load(); site != nullptr; site = site->Next) {
+                if (site->Contended > 0) {
+                    EmuLog(LOG_LEVEL::DEBUG, "Lock contention in %s: %u of %u acquisitions",
+                           site->Function, (uint32_t)site->Contended, (uint32_t)site->Acquired);
+                }
+            }
+        }
     }
 }
 
@@ -571,7 +715,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetOrientation)
     FLOAT           zTop,
     DWORD           dwApply)
 {
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -596,7 +740,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetOrientation)
         hRet = g_pDSoundPrimary3DListener8->SetOrientation(xFront, yFront, zFront, xTop, yTop, zTop, dwApply);
     }
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -737,7 +881,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBinVolumes_12)
     DWORD                   dwMixBinMask,
     const LONG*             alVolumes)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -750,7 +894,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBinVolumes_12)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -769,7 +913,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMixBinVolumes_8)
 		LOG_FUNC_ARG(pMixBins)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pMixBins, pThis->EmuFlags, pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pMixBins, pThis->EmuFlags, pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -783,7 +933,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetPosition)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -795,7 +945,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetPosition)
 
     HRESULT hRet = g_pDSoundPrimary3DListener8->SetPosition(x, y, z, dwApply);
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -811,7 +961,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetVelocity)
     FLOAT                   z,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -823,7 +973,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetVelocity)
 
     HRESULT hRet = g_pDSoundPrimary3DListener8->SetVelocity(x, y, z, dwApply);
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -838,7 +988,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetAllParameters)
     LPCDS3DLISTENER         pDS3DListenerParameters,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -848,7 +998,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_SetAllParameters)
 
     HRESULT hRet = g_pDSoundPrimary3DListener8->SetAllParameters(pDS3DListenerParameters, dwApply);
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -860,13 +1010,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSound_CommitDeferredSettings)
 (
     X_CDirectSound*         pThis)
 {
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
 	LOG_FUNC_ONE_ARG(pThis);
 
     HRESULT hRet = g_pDSoundPrimary3DListener8->CommitDeferredSettings();
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -924,6 +1074,7 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateBuffer)
 
         // TODO: Garbage Collection
         *ppBuffer = new X_CDirectSoundBuffer();
+        InitializeCriticalSection(&(*ppBuffer)->Host_CriticalSection);
 
         DSoundBufferSetDefault((*ppBuffer), 0);
         (*ppBuffer)->Host_lock = { 0 };
@@ -997,7 +1148,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
     LPVOID                  pvBufferData,
     DWORD                   dwBufferBytes)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -1013,6 +1164,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
                             pThis->EmuDirectSoundBuffer8,
                             pThis->EmuBufferDesc,
                             pThis->Host_lock,
+                            pThis->Host_shadow,
                             xbnullptr,
                             pThis->X_lock.dwLockOffset,
                             pThis->X_lock.dwLockBytes1,
@@ -1022,7 +1174,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
     //TODO: Current workaround method since dwBufferBytes do set to zero. Otherwise it will produce lock error message.
     if (dwBufferBytes == 0) {
 
-        leaveCriticalSection;
+        leaveObjectCriticalSection(pThis);
         return DS_OK;
     }
     HRESULT hRet = DSERR_OUTOFMEMORY;
@@ -1070,7 +1222,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetBufferData)
 
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -1084,7 +1236,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPlayRegion)
     DWORD                   dwPlayStart,
     DWORD                   dwPlayLength)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1116,7 +1268,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPlayRegion)
         }
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -1135,7 +1287,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
     LPDWORD                 pdwAudioBytes2,
     DWORD                   dwFlags)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1156,6 +1308,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
+                        pThis->Host_shadow,
                         pThis->X_BufferCache,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
@@ -1174,8 +1327,8 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
         CxbxKrnlCleanup("DirectSoundBuffer Lock Failed!");
     }
 
-    // Host lock position
-    pThis->Host_lock.dwLockOffset = pcmOffset;
+    // Host lock position, entire buffer locks always start at the beginning of the host buffer.
+    pThis->Host_lock.dwLockOffset = (dwFlags & DSBLOCK_ENTIREBUFFER) ? 0 : pcmOffset;
     pThis->Host_lock.dwLockFlags = dwFlags;
     pThis->X_lock.dwLockFlags = dwFlags;
 
@@ -1190,7 +1343,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Lock)
         *ppvAudioPtr2 = xbnullptr;
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1207,7 +1360,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Unlock)
     DWORD                   pdwAudioBytes2
     )
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -1234,12 +1387,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Unlock)
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
+                        pThis->Host_shadow,
                         pThis->X_BufferCache,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
                         pThis->X_lock.dwLockBytes2);
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -1257,8 +1411,14 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetHeadroom)
 		LOG_FUNC_ARG(dwHeadroom)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, dwHeadroom, pThis->Xb_dwHeadroom,
-                                               pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->EmuFlags);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, dwHeadroom, pThis->Xb_dwHeadroom,
+                                                       pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->EmuFlags);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -1270,7 +1430,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetLoopRegion)
     DWORD                   dwLoopStart,
     DWORD                   dwLoopLength)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1298,7 +1458,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetLoopRegion)
         }
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -1317,6 +1477,8 @@ ULONG WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Release)
     ULONG uRet = 0;
 
     //if (!(pThis->EmuFlags & DSE_FLAG_RECIEVEDATA)) {
+        enterObjectCriticalSection(pThis);
+
         uRet = pThis->EmuDirectSoundBuffer8->Release();
 
         if (uRet == 0) {
@@ -1338,7 +1500,11 @@ ULONG WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Release)
                 DSoundSGEMemDealloc(pThis->X_BufferCacheSize);
             }
 
+            leaveObjectCriticalSection(pThis);
+            DeleteCriticalSection(&pThis->Host_CriticalSection);
             delete pThis;
+        } else {
+            leaveObjectCriticalSection(pThis);
         }
     //}
 
@@ -1360,7 +1526,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPitch)
 		LOG_FUNC_ARG(lPitch)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -1371,7 +1543,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetStatus)
     X_CDirectSoundBuffer*   pThis,
     OUT LPDWORD             pdwStatus)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1399,7 +1571,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetStatus)
         hRet = DSERR_INVALIDPARAM;
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -1412,7 +1584,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetCurrentPosition)
     X_CDirectSoundBuffer*   pThis,
     DWORD                   dwNewPosition)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1428,7 +1600,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetCurrentPosition)
         EmuLog(LOG_LEVEL::WARNING, "SetCurrentPosition Failed!");
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1448,7 +1620,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetCurrentPosition)
 		LOG_FUNC_ARG_OUT(pdwCurrentWriteCursor)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_GetCurrentPosition(pThis->EmuDirectSoundBuffer8, pdwCurrentPlayCursor, pdwCurrentWriteCursor, pThis->EmuFlags);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_GetCurrentPosition(pThis->EmuDirectSoundBuffer8, pdwCurrentPlayCursor, pdwCurrentWriteCursor, pThis->EmuFlags);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -1461,7 +1639,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Play)
     DWORD                   dwReserved2,
     DWORD                   dwFlags)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1474,6 +1652,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Play)
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
+                        pThis->Host_shadow,
                         pThis->X_BufferCache,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
@@ -1511,7 +1690,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Play)
         }
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1523,19 +1702,19 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Stop)
 (
     X_CDirectSoundBuffer*   pThis)
 {
-    enterCriticalSection;
-
 	LOG_FUNC_ONE_ARG(pThis);
 
     HRESULT hRet = D3D_OK;
 
     if (pThis != nullptr) {
+        enterObjectCriticalSection(pThis);
+
         // TODO : Test Stop (emulated via Stop + SetCurrentPosition(0)) :
         hRet = pThis->EmuDirectSoundBuffer8->Stop();
         pThis->EmuDirectSoundBuffer8->SetCurrentPosition(0);
-    }
 
-    leaveCriticalSection;
+        leaveObjectCriticalSection(pThis);
+    }
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1549,7 +1728,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_StopEx)
     REFERENCE_TIME          rtTimeStamp,
     DWORD                   dwFlags)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -1630,7 +1809,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_StopEx)
         }
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -1648,8 +1827,14 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetVolume)
 		LOG_FUNC_ARG(lVolume)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags, &pThis->Xb_Volume,
-                                             pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags, &pThis->Xb_Volume,
+                                                     pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -1665,7 +1850,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFrequency)
 		LOG_FUNC_ARG(dwFrequency)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -1703,6 +1894,8 @@ HRESULT WINAPI XTL::EMUPATCH(DirectSoundCreateStream)
     } else {
         // TODO: Garbage Collection
         *ppStream = new X_CDirectSoundStream();
+        InitializeCriticalSection(&(*ppStream)->Host_CriticalSection);
+        (*ppStream)->Host_RefCount = 1;
 
         DSBUFFERDESC DSBufferDesc = { 0 };
 
@@ -1830,8 +2023,14 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetVolume)
 		LOG_FUNC_ARG(lVolume)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags, &pThis->Xb_Volume,
-                                             pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags, &pThis->Xb_Volume,
+                                                     pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -1843,7 +2042,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetRolloffFactor)
     FLOAT                   fRolloffFactor,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1855,7 +2054,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetRolloffFactor)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -1869,7 +2068,13 @@ ULONG WINAPI XTL::EMUPATCH(CDirectSoundStream_AddRef)
 {
 	LOG_FUNC_ONE_ARG(pThis);
 
-    return HybridDirectSoundBuffer_AddRef(pThis->EmuDirectSoundBuffer8);
+    enterObjectCriticalSection(pThis);
+
+    ULONG uRet = HybridDirectSoundBuffer_AddRef(pThis->EmuDirectSoundBuffer8);
+
+    leaveObjectCriticalSection(pThis);
+
+    return uRet;
 }
 
 // ******************************************************************
@@ -1885,6 +2090,8 @@ ULONG WINAPI XTL::EMUPATCH(CDirectSoundStream_Release)
 
     ULONG uRet = 0;
     if (pThis != 0 && (pThis->EmuDirectSoundBuffer8 != 0)) {
+        enterObjectCriticalSection(pThis);
+
         uRet = pThis->EmuDirectSoundBuffer8->Release();
 
         if (uRet == 0) {
@@ -1897,6 +2104,12 @@ ULONG WINAPI XTL::EMUPATCH(CDirectSoundStream_Release)
             if (ppDSStream != g_pDSoundStreamCache.end()) {
                 g_pDSoundStreamCache.erase(ppDSStream);
             }
+            enterStreamWorkCriticalSection;
+            ppDSStream = std::find(g_DSoundStreamAsyncWork.begin(), g_DSoundStreamAsyncWork.end(), pThis);
+            if (ppDSStream != g_DSoundStreamAsyncWork.end()) {
+                g_DSoundStreamAsyncWork.erase(ppDSStream);
+            }
+            leaveStreamWorkCriticalSection;
 
             for (auto buffer = pThis->Host_BufferPacketArray.begin(); buffer != pThis->Host_BufferPacketArray.end();) {
                 DSoundStreamClearPacket(buffer, XMP_STATUS_RELEASE_CXBXR, nullptr, nullptr, pThis);
@@ -1904,10 +2117,17 @@ ULONG WINAPI XTL::EMUPATCH(CDirectSoundStream_Release)
 
             if (pThis->EmuBufferDesc.lpwfxFormat != nullptr) {
                 free(pThis->EmuBufferDesc.lpwfxFormat);
+                pThis->EmuBufferDesc.lpwfxFormat = nullptr;
             }
             // NOTE: Do not release X_BufferCache! X_BufferCache is using xbox buffer.
 
-            delete pThis;
+            // Tells dsound_thread_worker, which may still reference the stream, to leave it alone
+            pThis->EmuDirectSoundBuffer8 = nullptr;
+
+            leaveObjectCriticalSection(pThis);
+            DSoundStreamDereference(pThis);
+        } else {
+            leaveObjectCriticalSection(pThis);
         }
     }
 
@@ -1924,7 +2144,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetInfo)
     X_CDirectSoundStream*   pThis,
     OUT LPXMEDIAINFO            pInfo)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -1938,7 +2158,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetInfo)
         pInfo->dwMaxLookahead = std::max(static_cast<uint32_t>(pThis->EmuBufferDesc.lpwfxFormat->nChannels * static_cast<uint32_t>(pThis->EmuBufferDesc.lpwfxFormat->wBitsPerSample) / 8) * 32, static_cast<uint32_t>(pThis->EmuBufferDesc.lpwfxFormat->nBlockAlign) * 2);
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -1951,7 +2171,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetStatus)
     X_CDirectSoundStream*   pThis,
     OUT DWORD*              pdwStatus)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -1994,7 +2214,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetStatus)
         *pdwStatus = 0;
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -2008,7 +2228,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Process)
     PXMEDIAPACKET           pInputBuffer,
     PXMEDIAPACKET           pOutputBuffer)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2055,6 +2275,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Process)
                 if (pThis->Host_isProcessing == false && pThis->Host_BufferPacketArray.size() == 1) {
                     pThis->EmuDirectSoundBuffer8->SetCurrentPosition(packet_input.rangeStart);
                 }
+                DSoundStreamQueueAsyncWork(pThis);
             // Once full it needs to change status to flushed when cannot hold any more packets.
             } else {
                 if (pInputBuffer->pdwStatus != xbnullptr) {
@@ -2075,7 +2296,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Process)
         }
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -2087,7 +2308,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Discontinuity)
 (
     X_CDirectSoundStream*   pThis)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_ONE_ARG(pThis);
 
@@ -2107,7 +2328,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Discontinuity)
         DSoundStreamClearPacket(buffer, XMP_STATUS_FLUSHED, pThis->Xb_lpfnCallback, pThis->Xb_lpvContext, pThis);
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -2119,7 +2340,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Flush)
 (
     X_CDirectSoundStream*   pThis)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_ONE_ARG(pThis);
 
@@ -2131,7 +2352,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Flush)
 
     while (DSoundStreamProcess(pThis));
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -2151,26 +2372,27 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSound_SynchPlayback)
 
     vector_ds_buffer::iterator ppDSBuffer = g_pDSoundBufferCache.begin();
     for (; ppDSBuffer != g_pDSoundBufferCache.end(); ppDSBuffer++) {
-        if ((*ppDSBuffer)->X_BufferCache == nullptr) {
-            continue;
-        }
+        enterObjectCriticalSection(*ppDSBuffer);
 
-        if (((*ppDSBuffer)->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
+        if ((*ppDSBuffer)->X_BufferCache != nullptr && ((*ppDSBuffer)->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
             DSoundBufferSynchPlaybackFlagRemove((*ppDSBuffer)->EmuFlags);
             EmuLog(LOG_LEVEL::DEBUG, "SynchPlayback - EmuPlayFlags: %08X", (*ppDSBuffer)->EmuPlayFlags);
             (*ppDSBuffer)->EmuDirectSoundBuffer8->Play(0, 0, (*ppDSBuffer)->EmuPlayFlags);
         }
+
+        leaveObjectCriticalSection(*ppDSBuffer);
     }
 
     vector_ds_stream::iterator ppDSStream = g_pDSoundStreamCache.begin();
     for (; ppDSStream != g_pDSoundStreamCache.end(); ppDSStream++) {
-        if ((*ppDSStream)->Host_BufferPacketArray.size() == 0) {
-            continue;
-        }
-        if (((*ppDSStream)->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
+        enterObjectCriticalSection(*ppDSStream);
+
+        if ((*ppDSStream)->Host_BufferPacketArray.size() != 0 && ((*ppDSStream)->EmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
             DSoundBufferSynchPlaybackFlagRemove((*ppDSStream)->EmuFlags);
             DSoundStreamProcess((*ppDSStream));
         }
+
+        leaveObjectCriticalSection(*ppDSStream);
     }
 
     //EmuLog(LOG_LEVEL::DEBUG, "Buffer started: %u; Stream started: %u", debugSynchBufferCount, debugSynchStreamCount);
@@ -2198,8 +2420,14 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_Pause)
 		return STATUS_SUCCESS;
 	}
 
-    return HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
-                                        pThis->Host_isProcessing, 0LL, pThis->Xb_rtPauseEx);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
+                                                 pThis->Host_isProcessing, 0LL, pThis->Xb_rtPauseEx);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2215,8 +2443,14 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetHeadroom)
 		LOG_FUNC_ARG(dwHeadroom)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, dwHeadroom, pThis->Xb_dwHeadroom,
-                                               pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->EmuFlags);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetHeadroom(pThis->EmuDirectSoundBuffer8, dwHeadroom, pThis->Xb_dwHeadroom,
+                                                       pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->EmuFlags);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2236,7 +2470,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetConeAngles)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetConeAngles(pThis->EmuDirectSound3DBuffer8, dwInsideConeAngle, dwOutsideConeAngle, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetConeAngles(pThis->EmuDirectSound3DBuffer8, dwInsideConeAngle, dwOutsideConeAngle, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2254,7 +2494,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetConeOutsideVolume)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetConeOutsideVolume(pThis->EmuDirectSound3DBuffer8, lConeOutsideVolume, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetConeOutsideVolume(pThis->EmuDirectSound3DBuffer8, lConeOutsideVolume, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2272,7 +2518,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetAllParameters)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetAllParameters(pThis->EmuDirectSound3DBuffer8, pc3DBufferParameters, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetAllParameters(pThis->EmuDirectSound3DBuffer8, pc3DBufferParameters, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2290,7 +2542,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMaxDistance)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetMaxDistance(pThis->EmuDirectSound3DBuffer8, flMaxDistance, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetMaxDistance(pThis->EmuDirectSound3DBuffer8, flMaxDistance, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2308,7 +2566,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMinDistance)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetMinDistance(pThis->EmuDirectSound3DBuffer8, fMinDistance, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetMinDistance(pThis->EmuDirectSound3DBuffer8, fMinDistance, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2330,7 +2594,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetVelocity)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetVelocity(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetVelocity(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2352,7 +2622,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetConeOrientation)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetConeOrientation(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetConeOrientation(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2374,7 +2650,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetPosition)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetPosition(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetPosition(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2390,7 +2672,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFrequency)
 		LOG_FUNC_ARG(dwFrequency)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2401,7 +2689,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBins)
     X_CDirectSoundStream*   pThis,
     PVOID                   pMixBins)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2410,7 +2698,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBins)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -2431,7 +2719,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMaxDistance)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetMaxDistance(pThis->EmuDirectSound3DBuffer8, flMaxDistance, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetMaxDistance(pThis->EmuDirectSound3DBuffer8, flMaxDistance, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2449,7 +2743,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMinDistance)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetMinDistance(pThis->EmuDirectSound3DBuffer8, flMinDistance, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetMinDistance(pThis->EmuDirectSound3DBuffer8, flMinDistance, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2461,7 +2761,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetRolloffFactor)
     FLOAT                   flRolloffFactor,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2473,7 +2773,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetRolloffFactor)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -2487,7 +2787,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetDistanceFactor)
     FLOAT                   flDistanceFactor,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2495,7 +2795,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetDistanceFactor)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return HybridDirectSound3DListener_SetDistanceFactor(g_pDSoundPrimary3DListener8, flDistanceFactor, dwApply);
 }
@@ -2517,7 +2817,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetConeAngles)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetConeAngles(pThis->EmuDirectSound3DBuffer8, dwInsideConeAngle, dwOutsideConeAngle, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetConeAngles(pThis->EmuDirectSound3DBuffer8, dwInsideConeAngle, dwOutsideConeAngle, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2539,7 +2845,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetConeOrientation)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetConeOrientation(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetConeOrientation(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2557,7 +2869,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetConeOutsideVolume)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetConeOutsideVolume(pThis->EmuDirectSound3DBuffer8, lConeOutsideVolume, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetConeOutsideVolume(pThis->EmuDirectSound3DBuffer8, lConeOutsideVolume, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2579,7 +2897,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetPosition)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetPosition(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetPosition(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2601,7 +2925,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetVelocity)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetVelocity(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetVelocity(pThis->EmuDirectSound3DBuffer8, x, y, z, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2631,7 +2961,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetI3DL2Source)
     X_DSI3DL2BUFFER*        pds3db,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2645,7 +2975,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetI3DL2Source)
 
     LOG_NOT_SUPPORTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -2665,7 +2995,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetMode)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetMode(pThis->EmuDirectSound3DBuffer8, dwMode, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetMode(pThis->EmuDirectSound3DBuffer8, dwMode, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // +s
@@ -2677,7 +3013,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFormat)
     X_CDirectSoundBuffer*   pThis,
     LPCWAVEFORMATEX         pwfxFormat)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2688,8 +3024,10 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetFormat)
                                                      pThis->EmuBufferDesc, pThis->EmuFlags, 
                                                      pThis->EmuPlayFlags, pThis->EmuDirectSound3DBuffer8,
                                                      0, pThis->X_BufferCache, pThis->X_BufferCacheSize);
+    // Switching between PCM and XADPCM changes what each host block was converted from
+    DSoundBufferShadowInvalidate(pThis->Host_shadow);
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -2782,7 +3120,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetLFO)
     X_CDirectSoundStream*   pThis,
     LPCDSLFODESC            pLFODesc)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -2793,7 +3131,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetLFO)
 
     LOG_NOT_SUPPORTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -2889,7 +3227,13 @@ ULONG WINAPI XTL::EMUPATCH(IDirectSoundBuffer_AddRef)
 {
 	LOG_FUNC_ONE_ARG(pThis);
 
-    return HybridDirectSoundBuffer_AddRef(pThis->EmuDirectSoundBuffer8);
+    enterObjectCriticalSection(pThis);
+
+    ULONG uRet = HybridDirectSoundBuffer_AddRef(pThis->EmuDirectSoundBuffer8);
+
+    leaveObjectCriticalSection(pThis);
+
+    return uRet;
 }
 
 // ******************************************************************
@@ -2906,17 +3250,24 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_Pause)
 		LOG_FUNC_ARG(dwPause)
 		LOG_FUNC_END;
 
+    enterObjectCriticalSection(pThis);
+
     DSoundGenericUnlock(pThis->EmuFlags,
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
+                        pThis->Host_shadow,
                         pThis->X_BufferCache,
                         pThis->X_lock.dwLockOffset,
                         pThis->X_lock.dwLockBytes1,
                         pThis->X_lock.dwLockBytes2);
 
-    return HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
-                                         1, 0LL, pThis->Xb_rtPauseEx);
+    HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
+                                                 1, 0LL, pThis->Xb_rtPauseEx);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -2931,7 +3282,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PauseEx)
 {
       
 
-        enterCriticalSection;
+        enterObjectCriticalSection(pThis);
 
         LOG_FUNC_BEGIN
             LOG_FUNC_ARG(pThis)
@@ -2942,7 +3293,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PauseEx)
     HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags,
                                                  1, rtTimestamp, pThis->Xb_rtPauseEx);
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -2983,7 +3334,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetEG)
     X_CDirectSoundStream*   pThis,
     X_DSENVOLOPEDESC*       pEnvelopeDesc)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -2996,7 +3347,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetEG)
 
     pThis->Xb_EnvolopeDesc = *pEnvelopeDesc;
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3010,7 +3361,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_FlushEx)
     REFERENCE_TIME          rtTimeStamp,
     DWORD                   dwFlags)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3048,9 +3399,11 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_FlushEx)
         else {
             pThis->EmuFlags ^= DSE_FLAG_ENVELOPE2;
         }
+
+        DSoundStreamQueueAsyncWork(pThis);
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -3070,7 +3423,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMode)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetMode(pThis->EmuDirectSound3DBuffer8, dwMode, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetMode(pThis->EmuDirectSound3DBuffer8, dwMode, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -3131,7 +3490,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFilter)
     X_CDirectSoundStream*   pThis,
     X_DSFILTERDESC*         pFilterDesc)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3142,7 +3501,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFilter)
 
     LOG_NOT_SUPPORTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3157,7 +3516,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PlayEx)
     REFERENCE_TIME        rtTimeStamp,
     DWORD                 dwFlags)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3172,7 +3531,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_PlayEx)
 
     HRESULT hRet = XTL::EMUPATCH(IDirectSoundBuffer_Play)(pThis, NULL, NULL, dwFlags);
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -3223,7 +3582,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetPitch)
         LOG_FUNC_ARG(lPitch)
         LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -3252,7 +3617,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBinVolumes_12)
     DWORD                   dwMixBinMask,
     const LONG*             alVolumes)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3265,7 +3630,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBinVolumes_12)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3284,7 +3649,13 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetMixBinVolumes_8)
 		LOG_FUNC_ARG(pMixBins)
 		LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pMixBins, pThis->EmuFlags, pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetMixBinVolumes_8(pThis->EmuDirectSoundBuffer8, pMixBins, pThis->EmuFlags, pThis->Xb_Volume, pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -3296,7 +3667,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetI3DL2Source)
     X_DSI3DL2BUFFER*        pds3db,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3310,7 +3681,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetI3DL2Source)
 
     LOG_NOT_SUPPORTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3330,7 +3701,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetAllParameters)
 		LOG_FUNC_ARG(dwApply)
 		LOG_FUNC_END;
 
-    return HybridDirectSound3DBuffer_SetAllParameters(pThis->EmuDirectSound3DBuffer8, pc3DBufferParameters, dwApply);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSound3DBuffer_SetAllParameters(pThis->EmuDirectSound3DBuffer8, pc3DBufferParameters, dwApply);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -3341,7 +3718,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFormat)
     X_CDirectSoundStream*   pThis,
     LPCWAVEFORMATEX         pwfxFormat)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3360,7 +3737,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetFormat)
                                              pThis->EmuFlags, pThis->EmuPlayFlags, pThis->EmuDirectSound3DBuffer8,
                                              0, pThis->X_BufferCache, pThis->X_BufferCacheSize);
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -3373,7 +3750,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetOutputBuffer)
     X_CDirectSoundBuffer*   pThis,
     X_CDirectSoundBuffer*   pOutputBuffer)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3386,7 +3763,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetOutputBuffer)
 
     LOG_NOT_SUPPORTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3399,7 +3776,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetOutputBuffer)
     X_CDirectSoundStream*   pThis,
     X_CDirectSoundBuffer*   pOutputBuffer)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3412,7 +3789,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_SetOutputBuffer)
 
     LOG_NOT_SUPPORTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3476,7 +3853,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetEG)
     X_CDirectSoundBuffer*   pThis,
     X_DSENVOLOPEDESC*       pEnvelopeDesc)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3489,7 +3866,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetEG)
 
     pThis->Xb_EnvolopeDesc = *pEnvelopeDesc;
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return S_OK;
 }
@@ -3538,7 +3915,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetNotificationPositions)
     DWORD                   dwNotifyCount,
     LPCDSBPOSITIONNOTIFY    paNotifies)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
 	LOG_FUNC_BEGIN
 		LOG_FUNC_ARG(pThis)
@@ -3571,7 +3948,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_SetNotificationPositions)
         }
     }
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -3912,7 +4289,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_CommitDeferredSettings)
 (
     X_CDirectSound*     pThis)
 {
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
     LOG_FUNC_ONE_ARG(pThis);
 
@@ -3921,7 +4298,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSound_CommitDeferredSettings)
         hRet = g_pDSoundPrimary3DListener8->CommitDeferredSettings();
     }
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     return hRet;
 }
@@ -3958,7 +4335,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_PauseEx)
 {
       
 
-        enterCriticalSection;
+        enterObjectCriticalSection(pThis);
 
         LOG_FUNC_BEGIN
             LOG_FUNC_ARG(pThis)
@@ -3972,7 +4349,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_PauseEx)
     HRESULT hRet = HybridDirectSoundBuffer_Pause(pThis->EmuDirectSoundBuffer8, dwPause, pThis->EmuFlags, pThis->EmuPlayFlags, 
                                                 pThis->Host_isProcessing, rtTimestamp, pThis->Xb_rtPauseEx);
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return hRet;
 }
@@ -4104,7 +4481,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetVoiceProperties)
     X_CDirectSoundBuffer*   pThis,
     OUT void*               pVoiceProps)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -4113,7 +4490,7 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundBuffer_GetVoiceProperties)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -4126,7 +4503,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetVoiceProperties)
     X_CDirectSoundStream*   pThis,
     OUT void*               pVoiceProps)
 {
-    enterCriticalSection;
+    enterObjectCriticalSection(pThis);
 
     LOG_FUNC_BEGIN
         LOG_FUNC_ARG(pThis)
@@ -4135,7 +4512,7 @@ HRESULT WINAPI XTL::EMUPATCH(CDirectSoundStream_GetVoiceProperties)
 
     LOG_UNIMPLEMENTED();
 
-    leaveCriticalSection;
+    leaveObjectCriticalSection(pThis);
 
     return DS_OK;
 }
@@ -4153,8 +4530,14 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetVolume)
         LOG_FUNC_ARG(lVolume)
         LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags, &pThis->Xb_Volume,
-                                             pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetVolume(pThis->EmuDirectSoundBuffer8, lVolume, pThis->EmuFlags, &pThis->Xb_Volume,
+                                                     pThis->Xb_VolumeMixbin, pThis->Xb_dwHeadroom);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -4170,7 +4553,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetPitch)
         LOG_FUNC_ARG(lPitch)
         LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetPitch(pThis->EmuDirectSoundBuffer8, lPitch);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
@@ -4249,7 +4638,13 @@ HRESULT WINAPI XTL::EMUPATCH(IDirectSoundStream_SetFrequency)
         LOG_FUNC_ARG(dwFrequency)
         LOG_FUNC_END;
 
-    return HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency);
+    enterObjectCriticalSection(pThis);
+
+    HRESULT hRet = HybridDirectSoundBuffer_SetFrequency(pThis->EmuDirectSoundBuffer8, dwFrequency);
+
+    leaveObjectCriticalSection(pThis);
+
+    return hRet;
 }
 
 // ******************************************************************
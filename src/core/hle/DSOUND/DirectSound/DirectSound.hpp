@@ -37,6 +37,7 @@ extern "C" {
 #endif
 
 void CxbxInitAudio();
+void CxbxShutdownAudio();
 
 #ifdef __cplusplus
 }
@@ -65,6 +66,14 @@ typedef struct _DSoundBuffer_Lock {
     DWORD   dwLockFlags;
 } DSoundBuffer_Lock;
 
+// Xbox ADPCM blocks as they were when last converted into each block of the host buffer,
+// so unchanged blocks are skipped on the next unlock (see DSoundBufferOutputXBtoHostBlocks)
+typedef struct _DSoundBuffer_Shadow {
+    std::vector<BYTE>   Blocks;
+    std::vector<bool>   Valid;
+    DWORD               dwBlockSize;
+} DSoundBuffer_Shadow;
+
 // ******************************************************************
 // * X_CDirectSoundBuffer
 // ******************************************************************
@@ -99,12 +108,14 @@ struct X_CDirectSoundBuffer
     DWORD                   X_BufferCacheSize;
     DSoundBuffer_Lock       Host_lock;
     DSoundBuffer_Lock       X_lock;
+    DSoundBuffer_Shadow     Host_shadow;
     REFERENCE_TIME          Xb_rtPauseEx;
     REFERENCE_TIME          Xb_rtStopEx;
     LONG                    Xb_Volume;
     LONG                    Xb_VolumeMixbin;
     DWORD                   Xb_dwHeadroom;
     X_DSENVOLOPEDESC        Xb_EnvolopeDesc;
+    CRITICAL_SECTION        Host_CriticalSection; // Guards this buffer's state, see DirectSoundInline.hpp
 };
 
 //Custom flags (4 bytes support up to 31 shifts,starting from 0)
@@ -256,6 +267,8 @@ class X_CDirectSoundStream
         LONG                                    Xb_VolumeMixbin;
         DWORD                                   Xb_dwHeadroom;
         X_DSENVOLOPEDESC                        Xb_EnvolopeDesc;
+        CRITICAL_SECTION                        Host_CriticalSection; // Guards this stream's state, see DirectSoundInline.hpp
+        LONG                                    Host_RefCount; // Held by the title, and by dsound_thread_worker while it works on the stream
 };
 
 // ******************************************************************
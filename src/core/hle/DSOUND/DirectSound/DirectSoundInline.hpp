@@ -29,9 +29,91 @@
 
 #include "XADPCM.h"
 
+// Lock order is g_DSoundCriticalSection -> X_CDirectSoundBuffer/X_CDirectSoundStream's Host_CriticalSection -> leaf locks.
+//  * g_DSoundCriticalSection guards the buffer/stream caches, DirectSoundDoWork, SynchPlayback and everything not owned by a voice.
+//  * Host_CriticalSection guards a single buffer's or stream's state, so voices no longer serialize against each other.
+//  * Leaf locks (3D listener, stream worker list) never have another lock acquired while held.
 CRITICAL_SECTION                    g_DSoundCriticalSection;
-#define enterCriticalSection        EnterCriticalSection(&g_DSoundCriticalSection)
-#define leaveCriticalSection        LeaveCriticalSection(&g_DSoundCriticalSection)
+CRITICAL_SECTION                    g_DSoundListenerCriticalSection;
+CRITICAL_SECTION                    g_DSoundStreamWorkCriticalSection;
+
+// Contention statistic for each place a lock is acquired, reported by dsound_thread_worker.
+struct DSoundLockSite;
+static std::atomic<DSoundLockSite*> g_DSoundLockSites { nullptr };
+struct DSoundLockSite {
+    const char*                     Function;
+    std::atomic<uint32_t>           Acquired;
+    std::atomic<uint32_t>           Contended;
+    DSoundLockSite*                 Next;
+
+    DSoundLockSite(const char* function) : Function(function), Acquired(0), Contended(0) {
+        Next = g_DSoundLockSites.load();
+        while (!g_DSoundLockSites.compare_exchange_weak(Next, this));
+    }
+};
+
+// Xbox stream packet completions are delivered once the thread no longer holds any DirectSound lock,
+// so a title's callback can freely call back into DirectSound (or wait on another of its threads).
+struct DSoundDeferredCompletion {
+    XTL::LPFNXMOCALLBACK            Xb_lpfnCallback;
+    LPVOID                          Xb_lpvContext;
+    HANDLE                          hCompletionEvent;
+    DWORD                           dwStatus;
+};
+static thread_local unsigned int    g_DSoundLockDepth = 0;
+static thread_local std::vector<DSoundDeferredCompletion> g_DSoundDeferredCompletions;
+
+inline void DSoundDeliverCompletion(const DSoundDeferredCompletion &completion) {
+    // If a callback is set, only do the callback instead of event handle.
+    if (completion.Xb_lpfnCallback != xbnullptr) {
+        completion.Xb_lpfnCallback(completion.Xb_lpvContext, completion.hCompletionEvent, completion.dwStatus);
+    } else if (completion.hCompletionEvent != 0) {
+        BOOL checkHandle = SetEvent(completion.hCompletionEvent);
+        if (checkHandle == 0) {
+            DWORD error = GetLastError();
+            EmuLog(LOG_LEVEL::WARNING, "Unable to set event on packet's hCompletionEvent. %8X | error = %8X", completion.hCompletionEvent, error);
+        }
+    }
+}
+
+inline void DSoundQueueCompletion(const DSoundDeferredCompletion &completion) {
+    if (g_DSoundLockDepth == 0) {
+        DSoundDeliverCompletion(completion);
+        return;
+    }
+    g_DSoundDeferredCompletions.push_back(completion);
+}
+
+inline void DSoundEnterLock(CRITICAL_SECTION* lock, DSoundLockSite &site) {
+    if (!TryEnterCriticalSection(lock)) {
+        site.Contended++;
+        EnterCriticalSection(lock);
+    }
+    site.Acquired++;
+    g_DSoundLockDepth++;
+}
+
+inline void DSoundLeaveLock(CRITICAL_SECTION* lock) {
+    LeaveCriticalSection(lock);
+    if (--g_DSoundLockDepth == 0 && !g_DSoundDeferredCompletions.empty()) {
+        // Callbacks may queue more completions of their own, which get delivered by their own last leave.
+        std::vector<DSoundDeferredCompletion> completions;
+        completions.swap(g_DSoundDeferredCompletions);
+        for (const auto &completion : completions) {
+            DSoundDeliverCompletion(completion);
+        }
+    }
+}
+
+#define DSoundEnterLockSite(lock)           do { static DSoundLockSite lockSite(__func__); DSoundEnterLock(lock, lockSite); } while (0)
+#define enterCriticalSection                DSoundEnterLockSite(&g_DSoundCriticalSection)
+#define leaveCriticalSection                DSoundLeaveLock(&g_DSoundCriticalSection)
+#define enterObjectCriticalSection(pObject) DSoundEnterLockSite(&(pObject)->Host_CriticalSection)
+#define leaveObjectCriticalSection(pObject) DSoundLeaveLock(&(pObject)->Host_CriticalSection)
+#define enterListenerCriticalSection        DSoundEnterLockSite(&g_DSoundListenerCriticalSection)
+#define leaveListenerCriticalSection        DSoundLeaveLock(&g_DSoundListenerCriticalSection)
+#define enterStreamWorkCriticalSection      DSoundEnterLockSite(&g_DSoundStreamWorkCriticalSection)
+#define leaveStreamWorkCriticalSection      DSoundLeaveLock(&g_DSoundStreamWorkCriticalSection)
 
 #define DSoundBufferGetPCMBufferSize(EmuFlags, size) (EmuFlags & DSE_FLAG_XADPCM) > 0 ? DWORD((size / float(XBOX_ADPCM_SRCSIZE)) * XBOX_ADPCM_DSTSIZE) : size
 #define DSoundBufferGetXboxBufferSize(EmuFlags, size) (EmuFlags & DSE_FLAG_XADPCM) > 0 ? DWORD((size / float(XBOX_ADPCM_DSTSIZE)) * XBOX_ADPCM_SRCSIZE) : size
@@ -47,10 +129,11 @@ inline DWORD DSoundSGEFreeBuffer() {
     return (DWORD)count;
 }
 inline void DSoundSGEMemAlloc(DWORD size) {
-    g_dwXbMemAllocated += size;
+    // Buffers and streams allocate under their own lock, so the shared counter must be updated atomically.
+    InterlockedExchangeAdd((LONG volatile*)&g_dwXbMemAllocated, (LONG)size);
 }
 inline void DSoundSGEMemDealloc(DWORD size) {
-    g_dwXbMemAllocated -= size;
+    InterlockedExchangeAdd((LONG volatile*)&g_dwXbMemAllocated, -(LONG)size);
 }
 inline bool DSoundSGEMenAllocCheck(DWORD sizeRequest) {
     int leftOverSize = X_DS_SGE_SIZE_MAX - (g_dwXbMemAllocated + sizeRequest);
@@ -77,7 +160,7 @@ inline void DSoundDebugMuteFlag(DWORD Xb_bufferBytes, DWORD &EmuFlags) {
 void DSoundBufferOutputXBtoHost(DWORD emuFlags, DSBUFFERDESC &DSBufferDesc, LPVOID pXBaudioPtr, DWORD dwXBAudioBytes, LPVOID pPCaudioPtr, DWORD dwPCMAudioBytes) {
     if ((emuFlags & DSE_FLAG_XADPCM) > 0) {
 
-        TXboxAdpcmDecoder_Decode_Memory((uint8_t*)pXBaudioPtr, dwXBAudioBytes, (uint8_t*)pPCaudioPtr, DSBufferDesc.lpwfxFormat->nChannels);
+        TXboxAdpcmDecoder_Decode_Blocks((uint8_t*)pXBaudioPtr, dwXBAudioBytes, (uint8_t*)pPCaudioPtr, DSBufferDesc.lpwfxFormat->nChannels);
 
     // PCM format, no changes requirement.
     } else {
@@ -85,6 +168,69 @@ void DSoundBufferOutputXBtoHost(DWORD emuFlags, DSBUFFERDESC &DSBufferDesc, LPVO
     }
 }
 
+// Forgets what was converted into the host buffer, so that the next unlock converts all of its blocks again.
+// Needed whenever the host buffer is recreated or its format changes, even when its block count stays the same.
+inline void DSoundBufferShadowInvalidate(XTL::DSoundBuffer_Shadow &Host_shadow) {
+    Host_shadow.Valid.clear();
+}
+
+// Same as DSoundBufferOutputXBtoHost, except XADPCM blocks are only converted when they differ from what was last
+// converted into the same host block. Titles refilling parts of a large looping buffer, or locking more than they
+// write, then only pay for the blocks they actually changed. dwPCMOffset is where pPCaudioPtr is in the host buffer.
+inline void DSoundBufferOutputXBtoHostBlocks(DWORD emuFlags, DSBUFFERDESC &DSBufferDesc, XTL::DSoundBuffer_Shadow &Host_shadow,
+                                             LPVOID pXBaudioPtr, DWORD dwXBAudioBytes, LPVOID pPCaudioPtr, DWORD dwPCMAudioBytes, DWORD dwPCMOffset) {
+    if ((emuFlags & DSE_FLAG_XADPCM) == 0) {
+        // PCM overwrites whatever XADPCM was converted before, should the buffer switch back later on.
+        DSoundBufferShadowInvalidate(Host_shadow);
+        DSoundBufferOutputXBtoHost(emuFlags, DSBufferDesc, pXBaudioPtr, dwXBAudioBytes, pPCaudioPtr, dwPCMAudioBytes);
+        return;
+    }
+
+    DWORD dwXBBlockSize = XBOX_ADPCM_SRCSIZE * DSBufferDesc.lpwfxFormat->nChannels;
+    DWORD dwPCMBlockSize = XBOX_ADPCM_DSTSIZE * DSBufferDesc.lpwfxFormat->nChannels;
+    size_t hostBlockCount = DSBufferDesc.dwBufferBytes / dwPCMBlockSize;
+
+    // Host buffer got (re)created with another size or format, nothing known about its content.
+    if (Host_shadow.dwBlockSize != dwXBBlockSize || Host_shadow.Valid.size() != hostBlockCount) {
+        Host_shadow.dwBlockSize = dwXBBlockSize;
+        Host_shadow.Blocks.assign(hostBlockCount * dwXBBlockSize, 0);
+        Host_shadow.Valid.assign(hostBlockCount, false);
+    }
+
+    size_t blockCount = dwXBAudioBytes / dwXBBlockSize;
+    size_t firstBlock = dwPCMOffset / dwPCMBlockSize;
+    if (dwPCMOffset % dwPCMBlockSize != 0 || firstBlock + blockCount > hostBlockCount) {
+        // Not block aligned, convert everything and forget what the blocks held.
+        DSoundBufferOutputXBtoHost(emuFlags, DSBufferDesc, pXBaudioPtr, dwXBAudioBytes, pPCaudioPtr, dwPCMAudioBytes);
+        for (size_t i = firstBlock; i < hostBlockCount && i <= firstBlock + blockCount; i++) {
+            Host_shadow.Valid[i] = false;
+        }
+        return;
+    }
+
+    PBYTE pXBBlocks = (PBYTE)pXBaudioPtr;
+    PBYTE pShadowBlocks = Host_shadow.Blocks.data() + firstBlock * dwXBBlockSize;
+    size_t i = 0;
+    while (i < blockCount) {
+        // Skip over unchanged blocks, then convert the following run of changed ones at once.
+        while (i < blockCount && Host_shadow.Valid[firstBlock + i] &&
+               memcmp(pXBBlocks + i * dwXBBlockSize, pShadowBlocks + i * dwXBBlockSize, dwXBBlockSize) == 0) {
+            i++;
+        }
+        size_t runStart = i;
+        while (i < blockCount && !(Host_shadow.Valid[firstBlock + i] &&
+               memcmp(pXBBlocks + i * dwXBBlockSize, pShadowBlocks + i * dwXBBlockSize, dwXBBlockSize) == 0)) {
+            memcpy(pShadowBlocks + i * dwXBBlockSize, pXBBlocks + i * dwXBBlockSize, dwXBBlockSize);
+            Host_shadow.Valid[firstBlock + i] = true;
+            i++;
+        }
+        if (i > runStart) {
+            TXboxAdpcmDecoder_Decode_Blocks(pXBBlocks + runStart * dwXBBlockSize, (i - runStart) * dwXBBlockSize,
+                                            (PBYTE)pPCaudioPtr + runStart * dwPCMBlockSize, DSBufferDesc.lpwfxFormat->nChannels);
+        }
+    }
+}
+
 // Convert XADPCM to PCM format helper function
 inline void XADPCM2PCMFormat(LPWAVEFORMATEX lpwfxFormat)
 {
@@ -391,6 +537,7 @@ inline void DSoundGenericUnlock(
     LPDIRECTSOUNDBUFFER8    pDSBuffer,
     DSBUFFERDESC           &DSBufferDesc,
     XTL::DSoundBuffer_Lock &Host_lock,
+    XTL::DSoundBuffer_Shadow &Host_shadow,
     LPVOID                  X_BufferCache,
     DWORD                   X_Offset,
     DWORD                   X_dwLockBytes1,
@@ -401,11 +548,13 @@ inline void DSoundGenericUnlock(
 
 
         if (X_BufferCache != xbnullptr) {
-            DSoundBufferOutputXBtoHost(dwEmuFlags, DSBufferDesc, ((PBYTE)X_BufferCache + X_Offset), X_dwLockBytes1, Host_lock.pLockPtr1, Host_lock.dwLockBytes1);
+            DSoundBufferOutputXBtoHostBlocks(dwEmuFlags, DSBufferDesc, Host_shadow, ((PBYTE)X_BufferCache + X_Offset), X_dwLockBytes1,
+                                             Host_lock.pLockPtr1, Host_lock.dwLockBytes1, Host_lock.dwLockOffset);
 
             if (Host_lock.pLockPtr2 != nullptr) {
 
-                DSoundBufferOutputXBtoHost(dwEmuFlags, DSBufferDesc, X_BufferCache, X_dwLockBytes2, Host_lock.pLockPtr2, Host_lock.dwLockBytes2);
+                DSoundBufferOutputXBtoHostBlocks(dwEmuFlags, DSBufferDesc, Host_shadow, X_BufferCache, X_dwLockBytes2,
+                                                 Host_lock.pLockPtr2, Host_lock.dwLockBytes2, 0);
             }
         }
 
@@ -424,6 +573,10 @@ inline void DSoundGenericUnlock(
 // Temporary creation since we need IDIRECTSOUNDBUFFER8, not IDIRECTSOUNDBUFFER class.
 inline HRESULT DSoundBufferCreate(LPDSBUFFERDESC pDSBufferDesc, LPDIRECTSOUNDBUFFER8 &pDSBuffer)
 {
+    if (g_pDSoundMixer != nullptr) {
+        return DSoundMixerCreateSoundBuffer(pDSBufferDesc, pDSBuffer);
+    }
+
     LPDIRECTSOUNDBUFFER pTempBuffer;
     HRESULT hRetDS = g_pDSound8->CreateSoundBuffer(pDSBufferDesc, &pTempBuffer, NULL);
 
@@ -571,6 +724,7 @@ inline void DSoundBufferResizeSetSize(
 
     pThis->EmuDirectSoundBuffer8 = pDSBufferNew;
     pThis->EmuDirectSound3DBuffer8 = pDS3DBufferNew;
+    DSoundBufferShadowInvalidate(pThis->Host_shadow);
 
     if (refCount) {
         while (pThis->EmuDirectSoundBuffer8->AddRef() < refCount);
@@ -591,10 +745,12 @@ inline void DSoundBufferResizeUpdate(
     if (hRet != DS_OK) {
         CxbxKrnlCleanup("Unable to lock region buffer!");
     }
+    pThis->Host_lock.dwLockOffset = 0;
     DSoundGenericUnlock(pThis->EmuFlags,
                         pThis->EmuDirectSoundBuffer8,
                         pThis->EmuBufferDesc,
                         pThis->Host_lock,
+                        pThis->Host_shadow,
                         pThis->X_BufferCache,
                         Xb_dwStartOffset,
                         Xb_dwByteLength,
@@ -758,17 +914,7 @@ inline void DSoundStreamClearPacket(
     // Test case: Pocketbike Racer
     //  * (cause audio skipping due to callback function called process then another called to process outside callback (x2)
     //    It only need to call process once.
-
-    // If a callback is set, only do the callback instead of event handle.
-    if (Xb_lpfnCallback != xbnullptr) {
-        Xb_lpfnCallback(Xb_lpvContext, unionEventContext, status);
-    } else if (unionEventContext != 0) {
-        BOOL checkHandle = SetEvent(unionEventContext);
-        if (checkHandle == 0) {
-            DWORD error = GetLastError();
-            EmuLog(LOG_LEVEL::WARNING, "Unable to set event on packet's hCompletionEvent. %8X | error = %8X", unionEventContext, error);
-        }
-    }
+    DSoundQueueCompletion({ Xb_lpfnCallback, Xb_lpvContext, unionEventContext, status });
 }
 
 // Generic force remove synch playback control flag.
@@ -782,7 +928,7 @@ inline void DSoundBufferSynchPlaybackFlagRemove(
     }
 
     if ((dwEmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) > 0) {
-        g_iDSoundSynchPlaybackCounter--;
+        InterlockedDecrement((LONG volatile*)&g_iDSoundSynchPlaybackCounter);
         dwEmuFlags ^= DSE_FLAG_SYNCHPLAYBACK_CONTROL;
     }
 }
@@ -796,7 +942,7 @@ inline HRESULT DSoundBufferSynchPlaybackFlagAdd(
     }
 
     if ((dwEmuFlags & DSE_FLAG_SYNCHPLAYBACK_CONTROL) == 0) {
-        g_iDSoundSynchPlaybackCounter++;
+        InterlockedIncrement((LONG volatile*)&g_iDSoundSynchPlaybackCounter);
         dwEmuFlags |= DSE_FLAG_SYNCHPLAYBACK_CONTROL;
     }
     return DS_OK;
@@ -906,26 +1052,16 @@ inline bool DSoundStreamProcess(XTL::X_CDirectSoundStream* pThis) {
 inline ULONG HybridDirectSoundBuffer_AddRef(
     LPDIRECTSOUNDBUFFER8    pDSBuffer)
 {
-
-    enterCriticalSection;
-
     ULONG uRet = pDSBuffer->AddRef();
 
-    leaveCriticalSection;
-
     return uRet;
 }
 
 inline ULONG HybridDirectSoundBuffer_Release(
     LPDIRECTSOUNDBUFFER8    pDSBuffer)
 {
-
-    enterCriticalSection;
-
     ULONG uRet = pDSBuffer->Release();
 
-    leaveCriticalSection;
-
     return uRet;
 }
 
@@ -966,9 +1102,6 @@ inline HRESULT HybridDirectSoundBuffer_GetCurrentPosition(
     PDWORD                  pdwCurrentWriteCursor,
     DWORD                   EmuFlags)
 {
-
-    enterCriticalSection;
-
     DWORD dwCurrentPlayCursor, dwCurrentWriteCursor;
     HRESULT hRet = pDSBuffer->GetCurrentPosition(&dwCurrentPlayCursor, &dwCurrentWriteCursor);
 
@@ -983,8 +1116,6 @@ inline HRESULT HybridDirectSoundBuffer_GetCurrentPosition(
         *pdwCurrentWriteCursor = DSoundBufferGetXboxBufferSize(EmuFlags, dwCurrentWriteCursor);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1033,9 +1164,6 @@ inline HRESULT HybridDirectSoundBuffer_Pause(
     REFERENCE_TIME          rtTimeStamp,
     REFERENCE_TIME         &Xb_rtTimeStamp)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     switch (dwPause) {
         case X_DSSPAUSE_RESUME:
@@ -1066,8 +1194,6 @@ inline HRESULT HybridDirectSoundBuffer_Pause(
             break;
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 /*
@@ -1148,8 +1274,6 @@ inline HRESULT HybridDirectSound3DBuffer_SetAllParameters(
     XTL::X_DS3DBUFFER*      pDS3DBufferParams,
     DWORD                   dwApply)
 {
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
 
@@ -1167,26 +1291,28 @@ inline HRESULT HybridDirectSound3DBuffer_SetAllParameters(
 
         hRet = pDS3DBuffer->SetAllParameters(&pDS3DBufferParamsTemp, dwApply);
         if (hRet != DS_OK) {
-			leaveCriticalSection;
             RETURN_RESULT_CHECK(hRet);
         }
 
+        // The factors below belong to the shared listener, not to this buffer.
+        enterListenerCriticalSection;
+
         hRet = g_pDSoundPrimary3DListener8->SetDistanceFactor(pDS3DBufferParams->flDistanceFactor, dwApply);
         if (hRet != DS_OK) {
-			leaveCriticalSection;
+			leaveListenerCriticalSection;
             RETURN_RESULT_CHECK(hRet);
         }
 
         hRet = g_pDSoundPrimary3DListener8->SetRolloffFactor(pDS3DBufferParams->flRolloffFactor, dwApply);
         if (hRet != DS_OK) {
-			leaveCriticalSection;
+			leaveListenerCriticalSection;
             RETURN_RESULT_CHECK(hRet);
         }
 
         hRet = g_pDSoundPrimary3DListener8->SetDopplerFactor(pDS3DBufferParams->flDopplerFactor, dwApply);
-    }
 
-    leaveCriticalSection;
+        leaveListenerCriticalSection;
+    }
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1208,16 +1334,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetConeAngles(
     DWORD                   dwOutsideConeAngle,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetConeAngles(dwInsideConeAngle, dwOutsideConeAngle, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1230,9 +1351,6 @@ inline HRESULT HybridDirectSound3DBuffer_SetConeOrientation(
     D3DVALUE                z,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         // TODO: (DSound) Should we do restrictive or passive to return actual result back to titles?
@@ -1244,8 +1362,6 @@ inline HRESULT HybridDirectSound3DBuffer_SetConeOrientation(
         }
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1256,16 +1372,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetConeOutsideVolume(
     LONG                    lConeOutsideVolume,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetConeOutsideVolume(lConeOutsideVolume, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 /*
@@ -1288,11 +1399,11 @@ inline HRESULT HybridDirectSound3DListener_SetDistanceFactor(
     DWORD                       dwApply)
 {
 
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
     HRESULT hRet = pDS3DListener->SetDistanceFactor(flDistanceFactor, dwApply);
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1306,11 +1417,11 @@ inline HRESULT HybridDirectSound3DListener_SetDopplerFactor(
     DWORD                       dwApply)
 {
 
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
     HRESULT hRet = pDS3DListener->SetDopplerFactor(flDopplerFactor, dwApply);
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1350,9 +1461,6 @@ inline HRESULT HybridDirectSoundBuffer_SetFormat(
     LPVOID                 &X_BufferCache,
     DWORD                  &X_BufferCacheSize)
 {
-
-    enterCriticalSection;
-
     pDSBuffer->Stop();
 
     if (X_BufferAllocate) {
@@ -1373,8 +1481,6 @@ inline HRESULT HybridDirectSoundBuffer_SetFormat(
         DSoundBufferReplace(pDSBuffer, BufferDesc, dwPlayFlags, pDS3DBuffer);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1384,15 +1490,10 @@ inline HRESULT HybridDirectSoundBuffer_SetFrequency(
     LPDIRECTSOUNDBUFFER8 pDSBuffer,
     DWORD               dwFrequency)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = S_OK;
 
     hRet = pDSBuffer->SetFrequency(dwFrequency);
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1409,9 +1510,6 @@ inline HRESULT HybridDirectSoundBuffer_SetHeadroom(
     LONG                Xb_volumeMixbin,
     DWORD               dwEmuFlags)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet;
     if (dwHeadroom > 10000) {
         hRet = DSERR_INVALIDPARAM;
@@ -1421,8 +1519,6 @@ inline HRESULT HybridDirectSoundBuffer_SetHeadroom(
         HybridDirectSoundBuffer_SetVolume(pDSBuffer, Xb_volume, dwEmuFlags, xbnullptr, Xb_volumeMixbin, dwHeadroom);
     }
 
-    leaveCriticalSection;
-
     return DS_OK;
 }
 
@@ -1469,16 +1565,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetMaxDistance(
     D3DVALUE                flMaxDistance,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetMaxDistance(flMaxDistance, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1489,16 +1580,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetMinDistance(
     D3DVALUE                flMinDistance,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetMinDistance(flMinDistance, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 /*
@@ -1523,8 +1609,6 @@ inline HRESULT HybridDirectSoundBuffer_SetMixBinVolumes_8(
     LONG                &Xb_volumeMixBin,
     DWORD                Xb_dwHeadroom)
 {
-    enterCriticalSection;
-
     HRESULT hRet = DSERR_INVALIDPARAM;
 
     if (pMixBins != xbnullptr) {
@@ -1556,8 +1640,6 @@ inline HRESULT HybridDirectSoundBuffer_SetMixBinVolumes_8(
         }
     }
 
-    leaveCriticalSection;
-
     return hRet;
 }
 
@@ -1568,16 +1650,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetMode(
     DWORD                   dwMode,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetMode(dwMode, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 /*
@@ -1653,16 +1730,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetPosition(
     D3DVALUE                z,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetPosition(x, y, z, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 /*
@@ -1688,11 +1760,11 @@ inline HRESULT HybridDirectSound3DListener_SetRolloffFactor(
     DWORD                       dwApply)
 {
 
-    enterCriticalSection;
+    enterListenerCriticalSection;
 
     HRESULT hRet = pDSBuffer->SetRolloffFactor(fRolloffFactor, dwApply);
 
-    leaveCriticalSection;
+    leaveListenerCriticalSection;
 
     RETURN_RESULT_CHECK(hRet);
 }
@@ -1707,16 +1779,11 @@ inline HRESULT HybridDirectSound3DBuffer_SetVelocity(
     FLOAT                   z,
     DWORD                   dwApply)
 {
-
-    enterCriticalSection;
-
     HRESULT hRet = DS_OK;
     if (pDS3DBuffer != nullptr) {
         hRet = pDS3DBuffer->SetVelocity(x, y, z, dwApply);
     }
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 
@@ -1732,9 +1799,6 @@ inline HRESULT HybridDirectSoundBuffer_SetVolume(
     LONG                    Xb_volumeMixbin,
     DWORD                   Xb_dwHeadroom)
 {
-
-    enterCriticalSection;
-
     // Preserve original volume
     if (Xb_lpVolume != xbnullptr) {
         *Xb_lpVolume = lVolume;
@@ -1772,8 +1836,6 @@ inline HRESULT HybridDirectSoundBuffer_SetVolume(
 
     HRESULT hRet = pDSBuffer->SetVolume(lVolume);
 
-    leaveCriticalSection;
-
     RETURN_RESULT_CHECK(hRet);
 }
 /*/
@@ -0,0 +1,805 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define LOG_PREFIX CXBXR_MODULE::DSOUND
+
+// prevent name collisions
+namespace xboxkrnl {
+    #include <xboxkrnl/xboxkrnl.h>
+};
+
+#include <dsound.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "core\kernel\init\CxbxKrnl.h"
+#include "core\kernel\support\Emu.h"
+#include "DirectSoundMixer.hpp"
+
+#define DSOUND_MIXER_OUTPUT_FRAMES  (XB_MIXER_OUTPUT_RATE / 5)   // Host streaming buffer, 200 ms
+#define DSOUND_MIXER_LATENCY_FRAMES (XB_MIXER_OUTPUT_RATE / 25)  // Kept queued ahead of the host play cursor, 40 ms
+#define DSOUND_MIXER_PERIOD         5                            // Output thread wake up interval, in milliseconds
+
+XbDSoundMixer *g_pDSoundMixer = nullptr;
+static LPDIRECTSOUNDBUFFER8 g_pDSoundMixerOutput = nullptr;
+static std::thread g_DSoundMixerOutputThread;
+static std::atomic<bool> g_bDSoundMixerOutputExit { false };
+
+// NOTE: 3D settings are applied right away, DS3D_DEFERRED isn't held back until CommitDeferredSettings;
+// the HLE code commits at the end of every change anyway.
+
+static inline XbMixerVector ToMixerVector(D3DVALUE x, D3DVALUE y, D3DVALUE z)
+{
+    return { x, y, z };
+}
+
+static inline XbMixerVector ToMixerVector(const D3DVECTOR &vector)
+{
+    return { vector.x, vector.y, vector.z };
+}
+
+static inline D3DVECTOR ToD3DVector(const XbMixerVector &vector)
+{
+    D3DVECTOR result;
+    result.x = vector.x;
+    result.y = vector.y;
+    result.z = vector.z;
+    return result;
+}
+
+class CxbxMixerSoundBuffer;
+
+// ******************************************************************
+// * IDirectSound3DBuffer8 of a mixer voice
+// ******************************************************************
+// Counted apart from its sound buffer, like host DirectSound does : DSoundBufferRelease expects the 3D
+// interface to be fully released before the buffer itself.
+class CxbxMixer3DBuffer : public IDirectSound3DBuffer {
+    public:
+        CxbxMixer3DBuffer(CxbxMixerSoundBuffer *pParent) : m_pParent(pParent), m_refCount(0) {}
+
+        // IUnknown
+        STDMETHODIMP QueryInterface(REFIID riid, LPVOID *ppvObject) override;
+        STDMETHODIMP_(ULONG) AddRef() override;
+        STDMETHODIMP_(ULONG) Release() override;
+
+        // IDirectSound3DBuffer
+        STDMETHODIMP GetAllParameters(LPDS3DBUFFER pDs3dBuffer) override;
+        STDMETHODIMP GetConeAngles(LPDWORD pdwInsideConeAngle, LPDWORD pdwOutsideConeAngle) override;
+        STDMETHODIMP GetConeOrientation(D3DVECTOR *pvOrientation) override;
+        STDMETHODIMP GetConeOutsideVolume(LPLONG plConeOutsideVolume) override;
+        STDMETHODIMP GetMaxDistance(D3DVALUE *pflMaxDistance) override;
+        STDMETHODIMP GetMinDistance(D3DVALUE *pflMinDistance) override;
+        STDMETHODIMP GetMode(LPDWORD pdwMode) override;
+        STDMETHODIMP GetPosition(D3DVECTOR *pvPosition) override;
+        STDMETHODIMP GetVelocity(D3DVECTOR *pvVelocity) override;
+        STDMETHODIMP SetAllParameters(LPCDS3DBUFFER pcDs3dBuffer, DWORD dwApply) override;
+        STDMETHODIMP SetConeAngles(DWORD dwInsideConeAngle, DWORD dwOutsideConeAngle, DWORD dwApply) override;
+        STDMETHODIMP SetConeOrientation(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+        STDMETHODIMP SetConeOutsideVolume(LONG lConeOutsideVolume, DWORD dwApply) override;
+        STDMETHODIMP SetMaxDistance(D3DVALUE flMaxDistance, DWORD dwApply) override;
+        STDMETHODIMP SetMinDistance(D3DVALUE flMinDistance, DWORD dwApply) override;
+        STDMETHODIMP SetMode(DWORD dwMode, DWORD dwApply) override;
+        STDMETHODIMP SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+        STDMETHODIMP SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override;
+
+    private:
+        XbMixer3DParams &Params();
+        HRESULT Update();
+
+        CxbxMixerSoundBuffer *m_pParent;
+        std::atomic<ULONG> m_refCount;
+};
+
+// ******************************************************************
+// * IDirectSoundBuffer8 of a mixer voice
+// ******************************************************************
+class CxbxMixerSoundBuffer : public IDirectSoundBuffer8 {
+    public:
+        CxbxMixerSoundBuffer(LPCDSBUFFERDESC pDSBufferDesc);
+        ~CxbxMixerSoundBuffer();
+
+        // IUnknown
+        STDMETHODIMP QueryInterface(REFIID riid, LPVOID *ppvObject) override;
+        STDMETHODIMP_(ULONG) AddRef() override;
+        STDMETHODIMP_(ULONG) Release() override;
+
+        // IDirectSoundBuffer
+        STDMETHODIMP GetCaps(LPDSBCAPS pDSBufferCaps) override;
+        STDMETHODIMP GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor) override;
+        STDMETHODIMP GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten) override;
+        STDMETHODIMP GetVolume(LPLONG plVolume) override;
+        STDMETHODIMP GetPan(LPLONG plPan) override;
+        STDMETHODIMP GetFrequency(LPDWORD pdwFrequency) override;
+        STDMETHODIMP GetStatus(LPDWORD pdwStatus) override;
+        STDMETHODIMP Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc) override;
+        STDMETHODIMP Lock(DWORD dwOffset, DWORD dwBytes, LPVOID *ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                          LPVOID *ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags) override;
+        STDMETHODIMP Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags) override;
+        STDMETHODIMP SetCurrentPosition(DWORD dwNewPosition) override;
+        STDMETHODIMP SetFormat(LPCWAVEFORMATEX pcfxFormat) override;
+        STDMETHODIMP SetVolume(LONG lVolume) override;
+        STDMETHODIMP SetPan(LONG lPan) override;
+        STDMETHODIMP SetFrequency(DWORD dwFrequency) override;
+        STDMETHODIMP Stop() override;
+        STDMETHODIMP Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2) override;
+        STDMETHODIMP Restore() override;
+
+        // IDirectSoundBuffer8
+        STDMETHODIMP SetFX(DWORD dwEffectsCount, LPDSEFFECTDESC pDSFXDesc, LPDWORD pdwResultCodes) override;
+        STDMETHODIMP AcquireResources(DWORD dwFlags, DWORD dwEffectsCount, LPDWORD pdwResultCodes) override;
+        STDMETHODIMP GetObjectInPath(REFGUID rguidObject, DWORD dwIndex, REFGUID rguidInterface, LPVOID *ppObject) override;
+
+    private:
+        friend class CxbxMixer3DBuffer;
+
+        XbMixerVoice *m_pVoice;
+        DWORD m_dwFlags;
+        WAVEFORMATEX m_wfxFormat;
+        XbMixer3DParams m_params3D;
+        CxbxMixer3DBuffer m_3DBuffer;
+        std::atomic<ULONG> m_refCount;
+};
+
+CxbxMixerSoundBuffer::CxbxMixerSoundBuffer(LPCDSBUFFERDESC pDSBufferDesc)
+    : m_dwFlags(pDSBufferDesc->dwFlags)
+    , m_wfxFormat(*pDSBufferDesc->lpwfxFormat)
+    , m_3DBuffer(this)
+    , m_refCount(1)
+{
+    m_wfxFormat.cbSize = 0;
+    XbMixerGetDefault3DParams(&m_params3D);
+
+    XbMixerFormat format = { m_wfxFormat.nSamplesPerSec, m_wfxFormat.nChannels, m_wfxFormat.wBitsPerSample };
+    m_pVoice = g_pDSoundMixer->CreateVoice(format, pDSBufferDesc->dwBufferBytes, (m_dwFlags & DSBCAPS_CTRL3D) != 0);
+}
+
+CxbxMixerSoundBuffer::~CxbxMixerSoundBuffer()
+{
+    g_pDSoundMixer->DestroyVoice(m_pVoice);
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::QueryInterface(REFIID riid, LPVOID *ppvObject)
+{
+    if (ppvObject == nullptr) {
+        return E_POINTER;
+    }
+
+    if (riid == IID_IUnknown || riid == IID_IDirectSoundBuffer || riid == IID_IDirectSoundBuffer8) {
+        AddRef();
+        *ppvObject = static_cast<IDirectSoundBuffer8*>(this);
+        return S_OK;
+    }
+
+    if (riid == IID_IDirectSound3DBuffer && (m_dwFlags & DSBCAPS_CTRL3D) != 0) {
+        m_3DBuffer.AddRef();
+        *ppvObject = static_cast<IDirectSound3DBuffer*>(&m_3DBuffer);
+        return S_OK;
+    }
+
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) CxbxMixerSoundBuffer::AddRef()
+{
+    return ++m_refCount;
+}
+
+STDMETHODIMP_(ULONG) CxbxMixerSoundBuffer::Release()
+{
+    ULONG refCount = --m_refCount;
+    if (refCount == 0) {
+        delete this;
+    }
+    return refCount;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetCaps(LPDSBCAPS pDSBufferCaps)
+{
+    uint32_t dwBufferBytes;
+    g_pDSoundMixer->GetVoiceData(m_pVoice, &dwBufferBytes);
+
+    pDSBufferCaps->dwFlags = m_dwFlags;
+    pDSBufferCaps->dwBufferBytes = dwBufferBytes;
+    pDSBufferCaps->dwUnlockTransferRate = 0;
+    pDSBufferCaps->dwPlayCpuOverhead = 0;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+    uint32_t dwBufferBytes;
+    g_pDSoundMixer->GetVoiceData(m_pVoice, &dwBufferBytes);
+    DWORD dwPlayCursor = g_pDSoundMixer->GetPosition(m_pVoice);
+
+    if (pdwCurrentPlayCursor != nullptr) {
+        *pdwCurrentPlayCursor = dwPlayCursor;
+    }
+
+    // Data up to the next output period may already have been mixed, so the write cursor is one period ahead
+    if (pdwCurrentWriteCursor != nullptr) {
+        DWORD dwAhead = (g_pDSoundMixer->GetFrequency(m_pVoice) * DSOUND_MIXER_PERIOD / 1000 + 1) * m_wfxFormat.nBlockAlign;
+        *pdwCurrentWriteCursor = dwBufferBytes != 0 ? (dwPlayCursor + dwAhead) % dwBufferBytes : 0;
+    }
+
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten)
+{
+    if (pwfxFormat != nullptr) {
+        memcpy(pwfxFormat, &m_wfxFormat, std::min<DWORD>(dwSizeAllocated, sizeof(WAVEFORMATEX)));
+    }
+    if (pdwSizeWritten != nullptr) {
+        *pdwSizeWritten = sizeof(WAVEFORMATEX);
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetVolume(LPLONG plVolume)
+{
+    *plVolume = g_pDSoundMixer->GetVolume(m_pVoice);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetPan(LPLONG plPan)
+{
+    *plPan = g_pDSoundMixer->GetPan(m_pVoice);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetFrequency(LPDWORD pdwFrequency)
+{
+    *pdwFrequency = g_pDSoundMixer->GetFrequency(m_pVoice);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetStatus(LPDWORD pdwStatus)
+{
+    bool bLooping;
+    bool bPlaying = g_pDSoundMixer->IsPlaying(m_pVoice, &bLooping);
+
+    *pdwStatus = 0;
+    if (bPlaying) {
+        *pdwStatus |= DSBSTATUS_PLAYING | (bLooping ? DSBSTATUS_LOOPING : 0);
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc)
+{
+    return DSERR_ALREADYINITIALIZED;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::Lock(DWORD dwOffset, DWORD dwBytes, LPVOID *ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                                        LPVOID *ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
+{
+    uint32_t dwBufferBytes;
+    uint8_t *pData = g_pDSoundMixer->GetVoiceData(m_pVoice, &dwBufferBytes);
+
+    if ((dwFlags & DSBLOCK_FROMWRITECURSOR) != 0) {
+        GetCurrentPosition(nullptr, &dwOffset);
+    }
+    if ((dwFlags & DSBLOCK_ENTIREBUFFER) != 0) {
+        dwOffset = 0;
+        dwBytes = dwBufferBytes;
+    }
+    if (dwOffset >= dwBufferBytes || dwBytes > dwBufferBytes || dwBytes == 0) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    // The voice data is what gets mixed, so writes to it are heard on the next mix without any transfer
+    DWORD dwBytes1 = std::min(dwBytes, dwBufferBytes - dwOffset);
+    *ppvAudioPtr1 = pData + dwOffset;
+    *pdwAudioBytes1 = dwBytes1;
+    if (ppvAudioPtr2 != nullptr) {
+        *ppvAudioPtr2 = dwBytes1 < dwBytes ? pData : nullptr;
+        *pdwAudioBytes2 = dwBytes - dwBytes1;
+    }
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags)
+{
+    g_pDSoundMixer->Play(m_pVoice, (dwFlags & DSBPLAY_LOOPING) != 0);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::SetCurrentPosition(DWORD dwNewPosition)
+{
+    g_pDSoundMixer->SetPosition(m_pVoice, dwNewPosition);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::SetFormat(LPCWAVEFORMATEX pcfxFormat)
+{
+    m_wfxFormat = *pcfxFormat;
+    m_wfxFormat.cbSize = 0;
+
+    XbMixerFormat format = { m_wfxFormat.nSamplesPerSec, m_wfxFormat.nChannels, m_wfxFormat.wBitsPerSample };
+    g_pDSoundMixer->SetVoiceFormat(m_pVoice, format);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::SetVolume(LONG lVolume)
+{
+    if (lVolume > DSBVOLUME_MAX || lVolume < DSBVOLUME_MIN) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    g_pDSoundMixer->SetVolume(m_pVoice, lVolume);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::SetPan(LONG lPan)
+{
+    if (lPan > DSBPAN_RIGHT || lPan < DSBPAN_LEFT) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    g_pDSoundMixer->SetPan(m_pVoice, lPan);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::SetFrequency(DWORD dwFrequency)
+{
+    if (dwFrequency != DSBFREQUENCY_ORIGINAL && (dwFrequency < DSBFREQUENCY_MIN || dwFrequency > DSBFREQUENCY_MAX)) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    g_pDSoundMixer->SetFrequency(m_pVoice, dwFrequency);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::Stop()
+{
+    g_pDSoundMixer->Stop(m_pVoice);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2)
+{
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::Restore()
+{
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::SetFX(DWORD dwEffectsCount, LPDSEFFECTDESC pDSFXDesc, LPDWORD pdwResultCodes)
+{
+    return DSERR_CONTROLUNAVAIL;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::AcquireResources(DWORD dwFlags, DWORD dwEffectsCount, LPDWORD pdwResultCodes)
+{
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixerSoundBuffer::GetObjectInPath(REFGUID rguidObject, DWORD dwIndex, REFGUID rguidInterface, LPVOID *ppObject)
+{
+    return DSERR_OBJECTNOTFOUND;
+}
+
+// ******************************************************************
+// * CxbxMixer3DBuffer
+// ******************************************************************
+XbMixer3DParams &CxbxMixer3DBuffer::Params()
+{
+    return m_pParent->m_params3D;
+}
+
+HRESULT CxbxMixer3DBuffer::Update()
+{
+    g_pDSoundMixer->Set3DParams(m_pParent->m_pVoice, m_pParent->m_params3D);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::QueryInterface(REFIID riid, LPVOID *ppvObject)
+{
+    return m_pParent->QueryInterface(riid, ppvObject);
+}
+
+STDMETHODIMP_(ULONG) CxbxMixer3DBuffer::AddRef()
+{
+    // The first reference keeps the sound buffer alive, until the last one is released
+    ULONG refCount = ++m_refCount;
+    if (refCount == 1) {
+        m_pParent->AddRef();
+    }
+    return refCount;
+}
+
+STDMETHODIMP_(ULONG) CxbxMixer3DBuffer::Release()
+{
+    ULONG refCount = --m_refCount;
+    if (refCount == 0) {
+        m_pParent->Release();
+    }
+    return refCount;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetAllParameters(LPDS3DBUFFER pDs3dBuffer)
+{
+    const XbMixer3DParams &params = Params();
+    pDs3dBuffer->vPosition = ToD3DVector(params.Position);
+    pDs3dBuffer->vVelocity = ToD3DVector(params.Velocity);
+    pDs3dBuffer->dwInsideConeAngle = params.InsideConeAngle;
+    pDs3dBuffer->dwOutsideConeAngle = params.OutsideConeAngle;
+    pDs3dBuffer->vConeOrientation = ToD3DVector(params.ConeOrientation);
+    pDs3dBuffer->lConeOutsideVolume = params.ConeOutsideVolume;
+    pDs3dBuffer->flMinDistance = params.MinDistance;
+    pDs3dBuffer->flMaxDistance = params.MaxDistance;
+    pDs3dBuffer->dwMode = params.Mode;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetConeAngles(LPDWORD pdwInsideConeAngle, LPDWORD pdwOutsideConeAngle)
+{
+    *pdwInsideConeAngle = Params().InsideConeAngle;
+    *pdwOutsideConeAngle = Params().OutsideConeAngle;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetConeOrientation(D3DVECTOR *pvOrientation)
+{
+    *pvOrientation = ToD3DVector(Params().ConeOrientation);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetConeOutsideVolume(LPLONG plConeOutsideVolume)
+{
+    *plConeOutsideVolume = Params().ConeOutsideVolume;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetMaxDistance(D3DVALUE *pflMaxDistance)
+{
+    *pflMaxDistance = Params().MaxDistance;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetMinDistance(D3DVALUE *pflMinDistance)
+{
+    *pflMinDistance = Params().MinDistance;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetMode(LPDWORD pdwMode)
+{
+    *pdwMode = Params().Mode;
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetPosition(D3DVECTOR *pvPosition)
+{
+    *pvPosition = ToD3DVector(Params().Position);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::GetVelocity(D3DVECTOR *pvVelocity)
+{
+    *pvVelocity = ToD3DVector(Params().Velocity);
+    return DS_OK;
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetAllParameters(LPCDS3DBUFFER pcDs3dBuffer, DWORD dwApply)
+{
+    XbMixer3DParams &params = Params();
+    params.Position = ToMixerVector(pcDs3dBuffer->vPosition);
+    params.Velocity = ToMixerVector(pcDs3dBuffer->vVelocity);
+    params.InsideConeAngle = pcDs3dBuffer->dwInsideConeAngle;
+    params.OutsideConeAngle = pcDs3dBuffer->dwOutsideConeAngle;
+    params.ConeOrientation = ToMixerVector(pcDs3dBuffer->vConeOrientation);
+    params.ConeOutsideVolume = pcDs3dBuffer->lConeOutsideVolume;
+    params.MinDistance = pcDs3dBuffer->flMinDistance;
+    params.MaxDistance = pcDs3dBuffer->flMaxDistance;
+    params.Mode = pcDs3dBuffer->dwMode;
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetConeAngles(DWORD dwInsideConeAngle, DWORD dwOutsideConeAngle, DWORD dwApply)
+{
+    Params().InsideConeAngle = dwInsideConeAngle;
+    Params().OutsideConeAngle = dwOutsideConeAngle;
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetConeOrientation(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    Params().ConeOrientation = ToMixerVector(x, y, z);
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetConeOutsideVolume(LONG lConeOutsideVolume, DWORD dwApply)
+{
+    Params().ConeOutsideVolume = lConeOutsideVolume;
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetMaxDistance(D3DVALUE flMaxDistance, DWORD dwApply)
+{
+    Params().MaxDistance = flMaxDistance;
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetMinDistance(D3DVALUE flMinDistance, DWORD dwApply)
+{
+    Params().MinDistance = flMinDistance;
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetMode(DWORD dwMode, DWORD dwApply)
+{
+    Params().Mode = dwMode;
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    Params().Position = ToMixerVector(x, y, z);
+    return Update();
+}
+
+STDMETHODIMP CxbxMixer3DBuffer::SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
+{
+    Params().Velocity = ToMixerVector(x, y, z);
+    return Update();
+}
+
+// ******************************************************************
+// * IDirectSound3DListener8 of the mixer
+// ******************************************************************
+class CxbxMixer3DListener : public IDirectSound3DListener {
+    public:
+        CxbxMixer3DListener() : m_refCount(1) { XbMixerGetDefaultListener(&m_params); }
+
+        // IUnknown
+        STDMETHODIMP QueryInterface(REFIID riid, LPVOID *ppvObject) override
+        {
+            if (ppvObject == nullptr) {
+                return E_POINTER;
+            }
+            if (riid == IID_IUnknown || riid == IID_IDirectSound3DListener) {
+                AddRef();
+                *ppvObject = static_cast<IDirectSound3DListener*>(this);
+                return S_OK;
+            }
+            *ppvObject = nullptr;
+            return E_NOINTERFACE;
+        }
+        STDMETHODIMP_(ULONG) AddRef() override { return ++m_refCount; }
+        // Lives as long as the mixer does
+        STDMETHODIMP_(ULONG) Release() override { return m_refCount > 1 ? --m_refCount : 1; }
+
+        // IDirectSound3DListener
+        STDMETHODIMP GetAllParameters(LPDS3DLISTENER pListener) override
+        {
+            pListener->vPosition = ToD3DVector(m_params.Position);
+            pListener->vVelocity = ToD3DVector(m_params.Velocity);
+            pListener->flDistanceFactor = m_params.DistanceFactor;
+            pListener->flRolloffFactor = m_params.RolloffFactor;
+            pListener->flDopplerFactor = m_params.DopplerFactor;
+            pListener->vOrientFront = ToD3DVector(m_params.OrientFront);
+            pListener->vOrientTop = ToD3DVector(m_params.OrientTop);
+            return DS_OK;
+        }
+        STDMETHODIMP GetDistanceFactor(D3DVALUE *pflDistanceFactor) override { *pflDistanceFactor = m_params.DistanceFactor; return DS_OK; }
+        STDMETHODIMP GetDopplerFactor(D3DVALUE *pflDopplerFactor) override { *pflDopplerFactor = m_params.DopplerFactor; return DS_OK; }
+        STDMETHODIMP GetOrientation(D3DVECTOR *pvOrientFront, D3DVECTOR *pvOrientTop) override
+        {
+            *pvOrientFront = ToD3DVector(m_params.OrientFront);
+            *pvOrientTop = ToD3DVector(m_params.OrientTop);
+            return DS_OK;
+        }
+        STDMETHODIMP GetPosition(D3DVECTOR *pvPosition) override { *pvPosition = ToD3DVector(m_params.Position); return DS_OK; }
+        STDMETHODIMP GetRolloffFactor(D3DVALUE *pflRolloffFactor) override { *pflRolloffFactor = m_params.RolloffFactor; return DS_OK; }
+        STDMETHODIMP GetVelocity(D3DVECTOR *pvVelocity) override { *pvVelocity = ToD3DVector(m_params.Velocity); return DS_OK; }
+        STDMETHODIMP SetAllParameters(LPCDS3DLISTENER pcListener, DWORD dwApply) override
+        {
+            m_params.Position = ToMixerVector(pcListener->vPosition);
+            m_params.Velocity = ToMixerVector(pcListener->vVelocity);
+            m_params.DistanceFactor = pcListener->flDistanceFactor;
+            m_params.RolloffFactor = pcListener->flRolloffFactor;
+            m_params.DopplerFactor = pcListener->flDopplerFactor;
+            m_params.OrientFront = ToMixerVector(pcListener->vOrientFront);
+            m_params.OrientTop = ToMixerVector(pcListener->vOrientTop);
+            return Update();
+        }
+        STDMETHODIMP SetDistanceFactor(D3DVALUE flDistanceFactor, DWORD dwApply) override { m_params.DistanceFactor = flDistanceFactor; return Update(); }
+        STDMETHODIMP SetDopplerFactor(D3DVALUE flDopplerFactor, DWORD dwApply) override { m_params.DopplerFactor = flDopplerFactor; return Update(); }
+        STDMETHODIMP SetOrientation(D3DVALUE xFront, D3DVALUE yFront, D3DVALUE zFront, D3DVALUE xTop, D3DVALUE yTop, D3DVALUE zTop, DWORD dwApply) override
+        {
+            m_params.OrientFront = ToMixerVector(xFront, yFront, zFront);
+            m_params.OrientTop = ToMixerVector(xTop, yTop, zTop);
+            return Update();
+        }
+        STDMETHODIMP SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override { m_params.Position = ToMixerVector(x, y, z); return Update(); }
+        STDMETHODIMP SetRolloffFactor(D3DVALUE flRolloffFactor, DWORD dwApply) override { m_params.RolloffFactor = flRolloffFactor; return Update(); }
+        STDMETHODIMP SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply) override { m_params.Velocity = ToMixerVector(x, y, z); return Update(); }
+        STDMETHODIMP CommitDeferredSettings() override { return DS_OK; }
+
+    private:
+        HRESULT Update()
+        {
+            g_pDSoundMixer->SetListener(m_params);
+            return DS_OK;
+        }
+
+        XbMixerListenerParams m_params;
+        std::atomic<ULONG> m_refCount;
+};
+
+// ******************************************************************
+// * Output
+// ******************************************************************
+// Keeps DSOUND_MIXER_LATENCY_FRAMES of mixed audio queued in the host streaming buffer. Without
+// one, mixing just follows the clock, so voices still play (and finish) at the right pace.
+static void DSoundMixerOutputThread(LPDIRECTSOUNDBUFFER8 pOutput)
+{
+    SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
+
+    std::vector<int16_t> frames(DSOUND_MIXER_OUTPUT_FRAMES * 2);
+    DWORD dwOutputBytes = DSOUND_MIXER_OUTPUT_FRAMES * 4;
+    DWORD dwWriteOffset = 0;
+    auto lastMix = std::chrono::steady_clock::now();
+    uint64_t clockFrames = 0;
+
+#ifdef _DEBUG_DSOUND_MIXER_WAV
+    XbMixerWavSink wavSink;
+    if (!wavSink.Open(_DEBUG_DSOUND_MIXER_WAV)) {
+        EmuLog(LOG_LEVEL::WARNING, "Unable to open %s for the software mixer output", _DEBUG_DSOUND_MIXER_WAV);
+    }
+#endif
+
+    if (pOutput != nullptr) {
+        pOutput->Play(0, 0, DSBPLAY_LOOPING);
+    }
+
+    while (!g_bDSoundMixerOutputExit) {
+        Sleep(DSOUND_MIXER_PERIOD);
+
+        DWORD dwFrames;
+        if (pOutput != nullptr) {
+            DWORD dwPlayCursor;
+            if (pOutput->GetCurrentPosition(&dwPlayCursor, nullptr) != DS_OK) {
+                continue;
+            }
+            DWORD dwQueuedFrames = ((dwWriteOffset + dwOutputBytes - dwPlayCursor) % dwOutputBytes) / 4;
+            dwFrames = dwQueuedFrames < DSOUND_MIXER_LATENCY_FRAMES ? DSOUND_MIXER_LATENCY_FRAMES - dwQueuedFrames : 0;
+        } else {
+            auto now = std::chrono::steady_clock::now();
+            uint64_t elapsedFrames = std::chrono::duration_cast<std::chrono::microseconds>(now - lastMix).count() * XB_MIXER_OUTPUT_RATE / 1000000;
+            dwFrames = DWORD(std::min<uint64_t>(elapsedFrames - clockFrames, DSOUND_MIXER_OUTPUT_FRAMES));
+            clockFrames = elapsedFrames;
+        }
+        if (dwFrames == 0) {
+            continue;
+        }
+
+        g_pDSoundMixer->Mix(frames.data(), dwFrames);
+
+#ifdef _DEBUG_DSOUND_MIXER_WAV
+        wavSink.Write(frames.data(), dwFrames);
+#endif
+
+        if (pOutput != nullptr) {
+            LPVOID pAudioPtr1, pAudioPtr2;
+            DWORD dwAudioBytes1, dwAudioBytes2;
+            if (pOutput->Lock(dwWriteOffset, dwFrames * 4, &pAudioPtr1, &dwAudioBytes1, &pAudioPtr2, &dwAudioBytes2, 0) == DS_OK) {
+                memcpy(pAudioPtr1, frames.data(), dwAudioBytes1);
+                if (pAudioPtr2 != nullptr) {
+                    memcpy(pAudioPtr2, (PBYTE)frames.data() + dwAudioBytes1, dwAudioBytes2);
+                }
+                pOutput->Unlock(pAudioPtr1, dwAudioBytes1, pAudioPtr2, dwAudioBytes2);
+            }
+            dwWriteOffset = (dwWriteOffset + dwFrames * 4) % dwOutputBytes;
+        }
+    }
+
+    if (pOutput != nullptr) {
+        pOutput->Stop();
+    }
+}
+
+void DSoundMixerStart(LPDIRECTSOUND8 pDSound8)
+{
+    if (g_pDSoundMixer != nullptr) {
+        return;
+    }
+
+    g_pDSoundMixer = new XbDSoundMixer();
+
+    WAVEFORMATEX wfxFormat = { 0 };
+    wfxFormat.wFormatTag = WAVE_FORMAT_PCM;
+    wfxFormat.nChannels = 2;
+    wfxFormat.nSamplesPerSec = XB_MIXER_OUTPUT_RATE;
+    wfxFormat.wBitsPerSample = 16;
+    wfxFormat.nBlockAlign = 4;
+    wfxFormat.nAvgBytesPerSec = XB_MIXER_OUTPUT_RATE * 4;
+
+    DSBUFFERDESC bufferDesc = { 0 };
+    bufferDesc.dwSize = sizeof(DSBUFFERDESC);
+    bufferDesc.dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_GLOBALFOCUS;
+    bufferDesc.dwBufferBytes = DSOUND_MIXER_OUTPUT_FRAMES * 4;
+    bufferDesc.lpwfxFormat = &wfxFormat;
+
+    LPDIRECTSOUNDBUFFER pTempBuffer;
+    LPDIRECTSOUNDBUFFER8 pOutput = nullptr;
+    if (pDSound8 != nullptr && pDSound8->CreateSoundBuffer(&bufferDesc, &pTempBuffer, NULL) == DS_OK) {
+        if (pTempBuffer->QueryInterface(IID_IDirectSoundBuffer8, (LPVOID*)&pOutput) != DS_OK) {
+            pOutput = nullptr;
+        }
+        pTempBuffer->Release();
+    }
+
+    if (pOutput == nullptr) {
+        EmuLog(LOG_LEVEL::WARNING, "Unable to create the software mixer output buffer, mixing without output");
+    }
+
+    g_pDSoundMixerOutput = pOutput;
+    g_DSoundMixerOutputThread = std::thread(DSoundMixerOutputThread, pOutput);
+}
+
+void DSoundMixerStop()
+{
+    if (g_pDSoundMixer == nullptr) {
+        return;
+    }
+
+    g_bDSoundMixerOutputExit = true;
+    if (g_DSoundMixerOutputThread.joinable()) {
+        g_DSoundMixerOutputThread.join();
+    }
+
+    if (g_pDSoundMixerOutput != nullptr) {
+        g_pDSoundMixerOutput->Release();
+        g_pDSoundMixerOutput = nullptr;
+    }
+
+    delete g_pDSoundMixer;
+    g_pDSoundMixer = nullptr;
+}
+
+HRESULT DSoundMixerCreateSoundBuffer(LPCDSBUFFERDESC pDSBufferDesc, LPDIRECTSOUNDBUFFER8 &pDSBuffer)
+{
+    if (pDSBufferDesc->lpwfxFormat == nullptr || (pDSBufferDesc->dwFlags & DSBCAPS_PRIMARYBUFFER) != 0) {
+        return DSERR_INVALIDPARAM;
+    }
+
+    pDSBuffer = new CxbxMixerSoundBuffer(pDSBufferDesc);
+    return DS_OK;
+}
+
+HRESULT DSoundMixerCreate3DListener(LPDIRECTSOUND3DLISTENER8 &pDS3DListener)
+{
+    static CxbxMixer3DListener listener;
+
+    listener.AddRef();
+    pDS3DListener = &listener;
+    return DS_OK;
+}
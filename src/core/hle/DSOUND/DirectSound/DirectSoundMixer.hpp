@@ -0,0 +1,45 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef DIRECTSOUNDMIXER_H
+#define DIRECTSOUNDMIXER_H
+
+#include <dsound.h>
+#include "..\XbDSoundMixer.hpp"
+
+// With the SoftwareMixer audio setting, sound buffers and the 3D listener are implemented on top of
+// XbDSoundMixer, behind the same IDirectSoundBuffer8 / IDirectSound3DBuffer8 / IDirectSound3DListener8
+// interfaces the HLE code already uses for host objects. The mixed output then plays through a single
+// host streaming buffer, instead of every Xbox voice being a host buffer of its own.
+
+// Only set while the software mixer is in use
+extern XbDSoundMixer *g_pDSoundMixer;
+
+// Starts the mixer and its output thread, playing through pDSound8 (or nowhere when that fails)
+void DSoundMixerStart(LPDIRECTSOUND8 pDSound8);
+// Stops the output thread and frees the mixer along with its host output buffer
+void DSoundMixerStop();
+
+HRESULT DSoundMixerCreateSoundBuffer(LPCDSBUFFERDESC pDSBufferDesc, LPDIRECTSOUNDBUFFER8 &pDSBuffer);
+HRESULT DSoundMixerCreate3DListener(LPDIRECTSOUND3DLISTENER8 &pDS3DListener);
+
+#endif // DIRECTSOUNDMIXER_H
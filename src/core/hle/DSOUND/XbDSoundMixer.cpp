@@ -0,0 +1,670 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+// Each voice is mixed in chunks : the source frames a chunk reads are first converted to interleaved
+// float stereo, then resampled (linear interpolation, 32.32 fixed point positions) straight into the
+// float mix bus, which is converted to 16 bit at the end. Only the conversion, resample and store
+// loops are vectorized, the per voice gain and pitch calculations are done once per Mix call.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h> // For SSE2 intrinsics
+#include "common\util\CPUID.h" // For SimdCaps
+#include "XbDSoundMixer.hpp"
+
+#define XB_MIXER_CHUNK_FRAMES   256 // Output frames mixed per voice at once, keeps the source conversion in cache
+#define XB_MIXER_RENDER_FRAMES  480 // Output frames handed to a sink at once (10 ms)
+#define XB_MIXER_FRACTION       4294967296.0 // 1 << 32, positions are 32.32 fixed point frames
+#define XB_MIXER_PI             3.14159265f
+
+struct XbMixerVoice {
+    std::vector<uint8_t>    Data;
+    XbMixerFormat           Format;
+    uint32_t                BlockAlign;     // Bytes per source frame
+    uint32_t                FrameCount;
+    uint64_t                Position;       // In source frames, 32.32 fixed point
+    bool                    bPlaying;
+    bool                    bLooping;
+    bool                    b3D;
+    uint32_t                Frequency;
+    int32_t                 Volume;
+    int32_t                 Pan;
+    XbMixer3DParams         Params3D;
+};
+
+static inline void SetVoiceLayout(XbMixerVoice *pVoice)
+{
+    pVoice->BlockAlign = std::max<uint32_t>(1, pVoice->Format.Channels * (pVoice->Format.BitsPerSample / 8));
+    pVoice->FrameCount = uint32_t(pVoice->Data.size() / pVoice->BlockAlign);
+    if ((pVoice->Position >> 32) >= pVoice->FrameCount) {
+        pVoice->Position = 0;
+    }
+}
+
+static inline float MilliBelToGain(int32_t lVolume)
+{
+    if (lVolume <= XB_MIXER_VOLUME_MIN) {
+        return 0.0f;
+    }
+    if (lVolume >= 0) {
+        return 1.0f;
+    }
+    return powf(10.0f, lVolume / 2000.0f);
+}
+
+static inline XbMixerVector VectorSub(const XbMixerVector &a, const XbMixerVector &b)
+{
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static inline float VectorDot(const XbMixerVector &a, const XbMixerVector &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline XbMixerVector VectorCross(const XbMixerVector &a, const XbMixerVector &b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static inline float VectorLength(const XbMixerVector &a)
+{
+    return sqrtf(VectorDot(a, a));
+}
+
+// Left and right gains plus the doppler pitch of a voice, from its volume, pan and 3D parameters
+static void ComputeVoiceGains(const XbMixerVoice *pVoice, const XbMixerListenerParams &listener, float &gainL, float &gainR, float &pitch)
+{
+    float gain = MilliBelToGain(pVoice->Volume);
+    pitch = 1.0f;
+
+    if (!pVoice->b3D || pVoice->Params3D.Mode == XB_MIXER_3DMODE_DISABLE) {
+        // DirectSound pan attenuates the opposite side only
+        gainL = gain * MilliBelToGain(pVoice->Pan > 0 ? -pVoice->Pan : 0);
+        gainR = gain * MilliBelToGain(pVoice->Pan < 0 ? pVoice->Pan : 0);
+        return;
+    }
+
+    const XbMixer3DParams &params = pVoice->Params3D;
+    bool bHeadRelative = (params.Mode == XB_MIXER_3DMODE_HEADRELATIVE);
+    XbMixerVector relative = bHeadRelative ? params.Position : VectorSub(params.Position, listener.Position);
+    float distance = VectorLength(relative);
+    float pan = 0.0f;
+
+    if (distance > 0.0f) {
+        XbMixerVector direction = { relative.x / distance, relative.y / distance, relative.z / distance };
+
+        // Distance rolloff, nothing changes beyond the max distance
+        if (distance > params.MinDistance && params.MinDistance > 0.0f) {
+            float clamped = std::min(distance, params.MaxDistance);
+            gain *= params.MinDistance / (params.MinDistance + listener.RolloffFactor * (clamped - params.MinDistance));
+        }
+
+        // Pan by how far the voice is to the listener's right (DirectSound is left handed)
+        if (bHeadRelative) {
+            pan = direction.x;
+        } else {
+            XbMixerVector right = VectorCross(listener.OrientTop, listener.OrientFront);
+            float length = VectorLength(right);
+            if (length > 0.0f) {
+                pan = VectorDot(direction, right) / length;
+            }
+        }
+
+        // Cone attenuation, from the angle between the cone orientation and the listener
+        float orientLength = VectorLength(params.ConeOrientation);
+        if ((params.InsideConeAngle < 360 || params.OutsideConeAngle < 360) && orientLength > 0.0f) {
+            float cosAngle = -VectorDot(direction, params.ConeOrientation) / orientLength;
+            float angle = acosf(std::max(-1.0f, std::min(1.0f, cosAngle))) * (180.0f / XB_MIXER_PI);
+            float inside = params.InsideConeAngle / 2.0f;
+            float outside = std::max(inside, params.OutsideConeAngle / 2.0f);
+            if (angle >= outside) {
+                gain *= MilliBelToGain(params.ConeOutsideVolume);
+            } else if (angle > inside) {
+                gain *= MilliBelToGain(int32_t(params.ConeOutsideVolume * (angle - inside) / (outside - inside)));
+            }
+        }
+
+        // Doppler, velocities along the line between listener and voice (the listener doesn't move for head relative voices)
+        if (listener.DopplerFactor > 0.0f && listener.DistanceFactor > 0.0f) {
+            float speedOfSound = XB_MIXER_SPEED_OF_SOUND / listener.DistanceFactor;
+            float sourceSpeed = VectorDot(params.Velocity, direction) * listener.DopplerFactor;
+            float listenerSpeed = bHeadRelative ? 0.0f : VectorDot(listener.Velocity, direction) * listener.DopplerFactor;
+            sourceSpeed = std::max(-speedOfSound / 2, std::min(speedOfSound / 2, sourceSpeed));
+            listenerSpeed = std::max(-speedOfSound / 2, std::min(speedOfSound / 2, listenerSpeed));
+            pitch = (speedOfSound + listenerSpeed) / (speedOfSound + sourceSpeed);
+        }
+    }
+
+    pan = std::max(-1.0f, std::min(1.0f, pan));
+    gainL = gain * std::min(1.0f, sqrtf(1.0f - pan));
+    gainR = gain * std::min(1.0f, sqrtf(1.0f + pan));
+}
+
+// ******************************************************************
+// * Source conversion, to interleaved float stereo
+// ******************************************************************
+static void ConvertFrames_C(const uint8_t *pData, const XbMixerFormat &format, uint32_t blockAlign, uint32_t frameCount, float *pOut)
+{
+    int right = format.Channels > 1 ? 1 : 0;
+    if (format.BitsPerSample == 16) {
+        for (uint32_t i = 0; i < frameCount; i++, pData += blockAlign) {
+            const int16_t *pSample = (const int16_t *)pData;
+            *pOut++ = pSample[0] * (1.0f / 32768.0f);
+            *pOut++ = pSample[right] * (1.0f / 32768.0f);
+        }
+    } else if (format.BitsPerSample == 8) {
+        for (uint32_t i = 0; i < frameCount; i++, pData += blockAlign) {
+            *pOut++ = (pData[0] - 128) * (1.0f / 128.0f);
+            *pOut++ = (pData[right] - 128) * (1.0f / 128.0f);
+        }
+    } else {
+        memset(pOut, 0, frameCount * 2 * sizeof(float));
+    }
+}
+
+static void ConvertFrames_SSE2(const uint8_t *pData, const XbMixerFormat &format, uint32_t blockAlign, uint32_t frameCount, float *pOut)
+{
+    if (format.BitsPerSample != 16 || format.Channels > 2) {
+        ConvertFrames_C(pData, format, blockAlign, frameCount, pOut);
+        return;
+    }
+
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    uint32_t i = 0;
+    if (format.Channels == 2) {
+        // 4 frames per iteration, 16 bit samples sign extended by shifting them down from the upper half
+        for (; i + 4 <= frameCount; i += 4, pData += 16, pOut += 8) {
+            __m128i samples = _mm_loadu_si128((const __m128i *)pData);
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+            _mm_storeu_ps(pOut, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+            _mm_storeu_ps(pOut + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+        }
+    } else {
+        // 4 mono frames per iteration, each sample duplicated into left and right
+        for (; i + 4 <= frameCount; i += 4, pData += 8, pOut += 8) {
+            __m128i samples = _mm_loadl_epi64((const __m128i *)pData);
+            __m128i doubled = _mm_unpacklo_epi16(samples, samples);
+            __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(doubled, doubled), 16);
+            __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(doubled, doubled), 16);
+            _mm_storeu_ps(pOut, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+            _mm_storeu_ps(pOut + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+        }
+    }
+
+    ConvertFrames_C(pData, format, blockAlign, frameCount - i, pOut);
+}
+
+static void(*ConvertFrames)(const uint8_t *, const XbMixerFormat &, uint32_t, uint32_t, float *) =
+[](const uint8_t *pData, const XbMixerFormat &format, uint32_t blockAlign, uint32_t frameCount, float *pOut)
+{
+    SimdCaps supports;
+    if (supports.SSE2())
+        ConvertFrames = ConvertFrames_SSE2;
+    else
+        ConvertFrames = ConvertFrames_C;
+
+    ConvertFrames(pData, format, blockAlign, frameCount, pOut);
+};
+
+// ******************************************************************
+// * Resample and mix, pSource holds every frame the positions reach plus one
+// ******************************************************************
+static void MixFrames_C(float *pBus, uint32_t frameCount, const float *pSource, uint64_t position, uint64_t step, float gainL, float gainR)
+{
+    for (uint32_t i = 0; i < frameCount; i++, position += step) {
+        const float *pFrame = pSource + (position >> 32) * 2;
+        float fraction = float(uint32_t(position) * (1.0 / XB_MIXER_FRACTION));
+        *pBus++ += (pFrame[0] + (pFrame[2] - pFrame[0]) * fraction) * gainL;
+        *pBus++ += (pFrame[1] + (pFrame[3] - pFrame[1]) * fraction) * gainR;
+    }
+}
+
+static void MixFrames_SSE2(float *pBus, uint32_t frameCount, const float *pSource, uint64_t position, uint64_t step, float gainL, float gainR)
+{
+    const __m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+    uint32_t i = 0;
+
+    if (step == (1ull << 32) && uint32_t(position) == 0) {
+        // Voice plays at the output rate, nothing to interpolate
+        const float *pFrame = pSource + (position >> 32) * 2;
+        for (; i + 2 <= frameCount; i += 2, pFrame += 4, pBus += 4) {
+            _mm_storeu_ps(pBus, _mm_add_ps(_mm_loadu_ps(pBus), _mm_mul_ps(_mm_loadu_ps(pFrame), gain)));
+        }
+        position += step * i;
+    } else {
+        // 2 frames per iteration, each left/right pair loaded as one 64 bit half
+        for (; i + 2 <= frameCount; i += 2, pBus += 4) {
+            const float *pFrame0 = pSource + (position >> 32) * 2;
+            float fraction0 = float(uint32_t(position) * (1.0 / XB_MIXER_FRACTION));
+            position += step;
+            const float *pFrame1 = pSource + (position >> 32) * 2;
+            float fraction1 = float(uint32_t(position) * (1.0 / XB_MIXER_FRACTION));
+            position += step;
+
+            __m128 current = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)pFrame0), (const __m64 *)pFrame1);
+            __m128 next = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(pFrame0 + 2)), (const __m64 *)(pFrame1 + 2));
+            __m128 fraction = _mm_setr_ps(fraction0, fraction0, fraction1, fraction1);
+            __m128 sample = _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(next, current), fraction));
+            _mm_storeu_ps(pBus, _mm_add_ps(_mm_loadu_ps(pBus), _mm_mul_ps(sample, gain)));
+        }
+    }
+
+    MixFrames_C(pBus, frameCount - i, pSource, position, step, gainL, gainR);
+}
+
+static void(*MixFrames)(float *, uint32_t, const float *, uint64_t, uint64_t, float, float) =
+[](float *pBus, uint32_t frameCount, const float *pSource, uint64_t position, uint64_t step, float gainL, float gainR)
+{
+    SimdCaps supports;
+    if (supports.SSE2())
+        MixFrames = MixFrames_SSE2;
+    else
+        MixFrames = MixFrames_C;
+
+    MixFrames(pBus, frameCount, pSource, position, step, gainL, gainR);
+};
+
+// ******************************************************************
+// * Mix bus to 16 bit output
+// ******************************************************************
+static void StoreFrames_C(int16_t *pOut, const float *pBus, uint32_t sampleCount)
+{
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        float sample = std::max(-1.0f, std::min(1.0f, pBus[i]));
+        pOut[i] = int16_t(lrintf(sample * 32767.0f));
+    }
+}
+
+static void StoreFrames_SSE2(int16_t *pOut, const float *pBus, uint32_t sampleCount)
+{
+    const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f), scale = _mm_set1_ps(32767.0f);
+    uint32_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        // Clamp before converting, out of range floats would convert to INT_MIN
+        __m128 low = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pBus + i), minusOne), one);
+        __m128 high = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pBus + i + 4), minusOne), one);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(low, scale)), _mm_cvtps_epi32(_mm_mul_ps(high, scale)));
+        _mm_storeu_si128((__m128i *)(pOut + i), packed);
+    }
+
+    StoreFrames_C(pOut + i, pBus + i, sampleCount - i);
+}
+
+static void(*StoreFrames)(int16_t *, const float *, uint32_t) =
+[](int16_t *pOut, const float *pBus, uint32_t sampleCount)
+{
+    SimdCaps supports;
+    if (supports.SSE2())
+        StoreFrames = StoreFrames_SSE2;
+    else
+        StoreFrames = StoreFrames_C;
+
+    StoreFrames(pOut, pBus, sampleCount);
+};
+
+// Converts frameCount source frames starting at frame into pOut, wrapping around for looping voices
+// and padding with silence past the end for the others
+static void FetchFrames(const XbMixerVoice *pVoice, uint32_t frame, uint32_t frameCount, float *pOut)
+{
+    while (frameCount > 0) {
+        if (frame >= pVoice->FrameCount) {
+            if (!pVoice->bLooping || pVoice->FrameCount == 0) {
+                memset(pOut, 0, frameCount * 2 * sizeof(float));
+                return;
+            }
+            frame %= pVoice->FrameCount;
+        }
+
+        uint32_t run = std::min(frameCount, pVoice->FrameCount - frame);
+        ConvertFrames(pVoice->Data.data() + size_t(frame) * pVoice->BlockAlign, pVoice->Format, pVoice->BlockAlign, run, pOut);
+        pOut += run * 2;
+        frame += run;
+        frameCount -= run;
+    }
+}
+
+void XbMixerGetDefault3DParams(XbMixer3DParams *pParams)
+{
+    *pParams = { 0 };
+    pParams->InsideConeAngle = 360;
+    pParams->OutsideConeAngle = 360;
+    pParams->ConeOrientation = { 0.0f, 0.0f, 1.0f };
+    pParams->MinDistance = 1.0f;
+    pParams->MaxDistance = 1000000000.0f;
+    pParams->Mode = XB_MIXER_3DMODE_NORMAL;
+}
+
+void XbMixerGetDefaultListener(XbMixerListenerParams *pParams)
+{
+    *pParams = { 0 };
+    pParams->DistanceFactor = 1.0f;
+    pParams->RolloffFactor = 1.0f;
+    pParams->DopplerFactor = 1.0f;
+    pParams->OrientFront = { 0.0f, 0.0f, 1.0f };
+    pParams->OrientTop = { 0.0f, 1.0f, 0.0f };
+}
+
+XbDSoundMixer::XbDSoundMixer()
+{
+    XbMixerGetDefaultListener(&m_listener);
+}
+
+XbDSoundMixer::~XbDSoundMixer()
+{
+    for (XbMixerVoice *pVoice : m_voices) {
+        delete pVoice;
+    }
+}
+
+XbMixerVoice *XbDSoundMixer::CreateVoice(const XbMixerFormat &format, uint32_t bufferBytes, bool b3D)
+{
+    XbMixerVoice *pVoice = new XbMixerVoice();
+    pVoice->Data.assign(bufferBytes, format.BitsPerSample == 8 ? 0x80 : 0x00);
+    pVoice->Format = format;
+    pVoice->Position = 0;
+    pVoice->bPlaying = false;
+    pVoice->bLooping = false;
+    pVoice->b3D = b3D;
+    pVoice->Frequency = 0;
+    pVoice->Volume = 0;
+    pVoice->Pan = 0;
+    XbMixerGetDefault3DParams(&pVoice->Params3D);
+    SetVoiceLayout(pVoice);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_voices.push_back(pVoice);
+    return pVoice;
+}
+
+void XbDSoundMixer::DestroyVoice(XbMixerVoice *pVoice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_voices.begin(), m_voices.end(), pVoice);
+    if (it != m_voices.end()) {
+        m_voices.erase(it);
+        delete pVoice;
+    }
+}
+
+uint8_t *XbDSoundMixer::GetVoiceData(XbMixerVoice *pVoice, uint32_t *pBufferBytes)
+{
+    // The data never moves nor resizes, so there's nothing to lock
+    if (pBufferBytes != nullptr) {
+        *pBufferBytes = uint32_t(pVoice->Data.size());
+    }
+    return pVoice->Data.data();
+}
+
+void XbDSoundMixer::GetVoiceFormat(XbMixerVoice *pVoice, XbMixerFormat *pFormat)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pFormat = pVoice->Format;
+}
+
+void XbDSoundMixer::SetVoiceFormat(XbMixerVoice *pVoice, const XbMixerFormat &format)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->Format = format;
+    SetVoiceLayout(pVoice);
+}
+
+void XbDSoundMixer::Play(XbMixerVoice *pVoice, bool bLooping)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->bPlaying = true;
+    pVoice->bLooping = bLooping;
+}
+
+void XbDSoundMixer::Stop(XbMixerVoice *pVoice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->bPlaying = false;
+}
+
+bool XbDSoundMixer::IsPlaying(XbMixerVoice *pVoice, bool *pbLooping)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (pbLooping != nullptr) {
+        *pbLooping = pVoice->bLooping;
+    }
+    return pVoice->bPlaying;
+}
+
+uint32_t XbDSoundMixer::GetPosition(XbMixerVoice *pVoice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return uint32_t(pVoice->Position >> 32) * pVoice->BlockAlign;
+}
+
+void XbDSoundMixer::SetPosition(XbMixerVoice *pVoice, uint32_t dwPosition)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t frame = dwPosition / pVoice->BlockAlign;
+    pVoice->Position = uint64_t(frame < pVoice->FrameCount ? frame : 0) << 32;
+}
+
+void XbDSoundMixer::SetFrequency(XbMixerVoice *pVoice, uint32_t dwFrequency)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->Frequency = std::min<uint32_t>(dwFrequency, XB_MIXER_FREQUENCY_MAX);
+}
+
+uint32_t XbDSoundMixer::GetFrequency(XbMixerVoice *pVoice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return pVoice->Frequency != 0 ? pVoice->Frequency : pVoice->Format.SamplesPerSec;
+}
+
+void XbDSoundMixer::SetVolume(XbMixerVoice *pVoice, int32_t lVolume)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->Volume = lVolume;
+}
+
+int32_t XbDSoundMixer::GetVolume(XbMixerVoice *pVoice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return pVoice->Volume;
+}
+
+void XbDSoundMixer::SetPan(XbMixerVoice *pVoice, int32_t lPan)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->Pan = lPan;
+}
+
+int32_t XbDSoundMixer::GetPan(XbMixerVoice *pVoice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return pVoice->Pan;
+}
+
+void XbDSoundMixer::Set3DParams(XbMixerVoice *pVoice, const XbMixer3DParams &params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pVoice->Params3D = params;
+}
+
+void XbDSoundMixer::Get3DParams(XbMixerVoice *pVoice, XbMixer3DParams *pParams)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pParams = pVoice->Params3D;
+}
+
+void XbDSoundMixer::SetListener(const XbMixerListenerParams &params)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_listener = params;
+}
+
+void XbDSoundMixer::GetListener(XbMixerListenerParams *pParams)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pParams = m_listener;
+}
+
+uint32_t XbDSoundMixer::GetPlayingVoiceCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return uint32_t(std::count_if(m_voices.begin(), m_voices.end(), [](XbMixerVoice *pVoice) { return pVoice->bPlaying; }));
+}
+
+void XbDSoundMixer::MixVoice(XbMixerVoice *pVoice, uint32_t frameCount)
+{
+    if (pVoice->FrameCount == 0) {
+        return;
+    }
+
+    float gainL, gainR, pitch;
+    ComputeVoiceGains(pVoice, m_listener, gainL, gainR, pitch);
+
+    uint32_t frequency = pVoice->Frequency != 0 ? pVoice->Frequency : pVoice->Format.SamplesPerSec;
+    uint64_t step = uint64_t(double(frequency) * pitch / XB_MIXER_OUTPUT_RATE * XB_MIXER_FRACTION);
+    bool bAudible = (gainL > 0.0f || gainR > 0.0f);
+
+    // Silent voices still move on, so they're at the right spot once they become audible
+    for (uint32_t done = 0; done < frameCount;) {
+        uint32_t count = std::min<uint32_t>(frameCount - done, XB_MIXER_CHUNK_FRAMES);
+
+        if (bAudible) {
+            uint64_t fraction = uint32_t(pVoice->Position);
+            uint32_t sourceCount = uint32_t((fraction + step * (count - 1)) >> 32) + 2;
+            if (m_source.size() < size_t(sourceCount) * 2) {
+                m_source.resize(size_t(sourceCount) * 2);
+            }
+            FetchFrames(pVoice, uint32_t(pVoice->Position >> 32), sourceCount, m_source.data());
+            MixFrames(m_bus.data() + size_t(done) * 2, count, m_source.data(), fraction, step, gainL, gainR);
+        }
+
+        pVoice->Position += step * count;
+        uint32_t frame = uint32_t(pVoice->Position >> 32);
+        if (frame >= pVoice->FrameCount) {
+            if (!pVoice->bLooping) {
+                pVoice->bPlaying = false;
+                pVoice->Position = 0;
+                return;
+            }
+            pVoice->Position = (uint64_t(frame % pVoice->FrameCount) << 32) | uint32_t(pVoice->Position);
+        }
+
+        done += count;
+    }
+}
+
+void XbDSoundMixer::Mix(int16_t *pFrames, uint32_t frameCount)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_bus.assign(size_t(frameCount) * 2, 0.0f);
+    for (XbMixerVoice *pVoice : m_voices) {
+        if (pVoice->bPlaying) {
+            MixVoice(pVoice, frameCount);
+        }
+    }
+
+    StoreFrames(pFrames, m_bus.data(), frameCount * 2);
+}
+
+void XbDSoundMixer::Render(XbMixerSink &sink, uint32_t frameCount)
+{
+    int16_t frames[XB_MIXER_RENDER_FRAMES * 2];
+
+    while (frameCount > 0) {
+        uint32_t count = std::min<uint32_t>(frameCount, XB_MIXER_RENDER_FRAMES);
+        Mix(frames, count);
+        sink.Write(frames, count);
+        frameCount -= count;
+    }
+}
+
+// ******************************************************************
+// * Wav file sink
+// ******************************************************************
+static void WriteLE32(FILE *pFile, uint32_t value)
+{
+    uint8_t bytes[4] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) };
+    fwrite(bytes, 1, sizeof(bytes), pFile);
+}
+
+static void WriteLE16(FILE *pFile, uint16_t value)
+{
+    uint8_t bytes[2] = { uint8_t(value), uint8_t(value >> 8) };
+    fwrite(bytes, 1, sizeof(bytes), pFile);
+}
+
+static void WriteWavHeader(FILE *pFile, uint32_t dataBytes)
+{
+    fwrite("RIFF", 1, 4, pFile);
+    WriteLE32(pFile, 36 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, pFile);
+    WriteLE32(pFile, 16);
+    WriteLE16(pFile, 1); // WAVE_FORMAT_PCM
+    WriteLE16(pFile, 2);
+    WriteLE32(pFile, XB_MIXER_OUTPUT_RATE);
+    WriteLE32(pFile, XB_MIXER_OUTPUT_RATE * 4);
+    WriteLE16(pFile, 4);
+    WriteLE16(pFile, 16);
+    fwrite("data", 1, 4, pFile);
+    WriteLE32(pFile, dataBytes);
+}
+
+bool XbMixerWavSink::Open(const char *szFileName)
+{
+    Close();
+
+    m_pFile = fopen(szFileName, "wb");
+    if (m_pFile == nullptr) {
+        return false;
+    }
+
+    m_dataBytes = 0;
+    WriteWavHeader(m_pFile, 0);
+    return true;
+}
+
+void XbMixerWavSink::Close()
+{
+    if (m_pFile == nullptr) {
+        return;
+    }
+
+    fseek(m_pFile, 0, SEEK_SET);
+    WriteWavHeader(m_pFile, m_dataBytes);
+    fclose(m_pFile);
+    m_pFile = nullptr;
+}
+
+void XbMixerWavSink::Write(const int16_t *pFrames, uint32_t frameCount)
+{
+    if (m_pFile == nullptr) {
+        return;
+    }
+
+    // Output samples are little endian like the file, as all the hosts are
+    m_dataBytes += uint32_t(fwrite(pFrames, 4, frameCount, m_pFile) * 4);
+}
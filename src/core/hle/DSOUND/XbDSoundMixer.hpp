@@ -0,0 +1,169 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef XBDSOUNDMIXER_H
+#define XBDSOUNDMIXER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Software mixer for the HLE DirectSound voices, as an alternative to one host sound buffer per voice.
+// It mixes plain PCM only (the HLE layer already converts Xbox ADPCM before it reaches a voice) and
+// doesn't depend on any host audio API : the mixed output is handed to a XbMixerSink, which can be a
+// host audio stream, a wav file or nothing at all.
+
+#define XB_MIXER_OUTPUT_RATE        48000   // Same as the Xbox APU output
+#define XB_MIXER_VOLUME_MIN         (-10000) // In hundredths of a decibel, same as DSBVOLUME_MIN
+#define XB_MIXER_FREQUENCY_MAX      200000  // Same as DSBFREQUENCY_MAX
+#define XB_MIXER_SPEED_OF_SOUND     343.3f  // In meters per second
+
+typedef struct _XbMixerFormat {
+    uint32_t        SamplesPerSec;
+    uint16_t        Channels;       // Only the first two channels are mixed, as left and right
+    uint16_t        BitsPerSample;  // 8 (unsigned) or 16 (signed)
+} XbMixerFormat;
+
+typedef struct _XbMixerVector {
+    float           x, y, z;
+} XbMixerVector;
+
+// Same values as DS3DMODE_*
+enum XbMixer3DMode {
+    XB_MIXER_3DMODE_NORMAL = 0,
+    XB_MIXER_3DMODE_HEADRELATIVE = 1,
+    XB_MIXER_3DMODE_DISABLE = 2,
+};
+
+// Same fields as DS3DBUFFER; angles are in degrees and volumes in hundredths of a decibel
+typedef struct _XbMixer3DParams {
+    XbMixerVector   Position;
+    XbMixerVector   Velocity;
+    uint32_t        InsideConeAngle;
+    uint32_t        OutsideConeAngle;
+    XbMixerVector   ConeOrientation;
+    int32_t         ConeOutsideVolume;
+    float           MinDistance;
+    float           MaxDistance;
+    uint32_t        Mode;
+} XbMixer3DParams;
+
+// Same fields as DS3DLISTENER
+typedef struct _XbMixerListenerParams {
+    XbMixerVector   Position;
+    XbMixerVector   Velocity;
+    float           DistanceFactor;
+    float           RolloffFactor;
+    float           DopplerFactor;
+    XbMixerVector   OrientFront;
+    XbMixerVector   OrientTop;
+} XbMixerListenerParams;
+
+// Receives the mixed output, as interleaved 16 bit stereo frames at XB_MIXER_OUTPUT_RATE
+class XbMixerSink {
+    public:
+        virtual ~XbMixerSink() {}
+        virtual void Write(const int16_t *pFrames, uint32_t frameCount) = 0;
+};
+
+// Drops the output, for running without audio device and for measuring the mixer alone
+class XbMixerNullSink : public XbMixerSink {
+    public:
+        void Write(const int16_t *pFrames, uint32_t frameCount) override { m_frameCount += frameCount; }
+        uint64_t GetFrameCount() const { return m_frameCount; }
+
+    private:
+        uint64_t m_frameCount = 0;
+};
+
+// Writes the output to a wav file, of which the header is completed on Close
+class XbMixerWavSink : public XbMixerSink {
+    public:
+        ~XbMixerWavSink() { Close(); }
+        bool Open(const char *szFileName);
+        void Close();
+        void Write(const int16_t *pFrames, uint32_t frameCount) override;
+
+    private:
+        FILE *m_pFile = nullptr;
+        uint32_t m_dataBytes = 0;
+};
+
+struct XbMixerVoice;
+
+// All methods are thread safe, Mix is expected to be called from a single (audio) thread though.
+// The sample data of a voice is written by the caller through the pointer from GetVoiceData,
+// like it would through a locked sound buffer, without holding on to the mixer.
+class XbDSoundMixer {
+    public:
+        XbDSoundMixer();
+        ~XbDSoundMixer();
+
+        XbMixerVoice *CreateVoice(const XbMixerFormat &format, uint32_t bufferBytes, bool b3D);
+        void DestroyVoice(XbMixerVoice *pVoice);
+        uint8_t *GetVoiceData(XbMixerVoice *pVoice, uint32_t *pBufferBytes);
+        void GetVoiceFormat(XbMixerVoice *pVoice, XbMixerFormat *pFormat);
+        void SetVoiceFormat(XbMixerVoice *pVoice, const XbMixerFormat &format);
+
+        void Play(XbMixerVoice *pVoice, bool bLooping);
+        void Stop(XbMixerVoice *pVoice);
+        bool IsPlaying(XbMixerVoice *pVoice, bool *pbLooping);
+        // Positions are in bytes of sample data
+        uint32_t GetPosition(XbMixerVoice *pVoice);
+        void SetPosition(XbMixerVoice *pVoice, uint32_t dwPosition);
+
+        // A frequency of 0 plays at the rate of the voice format
+        void SetFrequency(XbMixerVoice *pVoice, uint32_t dwFrequency);
+        uint32_t GetFrequency(XbMixerVoice *pVoice);
+        void SetVolume(XbMixerVoice *pVoice, int32_t lVolume);
+        int32_t GetVolume(XbMixerVoice *pVoice);
+        void SetPan(XbMixerVoice *pVoice, int32_t lPan);
+        int32_t GetPan(XbMixerVoice *pVoice);
+        void Set3DParams(XbMixerVoice *pVoice, const XbMixer3DParams &params);
+        void Get3DParams(XbMixerVoice *pVoice, XbMixer3DParams *pParams);
+
+        void SetListener(const XbMixerListenerParams &params);
+        void GetListener(XbMixerListenerParams *pParams);
+
+        // Mixes the next frameCount output frames of all playing voices
+        void Mix(int16_t *pFrames, uint32_t frameCount);
+        // Same as Mix, handing the output over to a sink
+        void Render(XbMixerSink &sink, uint32_t frameCount);
+
+        uint32_t GetPlayingVoiceCount();
+
+    private:
+        void MixVoice(XbMixerVoice *pVoice, uint32_t frameCount);
+
+        std::mutex m_mutex;
+        std::vector<XbMixerVoice*> m_voices;
+        XbMixerListenerParams m_listener;
+        std::vector<float> m_bus;       // Interleaved stereo, for one Mix call
+        std::vector<float> m_source;    // Interleaved stereo, source frames of the voice being mixed
+};
+
+// Default 3D parameters, same as the DirectSound defaults
+void XbMixerGetDefault3DParams(XbMixer3DParams *pParams);
+void XbMixerGetDefaultListener(XbMixerListenerParams *pParams);
+
+#endif // XBDSOUNDMIXER_H
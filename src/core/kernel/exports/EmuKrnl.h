@@ -50,15 +50,24 @@ xboxkrnl::PLIST_ENTRY RemoveTailList(xboxkrnl::PLIST_ENTRY pListHead);
 extern xboxkrnl::LAUNCH_DATA_PAGE DefaultLaunchDataPage;
 extern xboxkrnl::PKINTERRUPT EmuInterruptList[MAX_BUS_INTERRUPT_LEVEL + 1];
 
+class HalSystemInterrupt;
+// Marks the interrupt as pending and wakes up the interrupt thread
+void SignalPendingInterrupt(HalSystemInterrupt* Interrupt);
+
 class HalSystemInterrupt {
 public:
 	void Assert(bool state) {
 		// If the interrupt was marked as Asserted, and was previously not, set the pending flag too!
-		if (m_Asserted == 0 && state == 1) {
+		bool bRaised = (m_Asserted == 0 && state == 1);
+		if (bRaised) {
 			m_Pending = true;
 		}
 
 		m_Asserted = state;
+
+		if (bRaised) {
+			SignalPendingInterrupt(this);
+		}
 	};
 
 	void Enable() {
@@ -106,6 +115,9 @@ private:
 
 extern HalSystemInterrupt HalSystemInterrupts[MAX_BUS_INTERRUPT_LEVEL + 1];
 
+// Returns the refresh rate (in Hz) of the display mode last set with AvSetDisplayMode
+xboxkrnl::ULONG AvpGetRefreshRate();
+
 bool DisableInterrupts();
 void RestoreInterruptMode(bool value);
 void CallSoftwareInterrupt(const xboxkrnl::KIRQL SoftwareIrql);
@@ -130,6 +130,21 @@ ULONG AvSMCVideoModeToAVPack(ULONG VideoMode)
 	return AV_PACK_NONE;
 }
 
+ULONG AvpGetRefreshRate()
+{
+	ULONG Mode = AvpCurrentMode;
+
+	// Every mode appears in the table with a single refresh flag, so the first match is enough
+	for (const XB_DisplayMode& DisplayMode : g_DisplayModes) {
+		if (DisplayMode.DisplayMode == Mode) {
+			return (DisplayMode.AvInfo & AV_FLAGS_50Hz) ? 50 : 60;
+		}
+	}
+
+	// Until the title sets a mode, or if we don't know it, assume 60Hz
+	return 60;
+}
+
 
 ULONG AvQueryAvCapabilities()
 {
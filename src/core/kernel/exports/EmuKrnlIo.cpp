@@ -40,6 +40,8 @@ namespace xboxkrnl
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "core\kernel\support\Emu.h" // For EmuLog(LOG_LEVEL::WARNING, )
 #include "core\kernel\support\EmuFile.h" // For CxbxCreateSymbolicLink(), etc.
+#include "core\kernel\support\EmuFileCache.h" // For CxbxMediaCacheRegisterHandle()
+#include "core\kernel\support\EmuXiso.h" // For CxbxXisoOpenFile()
 #include "CxbxDebugger.h"
 
 // ******************************************************************
@@ -270,7 +272,17 @@ XBSYSAPI EXPORTNUM(66) xboxkrnl::NTSTATUS NTAPI xboxkrnl::IoCreateFile
 	// Force ShareAccess to all 
 	ShareAccess = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
 
-    if (SUCCEEDED(ret))
+    std::string xisoPath;
+    if (SUCCEEDED(ret) && nativeObjectAttributes.NtObjAttrPtr != nullptr &&
+        CxbxXisoResolvePath(nativeObjectAttributes.NtObjAttr.RootDirectory, nativeObjectAttributes.wszObjectName, xisoPath))
+    {
+        // Files on a mounted XISO image are opened from the image itself
+        ::ULONG_PTR Information;
+        ret = CxbxXisoOpenFile(xisoPath, DesiredAccess, Disposition, CreateOptions, FileHandle, &Information);
+        IoStatusBlock->Status = ret;
+        IoStatusBlock->Information = Information;
+    }
+    else if (SUCCEEDED(ret))
     {
         // redirect to NtCreateFile
         ret = NtDll::NtCreateFile(
@@ -290,6 +302,11 @@ XBSYSAPI EXPORTNUM(66) xboxkrnl::NTSTATUS NTAPI xboxkrnl::IoCreateFile
         {
             CxbxDebugger::ReportFileOpened(*FileHandle, nativeObjectAttributes.NtUnicodeString.Buffer, SUCCEEDED(ret));
         }
+
+        if (SUCCEEDED(ret) && (CreateOptions & FILE_DIRECTORY_FILE) == 0 && nativeObjectAttributes.NtObjAttrPtr != nullptr)
+        {
+            CxbxMediaCacheRegisterHandle(*FileHandle, nativeObjectAttributes.NtObjAttr.RootDirectory, DesiredAccess);
+        }
     }
 
 	if (FAILED(ret))
@@ -88,8 +88,11 @@ namespace NtDll
 #include "core\kernel\support\EmuFile.h" // For IsEmuHandle(), NtStatusToString()
 #include "Timer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <thread>
+#include <unordered_map>
 #include <windows.h>
 #include <map>
 
@@ -103,6 +106,15 @@ typedef struct _DpcData {
 
 DpcData g_DpcData = { 0 }; // Note : g_DpcData is initialized in InitDpcThread()
 
+// Set while a thread drains the DpcQueue; only that thread runs DPCs (like the Xbox, which has a single CPU)
+static std::atomic_bool g_DpcQueueDraining(false);
+
+// When each DPC currently in the DpcQueue was inserted, to measure how long it waited (protected by g_DpcData.Lock).
+// Entries are removed together with the DPC, as a KDPC can be freed once it's no longer queued
+static std::unordered_map<xboxkrnl::PKDPC, std::chrono::steady_clock::time_point> g_DpcInsertTime;
+
+static DpcQueueStats g_DpcQueueStats = { 0 }; // Protected by g_DpcData.Lock
+
 xboxkrnl::ULONGLONG LARGE_INTEGER2ULONGLONG(xboxkrnl::LARGE_INTEGER value)
 {
 	// Weird construction because there doesn't seem to exist an implicit
@@ -277,49 +289,114 @@ xboxkrnl::VOID NTAPI xboxkrnl::KeInitializeTimer
 #define KeRaiseIrql(NewIrql, OldIrql) \
 	*(OldIrql) = KfRaiseIrql(NewIrql)
 
-void ExecuteDpcQueue()
+static unsigned DpcHistogramBucket(uint64_t us)
 {
-	xboxkrnl::PKDPC pkdpc;
+	// Bucket 0 holds durations under 1 us, bucket n those from 2^(n-1) us up to 2^n us, the last one all the rest
+	unsigned bucket = 0;
+	while (us != 0 && bucket < DPC_HISTOGRAM_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
 
-	// While we're working with the DpcQueue, we need to be thread-safe :
-	EnterCriticalSection(&(g_DpcData.Lock));
+	return bucket;
+}
 
-//    if (g_DpcData._fShutdown)
-//        break; // while 
+static void RecordDpcExecution(uint64_t wait_us, uint64_t run_us)
+{
+	g_DpcQueueStats.executed++;
+	g_DpcQueueStats.total_wait_us += wait_us;
+	g_DpcQueueStats.total_run_us += run_us;
+	g_DpcQueueStats.max_wait_us = std::max(g_DpcQueueStats.max_wait_us, wait_us);
+	g_DpcQueueStats.max_run_us = std::max(g_DpcQueueStats.max_run_us, run_us);
+	g_DpcQueueStats.wait_histogram[DpcHistogramBucket(wait_us)]++;
+	g_DpcQueueStats.run_histogram[DpcHistogramBucket(run_us)]++;
+}
 
-//    Assert(g_DpcData._dwThreadId == GetCurrentThreadId());
-//    Assert(g_DpcData._dwDpcThreadId == 0);
-//    g_DpcData._dwDpcThreadId = g_DpcData._dwThreadId;
-//    Assert(g_DpcData._dwDpcThreadId != 0);
+void ExecuteDpcQueue()
+{
+	using namespace std::chrono;
 
-	// Are there entries in the DpqQueue?
-	while (!IsListEmpty(&(g_DpcData.DpcQueue)))
+	// If another thread is already draining the DpcQueue, it will also run whatever was just queued
+	// (the same goes for DPCs queued by a DPC, which end up here recursively)
+	if (g_DpcQueueDraining.exchange(true)) {
+		return;
+	}
+
+	bool executed = false;
+	uint64_t wait_us = 0, run_us = 0;
+
+	// The lock is only held to take entries from the DpcQueue, so KeInsertQueueDpc doesn't have to wait for running DPCs
+	while (true)
 	{
+		EnterCriticalSection(&(g_DpcData.Lock));
+
+		if (executed) {
+			RecordDpcExecution(wait_us, run_us);
+		}
+
+		// Are there entries in the DpqQueue?
+		if (IsListEmpty(&(g_DpcData.DpcQueue))) {
+			// Stop draining before releasing the lock, so that the next KeInsertQueueDpc starts a new drain
+			g_DpcQueueDraining = false;
+			LeaveCriticalSection(&(g_DpcData.Lock));
+			break;
+		}
+
 		// Extract the head entry and retrieve the containing KDPC pointer for it:
-		pkdpc = CONTAINING_RECORD(RemoveHeadList(&(g_DpcData.DpcQueue)), xboxkrnl::KDPC, DpcListEntry);
+		xboxkrnl::PKDPC pkdpc = CONTAINING_RECORD(RemoveHeadList(&(g_DpcData.DpcQueue)), xboxkrnl::KDPC, DpcListEntry);
 		// Mark it as no longer linked into the DpcQueue
 		pkdpc->Inserted = FALSE;
+		// Once unlocked, the DPC can be queued again (with new arguments), so take a copy of what we need to call it
+		xboxkrnl::PKDEFERRED_ROUTINE DeferredRoutine = pkdpc->DeferredRoutine;
+		xboxkrnl::PVOID DeferredContext = pkdpc->DeferredContext;
+		xboxkrnl::PVOID SystemArgument1 = pkdpc->SystemArgument1;
+		xboxkrnl::PVOID SystemArgument2 = pkdpc->SystemArgument2;
+
+		steady_clock::time_point start = steady_clock::now();
+		auto it = g_DpcInsertTime.find(pkdpc);
+		wait_us = 0;
+		if (it != g_DpcInsertTime.end()) {
+			wait_us = duration_cast<microseconds>(start - it->second).count();
+			g_DpcInsertTime.erase(it);
+		}
+
+		LeaveCriticalSection(&(g_DpcData.Lock));
+
 		// Set DpcRoutineActive to support KeIsExecutingDpc:
 		KeGetCurrentPrcb()->DpcRoutineActive = TRUE; // Experimental
-		DBG_PRINTF("Global DpcQueue, calling DPC at 0x%.8X\n", pkdpc->DeferredRoutine);
+		DBG_PRINTF("Global DpcQueue, calling DPC at 0x%.8X\n", DeferredRoutine);
 		__try {
 			// Call the Deferred Procedure  :
-			pkdpc->DeferredRoutine(
+			DeferredRoutine(
 				pkdpc,
-				pkdpc->DeferredContext,
-				pkdpc->SystemArgument1,
-				pkdpc->SystemArgument2);
+				DeferredContext,
+				SystemArgument1,
+				SystemArgument2);
 		} __except (EmuException(GetExceptionInformation()))
 		{
 			EmuLog(LOG_LEVEL::WARNING, "Problem with ExceptionFilter!");
 		}
 
 		KeGetCurrentPrcb()->DpcRoutineActive = FALSE; // Experimental
+
+		run_us = duration_cast<microseconds>(steady_clock::now() - start).count();
+		executed = true;
 	}
+}
 
-//    Assert(g_DpcData._dwThreadId == GetCurrentThreadId());
-//    Assert(g_DpcData._dwDpcThreadId == g_DpcData._dwThreadId);
-//    g_DpcData._dwDpcThreadId = 0;
+DpcQueueStats GetDpcQueueStats()
+{
+	EnterCriticalSection(&(g_DpcData.Lock));
+	DpcQueueStats stats = g_DpcQueueStats;
+	LeaveCriticalSection(&(g_DpcData.Lock));
+
+	return stats;
+}
+
+void ResetDpcQueueStats()
+{
+	EnterCriticalSection(&(g_DpcData.Lock));
+	g_DpcQueueStats = { 0 };
 	LeaveCriticalSection(&(g_DpcData.Lock));
 }
 
@@ -1071,18 +1148,22 @@ XBSYSAPI EXPORTNUM(119) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeInsertQueueDpc
 		Dpc->SystemArgument1 = SystemArgument1;
 		Dpc->SystemArgument2 = SystemArgument2;
 		InsertTailList(&(g_DpcData.DpcQueue), &(Dpc->DpcListEntry));
+		g_DpcInsertTime[Dpc] = std::chrono::steady_clock::now();
 		// TODO : Instead of DpcQueue, add the DPC to KeGetCurrentPrcb()->DpcListHead
-		// Signal the Dpc handling code there's work to do
-		HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
-		// OpenXbox has this instead:
-		// if (!pKPRCB->DpcRoutineActive && !pKPRCB->DpcInterruptRequested) {
-		//	pKPRCB->DpcInterruptRequested = TRUE;
 	}
 
 	// Thread-safety is no longer required anymore
 	LeaveCriticalSection(&(g_DpcData.Lock));
 	// TODO : Instead, enable interrupts - use KeLowerIrql(OldIrql) ?
 
+	if (NeedsInsertion) {
+		// Signal the Dpc handling code there's work to do (outside of the lock, as this can run the DpcQueue right away)
+		HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
+		// OpenXbox has this instead:
+		// if (!pKPRCB->DpcRoutineActive && !pKPRCB->DpcInterruptRequested) {
+		//	pKPRCB->DpcInterruptRequested = TRUE;
+	}
+
 	RETURN(NeedsInsertion);
 }
 
@@ -1449,6 +1530,7 @@ XBSYSAPI EXPORTNUM(137) xboxkrnl::BOOLEAN NTAPI xboxkrnl::KeRemoveQueueDpc
 	{
 		RemoveEntryList(&(Dpc->DpcListEntry));
 		Dpc->Inserted = FALSE;
+		g_DpcInsertTime.erase(Dpc);
 	}
 
 	// TODO : Instead of using a lock, emulate the Set Interrupt Flag (sti) instruction
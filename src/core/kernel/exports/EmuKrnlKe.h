@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 namespace xboxkrnl
 {
 	VOID NTAPI KeSetSystemTime
@@ -38,3 +40,19 @@ namespace xboxkrnl
 		IN PKTIMER Timer
 	);
 }
+
+#define DPC_HISTOGRAM_BUCKETS 16
+
+// How long DPCs waited in the DpcQueue and how long they ran (histogram buckets are powers of 2 in microseconds)
+struct DpcQueueStats {
+	uint64_t executed;
+	uint64_t total_wait_us;
+	uint64_t total_run_us;
+	uint64_t max_wait_us;
+	uint64_t max_run_us;
+	uint32_t wait_histogram[DPC_HISTOGRAM_BUCKETS];
+	uint32_t run_histogram[DPC_HISTOGRAM_BUCKETS];
+};
+
+DpcQueueStats GetDpcQueueStats();
+void ResetDpcQueueStats();
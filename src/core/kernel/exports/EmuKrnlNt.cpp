@@ -48,6 +48,8 @@ namespace NtDll
 #include "core\kernel\exports\EmuKrnlKe.h"
 #include "core\kernel\support\Emu.h" // For EmuLog(LOG_LEVEL::WARNING, )
 #include "core\kernel\support\EmuFile.h" // For EmuNtSymbolicLinkObject, NtStatusToString(), etc.
+#include "core\kernel\support\EmuFileCache.h" // For CxbxMediaCacheRead(), CxbxMediaCacheInvalidateHandle()
+#include "core\kernel\support\EmuXiso.h" // For CxbxXisoFileFromHandle(), etc.
 #include "core\kernel\memory-manager\VMManager.h" // For g_VMManager
 #include "CxbxDebugger.h"
 
@@ -165,6 +167,7 @@ XBSYSAPI EXPORTNUM(187) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtClose
 		// Prevent exceptions when using invalid NTHandle
 		DWORD flags = 0;
 		if (GetHandleInformation(Handle, &flags) != 0) {
+			CxbxMediaCacheUnregisterHandle(Handle);
 			ret = NtDll::NtClose(Handle);
 
 			// Delete duplicate threads created by our implementation of NtQueueApcThread()
@@ -651,6 +654,12 @@ XBSYSAPI EXPORTNUM(196) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtDeviceIoControlFile
 	{
 		PPARTITION_INFORMATION partitioninfo = (PPARTITION_INFORMATION)OutputBuffer;
 
+		// The mounted XISO image isn't a partition of the hard disk
+		if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+			ret = STATUS_INVALID_DEVICE_REQUEST;
+			break;
+		}
+
 		XboxPartitionTable partitionTable = CxbxGetPartitionTable();
 		int partitionNumber = CxbxGetPartitionNumberFromHandle(FileHandle);
 		
@@ -743,7 +752,13 @@ XBSYSAPI EXPORTNUM(198) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtFlushBuffersFile
 		LOG_FUNC_END;
 	NTSTATUS ret = STATUS_SUCCESS;
 	
-	if (IsEmuHandle(FileHandle)) 
+	// Files on a mounted XISO image are read-only, there's nothing to flush
+	if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+		ret = STATUS_ACCESS_DENIED;
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = 0;
+	}
+	else if (IsEmuHandle(FileHandle)) 
 		LOG_UNIMPLEMENTED();
 	else
 		ret = NtDll::NtFlushBuffersFile(FileHandle, (NtDll::IO_STATUS_BLOCK*)IoStatusBlock);
@@ -807,6 +822,15 @@ XBSYSAPI EXPORTNUM(200) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtFsControlFile
 
 	NTSTATUS ret = STATUS_INVALID_PARAMETER;
 
+	// The mounted XISO image can't be dismounted or formatted
+	if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+		ret = STATUS_NOT_SUPPORTED;
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = 0;
+
+		RETURN(ret);
+	}
+
 	switch (FsControlCode) {
 		case 0x00090020: // FSCTL_DISMOUNT_VOLUME 
 			int partitionNumber = CxbxGetPartitionNumberFromHandle(FileHandle);
@@ -1063,6 +1087,31 @@ XBSYSAPI EXPORTNUM(207) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryDirectoryFile
 	if (FileInformationClass != FileDirectoryInformation)   // Due to unicode->string conversion
 		CxbxKrnlCleanup("Unsupported FileInformationClass");
 
+	// Directories on a mounted XISO image are enumerated from the image directly
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileFromHandle(FileHandle);
+	if (xisoFile != nullptr) {
+		std::string xisoMask;
+		if (FileMask != 0) {
+			xisoMask.assign(FileMask->Buffer, FileMask->Length);
+		}
+
+		// Xbox expects directories to be listed when *.* is passed
+		if (xisoMask == "*.*") {
+			xisoMask = "*";
+		}
+
+		::ULONG_PTR Information;
+		ret = CxbxXisoQueryDirectory(xisoFile, FileInformation, Length, xisoMask, RestartScan != FALSE, &Information);
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = Information;
+
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, NULL);
+		}
+
+		RETURN(ret);
+	}
+
 	NtDll::UNICODE_STRING NtFileMask;
 
 	wchar_t wszObjectName[MAX_PATH];
@@ -1205,6 +1254,13 @@ XBSYSAPI EXPORTNUM(210) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryFullAttributes
 		/*var*/nativeObjectAttributes,
 		"NtQueryFullAttributesFile");
 
+	// Files on a mounted XISO image are looked up in the image directly
+	std::string xisoPath;
+	if (ret == STATUS_SUCCESS && CxbxXisoResolvePath(nativeObjectAttributes.NtObjAttr.RootDirectory, nativeObjectAttributes.wszObjectName, xisoPath)) {
+		ret = CxbxXisoQueryAttributes(xisoPath, Attributes);
+		RETURN(ret);
+	}
+
 	if (ret == STATUS_SUCCESS)
 		ret = NtDll::NtQueryFullAttributesFile(
 			nativeObjectAttributes.NtObjAttrPtr,
@@ -1242,6 +1298,17 @@ XBSYSAPI EXPORTNUM(211) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryInformationFil
 	NTSTATUS ret;
 	PVOID ntFileInfo;
 
+	// Files on a mounted XISO image are described from their directory entry
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileFromHandle(FileHandle);
+	if (xisoFile != nullptr) {
+		::ULONG_PTR Information;
+		ret = CxbxXisoQueryInformation(xisoFile, FileInformation, Length, FileInformationClass, &Information);
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = Information;
+
+		RETURN(ret);
+	}
+
 	// Start with sizeof(corresponding struct)
 	size_t bufferSize = XboxFileInfoStructSizes[FileInformationClass];
 
@@ -1521,6 +1588,15 @@ XBSYSAPI EXPORTNUM(218) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtQueryVolumeInformat
 		LOG_FUNC_ARG(FileInformationClass)
 		LOG_FUNC_END;
 
+	// The mounted XISO image has no host volume to query
+	if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+		EmuLog(LOG_LEVEL::WARNING, "Unsupported FsInformationClass %d on an XISO file", FileInformationClass);
+		IoStatusBlock->Status = STATUS_NOT_SUPPORTED;
+		IoStatusBlock->Information = 0;
+
+		RETURN(STATUS_NOT_SUPPORTED);
+	}
+
 	// FileFsSizeInformation is a special case that should read from our emulated partition table
 	if ((DWORD)FileInformationClass == FileFsSizeInformation) {
 		PFILE_FS_SIZE_INFORMATION XboxSizeInfo = (PFILE_FS_SIZE_INFORMATION)FileInformation;
@@ -1653,7 +1729,46 @@ XBSYSAPI EXPORTNUM(219) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtReadFile
 		CxbxDebugger::ReportFileRead(FileHandle, Length, Offset);
 	}
 
-	NTSTATUS ret = NtDll::NtReadFile(
+	// Reads from the game media can often be served from the host side cache. Reads that want an APC
+	// are left to the host, which queues it; otherwise complete like a synchronous read would
+	NTSTATUS ret;
+	::ULONG_PTR Information;
+
+	// Files on a mounted XISO image are read from the image directly
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileFromHandle(FileHandle);
+	if (xisoFile != nullptr) {
+		ret = CxbxXisoReadFile(xisoFile, Buffer, Length, (NtDll::LARGE_INTEGER*)ByteOffset, &Information);
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = Information;
+
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, NULL);
+		}
+
+		if (ApcRoutine != NULL) {
+			NtDll::NtQueueApcThread(
+				GetCurrentThread(),
+				(NtDll::PIO_APC_ROUTINE)ApcRoutine,
+				ApcContext,
+				(NtDll::PIO_STATUS_BLOCK)IoStatusBlock,
+				0);
+		}
+
+		RETURN(ret);
+	}
+
+	if (ApcRoutine == NULL && CxbxMediaCacheRead(FileHandle, Buffer, Length, (NtDll::LARGE_INTEGER*)ByteOffset, &ret, &Information)) {
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = Information;
+
+		if (Event != NULL) {
+			NtDll::NtSetEvent(Event, NULL);
+		}
+
+		RETURN(ret);
+	}
+
+	ret = NtDll::NtReadFile(
 		FileHandle,
 		Event,
 		ApcRoutine,
@@ -1697,6 +1812,14 @@ XBSYSAPI EXPORTNUM(220) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtReadFileScatter
 		LOG_FUNC_ARG(ByteOffset)
 	LOG_FUNC_END;
 
+	// Scattered reads aren't implemented for files on a mounted XISO image
+	if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+		IoStatusBlock->Status = STATUS_NOT_SUPPORTED;
+		IoStatusBlock->Information = 0;
+
+		RETURN(STATUS_NOT_SUPPORTED);
+	}
+
 	LOG_UNIMPLEMENTED();
 
 	RETURN(STATUS_SUCCESS);
@@ -1845,6 +1968,16 @@ XBSYSAPI EXPORTNUM(226) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtSetInformationFile
 		LOG_FUNC_ARG(Length)
 		LOG_FUNC_ARG(FileInformationClass)
 		LOG_FUNC_END;
+
+	// Files on a mounted XISO image only support moving the file pointer
+	EmuNtXisoFileObject *xisoFile = CxbxXisoFileFromHandle(FileHandle);
+	if (xisoFile != nullptr) {
+		NTSTATUS ret = CxbxXisoSetInformation(xisoFile, FileInformation, Length, FileInformationClass);
+		IoStatusBlock->Status = ret;
+		IoStatusBlock->Information = 0;
+
+		RETURN(ret);
+	}
 	
 	XboxToNTFileInformation(convertedFileInfo, FileInformation, FileInformationClass, &Length);
 
@@ -1855,6 +1988,9 @@ XBSYSAPI EXPORTNUM(226) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtSetInformationFile
 		Length,
 		FileInformationClass);
 
+	// This could have changed the size of a file on the game media
+	CxbxMediaCacheInvalidateHandle(FileHandle);
+
 	RETURN(ret);
 }
 
@@ -2173,6 +2309,14 @@ XBSYSAPI EXPORTNUM(236) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtWriteFile
 		CxbxDebugger::ReportFileWrite(FileHandle, Length, Offset);
 	}
 
+	// Files on a mounted XISO image are read-only
+	if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+		IoStatusBlock->Status = STATUS_ACCESS_DENIED;
+		IoStatusBlock->Information = 0;
+
+		RETURN(STATUS_ACCESS_DENIED);
+	}
+
 	NTSTATUS ret = NtDll::NtWriteFile(
 		FileHandle,
 		Event,
@@ -2184,6 +2328,9 @@ XBSYSAPI EXPORTNUM(236) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtWriteFile
 		(NtDll::LARGE_INTEGER*)ByteOffset,
 		/*Key=*/nullptr);
 
+	// Reads from the game media mustn't return what this just overwrote (asynchronous writes are caught by NtClose)
+	CxbxMediaCacheInvalidateHandle(FileHandle);
+
 	if (FAILED(ret))
 		EmuLog(LOG_LEVEL::WARNING, "NtWriteFile Failed! (0x%.08X)", ret);
 
@@ -2216,6 +2363,14 @@ XBSYSAPI EXPORTNUM(237) xboxkrnl::NTSTATUS NTAPI xboxkrnl::NtWriteFileGather
 		LOG_FUNC_ARG(ByteOffset)
 	LOG_FUNC_END;
 
+	// Files on a mounted XISO image are read-only
+	if (CxbxXisoFileFromHandle(FileHandle) != nullptr) {
+		IoStatusBlock->Status = STATUS_ACCESS_DENIED;
+		IoStatusBlock->Information = 0;
+
+		RETURN(STATUS_ACCESS_DENIED);
+	}
+
 	LOG_UNIMPLEMENTED();
 
 	RETURN(STATUS_SUCCESS);
@@ -40,7 +40,10 @@ namespace xboxkrnl
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup
 #include "EmuKrnl.h" // For OBJECT_TO_OBJECT_HEADER()
 #include "core\kernel\support\EmuFile.h" // For EmuNtSymbolicLinkObject, NtStatusToString(), etc.
+#include <atomic>
 #include <cassert>
+#include <mutex>
+#include <vector>
 
 #pragma warning(disable:4005) // Ignore redefined status values
 #include <ntstatus.h>
@@ -71,6 +74,13 @@ XBSYSAPI EXPORTNUM(245) xboxkrnl::OBJECT_HANDLE_TABLE xboxkrnl::ObpObjectHandleT
 
 xboxkrnl::PVOID ObpDosDevicesDriveLetterMap['Z' - 'A' + 1];
 
+// Handles are resolved without taking any lock (raising the IRQL doesn't keep other host threads out anyway). Instead, readers
+// announce themselves in ObpHandleTableReaders while they walk ObpObjectHandleTable, so that a root table replaced by
+// ObpExtendObjectHandleTable is only freed once no reader can still be using it. Handle creation is serialized by ObpHandleTableLock
+static std::atomic<LONG> ObpHandleTableReaders(0);
+static std::mutex ObpHandleTableLock;
+static std::vector<xboxkrnl::PVOID**> ObpRetiredRootTables; // Protected by ObpHandleTableLock
+
 xboxkrnl::BOOLEAN xboxkrnl::ObpCreatePermanentDirectoryObject(
 	IN xboxkrnl::POBJECT_STRING DirectoryName OPTIONAL,
 	OUT xboxkrnl::POBJECT_DIRECTORY *DirectoryObject
@@ -277,6 +287,7 @@ xboxkrnl::BOOLEAN xboxkrnl::ObpExtendObjectHandleTable()
 	}
 
 	PVOID **NewRootTable;
+	PVOID **OldRootTable = NULL;
 	SIZE_T NewRootTableSize;
 	if ((HandleToUlong(ObpObjectHandleTable.NextHandleNeedingPool) & (sizeof(PVOID) * OB_HANDLES_PER_SEGMENT - 1)) == 0) {
 		if (ObpObjectHandleTable.NextHandleNeedingPool == NULL) {
@@ -294,11 +305,25 @@ xboxkrnl::BOOLEAN xboxkrnl::ObpExtendObjectHandleTable()
 			RtlCopyMemory(NewRootTable, ObpObjectHandleTable.RootTable, sizeof(PVOID*) * OldRootTableSize);
 
 			if (ObpObjectHandleTable.RootTable != ObpObjectHandleTable.BuiltinRootTable) {
-				ExFreePool(ObpObjectHandleTable.RootTable);
+				OldRootTable = ObpObjectHandleTable.RootTable;
 			}
 		}
 
 		ObpObjectHandleTable.RootTable = NewRootTable;
+
+		// Readers that start from now on can only see the new root table, so the old one can go as soon as the current ones are done
+		if (OldRootTable != NULL) {
+			ObpRetiredRootTables.push_back(OldRootTable);
+		}
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (ObpHandleTableReaders == 0) {
+			for (PVOID **RetiredRootTable : ObpRetiredRootTables) {
+				ExFreePool(RetiredRootTable);
+			}
+
+			ObpRetiredRootTables.clear();
+		}
 	}
 
 	ObpGetTableFromHandle(ObpObjectHandleTable.NextHandleNeedingPool) = NewTable;
@@ -320,6 +345,8 @@ xboxkrnl::BOOLEAN xboxkrnl::ObpExtendObjectHandleTable()
 		*HandleContents = NULL;
 	}
 
+	// Make the new table (and the root table pointing to it) visible before the handles it holds
+	std::atomic_thread_fence(std::memory_order_release);
 	ObpObjectHandleTable.NextHandleNeedingPool = (HANDLE)(HandleToLong(Handle) + (sizeof(PVOID) * OB_HANDLES_PER_TABLE));
 
 	return TRUE;
@@ -332,6 +359,8 @@ xboxkrnl::HANDLE xboxkrnl::ObpCreateObjectHandle(xboxkrnl::PVOID Object)
 	HANDLE Handle;
 	PVOID *HandleContents;
 
+	std::lock_guard<std::mutex> lock(ObpHandleTableLock);
+
 	if (ObpObjectHandleTable.FirstFreeTableEntry == -1) {
 		if (!ObpExtendObjectHandleTable()) {
 			return NULL;
@@ -343,6 +372,7 @@ xboxkrnl::HANDLE xboxkrnl::ObpCreateObjectHandle(xboxkrnl::PVOID Object)
 	ObpObjectHandleTable.FirstFreeTableEntry = (LONG_PTR)*HandleContents;
 	ObpObjectHandleTable.HandleCount++;
 	OBJECT_TO_OBJECT_HEADER(Object)->HandleCount++;
+	std::atomic_thread_fence(std::memory_order_release);
 	*HandleContents = Object;
 	return Handle;
 }
@@ -484,19 +514,24 @@ XBSYSAPI EXPORTNUM(240) xboxkrnl::OBJECT_TYPE xboxkrnl::ObDirectoryObjectType =
 xboxkrnl::PVOID xboxkrnl::ObpGetObjectHandleContents(HANDLE Handle)
 {
 	PVOID *HandleContents;
-	PVOID Object;
+	PVOID Object = NULL;
 	Handle = ObpMaskOffApplicationBits(Handle);
-	
+
+	ObpHandleTableReaders++;
+
 	if (HandleToUlong(Handle) < HandleToUlong(ObpObjectHandleTable.NextHandleNeedingPool)) {
+		std::atomic_thread_fence(std::memory_order_acquire);
 		HandleContents = ObpGetHandleContentsPointer(Handle);
 		Object = *HandleContents;
 
-		if (Object != NULL && !ObpIsFreeHandleLink(Object)) {
-			return Object;
+		if (Object == NULL || ObpIsFreeHandleLink(Object)) {
+			Object = NULL;
 		}
 	}
 
-	return NULL;
+	ObpHandleTableReaders--;
+
+	return Object;
 }
 
 xboxkrnl::ULONG FASTCALL xboxkrnl::ObpComputeHashIndex(
@@ -528,23 +563,14 @@ xboxkrnl::ULONG FASTCALL xboxkrnl::ObpComputeHashIndex(
 
 xboxkrnl::PVOID xboxkrnl::ObpGetObjectHandleReference(HANDLE Handle)
 {
-	PVOID *HandleContents;
-	Handle = ObpMaskOffApplicationBits(Handle);
-	KIRQL OldIrql = KeRaiseIrqlToDpcLevel();
+	// Same as ObpGetObjectHandleContents, but also takes a reference on the object
+	PVOID Object = ObpGetObjectHandleContents(Handle);
 
-	if (HandleToUlong(Handle) < HandleToUlong(ObpObjectHandleTable.NextHandleNeedingPool)) {
-		HandleContents = ObpGetHandleContentsPointer(Handle);
-		PVOID Object = *HandleContents;
-
-		if (Object != NULL && !ObpIsFreeHandleLink(Object)) {
-			OBJECT_TO_OBJECT_HEADER(Object)->PointerCount++;
-			KfLowerIrql(OldIrql);
-			return Object;
-		}
+	if (Object != NULL) {
+		InterlockedIncrement(&OBJECT_TO_OBJECT_HEADER(Object)->PointerCount);
 	}
 
-	KfLowerIrql(OldIrql);
-	return NULL;
+	return Object;
 }
 
 xboxkrnl::BOOLEAN xboxkrnl::ObpLookupElementNameInDirectory(
@@ -47,6 +47,7 @@ namespace NtDll
 
 #include "core\kernel\init\CxbxKrnl.h" // For CxbxKrnlCleanup()
 #include "core\kernel\support\Emu.h" // For EmuLog(LOG_LEVEL::WARNING, )
+#include "EmuKrnlRtlSimd.h" // For RtlpCompareMemory, etc.
 #include <assert.h>
 
 #ifdef _WIN32
@@ -405,16 +406,7 @@ XBSYSAPI EXPORTNUM(268) xboxkrnl::SIZE_T NTAPI xboxkrnl::RtlCompareMemory
 		LOG_FUNC_ARG(Length)
 		LOG_FUNC_END;
 
-	SIZE_T result = Length;
-
-	uint8_t *pBytes1 = (uint8_t *)Source1;
-	uint8_t *pBytes2 = (uint8_t *)Source2;
-	for (uint32_t i = 0; i < Length; i++) {
-		if (pBytes1[i] != pBytes2[i]) {
-			result = i;
-			break;
-		}
-	}
+	SIZE_T result = RtlpCompareMemory(Source1, Source2, Length);
 
 	RETURN(result);
 }
@@ -435,18 +427,7 @@ XBSYSAPI EXPORTNUM(269) xboxkrnl::SIZE_T NTAPI xboxkrnl::RtlCompareMemoryUlong
 		LOG_FUNC_ARG(Pattern)
 		LOG_FUNC_END;
 
-	PULONG ptr = (PULONG)Source;
-	ULONG_PTR len = Length / sizeof(ULONG);
-	ULONG_PTR i;
-
-	for (i = 0; i < len; i++) {
-		if (*ptr != Pattern)
-			break;
-
-		ptr++;
-	}
-
-	SIZE_T result = (SIZE_T)((PCHAR)ptr - (PCHAR)Source);
+	SIZE_T result = RtlpCompareMemoryUlong(Source, Length, Pattern);
 
 	RETURN(result);
 }
@@ -669,6 +650,14 @@ XBSYSAPI EXPORTNUM(276) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlDowncaseUnicodeStr
 	RETURN(result);
 }
 
+extern xboxkrnl::KPRCB *KeGetCurrentPrcb();
+
+// Contended critical sections are retried this many times at most before blocking on their event. The
+// number of attempts actually made follows the average that recent contended acquisitions needed (this
+// is only a heuristic, so it's updated without synchronization)
+#define RTL_CRITICAL_SECTION_MAX_SPINS 100
+static LONG RtlpCriticalSectionSpins = 10;
+
 // ******************************************************************
 // * 0x0115 - RtlEnterCriticalSection()
 // ******************************************************************
@@ -677,38 +666,67 @@ XBSYSAPI EXPORTNUM(277) xboxkrnl::VOID NTAPI xboxkrnl::RtlEnterCriticalSection
     IN PRTL_CRITICAL_SECTION CriticalSection
 )
 {
-    LOG_FUNC_ONE_ARG(CriticalSection);
+    // Avoid KeGetCurrentThread(), as that logs
+    HANDLE thread = (HANDLE)KeGetCurrentPrcb()->CurrentThread;
 
-    HANDLE thread = (HANDLE)KeGetCurrentThread();
-
-    CriticalSection->LockCount++;
-    if(CriticalSection->LockCount == 0) {
+    // Titles enter and leave critical sections all the time, so uncontended and recursive acquisitions
+    // return straight away, and only the contended ones get logged
+    if (InterlockedCompareExchange(&CriticalSection->LockCount, 0, -1) == -1) {
         CriticalSection->OwningThread = thread;
         CriticalSection->RecursionCount = 1;
+        return;
     }
-    else {
-        if(CriticalSection->OwningThread != thread) {
-			if (CriticalSection->OwningThread != nullptr) {
-				NTSTATUS result;
-				result = KeWaitForSingleObject(
-					(PVOID)CriticalSection,
-					(KWAIT_REASON)0,
-					(KPROCESSOR_MODE)0,
-					(BOOLEAN)0,
-					(PLARGE_INTEGER)0
-				);
-				if (!NT_SUCCESS(result))
-				{
-					CxbxKrnlCleanup("Waiting for event of a critical section returned %lx.", result);
-				};
-			}
-            CriticalSection->OwningThread = thread;
-            CriticalSection->RecursionCount = 1;
+
+    if (CriticalSection->OwningThread == thread) {
+        InterlockedIncrement(&CriticalSection->LockCount);
+        CriticalSection->RecursionCount++;
+        return;
+    }
+
+    LOG_FUNC_ONE_ARG(CriticalSection);
+
+    LONG MaxSpins = RtlpCriticalSectionSpins * 2 + 10;
+    if (MaxSpins > RTL_CRITICAL_SECTION_MAX_SPINS) {
+        MaxSpins = RTL_CRITICAL_SECTION_MAX_SPINS;
+    }
+
+    LONG Spins = 0;
+    bool Acquired = false;
+    while (Spins < MaxSpins) {
+        Spins++;
+        // All Xbox threads share one host core, so let the owner run (if it's ready) instead of just spinning
+        if (!SwitchToThread()) {
+            YieldProcessor();
         }
-        else {
-            CriticalSection->RecursionCount++;
+
+        if (CriticalSection->LockCount == -1 && InterlockedCompareExchange(&CriticalSection->LockCount, 0, -1) == -1) {
+            Acquired = true;
+            break;
         }
     }
+
+    RtlpCriticalSectionSpins += (Spins - RtlpCriticalSectionSpins) / 8;
+
+    // Register as a waiter; the owner signals the event when it leaves while the count shows waiters.
+    // Note that the event must always be waited on from here, as a skipped wait would leave a signal
+    // behind that lets a later waiter in while the section is owned
+    if (!Acquired && InterlockedIncrement(&CriticalSection->LockCount) != 0) {
+        NTSTATUS result;
+        result = KeWaitForSingleObject(
+            (PVOID)CriticalSection,
+            (KWAIT_REASON)0,
+            (KPROCESSOR_MODE)0,
+            (BOOLEAN)0,
+            (PLARGE_INTEGER)0
+        );
+        if (!NT_SUCCESS(result))
+        {
+            CxbxKrnlCleanup("Waiting for event of a critical section returned %lx.", result);
+        };
+    }
+
+    CriticalSection->OwningThread = thread;
+    CriticalSection->RecursionCount = 1;
 }
 
 // ******************************************************************
@@ -749,30 +767,11 @@ XBSYSAPI EXPORTNUM(279) xboxkrnl::BOOLEAN NTAPI xboxkrnl::RtlEqualString
 		return FALSE;
 	}
 
-	CHAR *p1 = String1->Buffer;
-	CHAR *p2 = String2->Buffer;
-	CHAR *last = p1 + l1;
-
 	if (CaseInSensitive) {
-		while (p1 < last) {
-			CHAR c1 = *p1++;
-			CHAR c2 = *p2++;
-			if (c1 != c2) {
-				c1 = RtlUpperChar(c1);
-				c2 = RtlUpperChar(c2);
-				if (c1 != c2) {
-					return FALSE;
-				}
-			}
-		}
-		return TRUE;
+		bRet = RtlpEqualStringCaseInsensitive(String1->Buffer, String2->Buffer, l1) ? TRUE : FALSE;
 	}
-
-	while (p1 < last) {
-		if (*p1++ != *p2++) {
-			bRet = FALSE;
-			break;
-		}
+	else {
+		bRet = (RtlpCompareMemory(String1->Buffer, String2->Buffer, l1) == l1) ? TRUE : FALSE;
 	}
 
 	RETURN(bRet);
@@ -799,33 +798,15 @@ XBSYSAPI EXPORTNUM(280) xboxkrnl::BOOLEAN NTAPI xboxkrnl::RtlEqualUnicodeString
 	USHORT l2 = String2->Length;
 
 	if (l1 == l2) {
-		WCHAR *p1 = (WCHAR*)(String1->Buffer);
-		WCHAR *p2 = (WCHAR*)(String2->Buffer);
-		WCHAR *last = p1 + (l1 / sizeof(WCHAR));
-
-		bRet = TRUE;
+		USHORT *p1 = String1->Buffer;
+		USHORT *p2 = String2->Buffer;
+		ULONG length = l1 / sizeof(WCHAR);
 
 		if (CaseInSensitive) {
-			while (p1 < last) {
-				WCHAR c1 = *p1++;
-				WCHAR c2 = *p2++;
-				if (c1 != c2) {
-					c1 = towupper(c1);
-					c2 = towupper(c2);
-					if (c1 != c2) {
-						bRet = FALSE;
-						break;
-					}
-				}
-			}
+			bRet = RtlpEqualUnicodeCaseInsensitive(p1, p2, length) ? TRUE : FALSE;
 		}
 		else {
-			while (p1 < last) {
-				if (*p1++ != *p2++) {
-					bRet = FALSE;
-					break;
-				}
-			}
+			bRet = (RtlpCompareMemory(p1, p2, length * sizeof(WCHAR)) == length * sizeof(WCHAR)) ? TRUE : FALSE;
 		}
 	}
 
@@ -998,13 +979,7 @@ XBSYSAPI EXPORTNUM(285) xboxkrnl::VOID NTAPI xboxkrnl::RtlFillMemoryUlong
 	assert(CHECK_ALIGNMENT(Length, sizeof(ULONG)));                   // Length must be a multiple of ULONG
 	assert(CHECK_ALIGNMENT((uintptr_t)Destination, sizeof(ULONG)));   // Destination must be 4-byte aligned
 
-	int NumOfRepeats = Length / sizeof(ULONG);
-	ULONG* d = (ULONG*)Destination;
-
-	for (int i = 0; i < NumOfRepeats; ++i)
-	{
-		d[i] = Pattern; // copy an ULONG at a time
-	}
+	RtlpFillMemoryUlong(Destination, Length, Pattern);
 }
 
 // ******************************************************************
@@ -1222,15 +1197,17 @@ XBSYSAPI EXPORTNUM(294) xboxkrnl::VOID NTAPI xboxkrnl::RtlLeaveCriticalSection
     IN PRTL_CRITICAL_SECTION CriticalSection
 )
 {
-    LOG_FUNC_ONE_ARG(CriticalSection);
+    // Like RtlEnterCriticalSection, only log when there's a waiter to wake up
+    if (--CriticalSection->RecursionCount != 0) {
+        InterlockedDecrement(&CriticalSection->LockCount);
+        return;
+    }
 
-    CriticalSection->RecursionCount--;
-    CriticalSection->LockCount--;
-    if(CriticalSection->RecursionCount == 0) {
-        CriticalSection->OwningThread = 0;
-        if(CriticalSection->LockCount >= 0) {
-            KeSetEvent((PRKEVENT)CriticalSection, (KPRIORITY)1, (BOOLEAN)0);
-        }
+    CriticalSection->OwningThread = 0;
+    if (InterlockedDecrement(&CriticalSection->LockCount) >= 0) {
+        LOG_FUNC_ONE_ARG(CriticalSection);
+
+        KeSetEvent((PRKEVENT)CriticalSection, (KPRIORITY)1, (BOOLEAN)0);
     }
 }
 
@@ -1244,9 +1221,12 @@ XBSYSAPI EXPORTNUM(295) xboxkrnl::VOID NTAPI xboxkrnl::RtlLeaveCriticalSectionAn
 {
     LOG_FUNC_ONE_ARG(CriticalSection);
 
+	// Another thread may own the section as soon as it's left, so check the recursion count beforehand
+	bool LastRelease = (CriticalSection->RecursionCount == 1);
+
     RtlLeaveCriticalSection(CriticalSection);
 
-	if (CriticalSection->RecursionCount == 0) {
+	if (LastRelease) {
 		KeLeaveCriticalRegion();
 	}
 }
@@ -1353,13 +1333,7 @@ XBSYSAPI EXPORTNUM(299) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlMultiByteToUnicode
 		*BytesInUnicodeString = numChars * sizeof(WCHAR);
 	}
 
-	while (numChars) {
-		*UnicodeString = (WCHAR)(*MultiByteString);
-
-		UnicodeString++;
-		MultiByteString++;
-		numChars--;
-	}
+	RtlpMultiByteToUnicode((uint16_t *)UnicodeString, MultiByteString, numChars);
 
 	RETURN(STATUS_SUCCESS);
 }
@@ -1651,7 +1625,7 @@ XBSYSAPI EXPORTNUM(306) xboxkrnl::BOOLEAN NTAPI xboxkrnl::RtlTryEnterCriticalSec
     }
     else {
         if(CriticalSection->OwningThread == thread) {
-            CriticalSection->LockCount++;
+            InterlockedIncrement(&CriticalSection->LockCount);
             CriticalSection->RecursionCount++;
             ret = true;
         }
@@ -1849,13 +1823,7 @@ XBSYSAPI EXPORTNUM(310) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlUnicodeToMultiByte
 		*BytesInMultiByteString = numChars;
 	}
 
-	while (numChars) {
-		*MultiByteString = (*UnicodeString < 0xff) ? (CHAR)(*UnicodeString) : '?';
-
-		UnicodeString++;
-		MultiByteString++;
-		numChars--;
-	}
+	RtlpUnicodeToMultiByte(MultiByteString, (uint16_t *)UnicodeString, numChars);
 
 	RETURN(STATUS_SUCCESS);
 }
@@ -1947,11 +1915,7 @@ XBSYSAPI EXPORTNUM(314) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlUpcaseUnicodeStrin
 	}
 
 	ULONG length = ((ULONG)SourceString->Length) / sizeof(WCHAR);
-	WCHAR *pDst = (WCHAR*)(DestinationString->Buffer);
-	WCHAR *pSrc = (WCHAR*)(SourceString->Buffer);
-	for (ULONG i = 0; i < length; i++) {
-		pDst[i] = (WCHAR)towupper(pSrc[i]);
-	}
+	RtlpUpcaseUnicode(DestinationString->Buffer, SourceString->Buffer, length);
 
 	DestinationString->Length = SourceString->Length;
 
@@ -1985,16 +1949,7 @@ XBSYSAPI EXPORTNUM(315) xboxkrnl::NTSTATUS NTAPI xboxkrnl::RtlUpcaseUnicodeToMul
 		*BytesInMultiByteString = numChars;
 	}
 
-	while (numChars > 0) {
-		WCHAR unicodeChar = (*UnicodeString < 256) ? *UnicodeString : L'?';
-		unicodeChar = towupper(unicodeChar);
-
-		*MultiByteString = (unicodeChar < 256) ? unicodeChar : '?';
-
-		UnicodeString++;
-		MultiByteString++;
-		numChars--;
-	}
+	RtlpUpcaseUnicodeToMultiByte(MultiByteString, (uint16_t *)UnicodeString, numChars);
 
 	RETURN(STATUS_SUCCESS);
 }
@@ -2044,18 +1999,13 @@ XBSYSAPI EXPORTNUM(317) xboxkrnl::VOID NTAPI xboxkrnl::RtlUpperString
 		LOG_FUNC_ARG(SourceString)
 		LOG_FUNC_END;
 
-	CHAR *pDst = DestinationString->Buffer;
-	CHAR *pSrc = SourceString->Buffer;
 	ULONG length = SourceString->Length;
 	if ((USHORT)length > DestinationString->MaximumLength) {
 		length = DestinationString->MaximumLength;
 	}
 
 	DestinationString->Length = (USHORT)length;
-	while (length > 0) {
-		*pDst++ = RtlUpperChar(*pSrc++);
-		length--;
-	}
+	RtlpUpperString(DestinationString->Buffer, SourceString->Buffer, length);
 }
 
 // ******************************************************************
@@ -0,0 +1,531 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+// The exports in EmuKrnlRtl.cpp call these through pointers that select, on their first call, the widest
+// implementation the host supports. Every vectorized version processes whole vectors only and leaves the
+// remainder (and any block it can't handle, like non-ASCII characters in the case folding functions) to
+// the plain C version, so the results are always identical to it.
+
+#include <wctype.h> // For towupper
+#include <emmintrin.h> // For SSE2 intrinsics
+#include <immintrin.h> // For AVX2 intrinsics
+#include "common\util\CPUID.h" // For SimdCaps
+#include "EmuKrnlRtlSimd.h"
+
+static inline unsigned FirstSetBit(uint32_t Mask)
+{
+	unsigned long Index;
+	_BitScanForward(&Index, Mask);
+	return Index;
+}
+
+//
+// Memory comparison and filling
+//
+
+static size_t CompareMemory_C(const void *Source1, const void *Source2, size_t Length)
+{
+	const uint8_t *pBytes1 = (const uint8_t *)Source1;
+	const uint8_t *pBytes2 = (const uint8_t *)Source2;
+
+	for (size_t i = 0; i < Length; i++) {
+		if (pBytes1[i] != pBytes2[i]) {
+			return i;
+		}
+	}
+
+	return Length;
+}
+
+static size_t CompareMemory_SSE2(const void *Source1, const void *Source2, size_t Length)
+{
+	const uint8_t *pBytes1 = (const uint8_t *)Source1;
+	const uint8_t *pBytes2 = (const uint8_t *)Source2;
+	size_t i = 0;
+
+	for (; i + 16 <= Length; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(pBytes1 + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(pBytes2 + i));
+		uint32_t Mismatch = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) ^ 0xFFFF;
+		if (Mismatch) {
+			return i + FirstSetBit(Mismatch);
+		}
+	}
+
+	return i + CompareMemory_C(pBytes1 + i, pBytes2 + i, Length - i);
+}
+
+static size_t CompareMemory_AVX2(const void *Source1, const void *Source2, size_t Length)
+{
+	const uint8_t *pBytes1 = (const uint8_t *)Source1;
+	const uint8_t *pBytes2 = (const uint8_t *)Source2;
+	size_t i = 0;
+
+	for (; i + 32 <= Length; i += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(pBytes1 + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(pBytes2 + i));
+		uint32_t Mismatch = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+		if (Mismatch) {
+			return i + FirstSetBit(Mismatch);
+		}
+	}
+
+	return i + CompareMemory_SSE2(pBytes1 + i, pBytes2 + i, Length - i);
+}
+
+static size_t CompareMemoryUlong_C(const void *Source, size_t Length, uint32_t Pattern)
+{
+	const uint32_t *ptr = (const uint32_t *)Source;
+	size_t Count = Length / sizeof(uint32_t);
+	size_t i;
+
+	for (i = 0; i < Count; i++) {
+		if (ptr[i] != Pattern) {
+			break;
+		}
+	}
+
+	return i * sizeof(uint32_t);
+}
+
+static size_t CompareMemoryUlong_SSE2(const void *Source, size_t Length, uint32_t Pattern)
+{
+	const uint8_t *pBytes = (const uint8_t *)Source;
+	__m128i p = _mm_set1_epi32((int)Pattern);
+	size_t i = 0;
+
+	for (; i + 16 <= Length; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(pBytes + i));
+		uint32_t Mismatch = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(a, p)) ^ 0xFFFF;
+		if (Mismatch) {
+			// Round down to the start of the mismatching ULONG
+			return i + (FirstSetBit(Mismatch) & ~3);
+		}
+	}
+
+	return i + CompareMemoryUlong_C(pBytes + i, Length - i, Pattern);
+}
+
+static size_t CompareMemoryUlong_AVX2(const void *Source, size_t Length, uint32_t Pattern)
+{
+	const uint8_t *pBytes = (const uint8_t *)Source;
+	__m256i p = _mm256_set1_epi32((int)Pattern);
+	size_t i = 0;
+
+	for (; i + 32 <= Length; i += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(pBytes + i));
+		uint32_t Mismatch = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, p));
+		if (Mismatch) {
+			return i + (FirstSetBit(Mismatch) & ~3);
+		}
+	}
+
+	return i + CompareMemoryUlong_SSE2(pBytes + i, Length - i, Pattern);
+}
+
+static void FillMemoryUlong_C(void *Destination, size_t Length, uint32_t Pattern)
+{
+	uint32_t *d = (uint32_t *)Destination;
+	size_t Count = Length / sizeof(uint32_t);
+
+	for (size_t i = 0; i < Count; i++) {
+		d[i] = Pattern;
+	}
+}
+
+static void FillMemoryUlong_SSE2(void *Destination, size_t Length, uint32_t Pattern)
+{
+	uint8_t *pBytes = (uint8_t *)Destination;
+	__m128i p = _mm_set1_epi32((int)Pattern);
+	size_t i = 0;
+
+	for (; i + 16 <= Length; i += 16) {
+		_mm_storeu_si128((__m128i *)(pBytes + i), p);
+	}
+
+	FillMemoryUlong_C(pBytes + i, Length - i, Pattern);
+}
+
+static void FillMemoryUlong_AVX2(void *Destination, size_t Length, uint32_t Pattern)
+{
+	uint8_t *pBytes = (uint8_t *)Destination;
+	__m256i p = _mm256_set1_epi32((int)Pattern);
+	size_t i = 0;
+
+	for (; i + 32 <= Length; i += 32) {
+		_mm256_storeu_si256((__m256i *)(pBytes + i), p);
+	}
+
+	FillMemoryUlong_SSE2(pBytes + i, Length - i, Pattern);
+}
+
+//
+// ANSI case folding (ISO 8859-1, see RtlUpperChar)
+//
+
+static inline char UpperChar(char Character)
+{
+	uint8_t CharCode = (uint8_t)Character;
+
+	if (CharCode >= 'a' && CharCode <= 'z') {
+		CharCode ^= 0x20;
+	}
+	else if (CharCode >= 0xE0 && CharCode <= 0xFE && CharCode != 0xF7) {
+		CharCode ^= 0x20;
+	}
+	else if (CharCode == 0xFF) {
+		CharCode = '?';
+	}
+
+	return (char)CharCode;
+}
+
+// Sets the lanes of c that are within [First, Last] (as unsigned bytes)
+static inline __m128i InRange_SSE2(__m128i c, uint8_t First, uint8_t Last)
+{
+	__m128i Offset = _mm_sub_epi8(c, _mm_set1_epi8((char)First));
+	return _mm_cmpeq_epi8(_mm_min_epu8(Offset, _mm_set1_epi8((char)(Last - First))), Offset);
+}
+
+static inline __m128i UpperChars_SSE2(__m128i c)
+{
+	__m128i Lower = InRange_SSE2(c, 'a', 'z');
+	__m128i Latin = _mm_andnot_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8((char)0xF7)), InRange_SSE2(c, 0xE0, 0xFE));
+	__m128i Yuml = _mm_cmpeq_epi8(c, _mm_set1_epi8((char)0xFF));
+	__m128i Upper = _mm_xor_si128(c, _mm_and_si128(_mm_or_si128(Lower, Latin), _mm_set1_epi8(0x20)));
+
+	return _mm_or_si128(_mm_andnot_si128(Yuml, Upper), _mm_and_si128(Yuml, _mm_set1_epi8('?')));
+}
+
+static void UpperString_C(char *Destination, const char *Source, size_t Length)
+{
+	for (size_t i = 0; i < Length; i++) {
+		Destination[i] = UpperChar(Source[i]);
+	}
+}
+
+static void UpperString_SSE2(char *Destination, const char *Source, size_t Length)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= Length; i += 16) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(Source + i));
+		_mm_storeu_si128((__m128i *)(Destination + i), UpperChars_SSE2(c));
+	}
+
+	UpperString_C(Destination + i, Source + i, Length - i);
+}
+
+static bool EqualStringCaseInsensitive_C(const char *String1, const char *String2, size_t Length)
+{
+	for (size_t i = 0; i < Length; i++) {
+		char c1 = String1[i];
+		char c2 = String2[i];
+		if (c1 != c2 && UpperChar(c1) != UpperChar(c2)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool EqualStringCaseInsensitive_SSE2(const char *String1, const char *String2, size_t Length)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= Length; i += 16) {
+		__m128i a = UpperChars_SSE2(_mm_loadu_si128((const __m128i *)(String1 + i)));
+		__m128i b = UpperChars_SSE2(_mm_loadu_si128((const __m128i *)(String2 + i)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) {
+			return false;
+		}
+	}
+
+	return EqualStringCaseInsensitive_C(String1 + i, String2 + i, Length - i);
+}
+
+//
+// Unicode case folding and conversions. towupper has mappings all over the Unicode range, so only blocks
+// made of ASCII characters (where it reduces to flipping a-z) are vectorized, the others go through it
+//
+
+static inline bool IsAscii_SSE2(__m128i c)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(c, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128())) == 0xFFFF;
+}
+
+// Only valid for ASCII lanes
+static inline __m128i UpcaseAscii_SSE2(__m128i c)
+{
+	__m128i Lower = _mm_and_si128(_mm_cmpgt_epi16(c, _mm_set1_epi16('a' - 1)), _mm_cmplt_epi16(c, _mm_set1_epi16('z' + 1)));
+	return _mm_xor_si128(c, _mm_and_si128(Lower, _mm_set1_epi16(0x20)));
+}
+
+static void UpcaseUnicode_C(uint16_t *Destination, const uint16_t *Source, size_t Count)
+{
+	for (size_t i = 0; i < Count; i++) {
+		Destination[i] = (uint16_t)towupper(Source[i]);
+	}
+}
+
+static void UpcaseUnicode_SSE2(uint16_t *Destination, const uint16_t *Source, size_t Count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= Count; i += 8) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(Source + i));
+		if (IsAscii_SSE2(c)) {
+			_mm_storeu_si128((__m128i *)(Destination + i), UpcaseAscii_SSE2(c));
+		}
+		else {
+			UpcaseUnicode_C(Destination + i, Source + i, 8);
+		}
+	}
+
+	UpcaseUnicode_C(Destination + i, Source + i, Count - i);
+}
+
+static bool EqualUnicodeCaseInsensitive_C(const uint16_t *String1, const uint16_t *String2, size_t Count)
+{
+	for (size_t i = 0; i < Count; i++) {
+		uint16_t c1 = String1[i];
+		uint16_t c2 = String2[i];
+		if (c1 != c2 && towupper(c1) != towupper(c2)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool EqualUnicodeCaseInsensitive_SSE2(const uint16_t *String1, const uint16_t *String2, size_t Count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= Count; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(String1 + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(String2 + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, b)) == 0xFFFF) {
+			continue;
+		}
+
+		if (IsAscii_SSE2(_mm_or_si128(a, b))) {
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(UpcaseAscii_SSE2(a), UpcaseAscii_SSE2(b))) != 0xFFFF) {
+				return false;
+			}
+		}
+		else if (!EqualUnicodeCaseInsensitive_C(String1 + i, String2 + i, 8)) {
+			return false;
+		}
+	}
+
+	return EqualUnicodeCaseInsensitive_C(String1 + i, String2 + i, Count - i);
+}
+
+static void MultiByteToUnicode_C(uint16_t *Destination, const char *Source, size_t Count)
+{
+	for (size_t i = 0; i < Count; i++) {
+		Destination[i] = (uint16_t)(int16_t)Source[i];
+	}
+}
+
+static void MultiByteToUnicode_SSE2(uint16_t *Destination, const char *Source, size_t Count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= Count; i += 16) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(Source + i));
+		__m128i Sign = _mm_cmpgt_epi8(_mm_setzero_si128(), c);
+		_mm_storeu_si128((__m128i *)(Destination + i), _mm_unpacklo_epi8(c, Sign));
+		_mm_storeu_si128((__m128i *)(Destination + i + 8), _mm_unpackhi_epi8(c, Sign));
+	}
+
+	MultiByteToUnicode_C(Destination + i, Source + i, Count - i);
+}
+
+static void UnicodeToMultiByte_C(char *Destination, const uint16_t *Source, size_t Count)
+{
+	for (size_t i = 0; i < Count; i++) {
+		Destination[i] = (Source[i] < 0xFF) ? (char)Source[i] : '?';
+	}
+}
+
+static inline __m128i NarrowableOrQuestionMark_SSE2(__m128i c)
+{
+	// Lanes of 0xFF and above don't survive the subtraction of 0xFE with unsigned saturation as zero
+	__m128i Fits = _mm_cmpeq_epi16(_mm_subs_epu16(c, _mm_set1_epi16(0xFE)), _mm_setzero_si128());
+	return _mm_or_si128(_mm_and_si128(Fits, c), _mm_andnot_si128(Fits, _mm_set1_epi16('?')));
+}
+
+static void UnicodeToMultiByte_SSE2(char *Destination, const uint16_t *Source, size_t Count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= Count; i += 16) {
+		__m128i lo = NarrowableOrQuestionMark_SSE2(_mm_loadu_si128((const __m128i *)(Source + i)));
+		__m128i hi = NarrowableOrQuestionMark_SSE2(_mm_loadu_si128((const __m128i *)(Source + i + 8)));
+		_mm_storeu_si128((__m128i *)(Destination + i), _mm_packus_epi16(lo, hi));
+	}
+
+	UnicodeToMultiByte_C(Destination + i, Source + i, Count - i);
+}
+
+static void UpcaseUnicodeToMultiByte_C(char *Destination, const uint16_t *Source, size_t Count)
+{
+	for (size_t i = 0; i < Count; i++) {
+		uint16_t c = (Source[i] < 256) ? Source[i] : L'?';
+		c = (uint16_t)towupper(c);
+		Destination[i] = (c < 256) ? (char)c : '?';
+	}
+}
+
+static void UpcaseUnicodeToMultiByte_SSE2(char *Destination, const uint16_t *Source, size_t Count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= Count; i += 16) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(Source + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(Source + i + 8));
+		if (IsAscii_SSE2(_mm_or_si128(lo, hi))) {
+			_mm_storeu_si128((__m128i *)(Destination + i), _mm_packus_epi16(UpcaseAscii_SSE2(lo), UpcaseAscii_SSE2(hi)));
+		}
+		else {
+			UpcaseUnicodeToMultiByte_C(Destination + i, Source + i, 16);
+		}
+	}
+
+	UpcaseUnicodeToMultiByte_C(Destination + i, Source + i, Count - i);
+}
+
+//
+// Dispatch : detect SIMD support to select the real implementation on first call
+//
+
+size_t(*RtlpCompareMemory)(const void *, const void *, size_t) =
+[](const void *Source1, const void *Source2, size_t Length)
+{
+	SimdCaps supports;
+	if (supports.AVX2())
+		RtlpCompareMemory = CompareMemory_AVX2;
+	else if (supports.SSE2())
+		RtlpCompareMemory = CompareMemory_SSE2;
+	else
+		RtlpCompareMemory = CompareMemory_C;
+
+	return RtlpCompareMemory(Source1, Source2, Length);
+};
+
+size_t(*RtlpCompareMemoryUlong)(const void *, size_t, uint32_t) =
+[](const void *Source, size_t Length, uint32_t Pattern)
+{
+	SimdCaps supports;
+	if (supports.AVX2())
+		RtlpCompareMemoryUlong = CompareMemoryUlong_AVX2;
+	else if (supports.SSE2())
+		RtlpCompareMemoryUlong = CompareMemoryUlong_SSE2;
+	else
+		RtlpCompareMemoryUlong = CompareMemoryUlong_C;
+
+	return RtlpCompareMemoryUlong(Source, Length, Pattern);
+};
+
+void(*RtlpFillMemoryUlong)(void *, size_t, uint32_t) =
+[](void *Destination, size_t Length, uint32_t Pattern)
+{
+	SimdCaps supports;
+	if (supports.AVX2())
+		RtlpFillMemoryUlong = FillMemoryUlong_AVX2;
+	else if (supports.SSE2())
+		RtlpFillMemoryUlong = FillMemoryUlong_SSE2;
+	else
+		RtlpFillMemoryUlong = FillMemoryUlong_C;
+
+	RtlpFillMemoryUlong(Destination, Length, Pattern);
+};
+
+// Strings are mostly short, so the string functions stop at SSE2
+
+void(*RtlpUpperString)(char *, const char *, size_t) =
+[](char *Destination, const char *Source, size_t Length)
+{
+	SimdCaps supports;
+	RtlpUpperString = supports.SSE2() ? UpperString_SSE2 : UpperString_C;
+
+	RtlpUpperString(Destination, Source, Length);
+};
+
+bool(*RtlpEqualStringCaseInsensitive)(const char *, const char *, size_t) =
+[](const char *String1, const char *String2, size_t Length)
+{
+	SimdCaps supports;
+	RtlpEqualStringCaseInsensitive = supports.SSE2() ? EqualStringCaseInsensitive_SSE2 : EqualStringCaseInsensitive_C;
+
+	return RtlpEqualStringCaseInsensitive(String1, String2, Length);
+};
+
+void(*RtlpUpcaseUnicode)(uint16_t *, const uint16_t *, size_t) =
+[](uint16_t *Destination, const uint16_t *Source, size_t Count)
+{
+	SimdCaps supports;
+	RtlpUpcaseUnicode = supports.SSE2() ? UpcaseUnicode_SSE2 : UpcaseUnicode_C;
+
+	RtlpUpcaseUnicode(Destination, Source, Count);
+};
+
+bool(*RtlpEqualUnicodeCaseInsensitive)(const uint16_t *, const uint16_t *, size_t) =
+[](const uint16_t *String1, const uint16_t *String2, size_t Count)
+{
+	SimdCaps supports;
+	RtlpEqualUnicodeCaseInsensitive = supports.SSE2() ? EqualUnicodeCaseInsensitive_SSE2 : EqualUnicodeCaseInsensitive_C;
+
+	return RtlpEqualUnicodeCaseInsensitive(String1, String2, Count);
+};
+
+void(*RtlpMultiByteToUnicode)(uint16_t *, const char *, size_t) =
+[](uint16_t *Destination, const char *Source, size_t Count)
+{
+	SimdCaps supports;
+	RtlpMultiByteToUnicode = supports.SSE2() ? MultiByteToUnicode_SSE2 : MultiByteToUnicode_C;
+
+	RtlpMultiByteToUnicode(Destination, Source, Count);
+};
+
+void(*RtlpUnicodeToMultiByte)(char *, const uint16_t *, size_t) =
+[](char *Destination, const uint16_t *Source, size_t Count)
+{
+	SimdCaps supports;
+	RtlpUnicodeToMultiByte = supports.SSE2() ? UnicodeToMultiByte_SSE2 : UnicodeToMultiByte_C;
+
+	RtlpUnicodeToMultiByte(Destination, Source, Count);
+};
+
+void(*RtlpUpcaseUnicodeToMultiByte)(char *, const uint16_t *, size_t) =
+[](char *Destination, const uint16_t *Source, size_t Count)
+{
+	SimdCaps supports;
+	RtlpUpcaseUnicodeToMultiByte = supports.SSE2() ? UpcaseUnicodeToMultiByte_SSE2 : UpcaseUnicodeToMultiByte_C;
+
+	RtlpUpcaseUnicodeToMultiByte(Destination, Source, Count);
+};
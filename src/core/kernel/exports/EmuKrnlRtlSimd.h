@@ -0,0 +1,63 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef EMUKRNLRTLSIMD_H
+#define EMUKRNLRTLSIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Vectorized helpers behind the Rtl memory and string exports. Each one is a pointer that selects the
+// best implementation (AVX2, SSE2 or plain C) on its first call; all of them give exactly the same
+// results as the plain C loops the exports used to run.
+
+// Returns the number of leading bytes that are equal in both buffers (so Length when they match)
+extern size_t(*RtlpCompareMemory)(const void *Source1, const void *Source2, size_t Length);
+
+// Returns the size in bytes of the leading run of ULONGs equal to Pattern (Length is rounded down to ULONGs)
+extern size_t(*RtlpCompareMemoryUlong)(const void *Source, size_t Length, uint32_t Pattern);
+
+// Fills Length bytes (rounded down to ULONGs) with Pattern
+extern void(*RtlpFillMemoryUlong)(void *Destination, size_t Length, uint32_t Pattern);
+
+// Upcases Length characters following the ISO 8859-1 rules of RtlUpperChar
+extern void(*RtlpUpperString)(char *Destination, const char *Source, size_t Length);
+
+// Returns true when the strings are equal after upcasing them following the rules of RtlUpperChar
+extern bool(*RtlpEqualStringCaseInsensitive)(const char *String1, const char *String2, size_t Length);
+
+// Upcases Count characters with towupper
+extern void(*RtlpUpcaseUnicode)(uint16_t *Destination, const uint16_t *Source, size_t Count);
+
+// Returns true when the strings are equal after upcasing them with towupper
+extern bool(*RtlpEqualUnicodeCaseInsensitive)(const uint16_t *String1, const uint16_t *String2, size_t Count);
+
+// Widens Count characters (sign extending them, like the (WCHAR)CHAR cast RtlMultiByteToUnicodeN always did)
+extern void(*RtlpMultiByteToUnicode)(uint16_t *Destination, const char *Source, size_t Count);
+
+// Narrows Count characters, replacing the ones that don't fit (0xFF and above) by '?'
+extern void(*RtlpUnicodeToMultiByte)(char *Destination, const uint16_t *Source, size_t Count);
+
+// Narrows Count characters after upcasing them, replacing the ones that don't fit by '?'
+extern void(*RtlpUpcaseUnicodeToMultiByte)(char *Destination, const uint16_t *Source, size_t Count);
+
+#endif
@@ -43,6 +43,7 @@ namespace xboxkrnl
 #include "devices\x86\EmuX86.h"
 #include "core\kernel\support\EmuFile.h"
 #include "core\kernel\support\EmuFS.h"
+#include "core\kernel\support\EmuXiso.h" // For CxbxMountXiso
 #include "EmuEEPROM.h" // For CxbxRestoreEEPROM, EEPROM, XboxFactoryGameRegion
 #include "core\kernel\exports\EmuKrnl.h"
 #include "core\kernel\exports\EmuKrnlKi.h"
@@ -63,7 +64,8 @@ namespace xboxkrnl
 #include "devices\LED.h" // For LED::Sequence
 #include "devices\SMCDevice.h" // For SMC Access
 #include "common\crypto\EmuSha.h" // For the SHA1 functions
-#include "Timer.h" // For Timer_Init
+#include "Timer.h" // For Timer_Init, Timer_Shutdown
+#include "common\util\hasher.h" // For InitHasher
 #include "..\Common\Input\InputConfig.h" // For the InputDeviceManager
 
 /*! thread local storage */
@@ -105,6 +107,11 @@ DWORD_PTR g_CPUOthers = 0;
 // Indicates to disable/enable all interrupts when cli and sti instructions are executed
 std::atomic_bool g_bEnableAllInterrupts = true;
 
+// One bit per bus interrupt level, set when the interrupt is asserted and cleared by the interrupt thread
+static std::atomic<uint32_t> g_PendingInterruptMask = 0;
+// Auto-reset event used to wake up the interrupt thread when a bit is set in g_PendingInterruptMask
+static HANDLE g_hPendingInterruptEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
 // Set by the VMManager during initialization. Exported because it's needed in other parts of the emu
 size_t g_SystemMaxMemory = 0;
 
@@ -593,6 +600,7 @@ void PrintCurrentConfigurationLog()
 		printf("PCM is %s\n", XBAudioConf.codec_pcm ? "enabled" : "disabled");
 		printf("XADPCM is %s\n", XBAudioConf.codec_xadpcm ? "enabled" : "disabled");
 		printf("Unknown Codec is %s\n", XBAudioConf.codec_unknown ? "enabled" : "disabled");
+		printf("Software Mixer is %s\n", XBAudioConf.software_mixer ? "enabled" : "disabled");
 	}
 
 	// Print current network configuration
@@ -602,6 +610,7 @@ void PrintCurrentConfigurationLog()
 
 		printf("--------------------------- NETWORK CONFIG -------------------------\n");
 		printf("Network Adapter Name: %s\n", strlen(XBNetworkConf.adapter_name) == 0 ? "Not Configured" : XBNetworkConf.adapter_name);
+		printf("Loopback is %s\n", XBNetworkConf.loopback ? "enabled" : "disabled");
 	}
 
 	// Print Enabled Hacks
@@ -653,14 +662,35 @@ void InitSoftwareInterrupts()
 }
 #endif
 
-void TriggerPendingConnectedInterrupts()
+void SignalPendingInterrupt(HalSystemInterrupt* Interrupt)
 {
-	for (int i = 0; i < MAX_BUS_INTERRUPT_LEVEL; i++) {
+	unsigned int BusInterruptLevel = (unsigned int)(Interrupt - HalSystemInterrupts);
+
+	g_PendingInterruptMask.fetch_or(1 << BusInterruptLevel);
+	SetEvent(g_hPendingInterruptEvent);
+}
+
+// Services the interrupts in Mask, lowest bus interrupt level first, and returns those which are still pending afterwards
+uint32_t TriggerPendingConnectedInterrupts(uint32_t Mask)
+{
+	uint32_t StillPending = 0;
+	unsigned long i;
+
+	while (_BitScanForward(&i, Mask)) {
+		Mask &= ~(1 << i);
+
 		// If the interrupt is pending and connected, process it
 		if (HalSystemInterrupts[i].IsPending() && EmuInterruptList[i] && EmuInterruptList[i]->Connected) {
 			HalSystemInterrupts[i].Trigger(EmuInterruptList[i]);
 		}
+
+		// Latched interrupts stay pending until deasserted, and unconnected ones until somebody connects them
+		if (HalSystemInterrupts[i].IsPending()) {
+			StillPending |= (1 << i);
+		}
 	}
+
+	return StillPending;
 }
 
 static unsigned int WINAPI CxbxKrnlInterruptThread(PVOID param)
@@ -674,11 +704,21 @@ static unsigned int WINAPI CxbxKrnlInterruptThread(PVOID param)
 	InitSoftwareInterrupts();
 #endif
 
+	uint32_t Retry = 0;
+
 	while (true) {
+		// Sleep until a device asserts an interrupt. If some interrupts couldn't be serviced last time (interrupts disabled,
+		// latched or not connected yet), poll them again every millisecond like we used to
+		WaitForSingleObject(g_hPendingInterruptEvent, Retry ? 1 : INFINITE);
+
+		uint32_t Pending = g_PendingInterruptMask.exchange(0) | Retry;
+
 		if (g_bEnableAllInterrupts) {
-			TriggerPendingConnectedInterrupts();
+			Retry = TriggerPendingConnectedInterrupts(Pending);
+		}
+		else {
+			Retry = Pending;
 		}
-		Sleep(1);
 	}
 
 	return 0;
@@ -1020,6 +1060,12 @@ void CxbxKrnlMain(int argc, char* argv[])
 	g_EmuShared->GetIsKrnlLogEnabled(&isLogEnabled);
 	g_bPrintfOn = isLogEnabled;
 
+	bool isLogAsync;
+	g_EmuShared->GetIsLogAsync(&isLogAsync);
+	if (isLogEnabled && isLogAsync) {
+		log_async_start();
+	}
+
 	g_EmuShared->ResetKrnl();
 
 	// Save current kernel proccess id for next reboot if will occur in the future.
@@ -1151,6 +1197,23 @@ void CxbxKrnlMain(int argc, char* argv[])
 			}
 		}
 
+		// An XISO image is mounted as the game disc; its default.xbe is extracted so that it can be
+		// loaded like any other, while all other disc accesses are served from the image itself
+		if (xbePath.length() > 4 && _stricmp(xbePath.c_str() + xbePath.length() - 4, ".iso") == 0) {
+			if (!CxbxMountXiso(xbePath)) {
+				CxbxKrnlCleanup("Could not mount XISO image %s", xbePath.c_str());
+				return;
+			}
+
+			std::string xisoBootFolder = std::string(szFolder_CxbxReloadedData) + "\\XisoBoot";
+			CreateDirectory(xisoBootFolder.c_str(), NULL);
+			xbePath = xisoBootFolder + "\\default.xbe";
+			if (!CxbxXisoExtractFile("default.xbe", xbePath)) {
+				CxbxKrnlCleanup("Could not find default.xbe in the XISO image");
+				return;
+			}
+		}
+
 		// Once clean up process is done, proceed set to global variable string.
 		strncpy(szFilePath_Xbe, xbePath.c_str(), MAX_PATH - 1);
 		std::replace(xbePath.begin(), xbePath.end(), ';', '/');
@@ -1340,6 +1403,8 @@ __declspec(noreturn) void CxbxKrnlInit
 
 	// Initialize timer subsystem
 	Timer_Init();
+	// Select the fastest content hash implementation for this cpu
+	InitHasher();
 	// for unicode conversions
 	setlocale(LC_ALL, "English");
 	// Initialize time-related variables for the kernel and the timers
@@ -1472,6 +1537,7 @@ __declspec(noreturn) void CxbxKrnlInit
 		// Arrange that the Xbe path can reside outside the partitions, and put it to g_hCurDir :
 		EmuNtSymbolicLinkObject* xbePathSymbolicLinkObject = FindNtSymbolicLinkObjectByDriveLetter(CxbxDefaultXbeDriveLetter);
 		g_hCurDir = xbePathSymbolicLinkObject->RootDirectoryHandle;
+		CxbxInvalidateFilePathCache(); // Relative paths resolve against g_hCurDir
 	}
 
 	// Determine Xbox path to XBE and place it in XeImageFileName
@@ -1631,7 +1697,8 @@ __declspec(noreturn) void CxbxKrnlInit
 	DWORD dwThreadId;
 	HANDLE hThread = (HANDLE)_beginthreadex(NULL, NULL, CxbxKrnlInterruptThread, NULL, NULL, (unsigned int*)&dwThreadId);
 	// Start the kernel clock thread
-	TimerObject* KernelClockThr = Timer_Create(CxbxKrnlClockThread, nullptr, "Kernel clock thread", &g_CPUOthers);
+	// The clock interrupt is due every 1 ms, so don't let it wait behind the other timers
+	TimerObject* KernelClockThr = Timer_Create(CxbxKrnlClockThread, nullptr, "Kernel clock thread", &g_CPUOthers, true);
 	Timer_Start(KernelClockThr, SCALE_MS_IN_NS);
 
 	DBG_PRINTF_EX(LOG_PREFIX_INIT, "Calling XBE entry point...\n");
@@ -1701,6 +1768,7 @@ __declspec(noreturn) void CxbxKrnlCleanupEx(CXBXR_MODULE cxbxr_module, const cha
 		CxbxPopupMessageEx(cxbxr_module, LOG_LEVEL::FATAL, CxbxMsgDlgIcon_Error, "Received Fatal Message:\n\n* %s\n", szBuffer2); // Will also DBG_PRINTF
     }
 
+    log_async_flush();
     printf("[0x%.4X] MAIN: Terminating Process\n", GetCurrentThreadId());
     fflush(stdout);
 
@@ -1805,6 +1873,17 @@ void CxbxKrnlResume()
 
 void CxbxKrnlShutDown()
 {
+	// Write out whatever the asynchronous logger still has pending, before the process goes away
+	log_async_flush();
+
+	Timer_Shutdown();
+
+	if (g_NVNet != nullptr) {
+		g_NVNet->Shutdown();
+	}
+
+	XTL::CxbxShutdownAudio();
+
 	// Clear all kernel boot flags. These (together with the shared memory) persist until Cxbx-Reloaded is closed otherwise.
 	int BootFlags = 0;
 	g_EmuShared->SetBootFlags(&BootFlags);
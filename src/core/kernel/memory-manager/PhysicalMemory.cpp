@@ -33,14 +33,16 @@
 #include "core\kernel\exports\EmuKrnl.h" // For InitializeListHead(), etc.
 #include <assert.h>
 
-// See the links below for the details about the kernel structure LIST_ENTRY and the related functions
-// https://www.codeproject.com/Articles/800404/Understanding-LIST-ENTRY-Lists-and-Its-Importance
-// https://docs.microsoft.com/en-us/windows-hardware/drivers/kernel/singly-and-doubly-linked-lists
-#define LIST_ENTRY_INITIALIZE(ListEntry) ((ListEntry)->Flink = (ListEntry)->Blink = nullptr)
-
-inline FreeBlock* ListEntryToFreeBlock(xboxkrnl::PLIST_ENTRY pListEntry)
+// Returns the size class of a free block of pages, that is floor(log2(size))
+inline unsigned int GetFreeBlockClass(PFN_COUNT size)
 {
-	return CONTAINING_RECORD(pListEntry, FreeBlock, ListEntry);
+	unsigned long Class;
+
+	assert(size != 0);
+	_BitScanReverse(&Class, size);
+	assert(Class < FREE_BLOCK_CLASSES);
+
+	return Class;
 }
 
 void PhysicalMemory::InitializePageDirectory()
@@ -171,12 +173,14 @@ void PhysicalMemory::WritePte(PMMPTE pPteStart, PMMPTE pPteEnd, MMPTE Pte, PFN p
 
 bool PhysicalMemory::RemoveFree(PFN_COUNT NumberOfPages, PFN* result, PFN_COUNT PfnAlignment, PFN start, PFN end)
 {
-	xboxkrnl::PLIST_ENTRY ListEntry;
+	std::map<PFN, PFN_COUNT>::iterator it;
 	PFN PfnStart;
 	PFN PfnEnd;
 	PFN IntersectionStart;
 	PFN IntersectionEnd;
-	PFN_COUNT PfnCount;
+	PFN BlockStart = 0;
+	PFN BlockEnd = 0;
+	bool bFound = false;
 	PFN_COUNT PfnAlignmentMask;
 	PFN_COUNT PfnAlignmentSubtraction;
 
@@ -191,193 +195,149 @@ bool PhysicalMemory::RemoveFree(PFN_COUNT NumberOfPages, PFN* result, PFN_COUNT
 		PfnAlignmentSubtraction = ((NumberOfPages + PfnAlignment - 1) & PfnAlignmentMask) - NumberOfPages + 1;
 	}
 
-	ListEntry = FreeList.Blink; // search from the top
+	// The blocks in the classes below the one of NumberOfPages are too small and are never looked at. Every other class is
+	// searched from the top, and the highest usable block among all of them is taken, which is the same block that a top
+	// down search of all the free blocks would find
 
-	while (ListEntry != &FreeList)
+	for (unsigned int Class = GetFreeBlockClass(NumberOfPages); Class < FREE_BLOCK_CLASSES; ++Class)
 	{
-		if (ListEntryToFreeBlock(ListEntry)->size >= NumberOfPages) // search for a block with enough pages
+		it = m_FreeBlockClasses[Class].upper_bound(end); // first block starting above the requested range
+
+		while (it != m_FreeBlockClasses[Class].begin())
 		{
-			PfnStart = ListEntryToFreeBlock(ListEntry)->start;
-			PfnCount = ListEntryToFreeBlock(ListEntry)->size;
-			PfnEnd = PfnStart + PfnCount - 1;
-			IntersectionStart = start >= PfnStart ? start : PfnStart;
-			IntersectionEnd = end <= PfnEnd ? end : PfnEnd;
+			--it;
 
-			if (IntersectionEnd < IntersectionStart)
+			PfnStart = it->first;
+			PfnEnd = PfnStart + it->second - 1;
+
+			if ((bFound && PfnStart < BlockStart) || PfnEnd < start)
 			{
-				// Not inside the requested range, keep searching
+				// This block and all the lower ones are either below the requested range or below the one we already
+				// found, so stop searching this class
 
-				goto InvalidBlock;
+				break;
 			}
 
+			IntersectionStart = start >= PfnStart ? start : PfnStart;
+			IntersectionEnd = end <= PfnEnd ? end : PfnEnd;
+
 			if (IntersectionEnd - IntersectionStart + 1 < NumberOfPages)
 			{
 				// There is not enough free space inside the free block so this is an invalid block.
 				// We have to check again since the free size could have shrinked because of the intersection
 				// check done above
 
-				goto InvalidBlock;
+				continue;
 			}
 
 			if (PfnAlignment)
 			{
-				IntersectionEnd = ((IntersectionEnd + 1) & PfnAlignmentMask) - PfnAlignmentSubtraction;
+				IntersectionEnd = (IntersectionEnd + 1) & PfnAlignmentMask;
 
-				if (IntersectionEnd < IntersectionStart || IntersectionEnd - IntersectionStart + 1 < NumberOfPages)
+				// NOTE: this is checked before the subtraction below, which could otherwise underflow for blocks
+				// near pfn zero and make an unusable block look valid
+				if (IntersectionEnd < IntersectionStart + NumberOfPages - 1 + PfnAlignmentSubtraction)
 				{
 					// This free block doesn't honor the alignment requested, so this is another invalid block
 
-					goto InvalidBlock;
+					continue;
 				}
-			}
-
-			// Now we know that we have a usable free block with enough pages
 
-			if (IntersectionStart == PfnStart)
-			{
-				if (IntersectionEnd == PfnEnd)
-				{
-					// The block is totally inside the range, just shrink its size
+				IntersectionEnd -= PfnAlignmentSubtraction;
+			}
 
-					PfnCount -= NumberOfPages;
-					if (!PfnCount)
-					{
-						// delete the entry if there is no free space left
+			BlockStart = PfnStart;
+			BlockEnd = IntersectionEnd;
+			bFound = true;
+			break;
+		}
+	}
 
-						RemoveEntryList(ListEntry);
-						delete ListEntryToFreeBlock(ListEntry);
-					}
-					else { ListEntryToFreeBlock(ListEntry)->size = PfnCount; }
-				}
-				else
-				{
-					// Create a new block with the remaining pages after the block
-
-					PFreeBlock block = new FreeBlock;
-					block->start = IntersectionEnd + 1;
-					block->size = PfnStart + PfnCount - IntersectionEnd - 1;
-					LIST_ENTRY_INITIALIZE(&block->ListEntry);
-					InsertHeadList(ListEntry, &block->ListEntry);
-
-					PfnCount = IntersectionEnd - PfnStart - NumberOfPages + 1;
-					if (!PfnCount)
-					{
-						// delete the entry if there is no free space left
-
-						RemoveEntryList(ListEntry);
-						delete ListEntryToFreeBlock(ListEntry);
-					}
-					else { ListEntryToFreeBlock(ListEntry)->size = PfnCount; }
-				}
-			}
-			else
-			{
-				// Starting address of the free block is lower than the intersection start
+	if (!bFound)
+	{
+		result = nullptr;
+		return false;
+	}
 
-				if (IntersectionEnd == PfnEnd)
-				{
-					// The free block extends before IntersectionStart
+	// Now we know that we have a usable free block with enough pages. The allocation is taken from the top of the usable
+	// part of the block and what's left below and above it (if anything) becomes a new free block
 
-					PfnCount -= NumberOfPages;
-					ListEntryToFreeBlock(ListEntry)->size = PfnCount;
-				}
-				else
-				{
-					// The free block extends in both directions
+	it = m_FreeBlocks.find(BlockStart);
+	PfnEnd = BlockStart + it->second - 1;
+	*result = BlockEnd - NumberOfPages + 1;
 
-					PFreeBlock block = new FreeBlock;
-					block->start = IntersectionEnd + 1;
-					block->size = PfnStart + PfnCount - IntersectionEnd - 1;
-					LIST_ENTRY_INITIALIZE(&block->ListEntry);
-					InsertHeadList(ListEntry, &block->ListEntry);
+	UnindexFreeBlock(it);
+	if (*result != BlockStart) { IndexFreeBlock(BlockStart, *result - BlockStart); }
+	if (BlockEnd != PfnEnd) { IndexFreeBlock(BlockEnd + 1, PfnEnd - BlockEnd); }
 
-					PfnCount = IntersectionEnd - PfnStart - NumberOfPages + 1;
-					ListEntryToFreeBlock(ListEntry)->size = PfnCount;
-				}
-			}
-			if (m_MmLayoutDebug && (PfnStart + PfnCount >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
-				m_DebuggerPagesAvailable -= NumberOfPages;
-				assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
-			}
-			else {
-				m_PhysicalPagesAvailable -= NumberOfPages;
-				assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
-			}
-			*result = PfnStart + PfnCount;
-			return true;
-		}
-		InvalidBlock:
-		ListEntry = ListEntry->Blink;
+	if (m_MmLayoutDebug && (*result >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
+		m_DebuggerPagesAvailable -= NumberOfPages;
+		assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
 	}
-	result = nullptr;
-	return false;
+	else {
+		m_PhysicalPagesAvailable -= NumberOfPages;
+		assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
+	}
+
+	return true;
 }
 
 void PhysicalMemory::InsertFree(PFN start, PFN end)
 {
-	xboxkrnl::PLIST_ENTRY ListEntry;
+	PFN BlockStart = start;
 	PFN_COUNT size = end - start + 1;
+	PFN_COUNT BlockSize = size;
 
-	ListEntry = FreeList.Blink; // search from the top
-
-	while (true)
-	{
-		if (ListEntryToFreeBlock(ListEntry)->start < start || ListEntry == &FreeList)
-		{
-			PFreeBlock block = new FreeBlock;
-			block->start = start;
-			block->size = size;
-			LIST_ENTRY_INITIALIZE(&block->ListEntry);
-			InsertHeadList(ListEntry, &block->ListEntry);
-
-			// Ensure that we are not freeing a part of the previous block
-			if (ListEntry != &FreeList) {
-				assert(ListEntryToFreeBlock(ListEntry)->start +
-					ListEntryToFreeBlock(ListEntry)->size - 1 < start);
-			}
+	std::map<PFN, PFN_COUNT>::iterator next = m_FreeBlocks.upper_bound(start);
+	std::map<PFN, PFN_COUNT>::iterator prev = (next != m_FreeBlocks.begin()) ? std::prev(next) : m_FreeBlocks.end();
 
-			ListEntry = ListEntry->Flink; // move to the new created block
+	// Ensure that we are not freeing a part of the previous block
+	if (prev != m_FreeBlocks.end()) {
+		assert(prev->first + prev->second - 1 < start);
+	}
 
-			// Ensure that we are not freeing a part of the next block
-			if (ListEntry->Flink != &FreeList) {
-				assert(ListEntryToFreeBlock(ListEntry->Flink)->start > end);
-			}
+	// Ensure that we are not freeing a part of the next block
+	if (next != m_FreeBlocks.end()) {
+		assert(next->first > end);
+	}
 
-			// Check if merging is possible
-			if (ListEntry->Flink != &FreeList &&
-				start + size == ListEntryToFreeBlock(ListEntry->Flink)->start)
-			{
-				// Merge forward
-				xboxkrnl::PLIST_ENTRY temp = ListEntry->Flink;
-				ListEntryToFreeBlock(ListEntry)->size +=
-					ListEntryToFreeBlock(temp)->size;
-				RemoveEntryList(temp);
-				delete ListEntryToFreeBlock(temp);
-			}
-			if (ListEntry->Blink != &FreeList &&
-				ListEntryToFreeBlock(ListEntry->Blink)->start +
-				ListEntryToFreeBlock(ListEntry->Blink)->size == start)
-			{
-				// Merge backward
-				ListEntryToFreeBlock(ListEntry->Blink)->size +=
-					ListEntryToFreeBlock(ListEntry)->size;
-				RemoveEntryList(ListEntry);
-				delete block;
-			}
+	// Check if merging is possible
+	if (next != m_FreeBlocks.end() && start + size == next->first)
+	{
+		// Merge forward
+		BlockSize += next->second;
+		UnindexFreeBlock(next);
+	}
+	if (prev != m_FreeBlocks.end() && prev->first + prev->second == start)
+	{
+		// Merge backward
+		BlockStart = prev->first;
+		BlockSize += prev->second;
+		UnindexFreeBlock(prev);
+	}
 
-			if (m_MmLayoutDebug && (start >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
-				m_DebuggerPagesAvailable += size;
-				assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
-			}
-			else {
-				m_PhysicalPagesAvailable += size;
-				assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
-			}
+	IndexFreeBlock(BlockStart, BlockSize);
 
-			return;
-		}
-		ListEntry = ListEntry->Blink;
+	if (m_MmLayoutDebug && (start >= DEBUGKIT_FIRST_UPPER_HALF_PAGE)) {
+		m_DebuggerPagesAvailable += size;
+		assert(m_DebuggerPagesAvailable <= DEBUGKIT_FIRST_UPPER_HALF_PAGE);
 	}
+	else {
+		m_PhysicalPagesAvailable += size;
+		assert(m_PhysicalPagesAvailable <= m_HighestPage + 1);
+	}
+}
+
+void PhysicalMemory::IndexFreeBlock(PFN start, PFN_COUNT size)
+{
+	m_FreeBlocks.emplace(start, size);
+	m_FreeBlockClasses[GetFreeBlockClass(size)].emplace(start, size);
+}
+
+void PhysicalMemory::UnindexFreeBlock(std::map<PFN, PFN_COUNT>::iterator it)
+{
+	m_FreeBlockClasses[GetFreeBlockClass(it->second)].erase(it->first);
+	m_FreeBlocks.erase(it);
 }
 
 bool PhysicalMemory::ConvertXboxToSystemPteProtection(DWORD perms, PMMPTE pPte)
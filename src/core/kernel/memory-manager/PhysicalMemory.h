@@ -49,13 +49,9 @@ typedef unsigned int PFN;
 typedef unsigned int PFN_COUNT;
 
 
-/* An entry of the list tracking the free pages on the system */
-typedef struct _FreeBlock
-{
-	PFN start;                        // starting page of the block
-	PFN_COUNT size;                   // number of pages in the block (edges included)
-	xboxkrnl::LIST_ENTRY ListEntry;
-}FreeBlock, *PFreeBlock;
+/* Number of size classes of the free page index. A free block of n pages belongs to class floor(log2(n)), and the largest
+   possible block (128 MiB of Chihiro/devkit memory) is in class 15 */
+#define FREE_BLOCK_CLASSES 16
 
 
 // NOTE: all the bit fields below can have endianess issues...
@@ -213,8 +209,10 @@ typedef enum _MmLayout
 class PhysicalMemory
 {
 	protected:
-		// doubly linked list tracking the free physical pages
-		xboxkrnl::LIST_ENTRY FreeList = { &FreeList , &FreeList };
+		// free blocks of physical pages, ordered by starting pfn (start -> number of pages)
+		std::map<PFN, PFN_COUNT> m_FreeBlocks;
+		// the same free blocks segregated by size class, so that searches can skip the ones which are too small
+		std::map<PFN, PFN_COUNT> m_FreeBlockClasses[FREE_BLOCK_CLASSES];
 		// highest pfn available for contiguous allocations
 		PAddr m_MaxContiguousPfn = XBOX_CONTIGUOUS_MEMORY_LIMIT;
 		// amount of free physical pages available for non-debugger usage
@@ -253,6 +251,10 @@ class PhysicalMemory
 		bool RemoveFree(PFN_COUNT NumberOfPages, PFN* result, PFN_COUNT PfnAlignment, PFN start, PFN end);
 		// release a contiguous number of pages
 		void InsertFree(PFN start, PFN end);
+		// adds a block to the free page index, without touching the counts of available pages
+		void IndexFreeBlock(PFN start, PFN_COUNT size);
+		// removes a block from the free page index, without touching the counts of available pages
+		void UnindexFreeBlock(std::map<PFN, PFN_COUNT>::iterator it);
 		// convert from Xbox to the desired system pte protection (if possible) and return it
 		bool ConvertXboxToSystemPteProtection(DWORD perms, PMMPTE pPte);
 		// convert from Xbox to non-system pte protection (if possible) and return it
@@ -57,11 +57,17 @@ void PoolManager::InitializePool()
 	for (Index = 0; Index < POOL_SMALL_LISTS; Index++) {
 		Lookaside = &m_ExpSmallNPagedPoolLookasideLists[Index];
 		Lookaside->ListHead.Alignment = 0;
-		Lookaside->Depth = 2;
+		Lookaside->Depth = POOL_LOOKASIDE_MINIMUM_DEPTH;
 		Lookaside->TotalAllocates = 0;
 		Lookaside->AllocateHits = 0;
+		Lookaside->LastTotalAllocates = 0;
+		Lookaside->LastAllocateHits = 0;
 	}
 
+	// Like the balance set manager of the real kernel, resize the lookaside lists periodically
+	m_LookasideTimer = Timer_Create(AdjustLookasideDepthWrapper, this, "Pool lookaside scan", nullptr);
+	Timer_Start(m_LookasideTimer, POOL_LOOKASIDE_SCAN_PERIOD);
+
 	printf("Pool manager initialized!\n");
 }
 
@@ -115,14 +121,14 @@ VAddr PoolManager::AllocatePool(size_t Size, uint32_t Tag)
 
 	if (NeededSize <= POOL_SMALL_LISTS) {
 
-		// Small size requested, try to use a lookaside list to satisfy the allocation. ergo720: however, on Windows NT lookaside lists
-		// are first created with ExXxxLookasideListEx and ExXxxLookasideList, which are not exported by the Xbox kernel and are likely
-		// not present. If so, then lookaside lists are never created and the following is likely dead code...
+		// Small size requested, try to use a lookaside list to satisfy the allocation. These are filled by DeallocatePool up to their
+		// current depth, which AdjustLookasideDepth grows or shrinks according to the hit rate. The SLIST functions are lock free, so
+		// this doesn't need to take the pool lock (the counters are only statistics, so, like on NT, they are not updated atomically)
 
 		LookasideList = &m_ExpSmallNPagedPoolLookasideLists[NeededSize - 1];
 		LookasideList->TotalAllocates += 1;
 
-		Entry = reinterpret_cast<PPOOL_HEADER>(xboxkrnl::KRNL(InterlockedPopEntrySList(&LookasideList->ListHead)));
+		Entry = reinterpret_cast<PPOOL_HEADER>(InterlockedPopEntrySList(reinterpret_cast<::PSLIST_HEADER>(&LookasideList->ListHead)));
 
 		if (Entry != nullptr) {
 			Entry -= 1;
@@ -273,7 +279,7 @@ void PoolManager::DeallocatePool(VAddr addr)
 
 		if (QUERY_DEPTH_SLIST(&LookasideList->ListHead) < LookasideList->Depth) {
 			Entry += 1;
-			xboxkrnl::KRNL(InterlockedPushEntrySList)(&LookasideList->ListHead, reinterpret_cast<xboxkrnl::PSINGLE_LIST_ENTRY>(Entry));
+			InterlockedPushEntrySList(reinterpret_cast<::PSLIST_HEADER>(&LookasideList->ListHead), reinterpret_cast<::PSLIST_ENTRY>(Entry));
 
 			return;
 		}
@@ -348,6 +354,49 @@ size_t PoolManager::QueryPoolSize(VAddr addr)
 	RETURN(size);
 }
 
+void PoolManager::AdjustLookasideDepthWrapper(void* pVoid)
+{
+	static_cast<PoolManager*>(pVoid)->AdjustLookasideDepth();
+}
+
+void PoolManager::AdjustLookasideDepth()
+{
+	// Same policy as ExAdjustLookasideDepth of the NT kernel: lists that are barely used shrink quickly, lists that almost never
+	// miss shrink slowly, and the others grow in proportion of their miss rate
+
+	for (ULONG Index = 0; Index < POOL_SMALL_LISTS; Index++) {
+		PPOOL_LOOKASIDE_LIST Lookaside = &m_ExpSmallNPagedPoolLookasideLists[Index];
+		ULONG TotalAllocates = Lookaside->TotalAllocates;
+		ULONG AllocateHits = Lookaside->AllocateHits;
+		ULONG Allocates = TotalAllocates - Lookaside->LastTotalAllocates;
+		ULONG Hits = AllocateHits - Lookaside->LastAllocateHits;
+		ULONG Misses = (Allocates > Hits) ? Allocates - Hits : 0;
+		ULONG Depth = Lookaside->Depth;
+
+		Lookaside->LastTotalAllocates = TotalAllocates;
+		Lookaside->LastAllocateHits = AllocateHits;
+
+		if (Allocates < 75) {
+			Depth = (Depth > POOL_LOOKASIDE_MINIMUM_DEPTH + 10) ? Depth - 10 : POOL_LOOKASIDE_MINIMUM_DEPTH;
+		}
+		else {
+			// Misses per thousand allocations
+			ULONG MissRatio = static_cast<ULONG>((static_cast<ULONGLONG>(Misses) * 1000) / Allocates);
+			if (MissRatio < 5) {
+				Depth = (Depth > POOL_LOOKASIDE_MINIMUM_DEPTH) ? Depth - 1 : POOL_LOOKASIDE_MINIMUM_DEPTH;
+			}
+			else {
+				Depth += ((MissRatio * (POOL_LOOKASIDE_MAXIMUM_DEPTH - Depth)) / (2 * 1000)) + 5;
+				if (Depth > POOL_LOOKASIDE_MAXIMUM_DEPTH) {
+					Depth = POOL_LOOKASIDE_MAXIMUM_DEPTH;
+				}
+			}
+		}
+
+		Lookaside->Depth = static_cast<USHORT>(Depth);
+	}
+}
+
 void PoolManager::Lock()
 {
 	EnterCriticalSection(&m_CriticalSection);
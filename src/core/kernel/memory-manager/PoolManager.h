@@ -30,11 +30,15 @@
 
 
 #include "core\kernel\memory-manager\VMManager.h"
+#include "common\Timer.h"
 
 #define POOL_BLOCK_SHIFT 5
 #define POOL_LIST_HEADS (PAGE_SIZE / (1 << POOL_BLOCK_SHIFT)) // 0x80
 #define POOL_SMALL_LISTS 8
 #define POOL_TYPE_MASK 3
+#define POOL_LOOKASIDE_MINIMUM_DEPTH 4
+#define POOL_LOOKASIDE_MAXIMUM_DEPTH 256
+#define POOL_LOOKASIDE_SCAN_PERIOD SCALE_S_IN_NS // the lookaside lists are resized once per second
 
 
 typedef struct _POOL_DESCRIPTOR {
@@ -52,6 +56,8 @@ typedef struct _POOL_LOOKASIDE_LIST {
 	USHORT Padding;
 	ULONG TotalAllocates;
 	ULONG AllocateHits;
+	ULONG LastTotalAllocates;
+	ULONG LastAllocateHits;
 } POOL_LOOKASIDE_LIST, *PPOOL_LOOKASIDE_LIST;
 
 
@@ -107,12 +113,18 @@ class PoolManager
 		POOL_LOOKASIDE_LIST m_ExpSmallNPagedPoolLookasideLists[POOL_SMALL_LISTS];
 		// critical section lock to synchronize accesses
 		CRITICAL_SECTION m_CriticalSection;
+		// periodically adjusts the depth of the lookaside lists
+		TimerObject* m_LookasideTimer;
 	
 	
 		// acquires the critical section
 		void Lock();
 		// releases the critical section
 		void Unlock();
+		// lookaside timer callback wrapper
+		static void AdjustLookasideDepthWrapper(void* pVoid);
+		// resizes the lookaside lists according to their recent hit rate
+		void AdjustLookasideDepth();
 };
 
 
@@ -68,12 +68,6 @@ void VMManager::Initialize(HANDLE memory_view, HANDLE pagetables_view, int BootF
 	m_hContiguousFile = memory_view;
 	m_hPTFile = pagetables_view;
 
-	// Set up the structs tracking the memory regions
-	ConstructMemoryRegion(LOWEST_USER_ADDRESS, USER_MEMORY_SIZE, UserRegion);
-	ConstructMemoryRegion(CONTIGUOUS_MEMORY_BASE, CONTIGUOUS_MEMORY_XBOX_SIZE, ContiguousRegion);
-	ConstructMemoryRegion(SYSTEM_MEMORY_BASE, SYSTEM_MEMORY_SIZE, SystemRegion);
-	ConstructMemoryRegion(DEVKIT_MEMORY_BASE, DEVKIT_MEMORY_SIZE, DevkitRegion);
-
 	unsigned char PreviousLayout;
 	if ((BootFlags & BOOT_QUICK_REBOOT) != 0)
 	{
@@ -104,14 +98,12 @@ void VMManager::Initialize(HANDLE memory_view, HANDLE pagetables_view, int BootF
 		m_PhysicalPagesAvailable = g_SystemMaxMemory >> PAGE_SHIFT;
 		m_HighestPage = CHIHIRO_HIGHEST_PHYSICAL_PAGE;
 		m_NV2AInstancePage = CHIHIRO_INSTANCE_PHYSICAL_PAGE;
-		m_MemoryRegionArray[ContiguousRegion].RegionMap[CONTIGUOUS_MEMORY_BASE].size = CONTIGUOUS_MEMORY_CHIHIRO_SIZE;
 	}
 	else if (m_MmLayoutDebug)
 	{
 		g_SystemMaxMemory = CHIHIRO_MEMORY_SIZE;
 		m_DebuggerPagesAvailable = X64M_PHYSICAL_PAGE;
 		m_HighestPage = CHIHIRO_HIGHEST_PHYSICAL_PAGE;
-		m_MemoryRegionArray[ContiguousRegion].RegionMap[CONTIGUOUS_MEMORY_BASE].size = CONTIGUOUS_MEMORY_CHIHIRO_SIZE;
 
 		// Note that even if this is true, only the heap/Nt functions of the title are affected, the Mm functions
 		// will still use only the lower 64 MiB and the same is true for the debugger pages, meaning they will only
@@ -119,13 +111,16 @@ void VMManager::Initialize(HANDLE memory_view, HANDLE pagetables_view, int BootF
 		if (CxbxKrnl_Xbe->m_Header.dwInitFlags.bLimit64MB) { m_bAllowNonDebuggerOnTop64MiB = false; }
 	}
 
-	// Insert all the pages available on the system in the free list
-	xboxkrnl::PLIST_ENTRY ListEntry = FreeList.Blink;
-	PFreeBlock block = new FreeBlock;
-	block->start = 0;
-	block->size = m_HighestPage + 1;
-	block->ListEntry.Flink = block->ListEntry.Blink = nullptr; // Was LIST_ENTRY_INITIALIZE()
-	InsertHeadList(ListEntry, &block->ListEntry);
+	// Set up the structs tracking the memory regions. This is done only now because the size of the contiguous region
+	// depends on the layout, and the free space index must agree with it
+	ConstructMemoryRegion(LOWEST_USER_ADDRESS, USER_MEMORY_SIZE, UserRegion);
+	ConstructMemoryRegion(CONTIGUOUS_MEMORY_BASE, (m_MmLayoutChihiro || m_MmLayoutDebug) ?
+		CONTIGUOUS_MEMORY_CHIHIRO_SIZE : CONTIGUOUS_MEMORY_XBOX_SIZE, ContiguousRegion);
+	ConstructMemoryRegion(SYSTEM_MEMORY_BASE, SYSTEM_MEMORY_SIZE, SystemRegion);
+	ConstructMemoryRegion(DEVKIT_MEMORY_BASE, DEVKIT_MEMORY_SIZE, DevkitRegion);
+
+	// Insert all the pages available on the system in the free page index
+	IndexFreeBlock(0, m_HighestPage + 1);
 
 	// Set up the pfn database
 	if ((BootFlags & BOOT_QUICK_REBOOT) == 0) {
@@ -169,6 +164,7 @@ void VMManager::ConstructMemoryRegion(VAddr Start, size_t Size, MemoryRegionType
 	vma.base = Start;
 	vma.size = Size;
 	m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.emplace(Start, vma).first;
+	InsertFreeVMA(Start, Size, Type);
 }
 
 void VMManager::DestroyMemoryRegions()
@@ -382,62 +378,19 @@ void VMManager::RestorePersistentAllocation(VAddr addr, PFN StartingPfn, PFN End
 
 void VMManager::ConstructVMA(VAddr Start, size_t Size, MemoryRegionType Type, VMAType VmaType, bool bFragFlag, DWORD Perms)
 {
-	VMAIter it_begin = m_MemoryRegionArray[Type].RegionMap.begin();
-	VMAIter it_end = m_MemoryRegionArray[Type].RegionMap.end();
-	VMAIter it;
-
 	VMAIter vma_handle = CarveVMA(Start, Size, Type);
 	VirtualMemoryArea& vma = vma_handle->second;
+	RemoveFreeVMA(vma.base, Type);
+
+	LockVMA();
 	vma.type = VmaType;
 	vma.permissions = Perms;
 	vma.bFragmented = bFragFlag;
+	UnlockVMA();
 
 	// Depending on the splitting done by CarveVMA and the type of the adiacent vma's, there is no guarantee that the next
-	// or previous vma's are free. We are just going to iterate forward and backward until we find one.
-
-	it = std::next(vma_handle);
-
-	while (it != it_end)
-	{
-		if (it->second.type == FreeVma)
-		{
-			m_MemoryRegionArray[Type].LastFree = it;
-			return;
-		}
-		++it;
-	}
-
-	if (vma_handle == it_begin)
-	{
-		// Already at the beginning of the map, bail out immediately
-
-		EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
-		m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
-		return;
-	}
-
-	it = std::prev(vma_handle);
-
-	while (true)
-	{
-		if (it->second.type == FreeVma)
-		{
-			m_MemoryRegionArray[Type].LastFree = it;
-			return;
-		}
-
-		if (it == it_begin) { break; }
-		--it;
-	}
-
-	// ergo720: I don't expect this to happen since it would mean we have exhausted the virtual space in the memory region,
-	// but it's just in case it does
-
-	EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
-
-	m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
-
-	return;
+	// or previous vma's are free. The free space index gives us the closest free one directly
+	UpdateLastFree(Start, Type);
 }
 
 VAddr VMManager::DbgTestPte(VAddr addr, PMMPTE Pte, bool bWriteCheck)
@@ -1430,8 +1383,6 @@ size_t VMManager::QuerySize(VAddr addr, bool bCxbxCaller)
 	PFN_COUNT PagesNumber;
 	size_t Size = 0;
 
-	Lock();
-
 	if (bCxbxCaller)
 	{
 		// This is designed to handle Cxbx callers which can provide an offset instead of the beginning of the allocation
@@ -1445,22 +1396,28 @@ size_t VMManager::QuerySize(VAddr addr, bool bCxbxCaller)
 		else
 		{
 			DBG_PRINTF("QuerySize: Unknown memory region queried.\n");
-			Unlock();
 			RETURN(Size);
 		}
 
+		// We only need the vma lock in shared mode here, so that we don't have to wait for allocations that hold the
+		// critical section while they call the host
+
+		AcquireSRWLockShared(&m_VmaLock);
+
 		VMAIter it = GetVMAIterator(addr, Type);
 
 		if (it != m_MemoryRegionArray[Type].RegionMap.end() && it->second.type != FreeVma)
 		{
 			Size = it->second.size;
 		}
+
+		ReleaseSRWLockShared(&m_VmaLock);
 	}
 	else
 	{
 		// This will only work for allocations made by MmAllocateContiguousMemory(Ex), MmAllocateSystemMemory and
 		// MmCreateKernelStack which is what MmQueryAllocationSize expects. If they are not, this will either fault
-		// or return an incorrect size of at least PAGE_SIZE
+		// or return an incorrect size of at least PAGE_SIZE. No lock is needed since the ptes of a live allocation don't change
 
 		PagesNumber = 1;
 		PointerPte = GetPteAddress(addr);
@@ -1475,8 +1432,6 @@ size_t VMManager::QuerySize(VAddr addr, bool bCxbxCaller)
 		Size = PagesNumber << PAGE_SHIFT;
 	}
 
-	Unlock();
-
 	RETURN(Size);
 }
 
@@ -2231,7 +2186,9 @@ xboxkrnl::NTSTATUS VMManager::XbVirtualMemoryStatistics(VAddr addr, xboxkrnl::PM
 VAddr VMManager::MapMemoryBlock(MappingFn MappingRoutine, MemoryRegionType Type, PFN_COUNT PteNumber, PFN pfn, VAddr HighestAddress)
 {
 	VAddr addr;
-	VMAIter it = m_MemoryRegionArray[Type].LastFree;
+	FreeVmaIndex& FreeIndex = m_MemoryRegionArray[Type].FreeIndex;
+	VAddr base, start;
+	size_t size;
 	size_t Size = PteNumber << PAGE_SHIFT;
 	DWORD FileOffsetLow = 0;
 
@@ -2241,22 +2198,27 @@ VAddr VMManager::MapMemoryBlock(MappingFn MappingRoutine, MemoryRegionType Type,
 		Size = (pfn << PAGE_SHIFT) + Size - FileOffsetLow;
 	}
 
-	VMAIter end_it = m_MemoryRegionArray[Type].RegionMap.end();
+	// If not even the largest free vma of the region can hold the block, don't bother searching
 
-	if (HighestAddress) // XbAllocateVirtualMemory specific
+	if (FreeIndex.Largest() < Size)
 	{
-		end_it = std::next(GetVMAIterator(HighestAddress, Type));
+		EmuLog(LOG_LEVEL::WARNING, "Failed to map a memory block in the virtual region %d!", Type);
+		return NULL;
 	}
 
-	while (it != end_it)
+	// Only the free vma's large enough for the block are visited, starting from the one pointed to by the LastFree iterator.
+	// With HighestAddress (XbAllocateVirtualMemory specific), the vma's starting above it are skipped and the others are
+	// clipped to it
+
+	if (m_MemoryRegionArray[Type].LastFree == m_MemoryRegionArray[Type].RegionMap.end()) { start = (VAddr)~0; }
+	else { start = m_MemoryRegionArray[Type].LastFree->first; }
+
+	for (VAddr from = start; FreeIndex.FindFirstFit(from, Size, &base, &size); from = base + 1)
 	{
-		if (it->second.type != FreeVma) // already allocated by the VMManager
-		{
-			++it;
-			continue;
-		}
-		addr = it->first;
-		if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity)) // free vma
+		if (HighestAddress && (base > HighestAddress)) { break; }
+
+		addr = base;
+		if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity))
 		{
 			// addr is not aligned with the granularity of the host, jump to the next granularity boundary
 
@@ -2267,51 +2229,34 @@ VAddr VMManager::MapMemoryBlock(MappingFn MappingRoutine, MemoryRegionType Type,
 		// keep on trying until we succeed or fail entirely.
 
 		size_t vma_end;
-		if (HighestAddress && (it->first + it->second.size > HighestAddress + 1)) { vma_end = HighestAddress + 1; }
-		else { vma_end = it->first + it->second.size; }
+		if (HighestAddress && (base + size > HighestAddress + 1)) { vma_end = HighestAddress + 1; }
+		else { vma_end = base + size; }
 
 		addr = (this->*MappingRoutine)(addr, Size, vma_end, FileOffsetLow, pfn);
 
 		if (addr) { return addr; }
-
-		++it;
 	}
 
 	// If we are here, it means we reached the end of the memory region. In desperation, we also try to map it from the
 	// LastFree iterator and going backwards, since there could be holes created by deallocation operations...
 
-	VMAIter begin_it = m_MemoryRegionArray[Type].RegionMap.begin();
+	if (HighestAddress && (start > HighestAddress)) { start = HighestAddress + 1; }
 
-	if (m_MemoryRegionArray[Type].LastFree == begin_it)
+	for (VAddr below = start; FreeIndex.FindLastFit(below, Size, &base, &size); below = base)
 	{
-		// We are already at the beginning of the map, so bail out immediately
-
-		EmuLog(LOG_LEVEL::WARNING, "Failed to map a memory block in the virtual region %d!", Type);
-		return NULL;
-	}
-
-	it = std::prev(m_MemoryRegionArray[Type].LastFree);
-
-	while (true)
-	{
-		if (it->second.type == FreeVma)
+		addr = base;
+		if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity))
 		{
-			addr = it->first;
-
-			if (!CHECK_ALIGNMENT(addr, m_AllocationGranularity))
-			{
-				addr = ROUND_UP(addr, m_AllocationGranularity);
-			}
-
-			size_t vma_end = it->first + it->second.size;
+			addr = ROUND_UP(addr, m_AllocationGranularity);
+		}
 
-			addr = (this->*MappingRoutine)(addr, Size, vma_end, FileOffsetLow, pfn);
+		size_t vma_end;
+		if (HighestAddress && (base + size > HighestAddress + 1)) { vma_end = HighestAddress + 1; }
+		else { vma_end = base + size; }
 
-			if (addr) { return addr; }
-		}
+		addr = (this->*MappingRoutine)(addr, Size, vma_end, FileOffsetLow, pfn);
 
-		if (it == begin_it) { break; }
-		--it;
+		if (addr) { return addr; }
 	}
 
 	// We have failed to map the block. This is likely because the virtual space is fragmented or there are too many
@@ -2363,20 +2308,24 @@ bool VMManager::IsValidVirtualAddress(const VAddr addr)
 {
 	LOG_FUNC_ONE_ARG(addr);
 
-	PMMPTE PointerPte;
+	MMPTE TempPte;
 
-	Lock();
+	// This doesn't take the lock: the page tables are always mapped and every pte is an aligned dword, so each read below
+	// sees a consistent entry. The result can be stale by the time the caller uses it, but that was true with the lock too
 
-	PointerPte = GetPdeAddress(addr);
-	if (PointerPte->Hardware.Valid == 0) // invalid pde -> addr is invalid
-		goto InvalidAddress;
+	TempPte.Default = GetPdeAddress(addr)->Default;
+	if (TempPte.Hardware.Valid == 0) { // invalid pde -> addr is invalid
+		RETURN(false);
+	}
 
-	if (PointerPte->Hardware.LargePage != 0) // addr is backed by a large page
-		goto ValidAddress;
+	if (TempPte.Hardware.LargePage != 0) { // addr is backed by a large page
+		RETURN(true);
+	}
 
-	PointerPte = GetPteAddress(addr);
-	if (PointerPte->Hardware.Valid == 0) // invalid pte -> addr is invalid
-		goto InvalidAddress;
+	TempPte.Default = GetPteAddress(addr)->Default;
+	if (TempPte.Hardware.Valid == 0) { // invalid pte -> addr is invalid
+		RETURN(false);
+	}
 
 	// The following check is needed to handle the special case where the address being queried falls inside the PTs region.
 	// The first-level pte is also a second-level pte for the pages in the 0xC0000000 region, that is, the pte's of the PTs
@@ -2384,18 +2333,13 @@ bool VMManager::IsValidVirtualAddress(const VAddr addr)
 	// into is valid because the corresponding pde is valid. Addr could still be invalid but the pde is marked valid simply
 	// because it's mapping a large page instead of the queried PT.
 
-	if (PointerPte->Hardware.LargePage != 0) // pte is actually a pde and it's mapping a large page -> addr is invalid
-		goto InvalidAddress;
+	if (TempPte.Hardware.LargePage != 0) { // pte is actually a pde and it's mapping a large page -> addr is invalid
+		RETURN(false);
+	}
 
 	// If we reach here, we have a valid pte -> addr is backed by a 4K page
 
-	ValidAddress:
-	Unlock();
 	RETURN(true);
-
-	InvalidAddress:
-	Unlock();
-	RETURN(false);
 }
 
 PAddr VMManager::TranslateVAddrToPAddr(const VAddr addr)
@@ -2403,10 +2347,10 @@ PAddr VMManager::TranslateVAddrToPAddr(const VAddr addr)
 	LOG_FUNC_ONE_ARG(addr);
 
 	PAddr PAddr;
-	PMMPTE PointerPte;
+	MMPTE TempPte;
 	//MemoryRegionType Type;
 
-	Lock();
+	// Like IsValidVirtualAddress, this only reads single ptes and so doesn't need the lock
 
 	// ergo720: horrendous hack, this identity maps all allocations done by the VMManager to keep the LLE USB working.
 	// The problem is that if the user buffer pointed to by the TD is allocated by the VMManager with VirtualAlloc, then
@@ -2423,7 +2367,6 @@ PAddr VMManager::TranslateVAddrToPAddr(const VAddr addr)
 	if (true/*(addr >= PAGE_TABLES_BASE && addr <= PAGE_TABLES_END) || (Type != COUNTRegion && Type != ContiguousRegion)*/) {
 		if (IsValidVirtualAddress(addr)) {
 			EmuLog(LOG_LEVEL::WARNING, "Applying identity mapping hack to allocation at address 0x%X", addr);
-			Unlock();
 			RETURN(addr);
 			/*
 			if (Type == UserRegion) {
@@ -2455,15 +2398,15 @@ PAddr VMManager::TranslateVAddrToPAddr(const VAddr addr)
 		}
 	}
 
-	PointerPte = GetPdeAddress(addr);
-	if (PointerPte->Hardware.Valid == 0) { // invalid pde -> addr is invalid
+	TempPte.Default = GetPdeAddress(addr)->Default;
+	if (TempPte.Hardware.Valid == 0) { // invalid pde -> addr is invalid
 		goto InvalidAddress;
 	}
 
-	if (PointerPte->Hardware.LargePage == 0)
+	if (TempPte.Hardware.LargePage == 0)
 	{
-		PointerPte = GetPteAddress(addr);
-		if (PointerPte->Hardware.Valid == 0) { // invalid pte -> addr is invalid
+		TempPte.Default = GetPteAddress(addr)->Default;
+		if (TempPte.Hardware.Valid == 0) { // invalid pte -> addr is invalid
 			goto InvalidAddress;
 		}
 		PAddr = BYTE_OFFSET(addr); // valid pte -> addr is valid
@@ -2473,13 +2416,11 @@ PAddr VMManager::TranslateVAddrToPAddr(const VAddr addr)
 		PAddr = BYTE_OFFSET_LARGE(addr); // this is a large page, translate it immediately
 	}
 
-	PAddr += (PointerPte->Hardware.PFN << PAGE_SHIFT);
+	PAddr += (TempPte.Hardware.PFN << PAGE_SHIFT);
 
-	Unlock();
 	RETURN(PAddr);
 
 	InvalidAddress:
-	Unlock();
 	RETURN(NULL);
 }
 
@@ -2493,12 +2434,27 @@ void VMManager::Unlock()
 	LeaveCriticalSection(&m_CriticalSection);
 }
 
+void VMManager::LockVMA()
+{
+	AcquireSRWLockExclusive(&m_VmaLock);
+}
+
+void VMManager::UnlockVMA()
+{
+	ReleaseSRWLockExclusive(&m_VmaLock);
+}
+
 VMAIter VMManager::UnmapVMA(VMAIter vma_handle, MemoryRegionType Type)
 {
 	VirtualMemoryArea& vma = vma_handle->second;
+
+	LockVMA();
 	vma.type = FreeVma;
 	vma.permissions = XBOX_PAGE_NOACCESS;
 	vma.bFragmented = false;
+	UnlockVMA();
+
+	InsertFreeVMA(vma.base, vma.size, Type);
 
 	return MergeAdjacentVMA(vma_handle, Type);
 }
@@ -2577,12 +2533,24 @@ VMAIter VMManager::SplitVMA(VMAIter vma_handle, u32 offset_in_vma, MemoryRegionT
 	assert(offset_in_vma < old_vma.size);
 	assert(offset_in_vma > 0);
 
-	old_vma.size = offset_in_vma;
+	if (old_vma.type == FreeVma) { RemoveFreeVMA(old_vma.base, Type); }
+
 	new_vma.base += offset_in_vma;
 	new_vma.size -= offset_in_vma;
 
 	// add the new splitted vma to m_Vma_map
-	return m_MemoryRegionArray[Type].RegionMap.emplace_hint(std::next(vma_handle), new_vma.base, new_vma);
+	LockVMA();
+	old_vma.size = offset_in_vma;
+	VMAIter new_handle = m_MemoryRegionArray[Type].RegionMap.emplace_hint(std::next(vma_handle), new_vma.base, new_vma);
+	UnlockVMA();
+
+	if (old_vma.type == FreeVma)
+	{
+		InsertFreeVMA(old_vma.base, old_vma.size, Type);
+		InsertFreeVMA(new_vma.base, new_vma.size, Type);
+	}
+
+	return new_handle;
 }
 
 VMAIter VMManager::MergeAdjacentVMA(VMAIter vma_handle, MemoryRegionType Type)
@@ -2590,8 +2558,15 @@ VMAIter VMManager::MergeAdjacentVMA(VMAIter vma_handle, MemoryRegionType Type)
 	VMAIter next_vma = std::next(vma_handle);
 	if (next_vma != m_MemoryRegionArray[Type].RegionMap.end() && vma_handle->second.CanBeMergedWith(next_vma->second))
 	{
+		RemoveFreeVMA(vma_handle->first, Type);
+		RemoveFreeVMA(next_vma->first, Type);
+
+		LockVMA();
 		vma_handle->second.size += next_vma->second.size;
 		m_MemoryRegionArray[Type].RegionMap.erase(next_vma);
+		UnlockVMA();
+
+		InsertFreeVMA(vma_handle->first, vma_handle->second.size, Type);
 	}
 
 	if (vma_handle != m_MemoryRegionArray[Type].RegionMap.begin())
@@ -2599,9 +2574,16 @@ VMAIter VMManager::MergeAdjacentVMA(VMAIter vma_handle, MemoryRegionType Type)
 		VMAIter prev_vma = std::prev(vma_handle);
 		if (prev_vma->second.CanBeMergedWith(vma_handle->second))
 		{
+			RemoveFreeVMA(prev_vma->first, Type);
+			RemoveFreeVMA(vma_handle->first, Type);
+
+			LockVMA();
 			prev_vma->second.size += vma_handle->second.size;
 			m_MemoryRegionArray[Type].RegionMap.erase(vma_handle);
+			UnlockVMA();
+
 			vma_handle = prev_vma;
+			InsertFreeVMA(vma_handle->first, vma_handle->second.size, Type);
 		}
 	}
 
@@ -2623,6 +2605,169 @@ void VMManager::UpdateMemoryPermissions(VAddr addr, size_t Size, DWORD Perms)
 	}
 }
 
+void VMManager::InsertFreeVMA(VAddr base, size_t size, MemoryRegionType Type)
+{
+	m_MemoryRegionArray[Type].FreeIndex.Insert(base, size);
+}
+
+void VMManager::RemoveFreeVMA(VAddr base, MemoryRegionType Type)
+{
+	// the vma must be free and already indexed, otherwise the index went out of sync with the region map
+	if (!m_MemoryRegionArray[Type].FreeIndex.Erase(base))
+	{
+		assert(false);
+		EmuLog(LOG_LEVEL::WARNING, "%s: the free vma at 0x%.8X is missing from the free space index of the memory region %d", __func__, base, Type);
+	}
+}
+
+void VMManager::UpdateLastFree(VAddr hint, MemoryRegionType Type)
+{
+	FreeVmaIndex& FreeIndex = m_MemoryRegionArray[Type].FreeIndex;
+	VAddr base;
+	size_t size;
+
+	// Prefer the first free vma at or above hint, otherwise take the closest one below it
+	if (!FreeIndex.FindFirstFit(hint, 0, &base, &size) && !FreeIndex.FindLastFit(hint, 0, &base, &size))
+	{
+		EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
+		m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
+		return;
+	}
+
+	m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.find(base);
+}
+
+void FreeVmaIndex::Insert(VAddr Base, size_t Size)
+{
+	// xorshift, the priorities only need to be spread out to keep the treap balanced
+	m_Seed ^= m_Seed << 13; m_Seed ^= m_Seed >> 17; m_Seed ^= m_Seed << 5;
+
+	Node* NewNode = new Node{ Base, Size, Size, m_Seed, nullptr, nullptr };
+	Node* Left;
+	Node* Right;
+	Split(m_Root, Base, &Left, &Right);
+	m_Root = Merge(Merge(Left, NewNode), Right);
+}
+
+bool FreeVmaIndex::Erase(VAddr Base)
+{
+	Node* Left;
+	Node* Middle;
+	Node* Right;
+	Split(m_Root, Base, &Left, &Middle);
+	Split(Middle, Base + 1, &Middle, &Right);
+
+	bool bFound = (Middle != nullptr);
+	Destroy(Middle);
+	m_Root = Merge(Left, Right);
+	return bFound;
+}
+
+bool FreeVmaIndex::FindFirstFit(VAddr From, size_t Size, VAddr* Base, size_t* FoundSize) const
+{
+	const Node* Found = FirstFit(m_Root, From, Size);
+	if (Found == nullptr) { return false; }
+
+	*Base = Found->Base;
+	*FoundSize = Found->Size;
+	return true;
+}
+
+bool FreeVmaIndex::FindLastFit(VAddr Below, size_t Size, VAddr* Base, size_t* FoundSize) const
+{
+	const Node* Found = LastFit(m_Root, Below, Size);
+	if (Found == nullptr) { return false; }
+
+	*Base = Found->Base;
+	*FoundSize = Found->Size;
+	return true;
+}
+
+void FreeVmaIndex::Update(Node* t)
+{
+	t->MaxSize = t->Size;
+	if (t->Left && t->Left->MaxSize > t->MaxSize) { t->MaxSize = t->Left->MaxSize; }
+	if (t->Right && t->Right->MaxSize > t->MaxSize) { t->MaxSize = t->Right->MaxSize; }
+}
+
+// splits t into the nodes with a base below Base (Left) and the others (Right)
+void FreeVmaIndex::Split(Node* t, VAddr Base, Node** Left, Node** Right)
+{
+	if (t == nullptr)
+	{
+		*Left = *Right = nullptr;
+		return;
+	}
+
+	if (t->Base < Base)
+	{
+		Split(t->Right, Base, &t->Right, Right);
+		*Left = t;
+	}
+	else
+	{
+		Split(t->Left, Base, Left, &t->Left);
+		*Right = t;
+	}
+	Update(t);
+}
+
+// joins two treaps, all the bases in Left must be below those in Right
+FreeVmaIndex::Node* FreeVmaIndex::Merge(Node* Left, Node* Right)
+{
+	if (Left == nullptr) { return Right; }
+	if (Right == nullptr) { return Left; }
+
+	if (Left->Priority > Right->Priority)
+	{
+		Left->Right = Merge(Left->Right, Right);
+		Update(Left);
+		return Left;
+	}
+
+	Right->Left = Merge(Left, Right->Left);
+	Update(Right);
+	return Right;
+}
+
+const FreeVmaIndex::Node* FreeVmaIndex::FirstFit(const Node* t, VAddr From, size_t Size)
+{
+	// A subtree whose largest free vma is too small can be skipped entirely
+	if (t == nullptr || t->MaxSize < Size) { return nullptr; }
+
+	if (t->Base >= From)
+	{
+		const Node* Found = FirstFit(t->Left, From, Size);
+		if (Found) { return Found; }
+		if (t->Size >= Size) { return t; }
+	}
+
+	return FirstFit(t->Right, From, Size);
+}
+
+const FreeVmaIndex::Node* FreeVmaIndex::LastFit(const Node* t, VAddr Below, size_t Size)
+{
+	if (t == nullptr || t->MaxSize < Size) { return nullptr; }
+
+	if (t->Base < Below)
+	{
+		const Node* Found = LastFit(t->Right, Below, Size);
+		if (Found) { return Found; }
+		if (t->Size >= Size) { return t; }
+	}
+
+	return LastFit(t->Left, Below, Size);
+}
+
+void FreeVmaIndex::Destroy(Node* t)
+{
+	if (t == nullptr) { return; }
+
+	Destroy(t->Left);
+	Destroy(t->Right);
+	delete t;
+}
+
 VMAIter VMManager::CheckConflictingVMA(VAddr addr, size_t Size, MemoryRegionType Type, bool* bOverflow)
 {
 	*bOverflow = false;
@@ -2690,47 +2835,15 @@ void VMManager::DestructVMA(VAddr addr, MemoryRegionType Type, size_t Size)
 		CarvedVmaIt = std::next(UnmapVMA(CarvedVmaIt, Type));
 	}
 
-	// If we free an entire vma, prev(CarvedVmaIt) will be the freed vma. If it is not, we'll do a standard search
+	// If we free an entire vma, prev(CarvedVmaIt) will be the freed vma. If it is not, we'll ask the free space index
 
 	if (CarvedVmaIt != it_begin && std::prev(CarvedVmaIt)->second.type == FreeVma)
 	{
 		m_MemoryRegionArray[Type].LastFree = std::prev(CarvedVmaIt);
 		return;
 	}
-	else
-	{
-		DBG_PRINTF("std::prev(CarvedVmaIt) was not free\n");
-
-		it = CarvedVmaIt;
-
-		while (it != it_end)
-		{
-			if (it->second.type == FreeVma)
-			{
-				m_MemoryRegionArray[Type].LastFree = it;
-				return;
-			}
-			++it;
-		}
 
-		it = std::prev(CarvedVmaIt);
+	DBG_PRINTF("std::prev(CarvedVmaIt) was not free\n");
 
-		while (true)
-		{
-			if (it->second.type == FreeVma)
-			{
-				m_MemoryRegionArray[Type].LastFree = it;
-				return;
-			}
-
-			if (it == it_begin) { break; }
-			--it;
-		}
-
-		EmuLog(LOG_LEVEL::WARNING, "Can't find any more free space in the memory region %d! Virtual memory exhausted?", Type);
-
-		m_MemoryRegionArray[Type].LastFree = m_MemoryRegionArray[Type].RegionMap.end();
-
-		return;
-	}
+	UpdateLastFree(addr, Type);
 }
@@ -65,11 +65,59 @@ struct VirtualMemoryArea
 typedef std::map<VAddr, VirtualMemoryArea>::iterator VMAIter;
 
 
+/* index of the free vma's of a memory region (base -> size). It's a treap ordered by base address, where every node also
+   records the largest free size found in its subtree, so that a search for a free vma able to hold a block skips whole
+   subtrees of smaller ones instead of walking all the free vma's */
+class FreeVmaIndex
+{
+	public:
+		FreeVmaIndex() = default;
+		FreeVmaIndex(const FreeVmaIndex&) = delete;
+		FreeVmaIndex& operator=(const FreeVmaIndex&) = delete;
+		~FreeVmaIndex() { Destroy(m_Root); }
+		// adds a free vma
+		void Insert(VAddr Base, size_t Size);
+		// removes the free vma starting at Base, returns false if there isn't one
+		bool Erase(VAddr Base);
+		// size of the largest free vma, zero when there are none
+		size_t Largest() const { return m_Root ? m_Root->MaxSize : 0; }
+		// finds the free vma with the lowest base at or above From that is at least Size bytes large
+		bool FindFirstFit(VAddr From, size_t Size, VAddr* Base, size_t* FoundSize) const;
+		// finds the free vma with the highest base below Below that is at least Size bytes large
+		bool FindLastFit(VAddr Below, size_t Size, VAddr* Base, size_t* FoundSize) const;
+
+	private:
+		struct Node
+		{
+			VAddr Base;
+			size_t Size;
+			// largest Size in the subtree rooted at this node
+			size_t MaxSize;
+			uint32_t Priority;
+			Node* Left;
+			Node* Right;
+		};
+
+		Node* m_Root = nullptr;
+		// xorshift state for the node priorities
+		uint32_t m_Seed = 2463534242u;
+
+		static void Update(Node* t);
+		static void Split(Node* t, VAddr Base, Node** Left, Node** Right);
+		static Node* Merge(Node* Left, Node* Right);
+		static const Node* FirstFit(const Node* t, VAddr From, size_t Size);
+		static const Node* LastFit(const Node* t, VAddr Below, size_t Size);
+		static void Destroy(Node* t);
+};
+
+
 /* struct representing a particular memory region of interest. Used to track and speed up searches of free areas */
 typedef struct _MemoryRegion
 {
 	VMAIter LastFree;
 	std::map<VAddr, VirtualMemoryArea> RegionMap;
+	// index of the free vma's only, so that searches of free space don't need to walk the allocated ones
+	FreeVmaIndex FreeIndex;
 }MemoryRegion, *PMemoryRegion;
 
 
@@ -171,6 +219,8 @@ class VMManager : public PhysicalMemory
 		HANDLE m_hPTFile = NULL;
 		// critical section lock to synchronize accesses
 		CRITICAL_SECTION m_CriticalSection;
+		// slim lock protecting the structure of the vma maps, so that queries don't have to wait on the critical section
+		SRWLOCK m_VmaLock = SRWLOCK_INIT;
 		// the allocation granularity of the host. Needed by MapViewOfFileEx and VirtualAlloc
 		DWORD m_AllocationGranularity = 0;
 		// number of bytes reserved with XBOX_MEM_RESERVE by XbAllocateVirtualMemory
@@ -209,6 +259,12 @@ class VMManager : public PhysicalMemory
 		VMAIter SplitVMA(VMAIter vma_handle, u32 offset_in_vma, MemoryRegionType Type);
 		// merges the specified vma with adjacent ones if possible
 		VMAIter MergeAdjacentVMA(VMAIter vma_handle, MemoryRegionType Type);
+		// adds a free vma to the free space index of the specified memory region
+		void InsertFreeVMA(VAddr base, size_t size, MemoryRegionType Type);
+		// removes a free vma from the free space index of the specified memory region
+		void RemoveFreeVMA(VAddr base, MemoryRegionType Type);
+		// points the LastFree iterator to the free vma closest to the specified address
+		void UpdateLastFree(VAddr hint, MemoryRegionType Type);
 		// checks if the specified range conflicts with another non-free vma
 		VMAIter CheckConflictingVMA(VAddr addr, size_t Size, MemoryRegionType Type, bool* bOverflow);
 		// changes the access permissions of a block of memory
@@ -221,6 +277,10 @@ class VMManager : public PhysicalMemory
 		void Lock();
 		// releases the critical section
 		void Unlock();
+		// acquires the vma lock in exclusive mode, needed to modify the vma maps
+		void LockVMA();
+		// releases the exclusive vma lock
+		void UnlockVMA();
 };
 
 
@@ -132,6 +132,22 @@ void NTAPI EmuLogEx(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWa
 					break;
 			}
 
+			if (g_LogAsync) {
+				// Formatted as a whole, so that it ends up in a single run of TEXT records
+				char buffer[1024];
+				int length = snprintf(buffer, sizeof(buffer), "%s%s%s", _logThreadPrefix.c_str(), level_str,
+					g_EnumModules2String[to_underlying(cxbxr_module)]);
+
+				va_start(argp, szWarningMessage);
+				vsnprintf(buffer + length, sizeof(buffer) - length - 1, szWarningMessage, argp);
+				va_end(argp);
+
+				length = strlen(buffer);
+				buffer[length++] = '\n';
+				log_async_text(buffer, length);
+				return;
+			}
+
 			std::cout << _logThreadPrefix << level_str
 				<< g_EnumModules2String[to_underlying(cxbxr_module)];
 
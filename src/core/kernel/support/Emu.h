@@ -35,7 +35,9 @@
 // print out a log message to the kernel debug log file if level is high enough
 void NTAPI EmuLogEx(CXBXR_MODULE cxbxr_module, LOG_LEVEL level, const char *szWarningMessage, ...);
 
-#define EmuLog(level, fmt, ...) EmuLogEx(LOG_PREFIX, level, fmt, ##__VA_ARGS__)
+// Messages below the compile-time minimum level of the module (see CXBXR_LOG_MIN_LEVEL) are compiled out
+#define EmuLog(level, fmt, ...) \
+	do { if (LOG_COMPILED_IN(LOG_PREFIX, level)) EmuLogEx(LOG_PREFIX, level, fmt, ##__VA_ARGS__); } while (0)
 
 std::string FormatTitleId(uint32_t title_id);
 
@@ -33,6 +33,9 @@
 #include <string>
 #include <sstream>
 #include <cassert>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <Shlobj.h>
 #include <Shlwapi.h>
 #pragma warning(disable:4005) // Ignore redefined status values
@@ -269,13 +272,13 @@ EmuNtObject::EmuNtObject()
 
 HANDLE EmuNtObject::NewHandle()
 {
-	RefCount++;
+	InterlockedIncrement(&RefCount);
 	return EmuHandleToHandle(new EmuHandle(this));
 }
 
 NTSTATUS EmuNtObject::NtClose()
 {
-	if (--RefCount <= 0) {
+	if (InterlockedDecrement(&RefCount) <= 0) {
 		delete this;
 	}
 
@@ -284,7 +287,7 @@ NTSTATUS EmuNtObject::NtClose()
 
 EmuNtObject* EmuNtObject::NtDuplicateObject(DWORD Options)
 {
-	RefCount++;
+	InterlockedIncrement(&RefCount);
 	return this;
 }
 
@@ -336,7 +339,50 @@ void replace_all(std::string& str, const std::string& from, const std::string& t
 	}
 }
 
-NTSTATUS CxbxConvertFilePath(
+// Path translation cache, so that repeatedly opened files don't have to go through all the string manipulation
+// and symbolic link lookups of CxbxConvertFilePath again. Flushed whenever symbolic links or devices change
+#define CXBX_FILE_PATH_CACHE_SIZE 1024
+
+struct CxbxFilePathCacheKey {
+	NtDll::HANDLE RootDirectory;
+	bool PartitionHeader;
+	std::string XboxPath;
+
+	bool operator==(const CxbxFilePathCacheKey &other) const
+	{
+		return RootDirectory == other.RootDirectory && PartitionHeader == other.PartitionHeader && XboxPath == other.XboxPath;
+	}
+};
+
+struct CxbxFilePathCacheKeyHash {
+	size_t operator()(const CxbxFilePathCacheKey &key) const
+	{
+		return std::hash<std::string>()(key.XboxPath) ^ (std::hash<void *>()(key.RootDirectory) << 1) ^ key.PartitionHeader;
+	}
+};
+
+struct CxbxFilePathCacheEntry {
+	NtDll::HANDLE RootDirectory;
+	std::wstring RelativeHostPath;
+	std::list<CxbxFilePathCacheKey>::iterator LruPosition;
+};
+
+static std::mutex CxbxFilePathCacheMtx;
+static std::list<CxbxFilePathCacheKey> CxbxFilePathCacheLru; // Most recently used first
+static std::unordered_map<CxbxFilePathCacheKey, CxbxFilePathCacheEntry, CxbxFilePathCacheKeyHash> CxbxFilePathCache;
+// Incremented by every invalidation, so that translations which were already running then don't insert a stale result
+static uint64_t CxbxFilePathCacheGeneration = 0;
+
+void CxbxInvalidateFilePathCache()
+{
+	std::lock_guard<std::mutex> lock(CxbxFilePathCacheMtx);
+
+	CxbxFilePathCacheGeneration++;
+	CxbxFilePathCache.clear();
+	CxbxFilePathCacheLru.clear();
+}
+
+static NTSTATUS CxbxConvertFilePathUncached(
 	std::string RelativeXboxPath,
 	OUT std::wstring &RelativeHostPath,
 	IN OUT NtDll::HANDLE *RootDirectory,
@@ -483,6 +529,63 @@ NTSTATUS CxbxConvertFilePath(
 	return STATUS_SUCCESS;
 }
 
+NTSTATUS CxbxConvertFilePath(
+	std::string RelativeXboxPath,
+	OUT std::wstring &RelativeHostPath,
+	IN OUT NtDll::HANDLE *RootDirectory,
+	std::string aFileAPIName,
+	bool partitionHeader)
+{
+	// Only file-handling API paths are translated, the others are cheap enough as-is
+	if (aFileAPIName.empty()) {
+		return CxbxConvertFilePathUncached(RelativeXboxPath, RelativeHostPath, RootDirectory, aFileAPIName, partitionHeader);
+	}
+
+	CxbxFilePathCacheKey key = { *RootDirectory, partitionHeader, RelativeXboxPath };
+	uint64_t generation;
+
+	{
+		std::lock_guard<std::mutex> lock(CxbxFilePathCacheMtx);
+
+		auto it = CxbxFilePathCache.find(key);
+		if (it != CxbxFilePathCache.end()) {
+			CxbxFilePathCacheLru.splice(CxbxFilePathCacheLru.begin(), CxbxFilePathCacheLru, it->second.LruPosition);
+			*RootDirectory = it->second.RootDirectory;
+			RelativeHostPath = it->second.RelativeHostPath;
+
+			if (g_bPrintfOn) {
+				DBG_PRINTF("%s Corrected path (cached)...\n", aFileAPIName.c_str());
+				DBG_PRINTF("  Org:\"%s\"\n", RelativeXboxPath.c_str());
+			}
+
+			return STATUS_SUCCESS;
+		}
+
+		generation = CxbxFilePathCacheGeneration;
+	}
+
+	NTSTATUS result = CxbxConvertFilePathUncached(RelativeXboxPath, RelativeHostPath, RootDirectory, aFileAPIName, partitionHeader);
+	if (result != STATUS_SUCCESS) {
+		return result;
+	}
+
+	std::lock_guard<std::mutex> lock(CxbxFilePathCacheMtx);
+
+	// The symbolic links or devices could have changed while translating, and another
+	// thread could have translated the same path in the meantime
+	if (generation == CxbxFilePathCacheGeneration && CxbxFilePathCache.find(key) == CxbxFilePathCache.end()) {
+		if (CxbxFilePathCache.size() >= CXBX_FILE_PATH_CACHE_SIZE) {
+			CxbxFilePathCache.erase(CxbxFilePathCacheLru.back());
+			CxbxFilePathCacheLru.pop_back();
+		}
+
+		CxbxFilePathCacheLru.push_front(key);
+		CxbxFilePathCache.emplace(std::move(key), CxbxFilePathCacheEntry{ *RootDirectory, RelativeHostPath, CxbxFilePathCacheLru.begin() });
+	}
+
+	return result;
+}
+
 NTSTATUS CxbxObjectAttributesToNT(
 	xboxkrnl::POBJECT_ATTRIBUTES ObjectAttributes, 
 	OUT NativeObjectAttributes& nativeObjectAttributes, 
@@ -573,6 +676,7 @@ int CxbxRegisterDeviceHostPath(std::string XboxDevicePath, std::string HostDevic
 	if (status == STATUS_SUCCESS || status == ERROR_ALREADY_EXISTS) {
 		Devices.push_back(newDevice);
 		result = Devices.size() - 1;
+		CxbxInvalidateFilePathCache();
 	}
 
 	return result;
@@ -666,6 +770,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 				else
 				{
 					NtSymbolicLinkObjects[DriveLetter - 'A'] = this;
+					CxbxInvalidateFilePathCache();
 					DBG_PRINTF("Linked \"%s\" to \"%s\" (residing at \"%s\")\n", aSymbolicLinkName.c_str(), aFullPath.c_str(), HostSymbolicLinkPath.c_str());
 				}
 			}
@@ -679,6 +784,7 @@ NTSTATUS EmuNtSymbolicLinkObject::Init(std::string aSymbolicLinkName, std::strin
 {
 	if (DriveLetter >= 'A' && DriveLetter <= 'Z') {
 		NtSymbolicLinkObjects[DriveLetter - 'A'] = NULL;
+		CxbxInvalidateFilePathCache();
 		NtDll::NtClose(RootDirectoryHandle);
 	}
 }
@@ -157,8 +157,13 @@ struct NativeObjectAttributes {
 	NtDll::POBJECT_ATTRIBUTES NtObjAttrPtr;
 };
 
+#ifndef FILE_USE_FILE_POINTER_POSITION
+#define FILE_USE_FILE_POINTER_POSITION 0xfffffffe // From wdm.h; a ByteOffset of -2 means "at the current file position"
+#endif
+
 NTSTATUS CxbxObjectAttributesToNT(xboxkrnl::POBJECT_ATTRIBUTES ObjectAttributes, NativeObjectAttributes& nativeObjectAttributes, std::string aFileAPIName = "", bool partitionHeader = false);
 NTSTATUS CxbxConvertFilePath(std::string RelativeXboxPath, OUT std::wstring &RelativeHostPath, IN OUT NtDll::HANDLE *RootDirectory, std::string aFileAPIName = "", bool partitionHeader = false);
+void CxbxInvalidateFilePathCache();
 
 // ******************************************************************
 // * Wrapper of a handle object
@@ -185,7 +190,7 @@ public:
 protected:
 	virtual ~EmuNtObject() {};
 private:
-	ULONG RefCount;
+	volatile LONG RefCount; // Updated with interlocked operations, as handles are duplicated and closed from any thread
 
 };
 
@@ -0,0 +1,434 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define LOG_PREFIX CXBXR_MODULE::FILE
+
+#include "EmuFileCache.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#pragma warning(disable:4005) // Ignore redefined status values
+#include <ntstatus.h>
+#pragma warning(default:4005)
+
+#define MEDIA_CACHE_BLOCK_SIZE 0x10000 // 64 KiB
+#define MEDIA_CACHE_MAXIMUM_BLOCKS 1024 // 64 MiB in total
+#define MEDIA_CACHE_MAXIMUM_READ (8 * MEDIA_CACHE_BLOCK_SIZE) // Larger reads go straight to the host
+#define MEDIA_CACHE_READ_AHEAD_BLOCKS 4 // How far ahead of a sequential reader to prefetch
+#define MEDIA_CACHE_SEQUENTIAL_READS 2 // Consecutive reads that must follow each other before read-ahead kicks in
+
+struct MediaCacheFile {
+	HANDLE ReadHandle; // Our own handle to the file, so that cache fills never move the guest's file position
+	DWORD VolumeSerialNumber;
+	uint64_t FileIndex;
+	uint64_t FileSize; // Reread whenever a writer changes the file
+	uint64_t NextOffset; // Where the guest would continue reading sequentially
+	unsigned SequentialReads;
+	uint64_t ReadAheadBlock; // First block not yet queued for read-ahead
+
+	~MediaCacheFile()
+	{
+		CloseHandle(ReadHandle);
+	}
+};
+
+struct MediaCacheBlockKey {
+	DWORD VolumeSerialNumber;
+	uint64_t FileIndex;
+	uint64_t Block;
+
+	bool operator==(const MediaCacheBlockKey &other) const
+	{
+		return VolumeSerialNumber == other.VolumeSerialNumber && FileIndex == other.FileIndex && Block == other.Block;
+	}
+};
+
+struct MediaCacheBlockKeyHash {
+	size_t operator()(const MediaCacheBlockKey &key) const
+	{
+		return std::hash<uint64_t>()(key.FileIndex ^ ((uint64_t)key.VolumeSerialNumber << 32)) ^ std::hash<uint64_t>()(key.Block);
+	}
+};
+
+struct MediaCacheBlock {
+	std::vector<uint8_t> Data; // Shorter than a block only at the end of a file
+	std::list<MediaCacheBlockKey>::iterator LruPosition;
+};
+
+struct MediaCacheReadAheadRequest {
+	std::shared_ptr<MediaCacheFile> File; // Keeps the read handle alive, should the guest close the file meanwhile
+	uint64_t Block;
+};
+
+// The file a writable handle refers to
+struct MediaCacheWriter {
+	DWORD VolumeSerialNumber;
+	uint64_t FileIndex;
+};
+
+// All of the below is protected by MediaCacheMtx
+static std::mutex MediaCacheMtx;
+static std::unordered_map<HANDLE, std::shared_ptr<MediaCacheFile>> MediaCacheFiles;
+static std::unordered_map<MediaCacheBlockKey, MediaCacheBlock, MediaCacheBlockKeyHash> MediaCacheBlocks;
+static std::list<MediaCacheBlockKey> MediaCacheLru; // Most recently used first
+static std::unordered_map<HANDLE, MediaCacheWriter> MediaCacheWriters;
+// Incremented by every invalidation, so that blocks which were already being read then aren't inserted afterwards
+static uint64_t MediaCacheGeneration = 0;
+static std::deque<MediaCacheReadAheadRequest> MediaCacheReadAheadQueue;
+static std::condition_variable MediaCacheReadAheadCond;
+static bool MediaCacheReadAheadStarted = false;
+
+static MediaCacheBlockKey MediaCacheKey(const MediaCacheFile &file, uint64_t block)
+{
+	return { file.VolumeSerialNumber, file.FileIndex, block };
+}
+
+// Reads one block from the host, without holding MediaCacheMtx (so the caller passes the file size it read under it)
+static bool MediaCacheReadBlock(const MediaCacheFile &file, uint64_t fileSize, uint64_t block, std::vector<uint8_t> &data)
+{
+	uint64_t offset = block * MEDIA_CACHE_BLOCK_SIZE;
+	if (offset >= fileSize) {
+		return false;
+	}
+
+	DWORD size = (DWORD)std::min<uint64_t>(MEDIA_CACHE_BLOCK_SIZE, fileSize - offset);
+	data.resize(size);
+
+	// An OVERLAPPED offset on a synchronous handle gives a positional read
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)offset;
+	overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+	DWORD bytesRead = 0;
+	if (!ReadFile(file.ReadHandle, data.data(), size, &bytesRead, &overlapped) || bytesRead == 0) {
+		return false;
+	}
+
+	data.resize(bytesRead);
+	return true;
+}
+
+// Must be called with MediaCacheMtx held, generation is the MediaCacheGeneration from before the block was read
+static void MediaCacheInsertBlock(const MediaCacheBlockKey &key, std::vector<uint8_t> &&data, uint64_t generation)
+{
+	if (generation != MediaCacheGeneration || MediaCacheBlocks.find(key) != MediaCacheBlocks.end()) {
+		return;
+	}
+
+	if (MediaCacheBlocks.size() >= MEDIA_CACHE_MAXIMUM_BLOCKS) {
+		MediaCacheBlocks.erase(MediaCacheLru.back());
+		MediaCacheLru.pop_back();
+	}
+
+	MediaCacheLru.push_front(key);
+	MediaCacheBlocks.emplace(key, MediaCacheBlock{ std::move(data), MediaCacheLru.begin() });
+}
+
+// Drops the cached blocks of a file and rereads its size, must be called with MediaCacheMtx held
+static void MediaCacheInvalidateFile(const MediaCacheWriter &writer)
+{
+	MediaCacheGeneration++;
+
+	for (auto it = MediaCacheBlocks.begin(); it != MediaCacheBlocks.end();) {
+		if (it->first.VolumeSerialNumber == writer.VolumeSerialNumber && it->first.FileIndex == writer.FileIndex) {
+			MediaCacheLru.erase(it->second.LruPosition);
+			it = MediaCacheBlocks.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	for (auto &entry : MediaCacheFiles) {
+		MediaCacheFile &file = *entry.second;
+		if (file.VolumeSerialNumber == writer.VolumeSerialNumber && file.FileIndex == writer.FileIndex) {
+			LARGE_INTEGER size;
+			if (GetFileSizeEx(file.ReadHandle, &size)) {
+				file.FileSize = size.QuadPart;
+			}
+
+			file.ReadAheadBlock = 0;
+		}
+	}
+}
+
+static void MediaCacheReadAheadThread()
+{
+	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
+
+	std::unique_lock<std::mutex> lock(MediaCacheMtx);
+
+	while (true) {
+		MediaCacheReadAheadCond.wait(lock, [] { return !MediaCacheReadAheadQueue.empty(); });
+
+		MediaCacheReadAheadRequest request = std::move(MediaCacheReadAheadQueue.front());
+		MediaCacheReadAheadQueue.pop_front();
+
+		MediaCacheBlockKey key = MediaCacheKey(*request.File, request.Block);
+		if (MediaCacheBlocks.find(key) != MediaCacheBlocks.end()) {
+			continue;
+		}
+
+		uint64_t fileSize = request.File->FileSize;
+		uint64_t generation = MediaCacheGeneration;
+
+		lock.unlock();
+		std::vector<uint8_t> data;
+		bool success = MediaCacheReadBlock(*request.File, fileSize, request.Block, data);
+		request.File.reset(); // Close the read handle (if it was the last reference) outside of the lock
+		lock.lock();
+
+		if (success) {
+			MediaCacheInsertBlock(key, std::move(data), generation);
+		}
+	}
+}
+
+void CxbxMediaCacheRegisterHandle(HANDLE FileHandle, HANDLE RootDirectory, ACCESS_MASK DesiredAccess)
+{
+	BY_HANDLE_FILE_INFORMATION info;
+
+	// Any path could lead to a cached file (the same folder can be reached through other drives), so track all writers
+	if (DesiredAccess & (FILE_WRITE_DATA | FILE_APPEND_DATA | GENERIC_WRITE | GENERIC_ALL | MAXIMUM_ALLOWED)) {
+		if (!GetFileInformationByHandle(FileHandle, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+			return;
+		}
+
+		MediaCacheWriter writer = { info.dwVolumeSerialNumber, ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow };
+
+		std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+		MediaCacheWriters[FileHandle] = writer;
+		// Opening the file can already have overwritten or truncated it
+		MediaCacheInvalidateFile(writer);
+		return;
+	}
+
+	EmuNtSymbolicLinkObject* symbolicLink = FindNtSymbolicLinkObjectByRootHandle(RootDirectory);
+	if (symbolicLink == NULL || _strnicmp(symbolicLink->XboxSymbolicLinkPath.c_str(), DeviceCdrom0.c_str(), DeviceCdrom0.length()) != 0) {
+		return;
+	}
+
+	if (!GetFileInformationByHandle(FileHandle, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return;
+	}
+
+	HANDLE readHandle = ReOpenFile(FileHandle, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0);
+	if (readHandle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	auto file = std::make_shared<MediaCacheFile>();
+	file->ReadHandle = readHandle;
+	file->VolumeSerialNumber = info.dwVolumeSerialNumber;
+	file->FileIndex = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+	file->FileSize = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	file->NextOffset = 0;
+	file->SequentialReads = 0;
+	file->ReadAheadBlock = 0;
+
+	std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+	MediaCacheFiles[FileHandle] = file;
+
+	if (!MediaCacheReadAheadStarted) {
+		MediaCacheReadAheadStarted = true;
+		std::thread(MediaCacheReadAheadThread).detach();
+	}
+}
+
+void CxbxMediaCacheUnregisterHandle(HANDLE FileHandle)
+{
+	std::shared_ptr<MediaCacheFile> file; // Released after the lock, as that may close the read handle
+
+	std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+	auto it = MediaCacheFiles.find(FileHandle);
+	if (it != MediaCacheFiles.end()) {
+		file = std::move(it->second);
+		MediaCacheFiles.erase(it);
+	}
+
+	auto writer = MediaCacheWriters.find(FileHandle);
+	if (writer != MediaCacheWriters.end()) {
+		// Also covers changes that were made some other way than through NtWriteFile or NtSetInformationFile
+		MediaCacheInvalidateFile(writer->second);
+		MediaCacheWriters.erase(writer);
+	}
+}
+
+void CxbxMediaCacheInvalidateHandle(HANDLE FileHandle)
+{
+	std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+	auto writer = MediaCacheWriters.find(FileHandle);
+	if (writer != MediaCacheWriters.end()) {
+		MediaCacheInvalidateFile(writer->second);
+	}
+}
+
+bool CxbxMediaCacheRead(HANDLE FileHandle, PVOID Buffer, ULONG Length, NtDll::PLARGE_INTEGER ByteOffset, NtDll::NTSTATUS *Status, ULONG_PTR *Information)
+{
+	if (Length == 0 || Length > MEDIA_CACHE_MAXIMUM_READ) {
+		return false;
+	}
+
+	std::shared_ptr<MediaCacheFile> file;
+	uint64_t fileSize;
+	{
+		std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+		auto it = MediaCacheFiles.find(FileHandle);
+		if (it == MediaCacheFiles.end()) {
+			return false;
+		}
+
+		file = it->second;
+		fileSize = file->FileSize;
+	}
+
+	// Without an explicit offset, the read continues at the current file position
+	uint64_t offset;
+	if (ByteOffset == nullptr || (ByteOffset->u.HighPart == -1 && ByteOffset->u.LowPart == FILE_USE_FILE_POINTER_POSITION)) {
+		LARGE_INTEGER position = {};
+		if (!SetFilePointerEx(FileHandle, position, &position, FILE_CURRENT)) {
+			return false;
+		}
+
+		offset = position.QuadPart;
+	}
+	else if (ByteOffset->QuadPart >= 0) {
+		offset = ByteOffset->QuadPart;
+	}
+	else {
+		return false;
+	}
+
+	if (offset >= fileSize) {
+		*Status = STATUS_END_OF_FILE;
+		*Information = 0;
+		return true;
+	}
+
+	uint64_t end = std::min<uint64_t>(offset + Length, fileSize);
+	uint8_t *destination = (uint8_t *)Buffer;
+	uint64_t position = offset;
+
+	while (position < end) {
+		uint64_t block = position / MEDIA_CACHE_BLOCK_SIZE;
+		size_t blockOffset = (size_t)(position % MEDIA_CACHE_BLOCK_SIZE);
+		size_t count = (size_t)std::min<uint64_t>(MEDIA_CACHE_BLOCK_SIZE - blockOffset, end - position);
+		MediaCacheBlockKey key = MediaCacheKey(*file, block);
+		uint64_t generation;
+
+		{
+			std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+			auto it = MediaCacheBlocks.find(key);
+			if (it != MediaCacheBlocks.end()) {
+				MediaCacheLru.splice(MediaCacheLru.begin(), MediaCacheLru, it->second.LruPosition);
+				count = std::min(count, it->second.Data.size() > blockOffset ? it->second.Data.size() - blockOffset : 0);
+				memcpy(destination, it->second.Data.data() + blockOffset, count);
+				if (count == 0) {
+					break;
+				}
+
+				destination += count;
+				position += count;
+				continue;
+			}
+
+			generation = MediaCacheGeneration;
+		}
+
+		// Miss, read the whole block ourselves
+		std::vector<uint8_t> data;
+		if (!MediaCacheReadBlock(*file, fileSize, block, data)) {
+			break;
+		}
+
+		count = std::min(count, data.size() > blockOffset ? data.size() - blockOffset : 0);
+		memcpy(destination, data.data() + blockOffset, count);
+
+		{
+			std::lock_guard<std::mutex> lock(MediaCacheMtx);
+			MediaCacheInsertBlock(key, std::move(data), generation);
+		}
+
+		if (count == 0) {
+			break;
+		}
+
+		destination += count;
+		position += count;
+	}
+
+	// Let the host report whatever went wrong
+	if (position == offset) {
+		return false;
+	}
+
+	// Like NtReadFile, leave the file position right after the data that was read
+	LARGE_INTEGER newPosition;
+	newPosition.QuadPart = position;
+	SetFilePointerEx(FileHandle, newPosition, NULL, FILE_BEGIN);
+
+	*Status = STATUS_SUCCESS;
+	*Information = (ULONG_PTR)(position - offset);
+
+	// Detect sequential access, and keep the read-ahead worker a few blocks ahead of it
+	std::lock_guard<std::mutex> lock(MediaCacheMtx);
+
+	if (offset == file->NextOffset) {
+		file->SequentialReads++;
+	}
+	else {
+		file->SequentialReads = 0;
+		file->ReadAheadBlock = 0;
+	}
+
+	file->NextOffset = position;
+
+	if (file->SequentialReads >= MEDIA_CACHE_SEQUENTIAL_READS && file->FileSize > 0) {
+		uint64_t firstBlock = std::max<uint64_t>(file->ReadAheadBlock, (position + MEDIA_CACHE_BLOCK_SIZE - 1) / MEDIA_CACHE_BLOCK_SIZE);
+		uint64_t lastBlock = std::min<uint64_t>((position - 1) / MEDIA_CACHE_BLOCK_SIZE + MEDIA_CACHE_READ_AHEAD_BLOCKS, (file->FileSize - 1) / MEDIA_CACHE_BLOCK_SIZE);
+
+		for (uint64_t block = firstBlock; block <= lastBlock; block++) {
+			if (MediaCacheBlocks.find(MediaCacheKey(*file, block)) == MediaCacheBlocks.end()) {
+				MediaCacheReadAheadQueue.push_back({ file, block });
+			}
+		}
+
+		if (lastBlock >= firstBlock) {
+			file->ReadAheadBlock = lastBlock + 1;
+			MediaCacheReadAheadCond.notify_one();
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,45 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef EMUFILECACHE_H
+#define EMUFILECACHE_H
+
+#include "EmuFile.h"
+
+// Host side block cache with sequential read-ahead, for files opened read-only from the game media (\Device\CdRom0).
+// Handles are registered by IoCreateFile and unregistered by NtClose; NtReadFile asks the cache first.
+// Unless it's a mounted XISO, the game media is a writable host folder, so writable handles to any file are
+// registered too; whatever they change (NtWriteFile, NtSetInformationFile, and finally NtClose) is dropped from the cache
+
+// Starts caching reads on FileHandle if it's a read-only handle to a file relative to a CdRom0 symbolic link root,
+// or starts tracking FileHandle as a writer if it's writable
+void CxbxMediaCacheRegisterHandle(HANDLE FileHandle, HANDLE RootDirectory, ACCESS_MASK DesiredAccess);
+void CxbxMediaCacheUnregisterHandle(HANDLE FileHandle);
+
+// Drops the cached blocks and size of the file FileHandle refers to, if FileHandle is a registered writer
+void CxbxMediaCacheInvalidateHandle(HANDLE FileHandle);
+
+// Serves a synchronous read on a registered handle from the cache, updating the file position like NtReadFile does.
+// Returns false when the read must go to the host instead (unregistered handle, large read, host error, etc.)
+bool CxbxMediaCacheRead(HANDLE FileHandle, PVOID Buffer, ULONG Length, NtDll::PLARGE_INTEGER ByteOffset, NtDll::NTSTATUS *Status, ULONG_PTR *Information);
+
+#endif
@@ -0,0 +1,490 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#define LOG_PREFIX CXBXR_MODULE::FILE
+
+#include "EmuXiso.h"
+#include <algorithm> // For std::min
+#include <cctype> // For toupper
+#include <mutex>
+#include <vector>
+#pragma warning(disable:4005) // Ignore redefined status values
+#include <ntstatus.h>
+#pragma warning(default:4005)
+
+// The xdvdfs tools are written against the kernel types
+namespace xboxkrnl
+{
+#include "common\xdvdfs-tools\xdvdfs.h"
+};
+
+// Undo buffered_io.h's type overrides
+#undef BOOL
+#undef LPSTR
+
+#ifndef FILE_OPENED
+#define FILE_OPENED 0x00000001
+#endif
+
+// The session and the image handle are protected by XisoMtx
+static std::mutex XisoMtx;
+static xboxkrnl::XDVDFS_SESSION *XisoSession = nullptr;
+static HANDLE XisoImageHandle = INVALID_HANDLE_VALUE;
+
+static xboxkrnl::BOOLEAN XisoReadSectors(PVOID Data, PVOID Buffer, DWORD StartSector, DWORD ReadSize)
+{
+	uint64_t offset = (uint64_t)StartSector * SECTOR_SIZE;
+	DWORD size = ReadSize * SECTOR_SIZE;
+	DWORD bytesRead = 0;
+
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)offset;
+	overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+	return ReadFile((HANDLE)Data, Buffer, size, &bytesRead, &overlapped) && bytesRead == size;
+}
+
+// Must be called with XisoMtx held
+static bool XisoLookup(const std::string &XisoPath, xboxkrnl::SEARCH_RECORD &Record)
+{
+	std::vector<char> path(XisoPath.begin(), XisoPath.end());
+	path.push_back('\0');
+
+	return xboxkrnl::XDVDFS_GetFileInfo(XisoSession, path.data(), &Record) == XDVDFS_NO_ERROR;
+}
+
+static LONGLONG XisoCreationTime()
+{
+	return ((LONGLONG)XisoSession->Root.ImageCreationTime.dwHighDateTime << 32) | XisoSession->Root.ImageCreationTime.dwLowDateTime;
+}
+
+static ULONG XisoFileAttributes(DWORD Attributes)
+{
+	// The XDVDFS attribute bits are the same as the FILE_ATTRIBUTE_* ones
+	return Attributes ? Attributes : FILE_ATTRIBUTE_NORMAL;
+}
+
+static LONGLONG XisoAllocationSize(DWORD FileSize)
+{
+	return ((LONGLONG)FileSize + SECTOR_SIZE - 1) & ~(LONGLONG)(SECTOR_SIZE - 1);
+}
+
+// '*' matches any run of characters and '?' any single one, ignoring case
+static bool XisoMatchMask(const char *Name, const char *Mask)
+{
+	while (*Mask) {
+		if (*Mask == '*') {
+			Mask++;
+			if (*Mask == 0) {
+				return true;
+			}
+
+			for (; *Name; Name++) {
+				if (XisoMatchMask(Name, Mask)) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		if (*Name == 0 || (*Mask != '?' && toupper((unsigned char)*Mask) != toupper((unsigned char)*Name))) {
+			return false;
+		}
+
+		Mask++;
+		Name++;
+	}
+
+	return *Name == 0;
+}
+
+bool CxbxMountXiso(const std::string &IsoPath)
+{
+	std::lock_guard<std::mutex> lock(XisoMtx);
+
+	HANDLE imageHandle = CreateFile(IsoPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (imageHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	xboxkrnl::XDVDFS_SESSION *session = new xboxkrnl::XDVDFS_SESSION();
+	if (!xboxkrnl::XDVDFS_Mount(session, XisoReadSectors, imageHandle)) {
+		delete session;
+		CloseHandle(imageHandle);
+		return false;
+	}
+
+	XisoSession = session;
+	XisoImageHandle = imageHandle;
+	DBG_PRINTF("Mounted XISO \"%s\" (file system at sector 0x%X)\n", IsoPath.c_str(), session->FileSystemBaseSector);
+
+	return true;
+}
+
+bool CxbxXisoIsMounted()
+{
+	std::lock_guard<std::mutex> lock(XisoMtx);
+	return XisoSession != nullptr;
+}
+
+bool CxbxXisoExtractFile(const std::string &XboxPath, const std::string &HostPath)
+{
+	std::lock_guard<std::mutex> lock(XisoMtx);
+
+	xboxkrnl::SEARCH_RECORD search;
+	xboxkrnl::FILE_RECORD file;
+	if (XisoSession == nullptr || !XisoLookup(XboxPath, search) || xboxkrnl::XDVDFS_OpenFileEx(XisoSession, &search, &file) != XDVDFS_NO_ERROR) {
+		return false;
+	}
+
+	HANDLE hostFile = CreateFile(HostPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hostFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	std::vector<uint8_t> buffer(512 * SECTOR_SIZE);
+	DWORD total = 0;
+	DWORD bytesRead;
+	while ((bytesRead = xboxkrnl::XDVDFS_FileRead(XisoSession, &file, buffer.data(), (DWORD)buffer.size())) > 0) {
+		DWORD bytesWritten = 0;
+		if (!WriteFile(hostFile, buffer.data(), bytesRead, &bytesWritten, NULL) || bytesWritten != bytesRead) {
+			break;
+		}
+
+		total += bytesWritten;
+	}
+
+	CloseHandle(hostFile);
+	return total == file.FileSize;
+}
+
+bool CxbxXisoResolvePath(HANDLE RootDirectory, const wchar_t *RelativeHostPath, std::string &XisoPath)
+{
+	if (!CxbxXisoIsMounted()) {
+		return false;
+	}
+
+	// Paths are either relative to a directory opened from the image, or to a symbolic link to
+	// (a folder on) the disc, like "\Device\CdRom0" or "\Device\CdRom0\media"
+	EmuNtXisoFileObject *directory = CxbxXisoFileFromHandle(RootDirectory);
+	if (directory != nullptr) {
+		XisoPath = directory->Path;
+	}
+	else {
+		EmuNtSymbolicLinkObject* symbolicLink = FindNtSymbolicLinkObjectByRootHandle(RootDirectory);
+		if (symbolicLink == NULL || _strnicmp(symbolicLink->XboxSymbolicLinkPath.c_str(), DeviceCdrom0.c_str(), DeviceCdrom0.length()) != 0) {
+			return false;
+		}
+
+		XisoPath = symbolicLink->XboxSymbolicLinkPath.substr(DeviceCdrom0.length());
+	}
+
+	XisoPath += '\\';
+	for (const wchar_t *c = RelativeHostPath; *c != 0; c++) {
+		XisoPath += (char)*c;
+	}
+
+	// XDVDFS_GetFileInfo expects no leading, trailing or doubled separators
+	std::string path;
+	for (char c : XisoPath) {
+		if (c != '\\' || (!path.empty() && path.back() != '\\')) {
+			path += c;
+		}
+	}
+
+	if (!path.empty() && path.back() == '\\') {
+		path.pop_back();
+	}
+
+	XisoPath = path;
+	return true;
+}
+
+EmuNtXisoFileObject *CxbxXisoFileFromHandle(HANDLE Handle)
+{
+	if (!IsEmuHandle(Handle)) {
+		return nullptr;
+	}
+
+	return dynamic_cast<EmuNtXisoFileObject *>(HandleToEmuHandle(Handle)->NtObject);
+}
+
+NtDll::NTSTATUS CxbxXisoOpenFile(const std::string &XisoPath, ACCESS_MASK DesiredAccess, ULONG CreateDisposition, ULONG CreateOptions, HANDLE *FileHandle, ULONG_PTR *Information)
+{
+	*Information = 0;
+
+	// The disc is read-only
+	if ((DesiredAccess & (FILE_WRITE_DATA | FILE_APPEND_DATA | FILE_WRITE_ATTRIBUTES | FILE_WRITE_EA | DELETE | GENERIC_WRITE | GENERIC_ALL)) != 0 ||
+		(CreateDisposition != FILE_OPEN && CreateDisposition != FILE_OPEN_IF)) {
+		return STATUS_ACCESS_DENIED;
+	}
+
+	std::lock_guard<std::mutex> lock(XisoMtx);
+
+	xboxkrnl::SEARCH_RECORD search;
+	if (!XisoLookup(XisoPath, search)) {
+		return (CreateDisposition == FILE_OPEN_IF) ? STATUS_ACCESS_DENIED : STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	bool isDirectory = (search.CurrentFileAttributes & XDVDFS_ATTRIBUTE_DIRECTORY) != 0;
+	if ((CreateOptions & FILE_DIRECTORY_FILE) && !isDirectory) {
+		return STATUS_NOT_A_DIRECTORY;
+	}
+
+	if ((CreateOptions & FILE_NON_DIRECTORY_FILE) && isDirectory) {
+		return STATUS_FILE_IS_A_DIRECTORY;
+	}
+
+	EmuNtXisoFileObject *file = new EmuNtXisoFileObject();
+	file->Path = XisoPath;
+	file->IsDirectory = isDirectory;
+	file->StartSector = search.CurrentFileStartSector;
+	file->FileSize = search.CurrentFileSize;
+	file->Attributes = search.CurrentFileAttributes;
+	file->Position = 0;
+	file->EnumerationStarted = false;
+
+	// The handle takes over the initial reference, so that closing it deletes the object
+	*FileHandle = EmuHandleToHandle(new EmuHandle(file));
+	*Information = FILE_OPENED;
+
+	return STATUS_SUCCESS;
+}
+
+static void XisoFillNetworkOpenInformation(DWORD FileSize, DWORD Attributes, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Info)
+{
+	Info->CreationTime.QuadPart = XisoCreationTime();
+	Info->LastAccessTime.QuadPart = Info->CreationTime.QuadPart;
+	Info->LastWriteTime.QuadPart = Info->CreationTime.QuadPart;
+	Info->ChangeTime.QuadPart = Info->CreationTime.QuadPart;
+	Info->AllocationSize.QuadPart = XisoAllocationSize(FileSize);
+	Info->EndOfFile.QuadPart = FileSize;
+	Info->FileAttributes = XisoFileAttributes(Attributes);
+}
+
+NtDll::NTSTATUS CxbxXisoQueryAttributes(const std::string &XisoPath, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Attributes)
+{
+	std::lock_guard<std::mutex> lock(XisoMtx);
+
+	xboxkrnl::SEARCH_RECORD search;
+	if (!XisoLookup(XisoPath, search)) {
+		return STATUS_OBJECT_NAME_NOT_FOUND;
+	}
+
+	XisoFillNetworkOpenInformation(search.CurrentFileSize, search.CurrentFileAttributes, Attributes);
+	return STATUS_SUCCESS;
+}
+
+NtDll::NTSTATUS CxbxXisoReadFile(EmuNtXisoFileObject *File, PVOID Buffer, ULONG Length, NtDll::PLARGE_INTEGER ByteOffset, ULONG_PTR *Information)
+{
+	*Information = 0;
+
+	if (File->IsDirectory) {
+		return STATUS_INVALID_DEVICE_REQUEST;
+	}
+
+	std::lock_guard<std::mutex> lock(XisoMtx);
+
+	LONGLONG offset = File->Position;
+	if (ByteOffset != nullptr && !(ByteOffset->u.HighPart == -1 && ByteOffset->u.LowPart == FILE_USE_FILE_POINTER_POSITION)) {
+		offset = ByteOffset->QuadPart;
+	}
+
+	if (offset < 0) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if (offset >= File->FileSize) {
+		return STATUS_END_OF_FILE;
+	}
+
+	xboxkrnl::FILE_RECORD record;
+	record.Magic = XisoSession->Magic;
+	record.FileStartSector = File->StartSector;
+	record.FileSize = File->FileSize;
+	record.CurrentPosition = (DWORD)offset;
+
+	DWORD expected = (DWORD)std::min<LONGLONG>(Length, File->FileSize - offset);
+	DWORD bytesRead = xboxkrnl::XDVDFS_FileRead(XisoSession, &record, Buffer, Length);
+
+	File->Position = record.CurrentPosition;
+	*Information = bytesRead;
+
+	return (bytesRead == expected) ? STATUS_SUCCESS : STATUS_IO_DEVICE_ERROR;
+}
+
+NtDll::NTSTATUS CxbxXisoQueryDirectory(EmuNtXisoFileObject *File, xboxkrnl::FILE_DIRECTORY_INFORMATION *FileInformation, ULONG Length, const std::string &FileMask, bool RestartScan, ULONG_PTR *Information)
+{
+	*Information = 0;
+
+	if (!File->IsDirectory) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if (Length < offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName)) {
+		return STATUS_INFO_LENGTH_MISMATCH;
+	}
+
+	std::lock_guard<std::mutex> lock(XisoMtx);
+
+	if (RestartScan) {
+		File->Position = 0;
+		File->EnumerationStarted = false;
+	}
+
+	xboxkrnl::SEARCH_RECORD search;
+	search.Magic = XisoSession->Magic;
+	search.SearchStartSector = File->StartSector;
+	search.DirectorySize = File->FileSize;
+	search.Position = File->Position;
+
+	DWORD result;
+	while ((result = xboxkrnl::XDVDFS_EnumFiles(XisoSession, &search)) == XDVDFS_NO_ERROR) {
+		if (FileMask.empty() || XisoMatchMask((const char *)search.CurrentFilename, FileMask.c_str())) {
+			break;
+		}
+	}
+
+	bool firstQuery = !File->EnumerationStarted;
+	File->EnumerationStarted = true;
+
+	if (result != XDVDFS_NO_ERROR) {
+		File->Position = search.Position;
+		if (result != XDVDFS_NO_MORE_FILES) {
+			return STATUS_IO_DEVICE_ERROR;
+		}
+
+		return firstQuery ? STATUS_NO_SUCH_FILE : STATUS_NO_MORE_FILES;
+	}
+
+	ULONG fileNameLength = strlen((const char *)search.CurrentFilename);
+	ULONG entryLength = offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName) + fileNameLength;
+
+	FileInformation->NextEntryOffset = 0;
+	FileInformation->FileIndex = 0;
+	FileInformation->CreationTime.QuadPart = XisoCreationTime();
+	FileInformation->LastAccessTime.QuadPart = FileInformation->CreationTime.QuadPart;
+	FileInformation->LastWriteTime.QuadPart = FileInformation->CreationTime.QuadPart;
+	FileInformation->ChangeTime.QuadPart = FileInformation->CreationTime.QuadPart;
+	FileInformation->EndOfFile.QuadPart = search.CurrentFileSize;
+	FileInformation->AllocationSize.QuadPart = XisoAllocationSize(search.CurrentFileSize);
+	FileInformation->FileAttributes = XisoFileAttributes(search.CurrentFileAttributes);
+	FileInformation->FileNameLength = fileNameLength;
+
+	// When the name doesn't fit, return what does and leave the entry to be queried again
+	if (Length < entryLength) {
+		memcpy(FileInformation->FileName, search.CurrentFilename, Length - offsetof(xboxkrnl::FILE_DIRECTORY_INFORMATION, FileName));
+		*Information = Length;
+		return STATUS_BUFFER_OVERFLOW;
+	}
+
+	memcpy(FileInformation->FileName, search.CurrentFilename, fileNameLength);
+	File->Position = search.Position;
+	*Information = entryLength;
+
+	return STATUS_SUCCESS;
+}
+
+NtDll::NTSTATUS CxbxXisoQueryInformation(EmuNtXisoFileObject *File, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass, ULONG_PTR *Information)
+{
+	*Information = 0;
+
+	switch (FileInformationClass) {
+	case xboxkrnl::FileBasicInformation: {
+		if (Length < sizeof(xboxkrnl::FILE_BASIC_INFORMATION)) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		xboxkrnl::PFILE_BASIC_INFORMATION info = (xboxkrnl::PFILE_BASIC_INFORMATION)FileInformation;
+		info->CreationTime.QuadPart = XisoCreationTime();
+		info->LastAccessTime.QuadPart = info->CreationTime.QuadPart;
+		info->LastWriteTime.QuadPart = info->CreationTime.QuadPart;
+		info->ChangeTime.QuadPart = info->CreationTime.QuadPart;
+		info->FileAttributes = XisoFileAttributes(File->Attributes);
+		*Information = sizeof(xboxkrnl::FILE_BASIC_INFORMATION);
+		break;
+	}
+	case xboxkrnl::FileStandardInformation: {
+		if (Length < sizeof(xboxkrnl::FILE_STANDARD_INFORMATION)) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		xboxkrnl::PFILE_STANDARD_INFORMATION info = (xboxkrnl::PFILE_STANDARD_INFORMATION)FileInformation;
+		info->AllocationSize.QuadPart = XisoAllocationSize(File->FileSize);
+		info->EndOfFile.QuadPart = File->FileSize;
+		info->NumberOfLinks = 1;
+		info->DeletePending = FALSE;
+		info->Directory = File->IsDirectory;
+		*Information = sizeof(xboxkrnl::FILE_STANDARD_INFORMATION);
+		break;
+	}
+	case xboxkrnl::FilePositionInformation: {
+		if (Length < sizeof(xboxkrnl::FILE_POSITION_INFORMATION)) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		((xboxkrnl::PFILE_POSITION_INFORMATION)FileInformation)->CurrentByteOffset.QuadPart = File->IsDirectory ? 0 : File->Position;
+		*Information = sizeof(xboxkrnl::FILE_POSITION_INFORMATION);
+		break;
+	}
+	case xboxkrnl::FileNetworkOpenInformation: {
+		if (Length < sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION)) {
+			return STATUS_INFO_LENGTH_MISMATCH;
+		}
+
+		std::lock_guard<std::mutex> lock(XisoMtx);
+		XisoFillNetworkOpenInformation(File->FileSize, File->Attributes, (xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION)FileInformation);
+		*Information = sizeof(xboxkrnl::FILE_NETWORK_OPEN_INFORMATION);
+		break;
+	}
+	default:
+		EmuLog(LOG_LEVEL::WARNING, "Unsupported FileInformationClass %d on an XISO file", FileInformationClass);
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+NtDll::NTSTATUS CxbxXisoSetInformation(EmuNtXisoFileObject *File, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass)
+{
+	// Only the file position can change, everything else would modify the (read-only) disc
+	if (FileInformationClass != xboxkrnl::FilePositionInformation) {
+		return STATUS_ACCESS_DENIED;
+	}
+
+	if (Length < sizeof(xboxkrnl::FILE_POSITION_INFORMATION)) {
+		return STATUS_INFO_LENGTH_MISMATCH;
+	}
+
+	LONGLONG position = ((xboxkrnl::PFILE_POSITION_INFORMATION)FileInformation)->CurrentByteOffset.QuadPart;
+	if (position < 0 || position > MAXDWORD) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	std::lock_guard<std::mutex> lock(XisoMtx);
+	File->Position = (DWORD)position;
+
+	return STATUS_SUCCESS;
+}
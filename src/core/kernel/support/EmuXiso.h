@@ -0,0 +1,59 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef EMUXISO_H
+#define EMUXISO_H
+
+#include "EmuFile.h"
+
+// ******************************************************************
+// * A file or directory opened from a mounted XISO image
+// ******************************************************************
+class EmuNtXisoFileObject : public EmuNtObject {
+public:
+	std::string Path; // Relative to the image root, without leading backslash
+	bool IsDirectory;
+	DWORD StartSector;
+	DWORD FileSize;
+	DWORD Attributes;
+	DWORD Position; // Read position for files, enumeration position for directories
+	bool EnumerationStarted;
+};
+
+// Mounts an XISO image as the contents of \Device\CdRom0
+bool CxbxMountXiso(const std::string &IsoPath);
+bool CxbxXisoIsMounted();
+bool CxbxXisoExtractFile(const std::string &XboxPath, const std::string &HostPath);
+
+// Returns the image-relative path when RootDirectory and RelativeHostPath (as produced by
+// CxbxObjectAttributesToNT) point into the mounted image
+bool CxbxXisoResolvePath(HANDLE RootDirectory, const wchar_t *RelativeHostPath, std::string &XisoPath);
+EmuNtXisoFileObject *CxbxXisoFileFromHandle(HANDLE Handle);
+
+NtDll::NTSTATUS CxbxXisoOpenFile(const std::string &XisoPath, ACCESS_MASK DesiredAccess, ULONG CreateDisposition, ULONG CreateOptions, HANDLE *FileHandle, ULONG_PTR *Information);
+NtDll::NTSTATUS CxbxXisoQueryAttributes(const std::string &XisoPath, xboxkrnl::PFILE_NETWORK_OPEN_INFORMATION Attributes);
+NtDll::NTSTATUS CxbxXisoReadFile(EmuNtXisoFileObject *File, PVOID Buffer, ULONG Length, NtDll::PLARGE_INTEGER ByteOffset, ULONG_PTR *Information);
+NtDll::NTSTATUS CxbxXisoQueryDirectory(EmuNtXisoFileObject *File, xboxkrnl::FILE_DIRECTORY_INFORMATION *FileInformation, ULONG Length, const std::string &FileMask, bool RestartScan, ULONG_PTR *Information);
+NtDll::NTSTATUS CxbxXisoQueryInformation(EmuNtXisoFileObject *File, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass, ULONG_PTR *Information);
+NtDll::NTSTATUS CxbxXisoSetInformation(EmuNtXisoFileObject *File, PVOID FileInformation, ULONG Length, xboxkrnl::FILE_INFORMATION_CLASS FileInformationClass);
+
+#endif
@@ -47,8 +47,10 @@ namespace xboxkrnl
 #include "devices\Xbox.h"
 #include "EmuNVNet.h"
 #include <Iphlpapi.h>
-#include <pcap.h>
+#include <atomic>
+#include <chrono>
 #include <exception>
+#include <thread>
 
 #define IOPORT_SIZE 0x8
 #define MMIO_SIZE   0x400
@@ -351,7 +353,7 @@ void EmuNVNet_DMAPacketFromGuest()
 		DBG_PRINTF("Sending packet...\n");
 
 		memcpy(s->txrx_dma_buf, (void*)(desc.packet_buffer | CONTIGUOUS_MEMORY_BASE), desc.length + 1);
-		g_NVNet->PCAPSend(s->txrx_dma_buf, desc.length + 1);
+		g_NVNet->Send(s->txrx_dma_buf, desc.length + 1);
 
 		packet_sent = true;
 
@@ -376,9 +378,18 @@ void EmuNVNet_DMAPacketFromGuest()
 	}
 }
 
-bool EmuNVNet_DMAPacketToGuest(void* packet, size_t size)
+enum NVNetRxStatus {
+	NVNET_RX_RECEIVED,
+	NVNET_RX_RING_FULL, // No available rx descriptor, the frame can be retried once the guest frees one
+	NVNET_RX_DROPPED,   // The frame doesn't fit any available rx descriptor
+};
+
+// Writes a received frame to the next available rx descriptor; raising the interrupt is up to the caller,
+// so that it can happen once for a whole batch of frames
+static NVNetRxStatus EmuNVNet_DMAPacketToGuest(void* packet, size_t size)
 {
 	struct RingDesc desc;
+	bool ring_full = true;
 
 	NvNetState_t* s = &NvNetState;
 
@@ -397,7 +408,12 @@ bool EmuNVNet_DMAPacketToGuest(void* packet, size_t size)
 
 		s->rx_ring_index += 1;
 
-		if (!(desc.flags & NV_RX_AVAIL) || !(desc.length >= size)) {
+		if (!(desc.flags & NV_RX_AVAIL)) {
+			continue;
+		}
+
+		if (!(desc.length >= size)) {
+			ring_full = false;
 			continue;
 		}
 
@@ -412,17 +428,16 @@ bool EmuNVNet_DMAPacketToGuest(void* packet, size_t size)
 		DBG_PRINTF("Updated ring descriptor: ");
 		DBG_PRINTF("Length: 0x%x, ", desc.length);
 		DBG_PRINTF("Flags: 0x%x\n", desc.flags);
+		return NVNET_RX_RECEIVED;
+	}
 
-		/* Trigger interrupt */
-		DBG_PRINTF("Triggering interrupt\n");
-		EmuNVNet_SetRegister(NvRegIrqStatus, NVREG_IRQSTAT_BIT1, 4);
-		EmuNVNet_UpdateIRQ();
-		return true;
+	if (ring_full) {
+		DBG_PRINTF("Could not find free buffer!\n");
+		return NVNET_RX_RING_FULL;
 	}
 
-	/* Could not find free buffer, or packet too large. */
-	DBG_PRINTF("Could not find free buffer!\n");
-	return false;
+	DBG_PRINTF("Packet too large, dropped!\n");
+	return NVNET_RX_DROPPED;
 }
 
 void EmuNVNet_Write(xbaddr addr, uint32_t value, int size)
@@ -477,16 +492,56 @@ void EmuNVNet_Write(xbaddr addr, uint32_t value, int size)
 	DBG_PRINTF("Write%d: %s (0x%.8X) = 0x%.8X\n", size * 8, EmuNVNet_GetRegisterName(addr), addr, value);
 }
 
+// Upper bound of the wait for a first frame; there's no need to wake up before that, it only bounds the
+// time a missed wake up of the backend could take
+#define NVNET_RX_WAIT_MS    100
+// Frames written to the rx ring under a single interrupt at most
+#define NVNET_RX_BATCH_MAX  32
+// Delay before retrying a frame that found the rx ring full; the guest doesn't signal freed descriptors
+#define NVNET_RX_RETRY_MS   1
+
 std::thread NVNetRecvThread;
+std::atomic_bool NVNetRecvThreadRunning{ false };
 static void NVNetRecvThreadProc(NvNetState_t *s)
 {
 	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
 	uint8_t packet[65536];
-	while (true) {
-		int size = g_NVNet->PCAPReceive(packet, 65536);
-		if (size > 0) {
-			EmuNVNet_DMAPacketToGuest(packet, size);
-		}	
+	size_t pending_size = 0; // Size of the frame in packet that is still waiting for a free rx descriptor
+	while (NVNetRecvThreadRunning) {
+		// Sleep until a frame arrives, then also take the ones that are already queued behind it, so that a
+		// burst of frames costs the guest one interrupt instead of one per frame
+		size_t size = pending_size;
+		if (size == 0) {
+			size = g_NVNet->Receive(packet, sizeof(packet), NVNET_RX_WAIT_MS);
+			if (size == 0) {
+				continue;
+			}
+		}
+
+		int batch_count = 0;
+		bool packet_received = false;
+		pending_size = 0;
+		do {
+			NVNetRxStatus status = EmuNVNet_DMAPacketToGuest(packet, size);
+			if (status == NVNET_RX_RING_FULL) {
+				// Keep this frame for a retry, and leave the ones behind it queued in the backend
+				pending_size = size;
+				break;
+			}
+
+			packet_received |= (status == NVNET_RX_RECEIVED);
+		} while (++batch_count < NVNET_RX_BATCH_MAX && (size = g_NVNet->Receive(packet, sizeof(packet), 0)) > 0);
+
+		if (packet_received) {
+			/* Trigger interrupt */
+			DBG_PRINTF("Triggering interrupt\n");
+			EmuNVNet_SetRegister(NvRegIrqStatus, NVREG_IRQSTAT_BIT1, 4);
+			EmuNVNet_UpdateIRQ();
+		}
+
+		if (pending_size != 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(NVNET_RX_RETRY_MS));
+		}
 	}
 }
 
@@ -522,16 +577,45 @@ void NVNetDevice::Init()
 	g_EmuShared->GetNetworkSettings(&networkSettings);
 	m_HostAdapterName = networkSettings.adapter_name;
 
-	// Get Mac Address
-	if (!GetMacAddress(m_HostAdapterName, m_HostMacAddress.bytes)) {
-		EmuLog(LOG_LEVEL::WARNING, "Failed to initialize network adapter.");
-		return;
-	};
+	if (networkSettings.loopback) {
+		// Frames sent by the guest come straight back to it, no host adapter involved
+		m_Backend = std::make_unique<NVNetPipeBackend>();
+	} else {
+		// Get Mac Address
+		if (!GetMacAddress(m_HostAdapterName, m_HostMacAddress.bytes)) {
+			EmuLog(LOG_LEVEL::WARNING, "Failed to initialize network adapter.");
+			return;
+		};
+
+		auto backend = std::make_unique<NVNetPCAPBackend>();
+		std::string error;
+		if (!backend->Open(m_HostAdapterName, m_HostMacAddress.bytes, error)) {
+			EmuLog(LOG_LEVEL::WARNING, "Unable to open Network Adapter:\n%s\nNetworking will be disabled", error.c_str());
+			return;
+		}
+
+		m_Backend = std::move(backend);
+	}
 
-	PCAPInit();
+	NVNetRecvThreadRunning = true;
 	NVNetRecvThread = std::thread(NVNetRecvThreadProc, &NvNetState);
 }
 
+NVNetDevice::~NVNetDevice()
+{
+	Shutdown();
+}
+
+void NVNetDevice::Shutdown()
+{
+	if (NVNetRecvThread.joinable()) {
+		// Closing the backend wakes up a receive thread that waits for a frame
+		NVNetRecvThreadRunning = false;
+		m_Backend->Close();
+		NVNetRecvThread.join();
+	}
+}
+
 void NVNetDevice::Reset()
 {
 }
@@ -610,38 +694,6 @@ void NVNetDevice::MMIOWrite(int barIndex, uint32_t addr, uint32_t value, unsigne
 	}
 }
 
-bool NVNetDevice::PCAPInit()
-{
-	char errorBuffer[PCAP_ERRBUF_SIZE];
-
-	// Open the desired network adapter
-	__try {
-		char buffer[MAX_PATH];
-		snprintf(buffer, MAX_PATH, "\\Device\\NPF_%s", m_HostAdapterName.c_str());
-		m_AdapterHandle = pcap_open_live(buffer,
-			65536,	// Capture entire packet
-			1,		// Use promiscuous mode
-			1,		// Read Timeout
-			errorBuffer
-		);
-	} __except(EXCEPTION_EXECUTE_HANDLER) {
-		m_AdapterHandle = nullptr;
-		snprintf(errorBuffer, PCAP_ERRBUF_SIZE, "Could not initialize pcap");
-	}
-
-	if (m_AdapterHandle == nullptr) {
-		EmuLog(LOG_LEVEL::WARNING, "Unable to open Network Adapter:\n%s\nNetworking will be disabled", errorBuffer);
-		return false;
-	}
-
-	if (pcap_setnonblock((pcap_t*)m_AdapterHandle, 1, errorBuffer) == -1) {
-		EmuLog(LOG_LEVEL::WARNING, "PCAP: Failed to set non-blocking mode");
-	}
-
-	m_PCAPRunning = true;
-	return true;
-}
-
 void PrintRawPayload(void* buffer, size_t length)
 {
 	uint8_t* startAddr = (uint8_t*)buffer;
@@ -675,46 +727,32 @@ void PrintPacket(void* buffer, size_t length)
 	}
 }	
 
-bool NVNetDevice::PCAPSend(void* packet, size_t length)
+bool NVNetDevice::Send(void* packet, size_t length)
 {
-	if (!m_PCAPRunning) {
+	if (!m_Backend) {
 		return false;
 	}
 
-	ethernet_header* header = (ethernet_header*)packet;
-
 	// TODO: Optional
 	// PrintPacket(packet, length);
-	
-	if (memcmp(header->dst.bytes, m_BroadcastMacAddress.bytes, 6) == 0) {
-		static char pack[65536];
-		memcpy(pack, packet, length);
-		header->dst = m_HostMacAddress;
-		pcap_sendpacket((pcap_t*)m_AdapterHandle, (uint8_t*)pack, length);
-	}
 
-	return pcap_sendpacket((pcap_t*)m_AdapterHandle, (uint8_t*)packet, length);
+	return m_Backend->Send(packet, length);
 }
 
-size_t NVNetDevice::PCAPReceive(void* packet, size_t max_length)
+size_t NVNetDevice::Receive(void* packet, size_t max_length, uint32_t timeout_ms)
 {
-	if (!m_PCAPRunning) {
-		return -1;
+	if (!m_Backend) {
+		return 0;
 	}
 
-	struct pcap_pkthdr *header;
-	const uint8_t *pkt_data;
-
-	if (int res = pcap_next_ex((pcap_t*)m_AdapterHandle, &header, &pkt_data) > 0) {
+	size_t length;
+	while ((length = m_Backend->Receive(packet, max_length, timeout_ms)) > 0) {
 		// Only forward packets that are multicast or specifically for Cxbx-R's MAC
-		ethernet_header* e_header = (ethernet_header*)pkt_data;
-		if (memcmp(e_header->dst.bytes, m_GuestMacAddress.bytes, 6) != 0 && memcmp(e_header->dst.bytes, m_BroadcastMacAddress.bytes, 6) != 0) {
-			return -1;
+		ethernet_header* e_header = (ethernet_header*)packet;
+		if (memcmp(e_header->dst.bytes, m_GuestMacAddress.bytes, 6) == 0 || memcmp(e_header->dst.bytes, m_BroadcastMacAddress.bytes, 6) == 0) {
+			break;
 		}
-
-		memcpy(packet, pkt_data, header->len);
-		return header->len;
 	}
 
-	return -1;
+	return length;
 }
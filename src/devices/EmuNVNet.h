@@ -25,6 +25,7 @@
 #pragma once
 
 #include "PCIDevice.h" // For PCIDevice
+#include "EmuNVNetBackend.h"
 
 // NVNET Register Definitions
 // Taken from XQEMU
@@ -205,6 +206,8 @@ typedef struct _ip_header {
 
 class NVNetDevice : public PCIDevice {
 public:
+	~NVNetDevice();
+
 	// PCI Device functions
 	void Init();
 	void Reset();
@@ -214,16 +217,16 @@ public:
 	void MMIOWrite(int barIndex, uint32_t addr, uint32_t value, unsigned size);
 
 	void SetGuestMacAddress(mac_address* mac);
+	// Stops the receive thread and closes the backend, after which nothing is sent nor received anymore
+	void Shutdown();
 
-	__declspec(noinline) bool PCAPSend(void* packet, size_t length);
-	size_t PCAPReceive(void* packet, size_t max_length);
+	__declspec(noinline) bool Send(void* packet, size_t length);
+	// Returns the next frame addressed to the guest (see NVNetBackend::Receive), 0 if there's none
+	size_t Receive(void* packet, size_t max_length, uint32_t timeout_ms);
 private:
-	bool PCAPInit();
 	bool GetMacAddress(std::string adapterName, void* pMAC);
 
-	bool m_PCAPRunning = false;
-
-	void* m_AdapterHandle = nullptr;
+	std::unique_ptr<NVNetBackend> m_Backend;
 	std::string m_HostAdapterName;
 	mac_address m_HostMacAddress;
 	mac_address m_GuestMacAddress = { 0x00, 0x50, 0xF2, 0x00, 0x00, 0x34 };
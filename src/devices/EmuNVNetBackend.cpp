@@ -0,0 +1,141 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <WinSock2.h>
+#include <pcap.h>
+#include <chrono>
+#include <cstring>
+#include "EmuNVNetBackend.h"
+
+static const uint8_t BroadcastMacAddress[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+/* NVNetPCAPBackend */
+
+NVNetPCAPBackend::~NVNetPCAPBackend()
+{
+	if (m_AdapterHandle != nullptr) {
+		pcap_close((pcap_t*)m_AdapterHandle);
+	}
+
+	if (m_CloseEvent != nullptr) {
+		CloseHandle(m_CloseEvent);
+	}
+}
+
+bool NVNetPCAPBackend::Open(const std::string& adapterName, const uint8_t hostMacAddress[6], std::string& error)
+{
+	char errorBuffer[PCAP_ERRBUF_SIZE];
+
+	memcpy(m_HostMacAddress, hostMacAddress, sizeof(m_HostMacAddress));
+
+	// Open the desired network adapter
+	__try {
+		char buffer[MAX_PATH];
+		snprintf(buffer, MAX_PATH, "\\Device\\NPF_%s", adapterName.c_str());
+		m_AdapterHandle = pcap_open_live(buffer,
+			65536,	// Capture entire packet
+			1,		// Use promiscuous mode
+			1,		// Read Timeout
+			errorBuffer
+		);
+	} __except(EXCEPTION_EXECUTE_HANDLER) {
+		m_AdapterHandle = nullptr;
+		snprintf(errorBuffer, PCAP_ERRBUF_SIZE, "Could not initialize pcap");
+	}
+
+	if (m_AdapterHandle == nullptr) {
+		error = errorBuffer;
+		return false;
+	}
+
+	// Frames are read without blocking, waiting happens on the read event of the driver instead, which
+	// is signaled as soon as any frame is buffered (rather than after the default 16KB have piled up)
+	if (pcap_setnonblock((pcap_t*)m_AdapterHandle, 1, errorBuffer) == -1) {
+		error = errorBuffer;
+		return false;
+	}
+
+	pcap_setmintocopy((pcap_t*)m_AdapterHandle, 0);
+	m_ReadEvent = pcap_getevent((pcap_t*)m_AdapterHandle);
+	m_CloseEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (m_ReadEvent == nullptr || m_CloseEvent == nullptr) {
+		error = "Could not create the read event";
+		return false;
+	}
+
+	return true;
+}
+
+bool NVNetPCAPBackend::Send(const void* packet, size_t length)
+{
+	if (m_AdapterHandle == nullptr) {
+		return false;
+	}
+
+	bool sent = pcap_sendpacket((pcap_t*)m_AdapterHandle, (const uint8_t*)packet, (int)length) == 0;
+
+	// Broadcasts are also sent to the host adapter itself, which wouldn't see them otherwise
+	if (memcmp(packet, BroadcastMacAddress, 6) == 0) {
+		static uint8_t pack[65536];
+		memcpy(pack, packet, length);
+		memcpy(pack, m_HostMacAddress, 6);
+		pcap_sendpacket((pcap_t*)m_AdapterHandle, pack, (int)length);
+	}
+
+	return sent;
+}
+
+size_t NVNetPCAPBackend::Receive(void* packet, size_t max_length, uint32_t timeout_ms)
+{
+	if (m_AdapterHandle == nullptr) {
+		return 0;
+	}
+
+	struct pcap_pkthdr *header;
+	const uint8_t *pkt_data;
+	HANDLE events[] = { m_ReadEvent, m_CloseEvent };
+
+	while (WaitForSingleObject(m_CloseEvent, 0) != WAIT_OBJECT_0) {
+		if (pcap_next_ex((pcap_t*)m_AdapterHandle, &header, &pkt_data) > 0) {
+			size_t length = header->caplen < max_length ? header->caplen : max_length;
+			memcpy(packet, pkt_data, length);
+			return length;
+		}
+
+		// Nothing buffered : wait for the driver to signal new frames (or for Close)
+		if (timeout_ms == 0 || WaitForMultipleObjects(2, events, FALSE, timeout_ms) != WAIT_OBJECT_0) {
+			break;
+		}
+	}
+
+	return 0;
+}
+
+void NVNetPCAPBackend::Close()
+{
+	if (m_CloseEvent != nullptr) {
+		SetEvent(m_CloseEvent);
+	}
+}
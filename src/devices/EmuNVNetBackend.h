@@ -0,0 +1,88 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Host side of the emulated network adapter : frames sent by the guest are handed to a backend,
+// and the NVNet receive thread waits on the backend for incoming frames.
+class NVNetBackend {
+public:
+	virtual ~NVNetBackend() {}
+
+	virtual bool Send(const void* packet, size_t length) = 0;
+	// Returns the size of the next received frame, or 0 when none arrived within timeout_ms (0 only polls)
+	virtual size_t Receive(void* packet, size_t max_length, uint32_t timeout_ms) = 0;
+	// Wakes up a waiting Receive, after which nothing is received anymore
+	virtual void Close() = 0;
+};
+
+// Bridges to a host network adapter through WinPcap
+class NVNetPCAPBackend : public NVNetBackend {
+public:
+	~NVNetPCAPBackend();
+	bool Open(const std::string& adapterName, const uint8_t hostMacAddress[6], std::string& error);
+
+	bool Send(const void* packet, size_t length) override;
+	size_t Receive(void* packet, size_t max_length, uint32_t timeout_ms) override;
+	void Close() override;
+
+private:
+	void* m_AdapterHandle = nullptr;
+	void* m_ReadEvent = nullptr; // Owned by pcap, signaled when the driver has buffered frames
+	void* m_CloseEvent = nullptr;
+	uint8_t m_HostMacAddress[6];
+};
+
+// In-process link without any host networking : what one endpoint sends, its peer receives.
+// An endpoint that isn't linked to another one is a loopback. A linked pair lets a test rig drive
+// system link traffic into the receive path (or measure its throughput) without pcap nor Windows.
+class NVNetPipeBackend : public NVNetBackend {
+public:
+	NVNetPipeBackend();
+	~NVNetPipeBackend();
+	// Must happen before either endpoint is used
+	static void Link(NVNetPipeBackend& a, NVNetPipeBackend& b);
+
+	bool Send(const void* packet, size_t length) override;
+	size_t Receive(void* packet, size_t max_length, uint32_t timeout_ms) override;
+	void Close() override;
+
+private:
+	struct FrameQueue {
+		std::mutex Mutex;
+		std::condition_variable FrameReady;
+		std::deque<std::vector<uint8_t>> Frames;
+		std::vector<std::vector<uint8_t>> FreeFrames; // Recycled, so a warmed up link doesn't allocate
+		bool Closed = false;
+	};
+
+	std::shared_ptr<FrameQueue> m_RxQueue;
+	std::shared_ptr<FrameQueue> m_PeerRxQueue;
+};
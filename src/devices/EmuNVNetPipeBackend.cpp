@@ -0,0 +1,120 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <chrono>
+#include <cstring>
+#include "EmuNVNetBackend.h"
+
+// Frames the receiving pipe endpoint can have queued, beyond that they're dropped like a real link would
+#define NVNET_PIPE_QUEUE_MAX 512
+
+/* NVNetPipeBackend */
+
+NVNetPipeBackend::NVNetPipeBackend()
+{
+	m_RxQueue = std::make_shared<FrameQueue>();
+	m_PeerRxQueue = m_RxQueue;
+}
+
+NVNetPipeBackend::~NVNetPipeBackend()
+{
+	Close();
+}
+
+void NVNetPipeBackend::Link(NVNetPipeBackend& a, NVNetPipeBackend& b)
+{
+	a.m_PeerRxQueue = b.m_RxQueue;
+	b.m_PeerRxQueue = a.m_RxQueue;
+}
+
+bool NVNetPipeBackend::Send(const void* packet, size_t length)
+{
+	FrameQueue& queue = *m_PeerRxQueue;
+
+	std::unique_lock<std::mutex> lock(queue.Mutex);
+	if (queue.Closed) {
+		return false;
+	}
+
+	if (queue.Frames.size() >= NVNET_PIPE_QUEUE_MAX) {
+		// The receiver doesn't keep up
+		return true;
+	}
+
+	std::vector<uint8_t> frame;
+	if (!queue.FreeFrames.empty()) {
+		frame = std::move(queue.FreeFrames.back());
+		queue.FreeFrames.pop_back();
+	}
+
+	frame.assign((const uint8_t*)packet, (const uint8_t*)packet + length);
+	queue.Frames.push_back(std::move(frame));
+
+	// Only the first frame of a burst needs to wake up the receiver, it drains the rest by itself
+	bool wake = queue.Frames.size() == 1;
+	lock.unlock();
+	if (wake) {
+		queue.FrameReady.notify_one();
+	}
+
+	return true;
+}
+
+size_t NVNetPipeBackend::Receive(void* packet, size_t max_length, uint32_t timeout_ms)
+{
+	FrameQueue& queue = *m_RxQueue;
+
+	std::unique_lock<std::mutex> lock(queue.Mutex);
+	if (queue.Frames.empty() && timeout_ms > 0) {
+		queue.FrameReady.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&queue] {
+			return !queue.Frames.empty() || queue.Closed;
+		});
+	}
+
+	if (queue.Frames.empty() || queue.Closed) {
+		return 0;
+	}
+
+	std::vector<uint8_t> frame = std::move(queue.Frames.front());
+	queue.Frames.pop_front();
+
+	size_t length = frame.size() < max_length ? frame.size() : max_length;
+	memcpy(packet, frame.data(), length);
+	queue.FreeFrames.push_back(std::move(frame));
+
+	return length;
+}
+
+void NVNetPipeBackend::Close()
+{
+	FrameQueue& queue = *m_RxQueue;
+
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Closed = true;
+	}
+
+	queue.FrameReady.notify_all();
+}
@@ -880,7 +880,8 @@ void OHCI::OHCI_StateReset()
 void OHCI::OHCI_BusStart()
 {
 	// Create the EOF timer.
-	m_pEOFtimer = Timer_Create(OHCI_FrameBoundaryWrapper, this, "", nullptr);
+	// The frame boundary is due every 1 ms, so don't let it wait behind the other timers
+	m_pEOFtimer = Timer_Create(OHCI_FrameBoundaryWrapper, this, "Cxbx OHCI EOF", nullptr, true);
 
 	DBG_PRINTF("Operational event\n");
 
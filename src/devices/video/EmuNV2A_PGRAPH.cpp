@@ -425,20 +425,20 @@ static unsigned int pgraph_bind_inline_array(NV2AState *d);
 static float convert_f16_to_float(uint16_t f16);
 static float convert_f24_to_float(uint32_t f24);
 static uint8_t* convert_texture_data(const unsigned int color_format, const uint8_t *data, const uint8_t *palette_data, const unsigned int width, const unsigned int height, const unsigned int depth, const unsigned int row_pitch, const unsigned int slice_pitch);
-static int upload_gl_texture(GLenum gl_target, const TextureShape s, const uint8_t *texture_data, const uint8_t *palette_data);
-static TextureBinding* generate_texture(const TextureShape s, const uint8_t *texture_data, const uint8_t *palette_data);
-static guint texture_key_hash(gconstpointer key);
-static gboolean texture_key_equal(gconstpointer a, gconstpointer b);
-static gpointer texture_key_retrieve(gpointer key, gpointer user_data, GError **error);
-static void texture_key_destroy(gpointer data);
-static void texture_binding_destroy(gpointer data);
+static int upload_gl_texture(PGRAPHState *pg, GLenum gl_target, const TextureShape s, const uint8_t *texture_data, const uint8_t *palette_data, uint64_t palette_hash, const uint64_t *level_hashes, size_t *uploaded_size);
+static TextureBinding* generate_texture(PGRAPHState *pg, const TextureShape s, const uint8_t *texture_data, const uint8_t *palette_data, uint64_t palette_hash, const uint64_t *level_hashes);
+#ifdef USE_TEXTURE_CACHE
+static unsigned int hash_texture_levels(const TextureShape &s, const uint8_t *texture_data, uint64_t palette_hash, uint64_t *level_hashes);
+#endif
+static size_t texture_key_hash(const TextureKey *key);
+static bool texture_key_equal(const TextureKey *a, const TextureKey *b);
+static TextureBinding* texture_key_retrieve(const TextureKey *key);
+static void texture_binding_destroy(TextureBinding *binding);
 static guint shader_hash(gconstpointer key);
 static gboolean shader_equal(gconstpointer a, gconstpointer b);
 static unsigned int kelvin_map_stencil_op(uint32_t parameter);
 static unsigned int kelvin_map_polygon_mode(uint32_t parameter);
 static unsigned int kelvin_map_texgen(uint32_t parameter, unsigned int channel);
-static uint64_t fnv_hash(const uint8_t *data, size_t len);
-static uint64_t fast_hash(const uint8_t *data, size_t len, unsigned int samples);
 
 /* PGRAPH - accelerated 2d/3d drawing engine */
 DEVICE_READ32(PGRAPH)
@@ -2944,23 +2944,18 @@ void pgraph_init(NV2AState *d)
     //glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
 
 #ifdef USE_TEXTURE_CACHE
-    pg->texture_cache = g_lru_cache_new_full(
-        0,
-        NULL,
-        texture_key_destroy,
-        0,
-        NULL,
-        texture_binding_destroy,
+    pg->texture_cache = new TextureCache(
         texture_key_hash,
         texture_key_equal,
         texture_key_retrieve,
-        NULL,
-        NULL
+        texture_binding_destroy,
+        pg,
+        TEXTURE_CACHE_DEFAULT_BUDGET
         );
-
-    g_lru_cache_set_max_size(pg->texture_cache, 512);
 #endif
 
+    pg->texel_store = new TexelStore(TEXEL_STORE_DEFAULT_BUDGET);
+
 #ifdef USE_SHADER_CACHE
     pg->shader_cache = g_hash_table_new(shader_hash, shader_equal);
 #endif
@@ -3007,7 +3002,12 @@ void pgraph_destroy(PGRAPHState *pg)
 		glDeleteFramebuffers(1, &pg->gl_framebuffer);
 
 		// TODO: clear out shader cached
-		// TODO: clear out texture cache
+#ifdef USE_TEXTURE_CACHE
+		delete pg->texture_cache;
+		pg->texture_cache = nullptr;
+#endif
+		delete pg->texel_store;
+		pg->texel_store = nullptr;
 
 		glo_set_current(NULL);
 
@@ -4002,49 +4002,8 @@ static void pgraph_bind_textures(NV2AState *d)
 
         NV2A_DPRINTF(" - 0x%tx\n", texture_data - d->vram_ptr);
 
-        size_t length = 0;
-        if (f.encoding == linear) {
-            assert(cubemap == false);
-            assert(dimensionality == 2);
-            length = height * pitch;
-        } else {
-            if (dimensionality >= 2) {
-                unsigned int w = width, h = height;
-                unsigned int level;
-                if (f.encoding == swizzled) {
-                    for (level = 0; level < levels; level++) {
-                        w = MAX(w, 1); h = MAX(h, 1);
-                        length += w * h * f.bytes_per_pixel;
-                        w /= 2;
-                        h /= 2;
-                    }
-                } else {
-                    /* Compressed textures are a bit different */
-                    unsigned int block_size;
-                    if (f.gl_internal_format ==
-                            GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
-                        block_size = 8;
-                    } else {
-                        block_size = 16;
-                    }
-
-                    for (level = 0; level < levels; level++) {
-                        w = MAX(w, 4); h = MAX(h, 4);
-                        length += w/4 * h/4 * block_size;
-                        w /= 2; h /= 2;
-                    }
-                }
-                if (cubemap) {
-                    assert(dimensionality == 2);
-                    length *= 6;
-                }
-                if (dimensionality >= 3) {
-                    length *= depth;
-                }
-            }
-        }
-
 		TextureShape state;
+		memset(&state, 0, sizeof(TextureShape)); // clear padding, since the texture cache hashes and compares the raw bytes
 		state.cubemap = cubemap;
 		state.dimensionality = dimensionality;
 		state.color_format = color_format;
@@ -4056,24 +4015,28 @@ static void pgraph_bind_textures(NV2AState *d)
 		state.max_mipmap_level = max_mipmap_level;
         state.pitch = pitch;
 
+		uint64_t palette_hash = ComputeHash(palette_data, palette_length);
+
 #ifdef USE_TEXTURE_CACHE
+		// Every texel byte is hashed (a sampled hash would miss changes in the bytes it skips and hand out a stale texture),
+		// but only once : the key folds the per level hashes, which a miss hands on to the texel store lookups
+		uint64_t level_hashes[6 * NV2A_MAX_TEXTURE_LEVELS];
+		unsigned int level_count = hash_texture_levels(state, texture_data, palette_hash, level_hashes);
+
 		TextureKey key;
 		key.state = state;
-		key.data_hash = fast_hash(texture_data, length, 5003)
-			^ fnv_hash(palette_data, palette_length);
+		key.data_hash = ComputeHash(level_hashes, level_count * sizeof(uint64_t));
+		key.palette_hash = palette_hash;
 		key.texture_data = texture_data;
 		key.palette_data = palette_data;
+		key.level_hashes = level_hashes;
 
-        gpointer cache_key = g_malloc(sizeof(TextureKey));
-        memcpy(cache_key, &key, sizeof(TextureKey));
-
-        GError *err;
-        TextureBinding *binding = (TextureBinding *)g_lru_cache_get(pg->texture_cache, cache_key, &err);
+        TextureBinding *binding = pg->texture_cache->Get(&key);
         assert(binding);
         binding->refcnt++;
 #else
-        TextureBinding *binding = generate_texture(state,
-                                                   texture_data, palette_data);
+        TextureBinding *binding = generate_texture(pg, state,
+                                                   texture_data, palette_data, palette_hash, NULL);
 #endif
 
         glBindTexture(binding->gl_target, binding->gl_texture);
@@ -4451,11 +4414,111 @@ static uint8_t* convert_texture_data(const unsigned int color_format,
     }
 }
 
+/* returns whether convert_texture_data() converts texels of the given format, keep both in sync */
+static bool texture_format_is_converted(const unsigned int color_format)
+{
+	switch (color_format) {
+	case NV097_SET_TEXTURE_FORMAT_COLOR_SZ_I8_A8R8G8B8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_CR8YB8CB8YA8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LC_IMAGE_YB8CR8YA8CB8:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_SZ_R6G5B5:
+	case NV097_SET_TEXTURE_FORMAT_COLOR_LU_IMAGE_R6G5B5:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* returns the unswizzled and converted texel data for one texture level, taking it from
+ * the texel store when a level with the same content, shape and format was converted before.
+ * The result is either texture_data itself (when no conversion is needed), or owned by the store.
+ * level_hash is the hash of the level from hash_texture_levels(), or NULL to hash it here.
+ * resulting_format receives the format of the returned data - see converted_format */
+static const uint8_t* convert_texture_level(PGRAPHState *pg,
+                                            const TextureShape &s,
+                                            const uint8_t *texture_data,
+                                            const uint8_t *palette_data,
+                                            uint64_t palette_hash,
+                                            const uint64_t *level_hash,
+                                            unsigned int width,
+                                            unsigned int height,
+                                            unsigned int depth,
+                                            unsigned int row_pitch,
+                                            unsigned int slice_pitch,
+                                            int *resulting_format)
+{
+    ColorFormatInfo f = kelvin_color_format_map[s.color_format];
+
+    if (f.encoding != swizzled && !texture_format_is_converted(s.color_format)) {
+        /* linear data in a native format is uploaded as-is, so there's nothing to hash, look up nor store */
+        *resulting_format = s.color_format;
+        return texture_data;
+    }
+
+    size_t length = slice_pitch ? slice_pitch * depth : row_pitch * height;
+
+    TexelKey key;
+    memset(&key, 0, sizeof(TexelKey));
+    key.data_hash = level_hash ? *level_hash : ComputeHash(texture_data, length) ^ palette_hash;
+    key.color_format = s.color_format;
+    key.width = width;
+    key.height = height;
+    key.depth = depth;
+    key.row_pitch = row_pitch;
+    key.slice_pitch = slice_pitch;
+
+    const uint8_t *stored = pg->texel_store->Find(&key, resulting_format);
+    if (stored) {
+        return stored;
+    }
+
+    uint8_t *unswizzled = NULL;
+    if (f.encoding == swizzled) {
+        unswizzled = (uint8_t*)g_malloc(length);
+        if (slice_pitch) {
+            unswizzle_box(texture_data, width, height, depth, unswizzled,
+                          row_pitch, slice_pitch, f.bytes_per_pixel);
+        } else {
+            unswizzle_rect(texture_data, width, height,
+                           unswizzled, row_pitch, f.bytes_per_pixel);
+        }
+    }
+
+    uint8_t *converted = convert_texture_data(s.color_format, unswizzled ? unswizzled : texture_data,
+                                              palette_data,
+                                              width, height, depth,
+                                              row_pitch, slice_pitch);
+
+    if (converted) {
+        if (unswizzled) {
+            g_free(unswizzled);
+        }
+
+        *resulting_format = converted_format;
+        ColorFormatInfo cf = kelvin_color_format_map[converted_format];
+        return pg->texel_store->Insert(&key, converted,
+                                       width * height * depth * cf.bytes_per_pixel, converted_format);
+    }
+
+    *resulting_format = s.color_format;
+    if (unswizzled) {
+        return pg->texel_store->Insert(&key, unswizzled, length, s.color_format);
+    }
+
+    return texture_data;
+}
+
 /* returns the format of the output, either identical to the input format, or the converted format - see converted_format */
-static int upload_gl_texture(GLenum gl_target,
+/* adds the amount of texel bytes handed to OpenGL to uploaded_size */
+/* level_hashes holds one hash per level (see hash_texture_levels), or is NULL */
+static int upload_gl_texture(PGRAPHState *pg,
+                              GLenum gl_target,
                               const TextureShape s,
                               const uint8_t *texture_data,
-                              const uint8_t *palette_data)
+                              const uint8_t *palette_data,
+                              uint64_t palette_hash,
+                              const uint64_t *level_hashes,
+                              size_t *uploaded_size)
 {
 	//assert(pg->opengl_enabled);
     int resulting_format = s.color_format;
@@ -4471,30 +4534,18 @@ static int upload_gl_texture(GLenum gl_target,
         glPixelStorei(GL_UNPACK_ROW_LENGTH,
                       s.pitch / f.bytes_per_pixel);
 
-		uint8_t *unswizzled = NULL;
-        if (f.encoding == swizzled) { // TODO : Verify this works correctly
-            unswizzled = (uint8_t*)g_malloc(s.height * s.pitch);
-            unswizzle_rect(texture_data, s.width, s.height,
-                            unswizzled, s.pitch, f.bytes_per_pixel);
-        }
-        uint8_t *converted = convert_texture_data(s.color_format, unswizzled ? unswizzled : texture_data,
-                                                  palette_data,
-                                                  s.width, s.height, 1,
-                                                  s.pitch, 0);
+        const uint8_t *level_data = convert_texture_level(pg, s, texture_data,
+                                                          palette_data, palette_hash,
+                                                          level_hashes,
+                                                          s.width, s.height, 1,
+                                                          s.pitch, 0, &resulting_format);
 
-        resulting_format = converted ? converted_format : s.color_format;
         ColorFormatInfo cf = kelvin_color_format_map[resulting_format];
         glTexImage2D(gl_target, 0, cf.gl_internal_format,
                      s.width, s.height, 0,
                      cf.gl_format, cf.gl_type,
-                     converted ? converted : unswizzled ? unswizzled : texture_data);
-
-        if (converted) {
-          g_free(converted);
-        }
-		if (unswizzled) {
-			g_free(unswizzled);
-        }
+                     level_data);
+        *uploaded_size += s.width * s.height * cf.bytes_per_pixel;
 
         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
         break;
@@ -4526,6 +4577,7 @@ static int upload_gl_texture(GLenum gl_target,
                                        width, height, 0,
                                        width/4 * height/4 * block_size,
                                        texture_data);
+                *uploaded_size += width/4 * height/4 * block_size;
 
                 texture_data += width/4 * height/4 * block_size;
             } else {
@@ -4533,31 +4585,18 @@ static int upload_gl_texture(GLenum gl_target,
                 width = MAX(width, 1); height = MAX(height, 1);
 
                 unsigned int pitch = width * f.bytes_per_pixel;
-                uint8_t *unswizzled = NULL;
-                if (f.encoding == swizzled) {
-                    unswizzled = (uint8_t*)g_malloc(height * pitch);
-                    unswizzle_rect(texture_data, width, height,
-                                   unswizzled, pitch, f.bytes_per_pixel);
-                }
-
-                uint8_t *converted = convert_texture_data(s.color_format, unswizzled ? unswizzled : texture_data,
-                                                          palette_data,
-                                                          width, height, 1,
-                                                          pitch, 0);
+                const uint8_t *level_data = convert_texture_level(pg, s, texture_data,
+                                                                  palette_data, palette_hash,
+                                                                  level_hashes ? &level_hashes[level] : NULL,
+                                                                  width, height, 1,
+                                                                  pitch, 0, &resulting_format);
 
-                resulting_format = converted ? converted_format : s.color_format;
                 ColorFormatInfo cf = kelvin_color_format_map[resulting_format];
                 glTexImage2D(gl_target, level, cf.gl_internal_format,
                              width, height, 0,
                              cf.gl_format, cf.gl_type,
-                             converted ? converted : unswizzled ? unswizzled : texture_data);
-
-                if (converted) {
-                    g_free(converted);
-                }
-                if (unswizzled) {
-                    g_free(unswizzled);
-                }
+                             level_data);
+                *uploaded_size += width * height * cf.bytes_per_pixel;
 
                 texture_data += pitch * height;
             }
@@ -4577,30 +4616,18 @@ static int upload_gl_texture(GLenum gl_target,
 
             unsigned int row_pitch = width * f.bytes_per_pixel;
             unsigned int slice_pitch = row_pitch * height;
-            uint8_t *unswizzled = NULL;
-            if (f.encoding == swizzled) {
-                unswizzled = (uint8_t*)g_malloc(slice_pitch * depth);
-                unswizzle_box(texture_data, width, height, depth, unswizzled,
-                               row_pitch, slice_pitch, f.bytes_per_pixel);
-            }
-            uint8_t *converted = convert_texture_data(s.color_format, unswizzled ? unswizzled : texture_data,
-                                                      palette_data,
-                                                      width, height, depth,
-                                                      row_pitch, slice_pitch);
+            const uint8_t *level_data = convert_texture_level(pg, s, texture_data,
+                                                              palette_data, palette_hash,
+                                                              level_hashes ? &level_hashes[level] : NULL,
+                                                              width, height, depth,
+                                                              row_pitch, slice_pitch, &resulting_format);
 
-            resulting_format = converted ? converted_format : s.color_format;
             ColorFormatInfo cf = kelvin_color_format_map[resulting_format];
             glTexImage3D(gl_target, level, cf.gl_internal_format,
                          width, height, depth, 0,
                          cf.gl_format, cf.gl_type,
-                         converted ? converted : unswizzled ? unswizzled : texture_data);
-
-            if (converted) {
-                g_free(converted);
-            }
-            if (unswizzled) {
-                g_free(unswizzled);
-            }
+                         level_data);
+            *uploaded_size += width * height * depth * cf.bytes_per_pixel;
 
             texture_data += width * height * depth * f.bytes_per_pixel;
 
@@ -4617,9 +4644,12 @@ static int upload_gl_texture(GLenum gl_target,
 	return resulting_format;
 }
 
-static TextureBinding* generate_texture(const TextureShape s,
+static TextureBinding* generate_texture(PGRAPHState *pg,
+                                        const TextureShape s,
                                         const uint8_t *texture_data,
-                                        const uint8_t *palette_data)
+                                        const uint8_t *palette_data,
+                                        uint64_t palette_hash,
+                                        const uint64_t *level_hashes)
 {
 	// assert(pg->opengl_enabled);
 
@@ -4680,6 +4710,7 @@ static TextureBinding* generate_texture(const TextureShape s,
                          f.gl_swizzle_mask);
     }
 
+    size_t data_size = 0;
     if (gl_target == GL_TEXTURE_CUBE_MAP) {
 
         size_t length = 0;
@@ -4692,63 +4723,116 @@ static TextureBinding* generate_texture(const TextureShape s,
             h /= 2;
         }
 
-        upload_gl_texture(GL_TEXTURE_CUBE_MAP_POSITIVE_X,
-                          s, texture_data + 0 * length, palette_data);
-        upload_gl_texture(GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
-                          s, texture_data + 1 * length, palette_data);
-        upload_gl_texture(GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
-                          s, texture_data + 2 * length, palette_data);
-        upload_gl_texture(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
-                          s, texture_data + 3 * length, palette_data);
-        upload_gl_texture(GL_TEXTURE_CUBE_MAP_POSITIVE_Z,
-                          s, texture_data + 4 * length, palette_data);
-        upload_gl_texture(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z,
-                          s, texture_data + 5 * length, palette_data);
+        upload_gl_texture(pg, GL_TEXTURE_CUBE_MAP_POSITIVE_X,
+                          s, texture_data + 0 * length, palette_data, palette_hash,
+                          level_hashes ? level_hashes + 0 * s.levels : NULL, &data_size);
+        upload_gl_texture(pg, GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
+                          s, texture_data + 1 * length, palette_data, palette_hash,
+                          level_hashes ? level_hashes + 1 * s.levels : NULL, &data_size);
+        upload_gl_texture(pg, GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
+                          s, texture_data + 2 * length, palette_data, palette_hash,
+                          level_hashes ? level_hashes + 2 * s.levels : NULL, &data_size);
+        upload_gl_texture(pg, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
+                          s, texture_data + 3 * length, palette_data, palette_hash,
+                          level_hashes ? level_hashes + 3 * s.levels : NULL, &data_size);
+        upload_gl_texture(pg, GL_TEXTURE_CUBE_MAP_POSITIVE_Z,
+                          s, texture_data + 4 * length, palette_data, palette_hash,
+                          level_hashes ? level_hashes + 4 * s.levels : NULL, &data_size);
+        upload_gl_texture(pg, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z,
+                          s, texture_data + 5 * length, palette_data, palette_hash,
+                          level_hashes ? level_hashes + 5 * s.levels : NULL, &data_size);
     } else {
-        upload_gl_texture(gl_target, s, texture_data, palette_data);
+        upload_gl_texture(pg, gl_target, s, texture_data, palette_data, palette_hash, level_hashes, &data_size);
     }
 
     TextureBinding* ret = (TextureBinding *)g_malloc(sizeof(TextureBinding));
     ret->gl_target = gl_target;
     ret->gl_texture = gl_texture;
     ret->refcnt = 1;
+    ret->data_size = data_size;
     return ret;
 }
 
-// NOTE: Might want to change guint to guint64 for return.
-/* functions for texture LRU cache */
-static guint texture_key_hash(gconstpointer key)
+#ifdef USE_TEXTURE_CACHE
+/* hashes the texel data of each level (of each cubemap face) with the lengths and in the order that upload_gl_texture()
+ * walks them, so that the texture cache key and the texel store lookups share a single pass over the data.
+ * returns the number of hashes written to level_hashes */
+static unsigned int hash_texture_levels(const TextureShape &s,
+                                        const uint8_t *texture_data,
+                                        uint64_t palette_hash,
+                                        uint64_t *level_hashes)
 {
-    const TextureKey *k = (const TextureKey *)key;
-    uint64_t state_hash = fnv_hash(
-        (const uint8_t*)&k->state, sizeof(TextureShape));
-    return guint(state_hash ^ k->data_hash);
+    ColorFormatInfo f = kelvin_color_format_map[s.color_format];
+
+    if (f.encoding == linear) {
+        level_hashes[0] = ComputeHash(texture_data, s.pitch * s.height) ^ palette_hash;
+        return 1;
+    }
+
+    assert(s.levels <= NV2A_MAX_TEXTURE_LEVELS);
+
+    /* cubemap faces follow each other, see generate_texture() */
+    size_t face_length = 0;
+    unsigned int w = s.width, h = s.height;
+    unsigned int level;
+    for (level = 0; level < s.levels; level++) {
+        face_length += w * h * f.bytes_per_pixel;
+        w /= 2;
+        h /= 2;
+    }
+
+    unsigned int faces = s.cubemap ? 6 : 1;
+    unsigned int face;
+    for (face = 0; face < faces; face++) {
+        const uint8_t *data = texture_data + face * face_length;
+        unsigned int width = s.width, height = s.height, depth = s.depth;
+        for (level = 0; level < s.levels; level++) {
+            size_t length;
+            if (s.dimensionality == 3) {
+                length = width * height * depth * f.bytes_per_pixel;
+                depth /= 2;
+            } else if (f.encoding == compressed) {
+                width = MAX(width, 4); height = MAX(height, 4);
+                unsigned int block_size = (f.gl_internal_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+                length = width/4 * height/4 * block_size;
+            } else {
+                width = MAX(width, 1); height = MAX(height, 1);
+                length = width * height * f.bytes_per_pixel;
+            }
+
+            *level_hashes++ = ComputeHash(data, length) ^ palette_hash;
+            data += length;
+            width /= 2;
+            height /= 2;
+        }
+    }
+
+    return faces * s.levels;
 }
-static gboolean texture_key_equal(gconstpointer a, gconstpointer b)
+#endif
+
+/* functions for texture LRU cache */
+static size_t texture_key_hash(const TextureKey *key)
 {
-    const TextureKey *ak = (const TextureKey *)a, *bk = (const TextureKey *)b;
-    return memcmp(&ak->state, &bk->state, sizeof(TextureShape)) == 0
-            && ak->data_hash == bk->data_hash;
+    uint64_t state_hash = ComputeHash(&key->state, sizeof(TextureShape));
+    return size_t(state_hash ^ key->data_hash);
 }
-static gpointer texture_key_retrieve(gpointer key, gpointer user_data, GError **error)
+static bool texture_key_equal(const TextureKey *a, const TextureKey *b)
 {
-    const TextureKey *k = (const TextureKey *)key;
-    TextureBinding *v = generate_texture(k->state,
-                                         k->texture_data,
-                                         k->palette_data);
-    if (error != NULL) {
-        *error = NULL;
-    }
-    return v;
+    return memcmp(&a->state, &b->state, sizeof(TextureShape)) == 0
+            && a->data_hash == b->data_hash;
 }
-static void texture_key_destroy(gpointer data)
+static TextureBinding* texture_key_retrieve(const TextureKey *key, void *opaque)
 {
-    g_free(data);
+    return generate_texture((PGRAPHState *)opaque,
+                            key->state,
+                            key->texture_data,
+                            key->palette_data,
+                            key->palette_hash,
+                            key->level_hashes);
 }
-static void texture_binding_destroy(gpointer data)
+static void texture_binding_destroy(TextureBinding *binding)
 {
-    TextureBinding *binding = (TextureBinding *)data;
-
 	// assert(pg->opengl_enabled);
 
     assert(binding->refcnt > 0);
@@ -4763,7 +4847,7 @@ static void texture_binding_destroy(gpointer data)
 /* hash and equality for shader cache hash table */
 static guint shader_hash(gconstpointer key)
 {
-    return (guint)fnv_hash((const uint8_t *)key, sizeof(ShaderState));
+    return (guint)ComputeHash(key, sizeof(ShaderState));
 }
 static gboolean shader_equal(gconstpointer a, gconstpointer b)
 {
@@ -4841,54 +4925,3 @@ static unsigned int kelvin_map_texgen(uint32_t parameter, unsigned int channel)
 	}
 	return texgen;
 }
-
-static uint64_t fnv_hash(const uint8_t *data, size_t len)
-{
-    /* 64 bit Fowler/Noll/Vo FNV-1a hash code */
-    uint64_t hval = 0xcbf29ce484222325ULL;
-    const uint8_t *dp = data;
-    const uint8_t *de = data + len;
-    while (dp < de) {
-        hval ^= (uint64_t) *dp++;
-        hval += (hval << 1) + (hval << 4) + (hval << 5) +
-            (hval << 7) + (hval << 8) + (hval << 40);
-    }
-
-    return hval;
-}
-
-static uint64_t fast_hash(const uint8_t *data, size_t len, unsigned int samples)
-{
-#ifdef __SSE4_2__
-    uint64_t h[4] = {len, 0, 0, 0};
-    assert(samples > 0);
-
-    if (len < 8 || len % 8) {
-        return fnv_hash(data, len);
-    }
-
-    assert(len >= 8 && len % 8 == 0);
-    const uint64_t *dp = (const uint64_t*)data;
-    const uint64_t *de = dp + (len / 8);
-    size_t step = len / 8 / samples;
-    if (step == 0) step = 1;
-
-    while (dp < de - step * 3) {
-        h[0] = __builtin_ia32_crc32di(h[0], dp[step * 0]);
-        h[1] = __builtin_ia32_crc32di(h[1], dp[step * 1]);
-        h[2] = __builtin_ia32_crc32di(h[2], dp[step * 2]);
-        h[3] = __builtin_ia32_crc32di(h[3], dp[step * 3]);
-        dp += step * 4;
-    }
-    if (dp < de - step * 0)
-        h[0] = __builtin_ia32_crc32di(h[0], dp[step * 0]);
-    if (dp < de - step * 1)
-        h[1] = __builtin_ia32_crc32di(h[1], dp[step * 1]);
-    if (dp < de - step * 2)
-        h[2] = __builtin_ia32_crc32di(h[2], dp[step * 2]);
-
-    return h[0] + (h[1] << 10) + (h[2] << 21) + (h[3] << 32);
-#else
-    return fnv_hash(data, len);
-#endif
-}
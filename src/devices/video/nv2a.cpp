@@ -68,6 +68,10 @@ namespace xboxkrnl
 #include <gl\GL.h>
 #include <gl\GLU.h>
 #include <cassert>
+#include <algorithm> // For std::min, std::max
+#include <cfloat> // For DBL_MAX
+#include <chrono>
+#include <cmath> // For std::abs
 //#include <gl\glut.h>
 
 // glib types
@@ -91,6 +95,9 @@ struct _GError
 };
 
 #include "common\util\gloffscreen\glextensions.h" // for glextensions_init
+#include "common\util\hasher.h" // for ComputeHash
+#include "common\Timer.h" // for Timer_Create
+#include "nv2a_texture_cache.h" // for TextureCache
 
 GLuint create_gl_shader(GLenum gl_shader_type,
 	const char *code,
@@ -322,9 +329,13 @@ const NV2ABlockInfo* EmuNV2A_Block(xbaddr addr)
 }
 
 // HACK: Until we implement VGA/proper interrupt generation
-// we simulate VBLANK by calling the interrupt at 60Hz
-std::thread vblank_thread;
-extern std::chrono::time_point<std::chrono::steady_clock, std::chrono::duration<double, std::nano>> GetNextVBlankTime();
+// we simulate VBLANK by calling the interrupt at the refresh rate of the current AV mode
+extern std::chrono::duration<double, std::nano> GetVBlankPeriod();
+TimerObject* vblank_timer;
+
+// Uncomment to periodically log the jitter of the VBLANK period and the cpu usage of the thread raising it
+//#define DEBUG_NV2A_VBLANK
+#define VBLANK_STATS_FRAMES 600
 
 void _check_gl_reset()
 {
@@ -1101,25 +1112,76 @@ void NV2ADevice::UpdateHostDisplay(NV2AState *d)
 	UpdateFPSCounter();
 }
 
-// TODO: Fix this properly
-static void nv2a_vblank_thread(NV2AState *d)
+#ifdef DEBUG_NV2A_VBLANK
+// Accumulates how far each VBLANK period was from the nominal one, and logs it together with the
+// cpu time spent by the calling thread every VBLANK_STATS_FRAMES frames
+static void nv2a_vblank_stats()
 {
-	SetThreadAffinityMask(GetCurrentThread(), g_CPUOthers);
-	CxbxSetThreadName("Cxbx NV2A VBLANK");
-	auto nextVBlankTime = GetNextVBlankTime();
-
-	while (!d->exiting) {
-		// Handle VBlank
-		if (std::chrono::steady_clock::now() > nextVBlankTime) {
-			d->pcrtc.pending_interrupts |= NV_PCRTC_INTR_0_VBLANK;
-			update_irq(d);
-			nextVBlankTime = GetNextVBlankTime();
-
-			// TODO: We should swap here for the purposes of supporting overlays + direct framebuffer access
-			// But it causes crashes on AMD hardware for reasons currently unknown...
-			//NV2ADevice::UpdateHostDisplay(d);
+	static std::chrono::steady_clock::time_point lastVBlank, windowStart;
+	static uint64_t windowCpuTime;
+	static double minError, maxError, sumError;
+	static unsigned frames;
+
+	auto now = std::chrono::steady_clock::now();
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+	uint64_t cpuTime = ((uint64_t)kernelTime.dwHighDateTime << 32 | kernelTime.dwLowDateTime) +
+		((uint64_t)userTime.dwHighDateTime << 32 | userTime.dwLowDateTime); // in 100 ns units
+
+	if (frames == 0) {
+		if (lastVBlank.time_since_epoch().count() == 0) {
+			// First VBLANK ever, there is no period to measure yet
+			lastVBlank = now;
+			return;
 		}
+		windowStart = lastVBlank;
+		windowCpuTime = cpuTime;
+		minError = DBL_MAX;
+		maxError = -DBL_MAX;
+		sumError = 0;
+	}
+
+	double error = std::chrono::duration<double, std::micro>((now - lastVBlank) - GetVBlankPeriod()).count();
+	minError = std::min(minError, error);
+	maxError = std::max(maxError, error);
+	sumError += std::abs(error);
+	lastVBlank = now;
+
+	if (++frames == VBLANK_STATS_FRAMES) {
+		double wallTime = std::chrono::duration<double, std::micro>(now - windowStart).count();
+		EmuLog(LOG_LEVEL::INFO, "VBLANK: %u frames at %luHz, period error min %.1fus max %.1fus mean abs %.1fus, thread cpu usage %.2f%%",
+			frames, AvpGetRefreshRate(), minError, maxError, sumError / frames, (cpuTime - windowCpuTime) / 10.0 * 100.0 / wallTime);
+		frames = 0;
+	}
+}
+#endif
+
+static void nv2a_vblank(NV2AState *d)
+{
+#ifdef DEBUG_NV2A_VBLANK
+	nv2a_vblank_stats();
+#endif
+
+	d->pcrtc.pending_interrupts |= NV_PCRTC_INTR_0_VBLANK;
+	update_irq(d);
+
+	// TODO: We should swap here for the purposes of supporting overlays + direct framebuffer access
+	// But it causes crashes on AMD hardware for reasons currently unknown...
+	//NV2ADevice::UpdateHostDisplay(d);
+}
+
+static void nv2a_vblank_timer(void *opaque)
+{
+	NV2AState *d = (NV2AState *)opaque;
+
+	if (d->exiting) {
+		return;
 	}
+
+	nv2a_vblank(d);
+
+	// Follow refresh rate changes caused by AvSetDisplayMode; this takes effect from the next period
+	Timer_ChangeExpireTime(vblank_timer, (uint64_t)GetVBlankPeriod().count());
 }
 
 // See NV2ABlockInfo regions[] PRAMIN
@@ -1213,7 +1275,10 @@ void NV2ADevice::Init()
 	if (d->pgraph.opengl_enabled) {
 		pvideo_init(d);
 
-		vblank_thread = std::thread(nv2a_vblank_thread, d);
+		// The timer service keeps the deadlines absolute, so late wake ups don't accumulate into drift.
+		// Raising the interrupt doesn't need any Xbox thread state, so no affinity (and no InitXboxThread) is given
+		vblank_timer = Timer_Create(nv2a_vblank_timer, d, "Cxbx NV2A VBLANK", nullptr, true);
+		Timer_Start(vblank_timer, (uint64_t)GetVBlankPeriod().count());
 	}
 
     qemu_mutex_init(&d->pfifo.pfifo_lock);
@@ -1235,13 +1300,17 @@ void NV2ADevice::Reset()
 
 	d->exiting = true;
 
+	if (d->pgraph.opengl_enabled) {
+		// Waits for a VBLANK callback that is already running, so it can't touch the state torn down below
+		Timer_Exit(vblank_timer);
+	}
+
 	qemu_cond_broadcast(&d->pfifo.puller_cond);
 	qemu_cond_broadcast(&d->pfifo.pusher_cond);
 	d->pfifo.puller_thread.join();
 	d->pfifo.pusher_thread.join();
 	qemu_mutex_destroy(&d->pfifo.pfifo_lock); // Cbxbx addition
 	if (d->pgraph.opengl_enabled) {
-		vblank_thread.join();
 		pvideo_destroy(d);
 	}
 
@@ -208,19 +208,27 @@ typedef struct TextureShape {
 	unsigned int pitch;
 } TextureShape;
 
+#define NV2A_MAX_TEXTURE_LEVELS 16 // NV_PGRAPH_TEXFMT0_MIPMAP_LEVELS is 4 bits wide
+
 typedef struct TextureKey {
 	TextureShape state;
 	uint64_t data_hash;
+	uint64_t palette_hash;
 	uint8_t* texture_data;
 	uint8_t* palette_data;
+	uint64_t* level_hashes; // the per level hashes data_hash is folded from, only valid during the lookup
 } TextureKey;
 
 typedef struct TextureBinding {
 	GLenum gl_target;
 	GLuint gl_texture;
 	unsigned int refcnt;
+	size_t data_size; // bytes of texel data uploaded to OpenGL
 } TextureBinding;
 
+class TextureCache;
+class TexelStore;
+
 typedef struct KelvinState {
 	xbaddr object_instance;
 } KelvinState;
@@ -267,8 +275,9 @@ typedef struct PGRAPHState {
 
 	xbaddr dma_a, dma_b;
 #ifdef USE_TEXTURE_CACHE
-	GLruCache *texture_cache;
+	TextureCache *texture_cache;
 #endif
+	TexelStore *texel_store;
 	bool texture_dirty[NV2A_MAX_TEXTURES];
 	TextureBinding *texture_binding[NV2A_MAX_TEXTURES];
 
@@ -0,0 +1,237 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+
+#include <string.h> // For memcmp
+#include "nv2a_texture_cache.h"
+
+TextureCache::TextureCache(HashFunc hash, EqualFunc equal, RetrieveFunc retrieve, ReleaseFunc release, void *opaque, size_t budget)
+	: m_Retrieve(retrieve)
+	, m_Release(release)
+	, m_Opaque(opaque)
+	, m_Entries(64, KeyHash{ hash }, KeyEqual{ equal })
+	, m_Budget(budget)
+{
+}
+
+TextureCache::~TextureCache()
+{
+	Clear();
+}
+
+TextureBinding *TextureCache::Get(const TextureKey *key)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	auto it = m_Entries.find(*key);
+	if (it != m_Entries.end()) {
+		m_Stats.hits++;
+		// Make the entry the most recently used one
+		m_Lru.splice(m_Lru.begin(), m_Lru, it->second);
+		return it->second->binding;
+	}
+
+	m_Stats.misses++;
+
+	// The size of a texture is only known after it has been converted and uploaded,
+	// so generate it first (without blocking other lookups on the upload) and then make room for it
+	lock.unlock();
+	TextureBinding *binding = m_Retrieve(key, m_Opaque);
+	lock.lock();
+
+	// Another thread may have generated the same texture in the meantime; keep the cached one
+	it = m_Entries.find(*key);
+	if (it != m_Entries.end()) {
+		m_Lru.splice(m_Lru.begin(), m_Lru, it->second);
+		TextureBinding *cached = it->second->binding;
+		lock.unlock();
+		m_Release(binding);
+		return cached;
+	}
+
+	EvictLocked(binding->data_size);
+
+	m_Lru.push_front(Entry{ *key, binding });
+	m_Entries.emplace(*key, m_Lru.begin());
+	m_Stats.resident_bytes += binding->data_size;
+
+	return binding;
+}
+
+void TextureCache::EvictLocked(size_t incoming)
+{
+	// Drop the least recently used textures until the incoming one fits both the byte budget and
+	// the entry limit. Since every texture is charged its own size, a single large texture
+	// frees up as much room as many small ones would.
+	while (!m_Lru.empty()) {
+		if (m_Stats.resident_bytes + incoming <= m_Budget && m_Lru.size() < TEXTURE_CACHE_MAX_ENTRIES) {
+			break;
+		}
+
+		Entry &victim = m_Lru.back();
+		m_Stats.resident_bytes -= victim.binding->data_size;
+		m_Stats.evictions++;
+		m_Entries.erase(victim.key);
+		m_Release(victim.binding);
+		m_Lru.pop_back();
+	}
+}
+
+void TextureCache::SetBudget(size_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Budget = budget;
+}
+
+void TextureCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (auto &entry : m_Lru) {
+		m_Release(entry.binding);
+	}
+
+	m_Entries.clear();
+	m_Lru.clear();
+	m_Stats.resident_bytes = 0;
+}
+
+TextureCacheStats TextureCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	TextureCacheStats stats = m_Stats;
+	stats.budget_bytes = m_Budget;
+	stats.entries = m_Lru.size();
+	return stats;
+}
+
+size_t TexelStore::KeyHash::operator()(const TexelKey &key) const
+{
+	// data_hash is already well mixed; fold in the shape so equal content in different shapes spreads out
+	uint64_t shape = ((uint64_t)key.color_format << 56) ^ ((uint64_t)key.width << 32) ^ ((uint64_t)key.height << 16)
+		^ key.depth ^ ((uint64_t)key.row_pitch << 40) ^ key.slice_pitch;
+	return (size_t)(key.data_hash ^ (shape * 0x9E3779B97F4A7C15ULL));
+}
+
+bool TexelStore::KeyEqual::operator()(const TexelKey &a, const TexelKey &b) const
+{
+	return memcmp(&a, &b, sizeof(TexelKey)) == 0;
+}
+
+TexelStore::TexelStore(size_t budget)
+	: m_Budget(budget)
+{
+}
+
+TexelStore::~TexelStore()
+{
+	Clear();
+}
+
+const uint8_t *TexelStore::Find(const TexelKey *key, int *format)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	m_Stats.lookups++;
+
+	auto it = m_Entries.find(*key);
+	if (it == m_Entries.end()) {
+		return nullptr;
+	}
+
+	m_Stats.hits++;
+	m_Stats.reused_bytes += it->second->size;
+	m_Lru.splice(m_Lru.begin(), m_Lru, it->second);
+	*format = it->second->format;
+	return it->second->data;
+}
+
+const uint8_t *TexelStore::Insert(const TexelKey *key, uint8_t *data, size_t size, int format)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	m_Stats.converted_bytes += size;
+
+	// The previous oversized level has been uploaded by now
+	g_free(m_Transient);
+	m_Transient = nullptr;
+
+	// Levels larger than the whole budget are not worth keeping, only hold on to them until the next Insert
+	if (size > m_Budget) {
+		m_Transient = data;
+		return data;
+	}
+
+	EvictLocked(size);
+
+	m_Lru.push_front(Entry{ *key, data, size, format });
+	m_Entries.emplace(*key, m_Lru.begin());
+	m_Stats.resident_bytes += size;
+
+	return data;
+}
+
+void TexelStore::EvictLocked(size_t incoming)
+{
+	while (!m_Lru.empty() && m_Stats.resident_bytes + incoming > m_Budget) {
+		Entry &victim = m_Lru.back();
+		m_Stats.resident_bytes -= victim.size;
+		m_Stats.evictions++;
+		m_Entries.erase(victim.key);
+		g_free(victim.data);
+		m_Lru.pop_back();
+	}
+}
+
+void TexelStore::SetBudget(size_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Budget = budget;
+}
+
+void TexelStore::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (auto &entry : m_Lru) {
+		g_free(entry.data);
+	}
+
+	g_free(m_Transient);
+	m_Transient = nullptr;
+	m_Entries.clear();
+	m_Lru.clear();
+	m_Stats.resident_bytes = 0;
+}
+
+TexelStoreStats TexelStore::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	TexelStoreStats stats = m_Stats;
+	stats.budget_bytes = m_Budget;
+	stats.entries = m_Lru.size();
+	return stats;
+}
@@ -0,0 +1,166 @@
+// ******************************************************************
+// *
+// *  This file is part of the Cxbx project.
+// *
+// *  Cxbx and Cxbe are free software; you can redistribute them
+// *  and/or modify them under the terms of the GNU General Public
+// *  License as published by the Free Software Foundation; either
+// *  version 2 of the license, or (at your option) any later version.
+// *
+// *  This program is distributed in the hope that it will be useful,
+// *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+// *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// *  GNU General Public License for more details.
+// *
+// *  You should have recieved a copy of the GNU General Public License
+// *  along with this program; see the file COPYING.
+// *  If not, write to the Free Software Foundation, Inc.,
+// *  59 Temple Place - Suite 330, Bostom, MA 02111-1307, USA.
+// *
+// *  All rights reserved
+// *
+// ******************************************************************
+#ifndef NV2A_TEXTURE_CACHE_H
+#define NV2A_TEXTURE_CACHE_H
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "nv2a_int.h" // For TextureKey, TextureBinding
+
+// Default amount of texel bytes the texture cache may keep resident on the host gpu
+#define TEXTURE_CACHE_DEFAULT_BUDGET (256 * 1024 * 1024)
+// Upper bound on the amount of cached textures, regardless of their size
+#define TEXTURE_CACHE_MAX_ENTRIES 4096
+// Default amount of converted texel bytes kept in host memory by the texel store
+#define TEXEL_STORE_DEFAULT_BUDGET (128 * 1024 * 1024)
+
+typedef struct TextureCacheStats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t resident_bytes;
+	size_t budget_bytes;
+	size_t entries;
+} TextureCacheStats;
+
+// Byte-budgeted LRU cache of generated textures. Each binding is charged the size of the texel
+// data uploaded to OpenGL (the converted data, for formats needing conversion), so that a few
+// large render textures weigh as much as the many small textures they would otherwise push out.
+// Get() and eviction must happen on the thread owning the OpenGL context; the budget and the
+// statistics can be accessed from any thread, and aren't held up by a texture being generated.
+class TextureCache {
+public:
+	typedef size_t(*HashFunc)(const TextureKey *key);
+	typedef bool(*EqualFunc)(const TextureKey *a, const TextureKey *b);
+	typedef TextureBinding*(*RetrieveFunc)(const TextureKey *key, void *opaque);
+	typedef void(*ReleaseFunc)(TextureBinding *binding);
+
+	TextureCache(HashFunc hash, EqualFunc equal, RetrieveFunc retrieve, ReleaseFunc release, void *opaque, size_t budget);
+	~TextureCache();
+
+	// Returns the binding for key, generating it on a miss. The cache keeps its own reference
+	// to the binding; callers that hold on to it must increment its refcnt.
+	TextureBinding *Get(const TextureKey *key);
+	// Changes the byte budget. Shrinking takes effect on the next Get().
+	void SetBudget(size_t budget);
+	// Releases all cached bindings
+	void Clear();
+	TextureCacheStats GetStats();
+
+private:
+	struct KeyHash {
+		HashFunc func;
+		size_t operator()(const TextureKey &key) const { return func(&key); }
+	};
+	struct KeyEqual {
+		EqualFunc func;
+		bool operator()(const TextureKey &a, const TextureKey &b) const { return func(&a, &b); }
+	};
+	struct Entry {
+		TextureKey key;
+		TextureBinding *binding;
+	};
+	typedef std::list<Entry> LruList;
+	typedef std::unordered_map<TextureKey, LruList::iterator, KeyHash, KeyEqual> EntryMap;
+
+	void EvictLocked(size_t incoming);
+
+	RetrieveFunc m_Retrieve;
+	ReleaseFunc m_Release;
+	void *m_Opaque; // passed to m_Retrieve
+	std::mutex m_Mutex;
+	LruList m_Lru; // most recently used at the front
+	EntryMap m_Entries;
+	size_t m_Budget;
+	TextureCacheStats m_Stats = {};
+};
+
+// Identifies one unswizzled/converted texture level by its guest content and shape
+typedef struct TexelKey {
+	uint64_t data_hash; // hash of the guest texel data, combined with the palette hash
+	uint32_t color_format;
+	uint32_t width, height, depth;
+	uint32_t row_pitch, slice_pitch;
+} TexelKey;
+
+typedef struct TexelStoreStats {
+	uint64_t lookups;
+	uint64_t hits;
+	uint64_t evictions;
+	uint64_t converted_bytes; // bytes produced by converting guest data (misses)
+	uint64_t reused_bytes;    // bytes served from the store instead of converting again (hits)
+	size_t resident_bytes;
+	size_t budget_bytes;
+	size_t entries;
+} TexelStoreStats;
+
+// Content-addressed, byte-budgeted LRU store of converted texel data. Levels with identical
+// guest content, shape and format share one entry, regardless of the address they were
+// loaded at, so textures that are streamed into a different pool location (or are simply
+// duplicated) skip unswizzling, palette expansion and format conversion. Like TextureCache,
+// lookups and inserts must happen on the OpenGL thread; data returned by Find or Insert stays
+// valid until the next Insert. Evicting host copies doesn't affect textures already uploaded.
+class TexelStore {
+public:
+	explicit TexelStore(size_t budget);
+	~TexelStore();
+
+	// Returns the converted data for key (and its resulting color format), or nullptr
+	const uint8_t *Find(const TexelKey *key, int *format);
+	// Takes ownership of data (allocated with g_malloc) and returns it
+	const uint8_t *Insert(const TexelKey *key, uint8_t *data, size_t size, int format);
+	// Changes the byte budget. Shrinking takes effect on the next Insert().
+	void SetBudget(size_t budget);
+	void Clear();
+	TexelStoreStats GetStats();
+
+private:
+	struct KeyHash {
+		size_t operator()(const TexelKey &key) const;
+	};
+	struct KeyEqual {
+		bool operator()(const TexelKey &a, const TexelKey &b) const;
+	};
+	struct Entry {
+		TexelKey key;
+		uint8_t *data;
+		size_t size;
+		int format;
+	};
+	typedef std::list<Entry> LruList;
+	typedef std::unordered_map<TexelKey, LruList::iterator, KeyHash, KeyEqual> EntryMap;
+
+	void EvictLocked(size_t incoming);
+
+	std::mutex m_Mutex;
+	LruList m_Lru; // most recently used at the front
+	EntryMap m_Entries;
+	uint8_t *m_Transient = nullptr; // last inserted level that exceeded the budget
+	size_t m_Budget;
+	TexelStoreStats m_Stats = {};
+};
+
+#endif
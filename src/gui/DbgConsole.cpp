@@ -32,6 +32,16 @@
 #include "DbgConsole.h"
 #include "core\hle\D3D8\ResourceTracker.h"
 #include "core\kernel\support\EmuXTL.h"
+#include "devices\Xbox.h" // For g_NV2A
+#include "devices\video\nv2a_texture_cache.h" // For TextureCacheStats
+
+// prevent name collisions
+namespace xboxkrnl
+{
+	#include <xboxkrnl/xboxkrnl.h>
+};
+
+#include "core\kernel\exports\EmuKrnlKe.h" // For DpcQueueStats
 
 #include <conio.h>
 
@@ -189,6 +199,9 @@ void DbgConsole::ParseCommand()
 			printf("CxbxDbg:  DumpStreamCache [DSC]   : Dumps the patched streams cache\n");
 		}
 
+        printf("CxbxDbg:  TextureCache    [TC # #]: Show LLE texture cache statistics, optionally set budgets (MiB)\n");
+        printf("CxbxDbg:  DpcQueue        [DPC R] : Show DPC wait and run time histograms, optionally reset them\n");
+
         #ifdef _DEBUG_ALLOC
         printf("CxbxDbg:  DumpMem         [DMEM]  : Dump the heap allocation tracking table\n");
         #endif // _DEBUG_ALLOCC
@@ -271,6 +284,82 @@ void DbgConsole::ParseCommand()
 			}
 		}
     }
+    else if(_stricmp(szCmd, "tc") == 0 || _stricmp(szCmd, "TextureCache") == 0)
+    {
+        TexelStore *store = (g_NV2A != nullptr) ? g_NV2A->GetDeviceState()->pgraph.texel_store : nullptr;
+        if(store == nullptr)
+        {
+            printf("CxbxDbg: Texture cache is only available with LLE GPU\n");
+        }
+        else
+        {
+            unsigned int budget_mb = 0, store_budget_mb = 0;
+            int c = sscanf(m_szInput, "%*s %u %u", &budget_mb, &store_budget_mb);
+            if(c >= 2 && store_budget_mb > 0)
+            {
+                store->SetBudget((size_t)store_budget_mb * 1024 * 1024);
+            }
+
+#ifdef USE_TEXTURE_CACHE
+            TextureCache *cache = g_NV2A->GetDeviceState()->pgraph.texture_cache;
+            if(c >= 1 && budget_mb > 0)
+            {
+                cache->SetBudget((size_t)budget_mb * 1024 * 1024);
+            }
+
+            TextureCacheStats stats = cache->GetStats();
+            uint64_t lookups = stats.hits + stats.misses;
+            printf("CxbxDbg: Textures  : %u resident, %u of %u KiB\n", (unsigned int)stats.entries,
+                (unsigned int)(stats.resident_bytes / 1024), (unsigned int)(stats.budget_bytes / 1024));
+            printf("CxbxDbg: Lookups   : %llu (%.1f%% hits)\n", lookups,
+                lookups ? (100.0 * stats.hits) / lookups : 0.0);
+            printf("CxbxDbg: Evictions : %llu\n", stats.evictions);
+#else
+            printf("CxbxDbg: Textures  : cache compiled out (USE_TEXTURE_CACHE)\n");
+#endif
+
+            TexelStoreStats texels = store->GetStats();
+            printf("CxbxDbg: Texel store : %u levels, %u of %u KiB\n", (unsigned int)texels.entries,
+                (unsigned int)(texels.resident_bytes / 1024), (unsigned int)(texels.budget_bytes / 1024));
+            printf("CxbxDbg: Lookups     : %llu (%.1f%% hits), %llu evictions\n", texels.lookups,
+                texels.lookups ? (100.0 * texels.hits) / texels.lookups : 0.0, texels.evictions);
+            printf("CxbxDbg: Dedup ratio : %.2f (%llu KiB converted, %llu KiB reused)\n",
+                texels.converted_bytes ? (double)(texels.converted_bytes + texels.reused_bytes) / texels.converted_bytes : 1.0,
+                texels.converted_bytes / 1024, texels.reused_bytes / 1024);
+        }
+    }
+    else if(_stricmp(szCmd, "dpc") == 0 || _stricmp(szCmd, "DpcQueue") == 0)
+    {
+        DpcQueueStats stats = GetDpcQueueStats();
+        printf("CxbxDbg: DPCs executed : %llu\n", stats.executed);
+        if(stats.executed > 0)
+        {
+            printf("CxbxDbg: Wait (us)     : %llu average, %llu max\n", stats.total_wait_us / stats.executed, stats.max_wait_us);
+            printf("CxbxDbg: Run (us)      : %llu average, %llu max\n", stats.total_run_us / stats.executed, stats.max_run_us);
+            printf("CxbxDbg:   Duration (us)        Waited         Ran\n");
+            for(int b = 0; b < DPC_HISTOGRAM_BUCKETS; b++)
+            {
+                if(stats.wait_histogram[b] == 0 && stats.run_histogram[b] == 0)
+                    continue;
+
+                if(b == 0)
+                    printf("CxbxDbg:   < 1              ");
+                else if(b == DPC_HISTOGRAM_BUCKETS - 1)
+                    printf("CxbxDbg:   >= %-14u", 1u << (b - 1));
+                else
+                    printf("CxbxDbg:   %6u - %-8u", 1u << (b - 1), (1u << b) - 1);
+
+                printf("%10u  %10u\n", stats.wait_histogram[b], stats.run_histogram[b]);
+            }
+        }
+
+        char szArg[8] = "";
+        if(sscanf(m_szInput, "%*s %7s", szArg) == 1 && _stricmp(szArg, "r") == 0)
+        {
+            ResetDpcQueueStats();
+            printf("CxbxDbg: DPC statistics reset\n");
+        }
+    }
     #ifdef _DEBUG_ALLOC
     else if(_stricmp(szCmd, "dmem") == 0 || _stricmp(szCmd, "DumpMem") == 0)
     {